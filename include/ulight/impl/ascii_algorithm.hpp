@@ -29,7 +29,6 @@ find_if(std::u8string_view str, std::size_t start, F predicate, bool expected, s
 /// @brief Returns the position of the first code unit `c` in `str` for which
 /// `predicate(c)` is `true`, in code units.
 /// If none could be found, returns `std::u8string_view::npos`.
-/// @throws Unicode_Error If decoding failed.
 template <typename F>
     requires std::is_invocable_r_v<bool, F, char8_t>
 [[nodiscard]]
@@ -41,7 +40,6 @@ constexpr std::size_t find_if(std::u8string_view str, F predicate, std::size_t s
 /// @brief Returns the position of the first code unit `c` in `str` for which
 /// `predicate(c)` is `false`, in code units.
 /// If none could be found, returns `std::u8string_view::npos`.
-/// @throws Unicode_Error If decoding failed.
 template <typename F>
     requires std::is_invocable_r_v<bool, F, char8_t>
 [[nodiscard]]
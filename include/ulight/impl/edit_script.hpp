@@ -0,0 +1,328 @@
+#ifndef ULIGHT_EDIT_SCRIPT_HPP
+#define ULIGHT_EDIT_SCRIPT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "ulight/impl/fallible_vector.hpp"
+
+namespace ulight {
+
+enum struct Edit_Type : signed char {
+    /// @brief Delete an element in the source sequence.
+    /// Advance by one element in the source sequence.
+    del = -1,
+    /// @brief Keep the element in the source sequence.
+    /// Advance by one element in both sequences.
+    common = 0,
+    /// @brief Insert the element from the target sequence into the source sequence.
+    /// Advance by one element in the target sequence.
+    ins = 1,
+};
+
+namespace detail {
+
+/// @brief Resizes `v` to `size`, filling any new elements with `value`.
+/// @returns `false` if allocation failed.
+/// Standard containers report failure by throwing instead, so for them, this is always `true`.
+template <typename Vector>
+[[nodiscard]]
+bool try_resize(Vector& v, std::size_t size, const typename Vector::value_type& value = {})
+{
+    if constexpr (std::is_same_v<decltype(v.resize(size, value)), bool>) {
+        return v.resize(size, value);
+    }
+    else {
+        v.resize(size, value);
+        return true;
+    }
+}
+
+} // namespace detail
+
+/// @brief Computes shortest edit scripts using
+/// [Myers' algorithm](http://www.xmailserver.org/diff2.pdf) with its linear-space refinement.
+///
+/// The time taken is O((N + M) * D), where N and M are the lengths of the sequences
+/// and D is the length of the edit script,
+/// which is fast for similar sequences, such as expected and actual test outputs.
+/// Only O(N + M) memory is needed.
+///
+/// If the edit script would be longer than a given limit,
+/// the search is abandoned early, bounding the time taken by O((N + M) * limit).
+///
+/// The output is a `std::vector<Edit_Type>` or a `Fallible_Vector<Edit_Type>`,
+/// and the search vectors are allocated from a given memory resource,
+/// so that allocation failure abandons the search instead of throwing.
+template <typename T, typename Edits = std::vector<Edit_Type>>
+struct Myers_Diff {
+private:
+    std::span<const T> m_from;
+    std::span<const T> m_to;
+    Edits& m_out;
+    /// @brief The maximum `d` that the forward and backward searches may reach.
+    std::size_t m_max_search_d;
+    bool m_exceeded = false;
+    bool m_out_of_memory = false;
+    /// @brief For every diagonal `k`, the furthest `x` reached by the forward search,
+    /// where `k` is offset by the maximum `d` of the search.
+    Fallible_Vector<std::ptrdiff_t> m_forward;
+    /// @brief Like `m_forward`, but for the backward search,
+    /// where `x` is the distance from the end of the `from` sequence.
+    Fallible_Vector<std::ptrdiff_t> m_backward;
+
+public:
+    [[nodiscard]]
+    Myers_Diff(
+        Edits& out,
+        std::span<const T> from,
+        std::span<const T> to,
+        std::size_t max_edits = std::size_t(-1),
+        std::pmr::memory_resource* memory = std::pmr::get_default_resource()
+    )
+        : m_from { from }
+        , m_to { to }
+        , m_out { out }
+        // The searches meet halfway, so a script of length D is found when either reaches D / 2.
+        , m_max_search_d { max_edits == std::size_t(-1) ? max_edits : (max_edits / 2) + 1 }
+        , m_forward { memory }
+        , m_backward { memory }
+    {
+    }
+
+    /// @brief Appends the edit script to the output.
+    /// @returns `false` if the search was abandoned because the script would exceed the limit
+    /// or because allocation failed,
+    /// in which case the output contains an incomplete script.
+    [[nodiscard]]
+    bool operator()()
+    {
+        // The search vectors are sized for the whole sequences once,
+        // and reused for all subproblems.
+        const std::size_t max_d = (m_from.size() + m_to.size() + 1) / 2;
+        if (!m_forward.resize((2 * max_d) + 2) || !m_backward.resize((2 * max_d) + 2)) {
+            return false;
+        }
+        diff(0, m_from.size(), 0, m_to.size());
+        return !m_exceeded && !m_out_of_memory;
+    }
+
+private:
+    void append(Edit_Type type, std::size_t count)
+    {
+        if (!detail::try_resize(m_out, m_out.size() + count, type)) {
+            m_out_of_memory = true;
+        }
+    }
+
+    /// @brief Appends the edit script for `from[x_begin, x_end)` and `to[y_begin, y_end)`.
+    void diff(std::size_t x_begin, std::size_t x_end, std::size_t y_begin, std::size_t y_end)
+    {
+        if (m_exceeded || m_out_of_memory) {
+            return;
+        }
+        // Common prefixes and suffixes are trivially part of the script,
+        // and trimming them makes the search much cheaper for the typical case
+        // of a few changes in long sequences.
+        std::size_t prefix = 0;
+        while (x_begin + prefix < x_end && y_begin + prefix < y_end
+               && m_from[x_begin + prefix] == m_to[y_begin + prefix]) {
+            ++prefix;
+        }
+        append(Edit_Type::common, prefix);
+        x_begin += prefix;
+        y_begin += prefix;
+
+        std::size_t suffix = 0;
+        while (x_begin < x_end - suffix && y_begin < y_end - suffix
+               && m_from[x_end - suffix - 1] == m_to[y_end - suffix - 1]) {
+            ++suffix;
+        }
+        x_end -= suffix;
+        y_end -= suffix;
+
+        if (x_begin == x_end || y_begin == y_end) {
+            append(Edit_Type::del, x_end - x_begin);
+            append(Edit_Type::ins, y_end - y_begin);
+        }
+        else if (const auto [x_mid, y_mid] = find_middle(x_begin, x_end, y_begin, y_end);
+                 (x_mid != x_begin || y_mid != y_begin) && (x_mid != x_end || y_mid != y_end)) {
+            diff(x_begin, x_mid, y_begin, y_mid);
+            diff(x_mid, x_end, y_mid, y_end);
+        }
+        else {
+            // There is nothing in common between the sequences.
+            append(Edit_Type::del, x_end - x_begin);
+            append(Edit_Type::ins, y_end - y_begin);
+        }
+
+        append(Edit_Type::common, suffix);
+    }
+
+    struct Point {
+        std::size_t x;
+        std::size_t y;
+    };
+
+    /// @brief Searches forward from the start and backward from the end simultaneously
+    /// until the paths overlap, and returns a point on the shortest path where they meet.
+    /// Diffing the subsequences before and after that point yields the overall script.
+    /// If the sequences have nothing in common, returns the start.
+    [[nodiscard]]
+    Point find_middle(
+        std::size_t x_begin,
+        std::size_t x_end,
+        std::size_t y_begin,
+        std::size_t y_end
+    )
+    {
+        const auto n = std::ptrdiff_t(x_end - x_begin);
+        const auto m = std::ptrdiff_t(y_end - y_begin);
+        const std::ptrdiff_t max_d = (n + m + 1) / 2;
+        const std::ptrdiff_t offset = max_d;
+        const auto vector_size = std::size_t((2 * max_d) + 2);
+        std::fill_n(m_forward.begin(), vector_size, -1);
+        std::fill_n(m_backward.begin(), vector_size, -1);
+        m_forward[std::size_t(offset + 1)] = 0;
+        m_backward[std::size_t(offset + 1)] = 0;
+
+        const auto from_at = [&](std::ptrdiff_t x) -> const T& {
+            return m_from[x_begin + std::size_t(x)];
+        };
+        const auto to_at = [&](std::ptrdiff_t y) -> const T& {
+            return m_to[y_begin + std::size_t(y)];
+        };
+
+        const std::ptrdiff_t delta = n - m;
+        // If the difference in length is odd, the paths can only overlap in the forward search,
+        // otherwise only in the backward search.
+        const bool front = delta % 2 != 0;
+        // Diagonals which have run off the edges of the grid are no longer searched.
+        std::ptrdiff_t k1_start = 0;
+        std::ptrdiff_t k1_end = 0;
+        std::ptrdiff_t k2_start = 0;
+        std::ptrdiff_t k2_end = 0;
+
+        for (std::ptrdiff_t d = 0; d < max_d; ++d) {
+            if (std::size_t(d) > m_max_search_d) {
+                m_exceeded = true;
+                return { x_begin, y_begin };
+            }
+            for (std::ptrdiff_t k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2) {
+                const std::ptrdiff_t k1_offset = offset + k1;
+                std::ptrdiff_t x1 = k1 == -d
+                        || (k1 != d && m_forward[std::size_t(k1_offset - 1)]
+                                < m_forward[std::size_t(k1_offset + 1)])
+                    ? m_forward[std::size_t(k1_offset + 1)]
+                    : m_forward[std::size_t(k1_offset - 1)] + 1;
+                std::ptrdiff_t y1 = x1 - k1;
+                while (x1 < n && y1 < m && from_at(x1) == to_at(y1)) {
+                    ++x1;
+                    ++y1;
+                }
+                m_forward[std::size_t(k1_offset)] = x1;
+                if (x1 > n) {
+                    k1_end += 2;
+                }
+                else if (y1 > m) {
+                    k1_start += 2;
+                }
+                else if (front) {
+                    const std::ptrdiff_t k2_offset = offset + delta - k1;
+                    if (k2_offset >= 0 && k2_offset < std::ptrdiff_t(vector_size)
+                        && m_backward[std::size_t(k2_offset)] != -1
+                        && x1 >= n - m_backward[std::size_t(k2_offset)]) {
+                        return { x_begin + std::size_t(x1), y_begin + std::size_t(y1) };
+                    }
+                }
+            }
+
+            for (std::ptrdiff_t k2 = -d + k2_start; k2 <= d - k2_end; k2 += 2) {
+                const std::ptrdiff_t k2_offset = offset + k2;
+                std::ptrdiff_t x2 = k2 == -d
+                        || (k2 != d && m_backward[std::size_t(k2_offset - 1)]
+                                < m_backward[std::size_t(k2_offset + 1)])
+                    ? m_backward[std::size_t(k2_offset + 1)]
+                    : m_backward[std::size_t(k2_offset - 1)] + 1;
+                std::ptrdiff_t y2 = x2 - k2;
+                while (x2 < n && y2 < m && from_at(n - x2 - 1) == to_at(m - y2 - 1)) {
+                    ++x2;
+                    ++y2;
+                }
+                m_backward[std::size_t(k2_offset)] = x2;
+                if (x2 > n) {
+                    k2_end += 2;
+                }
+                else if (y2 > m) {
+                    k2_start += 2;
+                }
+                else if (!front) {
+                    const std::ptrdiff_t k1_offset = offset + delta - k2;
+                    if (k1_offset >= 0 && k1_offset < std::ptrdiff_t(vector_size)
+                        && m_forward[std::size_t(k1_offset)] != -1) {
+                        const std::ptrdiff_t x1 = m_forward[std::size_t(k1_offset)];
+                        const std::ptrdiff_t y1 = offset + x1 - k1_offset;
+                        if (x1 >= n - x2) {
+                            return { x_begin + std::size_t(x1), y_begin + std::size_t(y1) };
+                        }
+                    }
+                }
+            }
+        }
+
+        return { x_begin, y_begin };
+    }
+};
+
+/// @brief Computes the Shortest Edit Script to convert sequence `from` into sequence `to`
+/// and appends it to `out`.
+/// Within each run of changes, all deletions precede all insertions.
+/// @param max_edits The maximum number of deletions and insertions in the script.
+/// This also limits the time taken to O((N + M) * max_edits).
+/// @param memory The memory resource from which temporary storage for the search is allocated.
+/// @returns `true` if a script with at most `max_edits` deletions and insertions was found.
+/// Otherwise, including when allocation failed, `out` is left unchanged.
+template <typename T, typename Edits = std::vector<Edit_Type>>
+bool shortest_edit_script(
+    Edits& out,
+    std::span<const T> from,
+    std::span<const T> to,
+    std::size_t max_edits = std::size_t(-1),
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource()
+)
+{
+    const std::size_t initial_size = out.size();
+    const bool found = Myers_Diff<T, Edits> { out, from, to, max_edits, memory }();
+    const auto edits = std::ranges::count_if(
+        out.begin() + std::ptrdiff_t(initial_size), out.end(),
+        [](Edit_Type t) { return t != Edit_Type::common; }
+    );
+    if (!found || std::size_t(edits) > max_edits) {
+        // Shrinking never allocates, so it cannot fail.
+        [[maybe_unused]] const bool shrunk = detail::try_resize(out, initial_size);
+        return false;
+    }
+
+    auto it = out.begin() + std::ptrdiff_t(initial_size);
+    while (it != out.end()) {
+        // Find the next block of insertions/deletions.
+        const auto next_mod_begin = std::ranges::find_if(it, out.end(), [](Edit_Type t) {
+            return t != Edit_Type::common;
+        });
+        const auto next_mod_end = std::ranges::find(next_mod_begin, out.end(), Edit_Type::common);
+        // Partition the block so that deletions all precede insertions.
+        std::ranges::partition(next_mod_begin, next_mod_end, [](Edit_Type t) {
+            return t == Edit_Type::del;
+        });
+        it = next_mod_end;
+    }
+    return true;
+}
+
+} // namespace ulight
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef ULIGHT_FALLIBLE_VECTOR_HPP
+#define ULIGHT_FALLIBLE_VECTOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
+
+#include "ulight/impl/assert.hpp"
+#include "ulight/impl/memory.hpp"
+
+namespace ulight {
+
+/// @brief A growable array of trivially copyable elements,
+/// whose storage is obtained from a `std::pmr::memory_resource`.
+/// Unlike `std::pmr::vector`, the member functions which allocate
+/// return `false` on failure instead of throwing `std::bad_alloc`,
+/// so that highlighters can handle allocation failure in builds without exceptions.
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+struct Fallible_Vector {
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+private:
+    std::pmr::memory_resource* m_memory;
+    T* m_data = nullptr;
+    std::size_t m_size = 0;
+    std::size_t m_capacity = 0;
+
+public:
+    [[nodiscard]]
+    explicit Fallible_Vector(std::pmr::memory_resource* memory) noexcept
+        : m_memory { memory }
+    {
+        ULIGHT_ASSERT(m_memory != nullptr);
+    }
+
+    Fallible_Vector(const Fallible_Vector&) = delete;
+    Fallible_Vector& operator=(const Fallible_Vector&) = delete;
+
+    ~Fallible_Vector()
+    {
+        if (m_data) {
+            m_memory->deallocate(m_data, m_capacity * sizeof(T), alignof(T));
+        }
+    }
+
+    [[nodiscard]]
+    std::size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    [[nodiscard]]
+    std::size_t capacity() const noexcept
+    {
+        return m_capacity;
+    }
+
+    [[nodiscard]]
+    bool empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    [[nodiscard]]
+    T* data() noexcept
+    {
+        return m_data;
+    }
+
+    [[nodiscard]]
+    const T* data() const noexcept
+    {
+        return m_data;
+    }
+
+    [[nodiscard]]
+    iterator begin() noexcept
+    {
+        return m_data;
+    }
+
+    [[nodiscard]]
+    const_iterator begin() const noexcept
+    {
+        return m_data;
+    }
+
+    [[nodiscard]]
+    iterator end() noexcept
+    {
+        return m_data + m_size;
+    }
+
+    [[nodiscard]]
+    const_iterator end() const noexcept
+    {
+        return m_data + m_size;
+    }
+
+    [[nodiscard]]
+    T& operator[](std::size_t i) noexcept
+    {
+        ULIGHT_DEBUG_ASSERT(i < m_size);
+        return m_data[i];
+    }
+
+    [[nodiscard]]
+    const T& operator[](std::size_t i) const noexcept
+    {
+        ULIGHT_DEBUG_ASSERT(i < m_size);
+        return m_data[i];
+    }
+
+    /// @brief Sets the size to zero, keeping the storage for reuse.
+    void clear() noexcept
+    {
+        m_size = 0;
+    }
+
+    /// @brief Ensures that the capacity is at least `capacity`.
+    /// @returns `false` if allocation failed, in which case the vector is left unchanged.
+    [[nodiscard]]
+    bool reserve(std::size_t capacity) noexcept
+    {
+        if (capacity <= m_capacity) {
+            return true;
+        }
+        if (capacity > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+            return false;
+        }
+        auto* const data
+            = static_cast<T*>(try_allocate(m_memory, capacity * sizeof(T), alignof(T)));
+        if (!data) {
+            return false;
+        }
+        if (m_data) {
+            std::uninitialized_copy_n(m_data, m_size, data);
+            m_memory->deallocate(m_data, m_capacity * sizeof(T), alignof(T));
+        }
+        m_data = data;
+        m_capacity = capacity;
+        return true;
+    }
+
+    /// @brief Changes the size to `size`, filling any new elements with `value`.
+    /// @returns `false` if allocation failed, in which case the vector is left unchanged.
+    [[nodiscard]]
+    bool resize(std::size_t size, const T& value = T {}) noexcept
+    {
+        if (size > m_size) {
+            if (!grow(size)) {
+                return false;
+            }
+            std::uninitialized_fill(m_data + m_size, m_data + size, value);
+        }
+        m_size = size;
+        return true;
+    }
+
+    /// @returns `false` if allocation failed, in which case the vector is left unchanged.
+    [[nodiscard]]
+    bool push_back(const T& e) noexcept
+    {
+        if (!grow(m_size + 1)) {
+            return false;
+        }
+        std::construct_at(m_data + m_size, e);
+        ++m_size;
+        return true;
+    }
+
+    /// @brief Appends all of `elements`, which must not be part of this vector.
+    /// @returns `false` if allocation failed, in which case the vector is left unchanged.
+    [[nodiscard]]
+    bool append(std::span<const T> elements) noexcept
+    {
+        if (!grow(m_size + elements.size())) {
+            return false;
+        }
+        std::uninitialized_copy(elements.begin(), elements.end(), m_data + m_size);
+        m_size += elements.size();
+        return true;
+    }
+
+private:
+    /// @brief Ensures that the capacity is at least `size`,
+    /// growing geometrically so that repeated appending takes amortized constant time.
+    [[nodiscard]]
+    bool grow(std::size_t size) noexcept
+    {
+        if (size <= m_capacity) {
+            return true;
+        }
+        if (size < m_size) {
+            // Computing the size has overflowed.
+            return false;
+        }
+        return reserve(std::max({ size, m_capacity * 2, std::size_t { 16 } }));
+    }
+};
+
+} // namespace ulight
+
+#endif
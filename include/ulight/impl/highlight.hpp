@@ -1,6 +1,9 @@
 #ifndef ULIGHT_HIGHLIGHT_TOKEN_HPP
 #define ULIGHT_HIGHLIGHT_TOKEN_HPP
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <memory_resource>
 #include <string_view>
 
@@ -10,6 +13,46 @@
 
 namespace ulight {
 
+/// @brief Decides whether highlighting should stop early,
+/// based on a user-provided callback, a flag set by another thread, and a deadline.
+/// Polling is cheap enough to be done once per iteration of the main loop of a highlighter
+/// because these are only checked every `interval` polls.
+/// Once cancelled, polling keeps returning `true`,
+/// so that nested and enclosing highlighters stop as well.
+struct Cancellation {
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief The number of polls per check.
+    static constexpr unsigned interval = 256;
+
+    const void* data = nullptr;
+    int (*is_cancelled)(const void*) = nullptr;
+    int* flag = nullptr;
+    Clock::time_point deadline = Clock::time_point::max();
+    unsigned countdown = interval;
+    bool cancelled = false;
+
+    /// @brief Returns `true` if highlighting has been cancelled.
+    [[nodiscard]]
+    bool poll() noexcept
+    {
+        if (!cancelled && --countdown == 0) {
+            countdown = interval;
+            cancelled = check();
+        }
+        return cancelled;
+    }
+
+private:
+    [[nodiscard]]
+    bool check() const noexcept
+    {
+        return (flag && std::atomic_ref<int>(*flag).load(std::memory_order::relaxed) != 0)
+            || (is_cancelled && is_cancelled(data) != 0)
+            || (deadline != Clock::time_point::max() && Clock::now() >= deadline);
+    }
+};
+
 struct Highlight_Options {
     /// @brief If `true`,
     /// adjacent spans with the same `Highlight_Type` get merged into one.
@@ -20,8 +63,27 @@ struct Highlight_Options {
     ///
     /// For example, if `false`, C++ highlighting also includes all C keywords.
     bool strict = false;
+    /// @brief If `true`, diffs mark changed words within paired deletions and insertions.
+    bool diff_words = false;
+    /// @brief If `true`, hunks in unified diffs are highlighted in the language of the file.
+    bool diff_lang = false;
+    /// @brief If not null, statistics such as nested language invocations are recorded here.
+    ulight_stats* stats = nullptr;
+    /// @brief The depth of language nesting,
+    /// where `0` is the top-level language.
+    std::size_t nesting_depth = 0;
+    /// @brief If not null, highlighters poll this regularly, and stop early once it is cancelled.
+    /// It is shared by nested highlighters.
+    Cancellation* cancellation = nullptr;
 };
 
+/// @brief Returns `true` if highlighting with the given `options` should stop early.
+[[nodiscard]]
+inline bool is_cancelled(const Highlight_Options& options) noexcept
+{
+    return options.cancellation && options.cancellation->poll();
+}
+
 bool highlight_cowel(
     Non_Owning_Buffer<Token>& out,
     std::u8string_view source,
@@ -125,6 +187,31 @@ bool highlight_nasm(
     const Highlight_Options& options = {}
 );
 
+/// @brief A bit mask of the languages whose highlighters are built into the library,
+/// where bit `n` stands for the `Lang` with numeric value `n`.
+/// By default, every language is built.
+/// When building for the web, this can be defined to a smaller set
+/// (see `ULIGHT_WASM_SPLIT` in `CMakeLists.txt`),
+/// so that a module only contains the code for the languages that a page actually uses.
+#ifndef ULIGHT_ENABLED_LANGS
+#define ULIGHT_ENABLED_LANGS (~0ull)
+#endif
+
+/// @brief Returns `true` iff the highlighter for `lang` is built into the library,
+/// according to `ULIGHT_ENABLED_LANGS`.
+/// `highlight` treats other languages like invalid languages.
+[[nodiscard]]
+constexpr bool is_lang_enabled(Lang lang) noexcept
+{
+    return lang != Lang::none && ((ULIGHT_ENABLED_LANGS >> Underlying(lang)) & 1) != 0;
+}
+
+static_assert(
+    !is_lang_enabled(Lang::html)
+        || (is_lang_enabled(Lang::css) && is_lang_enabled(Lang::javascript)),
+    "HTML highlighting requires CSS and JavaScript highlighting for <style> and <script>."
+);
+
 inline Status highlight(
     Non_Owning_Buffer<Token>& out,
     std::u8string_view source,
@@ -140,42 +227,36 @@ inline Status highlight(
         return Status::bad_code;
     };
 
+    // The highlighters of disabled languages are in discarded statements,
+    // so they are not referenced, and their definitions need not be linked.
+#define ULIGHT_HIGHLIGHT_CASE(lang, function)                                                      \
+    case Lang::lang:                                                                               \
+        if constexpr (is_lang_enabled(Lang::lang)) {                                               \
+            return to_result(function(out, source, memory, options));                              \
+        }                                                                                          \
+        break
+
     switch (language) {
-    case Lang::cpp: //
-        return to_result(highlight_cpp(out, source, memory, options));
-    case Lang::cowel: //
-        return to_result(highlight_cowel(out, source, memory, options));
-    case Lang::lua: //
-        return to_result(highlight_lua(out, source, memory, options));
-    case Lang::html: //
-        return to_result(highlight_html(out, source, memory, options));
-    case Lang::xml: //
-        return to_result(highlight_xml(out, source, memory, options));
-    case Lang::css: //
-        return to_result(highlight_css(out, source, memory, options));
-    case Lang::c: //
-        return to_result(highlight_c(out, source, memory, options));
-    case Lang::javascript: //
-        return to_result(highlight_javascript(out, source, memory, options));
-    case Lang::bash: //
-        return to_result(highlight_bash(out, source, memory, options));
-    case Lang::diff: //
-        return to_result(highlight_diff(out, source, memory, options));
-    case Lang::json: //
-        return to_result(highlight_json(out, source, memory, options));
-    case Lang::jsonc: //
-        return to_result(highlight_jsonc(out, source, memory, options));
-    case Lang::txt: //
-        return to_result(highlight_txt(out, source, memory, options));
-    case Lang::tex: //
-        return to_result(highlight_tex(out, source, memory, options));
-    case Lang::latex: //
-        return to_result(highlight_latex(out, source, memory, options));
-    case Lang::nasm: //
-        return to_result(highlight_nasm(out, source, memory, options));
-    default: //
-        return Status::bad_lang;
+        ULIGHT_HIGHLIGHT_CASE(cpp, highlight_cpp);
+        ULIGHT_HIGHLIGHT_CASE(cowel, highlight_cowel);
+        ULIGHT_HIGHLIGHT_CASE(lua, highlight_lua);
+        ULIGHT_HIGHLIGHT_CASE(html, highlight_html);
+        ULIGHT_HIGHLIGHT_CASE(xml, highlight_xml);
+        ULIGHT_HIGHLIGHT_CASE(css, highlight_css);
+        ULIGHT_HIGHLIGHT_CASE(c, highlight_c);
+        ULIGHT_HIGHLIGHT_CASE(javascript, highlight_javascript);
+        ULIGHT_HIGHLIGHT_CASE(bash, highlight_bash);
+        ULIGHT_HIGHLIGHT_CASE(diff, highlight_diff);
+        ULIGHT_HIGHLIGHT_CASE(json, highlight_json);
+        ULIGHT_HIGHLIGHT_CASE(jsonc, highlight_jsonc);
+        ULIGHT_HIGHLIGHT_CASE(txt, highlight_txt);
+        ULIGHT_HIGHLIGHT_CASE(tex, highlight_tex);
+        ULIGHT_HIGHLIGHT_CASE(latex, highlight_latex);
+        ULIGHT_HIGHLIGHT_CASE(nasm, highlight_nasm);
+    default: break;
     }
+#undef ULIGHT_HIGHLIGHT_CASE
+    return Status::bad_lang;
 }
 
 } // namespace ulight
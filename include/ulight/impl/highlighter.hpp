@@ -1,12 +1,14 @@
 #ifndef ULIGHT_HIGHLIGHTER_HPP
 #define ULIGHT_HIGHLIGHTER_HPP
 
+#include <algorithm>
 #include <cstddef>
 #include <string_view>
 
 #include "ulight/impl/assert.hpp"
 #include "ulight/impl/buffer.hpp"
 #include "ulight/impl/highlight.hpp"
+#include "ulight/impl/trace.hpp"
 
 namespace ulight {
 
@@ -64,6 +66,15 @@ protected:
         return remainder.empty();
     }
 
+    /// @brief Equivalent to `is_cancelled(options)`.
+    /// Highlighters call this once per iteration of their main loops,
+    /// and stop early if it returns `true`.
+    [[nodiscard]]
+    bool cancelled() const
+    {
+        return is_cancelled(options);
+    }
+
     /// @brief Emits a single token into the output buffer,
     /// or coalesces it into the most recent token.
     /// @param begin The start index within the source file of the token.
@@ -130,10 +141,16 @@ protected:
         if (length == 0) {
             return Status::ok;
         }
-        Non_Owning_Buffer<Token> sub = sub_buffer(nested_tokens);
-        const std::u8string_view nested_source = remainder.substr(0, length);
+        return ULIGHT_TRACE_RULE(consume_nested_language_nonempty(lang, length, nested_tokens));
+    }
 
-        const Status result = highlight(sub, nested_source, lang, memory, options);
+    /// @brief Like `consume_nested_language`, but for `length != 0`.
+    [[nodiscard]]
+    Status
+    consume_nested_language_nonempty(Lang lang, std::size_t length, std::span<Token> nested_tokens)
+    {
+        Non_Owning_Buffer<Token> sub = sub_buffer(nested_tokens);
+        const Status result = highlight_nested(sub, remainder.substr(0, length), lang);
         if (result != Status::ok) {
             return result;
         }
@@ -142,6 +159,31 @@ protected:
         return Status::ok;
     }
 
+    /// @brief Highlights `source` in a language of choice,
+    /// one level of nesting deeper than this highlighter.
+    /// Unlike `consume_nested_language`, `source` need not be part of the source file,
+    /// and the resulting tokens are relative to the start of `source`.
+    /// @param nested_out The buffer which receives the nested tokens.
+    /// @param source The code to highlight.
+    /// @param lang The nested language to highlight.
+    /// @returns The status resulting from nested highlighting.
+    [[nodiscard]]
+    Status highlight_nested(
+        Non_Owning_Buffer<Token>& nested_out,
+        std::u8string_view source,
+        Lang lang
+    )
+    {
+        Highlight_Options nested_options = options;
+        ++nested_options.nesting_depth;
+        if (options.stats) {
+            ++options.stats->nested_invocations;
+            options.stats->max_nesting_depth
+                = std::max(options.stats->max_nesting_depth, nested_options.nesting_depth);
+        }
+        return ULIGHT_TRACE_RULE(highlight(nested_out, source, lang, memory, nested_options));
+    }
+
     /// @brief Creates a sub-buffer from `out`.
     /// Upon flushing that buffer,
     /// the start positions of the tokens are offset by `self.index`.
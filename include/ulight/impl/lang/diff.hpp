@@ -1,6 +1,7 @@
 #ifndef ULIGHT_DIFF_HPP
 #define ULIGHT_DIFF_HPP
 
+#include <cstddef>
 #include <string_view>
 
 #include "ulight/ulight.hpp"
@@ -10,6 +11,12 @@ namespace ulight::diff {
 [[nodiscard]]
 Highlight_Type choose_line_highlight(std::u8string_view line);
 
+/// @brief Returns the length of the word at the start of `str`, which must not be empty.
+/// A word is a run of letters, digits, underscores, and non-ASCII characters,
+/// a run of spaces and tabs, or any other single character.
+[[nodiscard]]
+std::size_t match_word(std::u8string_view str);
+
 }
 
 #endif
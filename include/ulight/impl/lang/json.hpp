@@ -111,6 +111,11 @@ struct Number_Result {
 [[nodiscard]]
 Number_Result match_number(std::u8string_view str);
 
+enum struct String_Type : bool {
+    value,
+    property,
+};
+
 } // namespace ulight::json
 
 #endif
@@ -0,0 +1,175 @@
+#ifndef ULIGHT_JSON_NUMBER_HPP
+#define ULIGHT_JSON_NUMBER_HPP
+
+#include <bit>
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+#include "ulight/impl/assert.hpp"
+
+#include "ulight/impl/lang/json.hpp"
+
+namespace ulight::json {
+
+/// @brief Loads eight code units starting at `data` into an integer,
+/// where the first code unit is in the least significant byte.
+[[nodiscard]]
+inline std::uint64_t load_eight_chars(const char8_t* data) noexcept
+{
+    std::uint64_t result;
+    std::memcpy(&result, data, sizeof(result));
+    if constexpr (std::endian::native == std::endian::big) {
+        result = std::byteswap(result);
+    }
+    return result;
+}
+
+/// @brief Returns `true` if all eight bytes of `chars`
+/// (as obtained from `load_eight_chars`) are ASCII digits.
+[[nodiscard]]
+constexpr bool is_eight_digits(std::uint64_t chars) noexcept
+{
+    // The upper nibble of every byte must be 3, and adding 6 must not carry into it,
+    // which is only the case for 0x30 to 0x39.
+    constexpr std::uint64_t upper_nibbles = 0xF0F0F0F0F0F0F0F0;
+    const std::uint64_t plus_six = chars + 0x0606060606060606;
+    return ((chars & upper_nibbles) | ((plus_six & upper_nibbles) >> 4)) == 0x3333333333333333;
+}
+
+/// @brief Converts eight ASCII digits (as obtained from `load_eight_chars`) into their value,
+/// using three multiplications instead of eight.
+[[nodiscard]]
+constexpr std::uint32_t parse_eight_digits(std::uint64_t chars) noexcept
+{
+    // Combine adjacent digits into pairs, then pairs into quadruples, then both quadruples.
+    constexpr std::uint64_t mask = 0x000000FF000000FF;
+    constexpr std::uint64_t mul1 = 100 + (1000000ULL << 32);
+    constexpr std::uint64_t mul2 = 1 + (10000ULL << 32);
+    chars -= 0x3030303030303030;
+    chars = (chars * 10) + (chars >> 8);
+    chars = (((chars & mask) * mul1) + (((chars >> 16) & mask) * mul2)) >> 32;
+    return std::uint32_t(chars);
+}
+
+/// @brief Appends the decimal `digits` to `value`, eight at a time where possible.
+/// The result must fit into 64 bits, which is always the case for up to 19 digits.
+inline void accumulate_digits(std::uint64_t& value, std::u8string_view digits) noexcept
+{
+    while (digits.length() >= 8) {
+        const std::uint64_t chars = load_eight_chars(digits.data());
+        if (!is_eight_digits(chars)) {
+            break;
+        }
+        value = (value * 100000000) + parse_eight_digits(chars);
+        digits.remove_prefix(8);
+    }
+    for (const char8_t c : digits) {
+        ULIGHT_DEBUG_ASSERT(c >= u8'0' && c <= u8'9');
+        value = (value * 10) + std::uint64_t(c - u8'0');
+    }
+}
+
+/// @brief Converts a JSON number to the nearest `double`,
+/// handling only the cases where this can be done exactly and cheaply.
+///
+/// This is the case if the decimal significand has at most 19 digits and is at most 2^53,
+/// and the decimal exponent is at most 22 in magnitude,
+/// since then both the significand and the power of ten are exactly representable,
+/// and a single (correctly rounded) multiplication or division yields the correct result.
+/// This is known as Clinger's fast path, and covers the vast majority of numbers in practice,
+/// especially integers.
+/// @param str The number, as matched by `match_number`.
+/// @param number The result of `match_number(str)`, which must not be erroneous.
+/// @returns The value, or `std::nullopt` if the slow path is needed.
+[[nodiscard]]
+inline std::optional<double> parse_number_fast(std::u8string_view str, const Number_Result& number)
+{
+#if FLT_EVAL_METHOD != 0
+    // With excess precision (e.g. x87), the multiplication would be rounded twice.
+    return {};
+#else
+    ULIGHT_DEBUG_ASSERT(number && !number.erroneous);
+    static constexpr double powers_of_ten[] {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    constexpr std::uint64_t max_exact_integer = std::uint64_t { 1 } << 53;
+    constexpr std::size_t max_digits = 19;
+
+    const bool negative = str.starts_with(u8'-');
+    const std::u8string_view integer_digits
+        = str.substr(negative ? 1 : 0, number.integer - (negative ? 1 : 0));
+    const std::u8string_view fraction_digits = number.fraction == 0
+        ? std::u8string_view {}
+        : str.substr(number.integer + 1, number.fraction - 1);
+    if (integer_digits.length() + fraction_digits.length() > max_digits) {
+        return {};
+    }
+
+    std::uint64_t significand = 0;
+    accumulate_digits(significand, integer_digits);
+    accumulate_digits(significand, fraction_digits);
+    if (significand > max_exact_integer) {
+        return {};
+    }
+
+    long long exponent = -static_cast<long long>(fraction_digits.length());
+    if (number.exponent != 0) {
+        std::u8string_view exponent_digits
+            = str.substr(number.integer + number.fraction + 1, number.exponent - 1);
+        const bool negative_exponent = exponent_digits.starts_with(u8'-');
+        if (exponent_digits.starts_with(u8'-') || exponent_digits.starts_with(u8'+')) {
+            exponent_digits.remove_prefix(1);
+        }
+        // Anything with more digits is certainly not in the range of the fast path,
+        // unless it has many leading zeros, which is rare enough.
+        if (exponent_digits.length() > 4) {
+            return {};
+        }
+        std::uint64_t exponent_value = 0;
+        accumulate_digits(exponent_value, exponent_digits);
+        exponent += negative_exponent ? -static_cast<long long>(exponent_value)
+                                      : static_cast<long long>(exponent_value);
+    }
+
+    if (exponent < -22 || exponent > 22) {
+        return {};
+    }
+    auto result = static_cast<double>(significand);
+    if (exponent < 0) {
+        result /= powers_of_ten[-exponent];
+    }
+    else {
+        result *= powers_of_ten[exponent];
+    }
+    return negative ? -result : result;
+#endif
+}
+
+/// @brief Converts a JSON number to the nearest `double`, for any number.
+/// This is used when `parse_number_fast` fails.
+/// @param str The number, as matched by `match_number`, which must not be erroneous.
+/// @returns The value, or `std::nullopt` if the conversion failed.
+[[nodiscard]]
+std::optional<double> parse_number_slow(std::u8string_view str);
+
+/// @brief Converts a JSON number to the nearest `double`.
+/// @param str The number, as matched by `match_number`.
+/// @param number The result of `match_number(str)`, which must not be erroneous.
+/// @returns The value, or `std::nullopt` if the conversion failed.
+[[nodiscard]]
+inline std::optional<double> parse_number(std::u8string_view str, const Number_Result& number)
+{
+    if (const std::optional<double> result = parse_number_fast(str, number)) {
+        return result;
+    }
+    return parse_number_slow(str.substr(0, number.length));
+}
+
+} // namespace ulight::json
+
+#endif
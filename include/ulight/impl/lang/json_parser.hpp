@@ -0,0 +1,653 @@
+#ifndef ULIGHT_LANG_JSON_PARSER_HPP
+#define ULIGHT_LANG_JSON_PARSER_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "ulight/json.hpp"
+
+#include "ulight/impl/assert.hpp"
+#include "ulight/impl/simd.hpp"
+#include "ulight/impl/unicode.hpp"
+
+#include "ulight/impl/lang/json.hpp"
+#include "ulight/impl/lang/json_number.hpp"
+
+namespace ulight {
+namespace json {
+
+/// @brief Computes the line and column of positions within a source on demand,
+/// by counting line feeds one block at a time.
+///
+/// The result of the previous query is retained,
+/// so a sequence of queries for increasing positions examines every block only once.
+struct Line_Index {
+private:
+    std::u8string_view m_source;
+    /// @brief The position of the last query.
+    std::size_t m_code_unit = 0;
+    /// @brief The number of line feeds before `m_code_unit`.
+    std::size_t m_line = 0;
+    /// @brief The position of the first code unit in the line containing `m_code_unit`.
+    std::size_t m_line_start = 0;
+
+public:
+    [[nodiscard]]
+    explicit Line_Index(std::u8string_view source) noexcept
+        : m_source { source }
+    {
+    }
+
+    /// @brief Returns the position of the code unit at the given offset,
+    /// which is at most the length of the source.
+    [[nodiscard]]
+    Source_Position position(std::size_t code_unit) noexcept
+    {
+        ULIGHT_DEBUG_ASSERT(code_unit <= m_source.length());
+        if (code_unit < m_code_unit) {
+            m_code_unit = 0;
+            m_line = 0;
+            m_line_start = 0;
+        }
+        for (std::size_t begin = m_code_unit; begin < code_unit;) {
+            const std::size_t block = begin / block_size;
+            const std::size_t block_end = std::min((block + 1) * block_size, code_unit);
+            std::uint64_t bits = classify_block_of(m_source, block).newline;
+            // Only the line feeds within [begin, block_end) are counted.
+            bits &= ~std::uint64_t { 0 } << (begin % block_size);
+            const std::size_t end_bit = block_end - (block * block_size);
+            if (end_bit < block_size) {
+                bits &= (std::uint64_t { 1 } << end_bit) - 1;
+            }
+            if (bits != 0) {
+                m_line += std::size_t(std::popcount(bits));
+                m_line_start = (block * block_size) + std::size_t(63 - std::countl_zero(bits)) + 1;
+            }
+            begin = block_end;
+        }
+        m_code_unit = code_unit;
+        return { .code_unit = code_unit,
+                 .line = m_line,
+                 .line_code_unit = code_unit - m_line_start };
+    }
+};
+
+/// @brief The JSON parser behind all overloads of `parse_json`.
+///
+/// Every callback of `Visitor` is only invoked if `Visitor` has a member function
+/// that can be called with the corresponding arguments.
+/// Otherwise, the call is compiled away entirely,
+/// along with any work whose only purpose is to compute its arguments
+/// (e.g. converting numbers to `double` or decoding escape sequences).
+/// For `JSON_Visitor`, every callback exists, and is invoked virtually.
+template <typename Visitor>
+struct Parser {
+private:
+    static constexpr bool has_line_comment = json::has_line_comment<Visitor>;
+    static constexpr bool has_block_comment = json::has_block_comment<Visitor>;
+    static constexpr bool has_literal = json::has_literal<Visitor>;
+    static constexpr bool has_escape = json::has_escape<Visitor>;
+    static constexpr bool has_escape_parse = json::has_escape_parse<Visitor>;
+    static constexpr bool has_escape_parse_encode = json::has_escape_parse_encode<Visitor>;
+    static constexpr bool has_number = json::has_number<Visitor>;
+    static constexpr bool has_number_parse = json::has_number_parse<Visitor>;
+    static constexpr bool has_null = json::has_null<Visitor>;
+    static constexpr bool has_boolean = json::has_boolean<Visitor>;
+    static constexpr bool has_push_string = json::has_push_string<Visitor>;
+    static constexpr bool has_pop_string = json::has_pop_string<Visitor>;
+    static constexpr bool has_push_property = json::has_push_property<Visitor>;
+    static constexpr bool has_pop_property = json::has_pop_property<Visitor>;
+    static constexpr bool has_push_object = json::has_push_object<Visitor>;
+    static constexpr bool has_pop_object = json::has_pop_object<Visitor>;
+    static constexpr bool has_push_array = json::has_push_array<Visitor>;
+    static constexpr bool has_pop_array = json::has_pop_array<Visitor>;
+    static constexpr bool has_error = json::has_error<Visitor>;
+
+    Visitor& out;
+    const JSON_Options options;
+
+    std::u8string_view remainder;
+    Source_Position pos {};
+    /// @brief Used to skip over whitespace and the contents of strings in bulk.
+    /// The offset of `remainder` within the source is `pos.code_unit`.
+    Block_Index index;
+    /// @brief Used to compute lines and columns for errors if `options.lazy_positions` is set.
+    Line_Index lines;
+
+public:
+    [[nodiscard]]
+    Parser(Visitor& out, std::u8string_view source, JSON_Options options)
+        : out { out }
+        , options { options }
+        , remainder { source }
+        , index { source }
+        , lines { source }
+    {
+    }
+
+    [[nodiscard]]
+    bool operator()()
+    {
+        if (!consume_whitespace_comments() || !consume_value()) {
+            return false;
+        }
+        while (true) {
+            if (!consume_whitespace_comments()) {
+                return false;
+            }
+            if (remainder.empty()) {
+                return true;
+            }
+            if (!options.allow_multiple_values) {
+                error(JSON_Error::illegal_character);
+                return false;
+            }
+            if (!consume_value()) {
+                return false;
+            }
+        }
+    }
+
+private:
+    void error(JSON_Error error)
+    {
+        if constexpr (has_error) {
+            if (options.lazy_positions) {
+                out.error(lines.position(pos.code_unit), error);
+            }
+            else {
+                out.error(pos, error);
+            }
+        }
+    }
+
+    void advance_on_same_line(std::size_t amount)
+    {
+        pos.code_unit += amount;
+        if (!options.lazy_positions) {
+            pos.line_code_unit += amount;
+        }
+        remainder.remove_prefix(amount);
+    }
+
+    void advance(std::size_t amount)
+    {
+        if (options.lazy_positions) {
+            pos.code_unit += amount;
+            remainder.remove_prefix(amount);
+            return;
+        }
+        while (amount != 0) {
+            const std::size_t newline_pos = remainder.substr(0, amount).find(u8'\n');
+            if (newline_pos == std::u8string_view::npos) {
+                advance_on_same_line(amount);
+                return;
+            }
+            const std::size_t remaining_line_length = newline_pos + 1;
+            pos.code_unit += remaining_line_length;
+            pos.line += 1;
+            pos.line_code_unit = 0;
+            remainder.remove_prefix(remaining_line_length);
+
+            ULIGHT_DEBUG_ASSERT(amount >= remaining_line_length);
+            amount -= remaining_line_length;
+        }
+    }
+
+    [[nodiscard]]
+    std::size_t whitespace_length()
+    {
+        return index.find_non_whitespace(pos.code_unit) - pos.code_unit;
+    }
+
+    [[nodiscard]]
+    bool consume_whitespace_comments()
+    {
+        if (!options.allow_comments) {
+            const std::size_t white_length = whitespace_length();
+            advance(white_length);
+            return true;
+        }
+        while (true) {
+            const std::size_t white_length = whitespace_length();
+            advance(white_length);
+            if (remainder.starts_with(u8"//")) {
+                if (!consume_line_comment()) {
+                    return false;
+                }
+                continue;
+            }
+            if (remainder.starts_with(u8"/*")) {
+                if (!consume_block_comment()) {
+                    return false;
+                }
+                continue;
+            }
+            break;
+        }
+        return true;
+    }
+
+    [[nodiscard]]
+    bool consume_line_comment()
+    {
+        if (const std::size_t length = match_line_comment(remainder)) {
+            if constexpr (has_line_comment) {
+                out.line_comment(pos, remainder.substr(0, length));
+            }
+            advance_on_same_line(length);
+            return true;
+        }
+        ULIGHT_DEBUG_ASSERT_UNREACHABLE(u8"// should have been tested.");
+        error(JSON_Error::error);
+        return false;
+    }
+
+    [[nodiscard]]
+    bool consume_block_comment()
+    {
+        if (const js::Comment_Result block_comment = match_block_comment(remainder)) {
+            if (!block_comment.is_terminated) {
+                error(JSON_Error::comment);
+                return false;
+            }
+            if constexpr (has_block_comment) {
+                out.block_comment(pos, remainder.substr(0, block_comment.length));
+            }
+            advance(block_comment.length);
+            return true;
+        }
+        ULIGHT_DEBUG_ASSERT_UNREACHABLE(u8"/* should have been tested.");
+        error(JSON_Error::error);
+        return false;
+    }
+
+    [[nodiscard]]
+    bool consume_value()
+    {
+        if (remainder.empty()) {
+            error(JSON_Error::error);
+            return false;
+        }
+        switch (remainder[0]) {
+        case u8'"': {
+            return consume_string(String_Type::value);
+        }
+        case u8'[': {
+            return consume_array();
+        }
+        case u8'{': {
+            return consume_object();
+        }
+        case u8'-':
+        case u8'0':
+        case u8'1':
+        case u8'2':
+        case u8'3':
+        case u8'4':
+        case u8'5':
+        case u8'6':
+        case u8'7':
+        case u8'8':
+        case u8'9': {
+            return consume_number();
+        }
+        case u8't': {
+            if (remainder.starts_with(u8"true")) {
+                if constexpr (has_boolean) {
+                    out.boolean(pos, true);
+                }
+                advance_on_same_line(4);
+                return true;
+            }
+            error(JSON_Error::illegal_character);
+            return false;
+        }
+        case u8'f': {
+            if (remainder.starts_with(u8"false")) {
+                if constexpr (has_boolean) {
+                    out.boolean(pos, false);
+                }
+                advance_on_same_line(5);
+                return true;
+            }
+            error(JSON_Error::illegal_character);
+            return false;
+        }
+        case u8'n': {
+            if (remainder.starts_with(u8"null")) {
+                if constexpr (has_null) {
+                    out.null(pos);
+                }
+                advance_on_same_line(4);
+                return true;
+            }
+            error(JSON_Error::illegal_character);
+            return false;
+        }
+        default: error(JSON_Error::illegal_character); return false;
+        }
+    }
+
+    void push_string(String_Type type)
+    {
+        if (type == String_Type::property) {
+            if constexpr (has_push_property) {
+                out.push_property(pos);
+            }
+        }
+        else {
+            if constexpr (has_push_string) {
+                out.push_string(pos);
+            }
+        }
+    }
+
+    void pop_string(String_Type type)
+    {
+        if (type == String_Type::property) {
+            if constexpr (has_pop_property) {
+                out.pop_property(pos);
+            }
+        }
+        else {
+            if constexpr (has_pop_string) {
+                out.pop_string(pos);
+            }
+        }
+    }
+
+    [[nodiscard]]
+    bool consume_string(String_Type type)
+    {
+        if (!remainder.starts_with(u8'"')) {
+            ULIGHT_DEBUG_ASSERT_UNREACHABLE(u8"Should have checked for quotes already.");
+            return false;
+        }
+        push_string(type);
+        std::size_t length = 0;
+        advance_on_same_line(1);
+
+        const auto flush = [&] {
+            if (length != 0) {
+                if constexpr (has_literal) {
+                    out.literal(pos, remainder.substr(0, length));
+                }
+                advance_on_same_line(length);
+                length = 0;
+            }
+        };
+
+        while (true) {
+            // Everything up to the next quote, backslash, or control character is literal.
+            length = index.find_string_special(pos.code_unit + length) - pos.code_unit;
+            if (length >= remainder.length()) {
+                break;
+            }
+            switch (remainder[length]) {
+            case u8'"': {
+                flush();
+                pop_string(type);
+                advance_on_same_line(1);
+                return true;
+            }
+            case u8'\\': {
+                flush();
+                if (!consume_escape()) {
+                    return false;
+                }
+                continue;
+            }
+            default: {
+                ULIGHT_DEBUG_ASSERT(remainder[length] < 0x20);
+                flush();
+                error(JSON_Error::illegal_character);
+                return false;
+            }
+            }
+        }
+
+        flush();
+        error(JSON_Error::unterminated_string);
+        return false;
+    }
+
+    [[nodiscard]]
+    bool consume_escape()
+    {
+        const bool wants_value = (options.escapes == Escape_Parsing::parse && has_escape_parse)
+            || (options.escapes == Escape_Parsing::parse_encode && has_escape_parse_encode);
+        const Escape_Result escape = match_escape_sequence(
+            remainder, wants_value ? Escape_Policy::parse : Escape_Policy::match_only
+        );
+        if (!escape || escape.value == Escape_Result::no_value) {
+            error(JSON_Error::illegal_escape);
+            return false;
+        }
+
+        switch (options.escapes) {
+        case Escape_Parsing::none: {
+            if constexpr (has_escape) {
+                out.escape(pos, remainder.substr(0, escape.length));
+            }
+            break;
+        }
+        case Escape_Parsing::parse: {
+            if constexpr (has_escape_parse) {
+                out.escape(pos, remainder.substr(0, escape.length), escape.value);
+            }
+            break;
+        }
+        case Escape_Parsing::parse_encode: {
+            if constexpr (has_escape_parse_encode) {
+                const auto [code_units, length] = utf8::encode8_unchecked(escape.value);
+                const std::u8string_view encoded { code_units.data(), std::size_t(length) };
+                out.escape(pos, remainder.substr(0, escape.length), escape.value, encoded);
+            }
+            break;
+        }
+        }
+
+        advance_on_same_line(escape.length);
+        return true;
+    }
+
+    [[nodiscard]]
+    bool consume_number()
+    {
+        const Number_Result number = match_number(remainder);
+        if (!number || number.erroneous) {
+            error(JSON_Error::illegal_number);
+            return false;
+        }
+
+        const std::u8string_view number_string = remainder.substr(0, number.length);
+        if (options.parse_numbers) {
+            if constexpr (has_number_parse) {
+                const std::optional<double> value = parse_number(number_string, number);
+                if (!value) {
+                    error(JSON_Error::illegal_number);
+                    return false;
+                }
+                out.number(pos, number_string, *value);
+            }
+        }
+        else {
+            if constexpr (has_number) {
+                out.number(pos, number_string);
+            }
+        }
+        advance_on_same_line(number.length);
+        return true;
+    }
+
+    [[nodiscard]]
+    bool consume_object()
+    {
+        if (!remainder.starts_with(u8'{')) {
+            ULIGHT_DEBUG_ASSERT_UNREACHABLE(u8"This should have been tested outside.");
+            error(JSON_Error::error);
+            return false;
+        }
+        if constexpr (has_push_object) {
+            out.push_object(pos);
+        }
+        advance_on_same_line(1);
+
+        bool first_member = true;
+        while (!remainder.empty()) {
+            if (!consume_whitespace_comments()) {
+                return false;
+            }
+            if (remainder.starts_with(u8'}')) {
+                if constexpr (has_pop_object) {
+                    out.pop_object(pos);
+                }
+                advance_on_same_line(1);
+                return true;
+            }
+            if (first_member) {
+                if (!consume_member()) {
+                    return false;
+                }
+                first_member = false;
+                continue;
+            }
+            if (remainder.starts_with(u8',')) {
+                advance_on_same_line(1);
+                if (!consume_whitespace_comments()) {
+                    return false;
+                }
+                if (remainder.empty()) {
+                    break;
+                }
+                if (!consume_member()) {
+                    return false;
+                }
+                continue;
+            }
+            error(JSON_Error::illegal_character);
+            return false;
+        }
+
+        error(JSON_Error::unterminated_object);
+        return false;
+    }
+
+    [[nodiscard]]
+    bool consume_member()
+    {
+        if (!remainder.starts_with(u8'"')) {
+            error(JSON_Error::illegal_character);
+            return false;
+        }
+        if (!consume_string(String_Type::property)) {
+            return false;
+        }
+
+        const auto at_end = [&] {
+            return remainder.empty() || remainder.starts_with(u8'}')
+                || remainder.starts_with(u8',');
+        };
+        if (!consume_whitespace_comments()) {
+            return false;
+        }
+        if (!remainder.starts_with(u8':')) {
+            error(JSON_Error::valueless_member);
+            return false;
+        }
+        advance_on_same_line(1);
+
+        if (!consume_whitespace_comments()) {
+            return false;
+        }
+        if (at_end()) {
+            error(JSON_Error::valueless_member);
+            return false;
+        }
+        return consume_value();
+    }
+
+    [[nodiscard]]
+    bool consume_array()
+    {
+        if (!remainder.starts_with(u8'[')) {
+            ULIGHT_DEBUG_ASSERT_UNREACHABLE(u8"This should have been tested outside.");
+            error(JSON_Error::error);
+            return false;
+        }
+        if constexpr (has_push_array) {
+            out.push_array(pos);
+        }
+        advance_on_same_line(1);
+        if (!consume_whitespace_comments()) {
+            return false;
+        }
+
+        bool first_element = true;
+        while (!remainder.empty()) {
+            if (!consume_whitespace_comments()) {
+                return false;
+            }
+            if (remainder.starts_with(u8']')) {
+                if constexpr (has_pop_array) {
+                    out.pop_array(pos);
+                }
+                advance_on_same_line(1);
+                return true;
+            }
+            if (first_element) {
+                if (!consume_value()) {
+                    return false;
+                }
+                first_element = false;
+                continue;
+            }
+            if (remainder.starts_with(u8',')) {
+                advance_on_same_line(1);
+                if (!consume_whitespace_comments()) {
+                    return false;
+                }
+                if (remainder.empty()) {
+                    break;
+                }
+                if (!consume_value()) {
+                    return false;
+                }
+                continue;
+            }
+            error(JSON_Error::illegal_character);
+            return false;
+        }
+
+        error(JSON_Error::unterminated_array);
+        return false;
+    }
+};
+
+// The virtual interface is instantiated only once, within the library.
+extern template struct Parser<JSON_Visitor>;
+
+} // namespace json
+
+template <json_static_visitor Visitor>
+bool parse_json(Visitor& visitor, std::u8string_view source, JSON_Options options)
+{
+    return json::Parser<Visitor> { visitor, source, options }();
+}
+
+template <json_static_visitor Visitor>
+bool parse_json(Visitor& visitor, std::string_view source, JSON_Options options)
+{
+    const std::u8string_view u8source { reinterpret_cast<const char8_t*>(source.data()),
+                                        source.length() };
+    return parse_json(visitor, u8source, options);
+}
+
+} // namespace ulight
+
+#endif
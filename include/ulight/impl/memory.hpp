@@ -3,6 +3,7 @@
 
 #include <cstddef>
 #include <memory_resource>
+#include <new>
 
 #include "ulight/ulight.hpp"
 
@@ -11,15 +12,42 @@
 
 namespace ulight {
 
-/// @brief A `std::pmr::memory_resource` which uses
-/// `ulight::alloc` and `ulight::free` to allocate or free memory.
-struct Global_Memory_Resource final : std::pmr::memory_resource {
+/// @brief A `std::pmr::memory_resource` which can also allocate without throwing,
+/// and which remembers whether any allocation has failed.
+/// This lets allocation failure be reported as `ULIGHT_STATUS_BAD_ALLOC`
+/// even in builds without exceptions,
+/// where `allocate` cannot report failure to standard containers.
+struct Fallible_Memory_Resource : std::pmr::memory_resource {
+private:
+    bool m_failed = false;
 
+public:
+    /// @brief Like `allocate`, but returns a null pointer on failure instead of throwing,
+    /// in which case `failed()` is `true` from then on.
     [[nodiscard]]
-    void* do_allocate(std::size_t bytes, std::size_t alignment) final
+    void* try_allocate(std::size_t bytes, std::size_t alignment) noexcept
     {
         ULIGHT_DEBUG_ASSERT(alignment != 0);
-        void* const result = ulight::alloc(bytes, alignment);
+        void* const result = do_try_allocate(bytes, alignment);
+        m_failed |= result == nullptr;
+        return result;
+    }
+
+    /// @brief Returns `true` if any allocation from this resource has failed.
+    [[nodiscard]]
+    bool failed() const noexcept
+    {
+        return m_failed;
+    }
+
+protected:
+    [[nodiscard]]
+    virtual void* do_try_allocate(std::size_t bytes, std::size_t alignment) noexcept = 0;
+
+    [[nodiscard]]
+    void* do_allocate(std::size_t bytes, std::size_t alignment) final
+    {
+        void* const result = try_allocate(bytes, alignment);
         if (!result) {
 #ifdef ULIGHT_EXCEPTIONS
             throw std::bad_alloc();
@@ -29,6 +57,17 @@ struct Global_Memory_Resource final : std::pmr::memory_resource {
         }
         return result;
     }
+};
+
+/// @brief A `Fallible_Memory_Resource` which uses
+/// `ulight::alloc` and `ulight::free` to allocate or free memory.
+struct Global_Memory_Resource final : Fallible_Memory_Resource {
+protected:
+    [[nodiscard]]
+    void* do_try_allocate(std::size_t bytes, std::size_t alignment) noexcept final
+    {
+        return ulight::alloc(bytes, alignment);
+    }
 
     void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept final
     {
@@ -42,6 +81,63 @@ struct Global_Memory_Resource final : std::pmr::memory_resource {
     }
 };
 
+/// @brief A `Fallible_Memory_Resource` which uses the given functions
+/// to allocate or free memory, such as those of a `ulight_engine`.
+struct Function_Memory_Resource final : Fallible_Memory_Resource {
+    void* (*alloc)(std::size_t size, std::size_t alignment);
+    void (*free)(void* pointer, std::size_t size, std::size_t alignment);
+
+    Function_Memory_Resource(
+        void* alloc(std::size_t, std::size_t),
+        void free(void*, std::size_t, std::size_t)
+    ) noexcept
+        : alloc { alloc }
+        , free { free }
+    {
+    }
+
+protected:
+    [[nodiscard]]
+    void* do_try_allocate(std::size_t bytes, std::size_t alignment) noexcept final
+    {
+        return alloc(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept final
+    {
+        free(p, bytes, alignment);
+    }
+
+    [[nodiscard]]
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept final
+    {
+        const auto* const other_function = dynamic_cast<const Function_Memory_Resource*>(&other);
+        return other_function && other_function->alloc == alloc && other_function->free == free;
+    }
+};
+
+/// @brief Allocates from `memory` without throwing.
+/// @returns The allocated memory, or a null pointer if allocation failed.
+/// Unless `memory` is a `Fallible_Memory_Resource`,
+/// failure can only be detected in builds with exceptions.
+[[nodiscard]]
+inline void*
+try_allocate(std::pmr::memory_resource* memory, std::size_t bytes, std::size_t alignment) noexcept
+{
+    if (auto* const fallible = dynamic_cast<Fallible_Memory_Resource*>(memory)) {
+        return fallible->try_allocate(bytes, alignment);
+    }
+#ifdef ULIGHT_EXCEPTIONS
+    try {
+        return memory->allocate(bytes, alignment);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+#else
+    return memory->allocate(bytes, alignment);
+#endif
+}
+
 } // namespace ulight
 
 #endif
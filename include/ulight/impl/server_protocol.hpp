@@ -0,0 +1,200 @@
+#ifndef ULIGHT_SERVER_PROTOCOL_HPP
+#define ULIGHT_SERVER_PROTOCOL_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "ulight/ulight.hpp"
+
+#include "ulight/impl/platform.h"
+
+#ifdef ULIGHT_EMSCRIPTEN
+#error The server protocol should not be included when compiling with Emscripten.
+#endif
+
+// The protocol of ulight-server (see src/main/cpp/server.cpp).
+//
+// Every message is a frame consisting of a 32-bit size, followed by that many bytes of payload.
+// All integers are unsigned and little-endian.
+//
+// The payload of a request is:
+//   u32 id       chosen by the client, and echoed by the response
+//   u8  lang     a ulight_lang
+//   u8  format   an Output_Format
+//   u8  flags    a combination of ulight_flag
+//   u8  reserved zero
+//   ...          the UTF-8-encoded source code, up to the end of the frame
+//
+// The payload of a response is:
+//   u32 id       the id of the request
+//   u8  status   a ulight_status
+//   u8  format   the format of the request
+//   u16 reserved zero
+//   ...          if status is ULIGHT_STATUS_OK, the output, otherwise an error message
+//
+// Any number of requests can be in flight on one connection,
+// and responses are sent as soon as they are ready,
+// which is not necessarily in the order of requests.
+
+namespace ulight::server {
+
+/// @brief The output that the server produces for a request.
+enum struct Output_Format : std::uint8_t {
+    /// @brief HTML, like `ulight_source_to_html`.
+    html,
+    /// @brief Text with ANSI escape sequences, like `ulight_source_to_ansi`
+    /// with the default theme.
+    ansi,
+    /// @brief Token records, like `ulight_session_token_records`,
+    /// where each 32-bit integer is little-endian.
+    tokens,
+};
+
+/// @brief The size of the size prefix of every frame, in bytes.
+inline constexpr std::size_t frame_size_size = 4;
+/// @brief The size of a request payload without the source code, in bytes.
+inline constexpr std::size_t request_header_size = 8;
+/// @brief The size of a response payload without the output, in bytes.
+inline constexpr std::size_t response_header_size = 8;
+/// @brief The greatest frame size that the server accepts.
+/// Larger requests are treated as a protocol error, which protects the server from
+/// allocating unbounded amounts of memory for a corrupted size prefix.
+inline constexpr std::uint32_t max_frame_size = 256 * 1024 * 1024;
+
+struct Request_Header {
+    std::uint32_t id;
+    Lang lang;
+    Output_Format format;
+    Flag flags;
+};
+
+struct Response_Header {
+    std::uint32_t id;
+    Status status;
+    Output_Format format;
+};
+
+/// @brief A frame size prefix followed by a request header.
+using Request_Prefix = std::array<char, frame_size_size + request_header_size>;
+/// @brief A frame size prefix followed by a response header.
+using Response_Prefix = std::array<char, frame_size_size + response_header_size>;
+
+namespace detail {
+
+inline void store_u32(char* out, std::uint32_t x) noexcept
+{
+    out[0] = char(x & 0xff);
+    out[1] = char((x >> 8) & 0xff);
+    out[2] = char((x >> 16) & 0xff);
+    out[3] = char((x >> 24) & 0xff);
+}
+
+} // namespace detail
+
+/// @brief Returns the integer stored in the first four bytes of `data`.
+[[nodiscard]]
+inline std::uint32_t load_u32(std::span<const char> data) noexcept
+{
+    return std::uint32_t(std::uint8_t(data[0])) | (std::uint32_t(std::uint8_t(data[1])) << 8)
+        | (std::uint32_t(std::uint8_t(data[2])) << 16)
+        | (std::uint32_t(std::uint8_t(data[3])) << 24);
+}
+
+/// @brief Returns `true` if `format` is one of the enumerators of `Output_Format`.
+[[nodiscard]]
+constexpr bool is_valid_format(std::uint8_t format) noexcept
+{
+    return format <= std::uint8_t(Output_Format::tokens);
+}
+
+/// @brief Returns the frame size prefix and the header of a request
+/// with `source_size` bytes of source code,
+/// which have to be written before the source code.
+/// `source_size` has to be at most `max_frame_size - request_header_size`.
+[[nodiscard]]
+inline Request_Prefix encode_request_prefix(const Request_Header& header, std::size_t source_size)
+{
+    Request_Prefix result {};
+    detail::store_u32(result.data(), std::uint32_t(request_header_size + source_size));
+    detail::store_u32(result.data() + 4, header.id);
+    result[8] = char(header.lang);
+    result[9] = char(header.format);
+    result[10] = char(header.flags);
+    result[11] = 0;
+    return result;
+}
+
+/// @brief Like `encode_request_prefix`, but for a response with `body_size` bytes of body.
+[[nodiscard]]
+inline Response_Prefix encode_response_prefix(const Response_Header& header, std::size_t body_size)
+{
+    Response_Prefix result {};
+    detail::store_u32(result.data(), std::uint32_t(response_header_size + body_size));
+    detail::store_u32(result.data() + 4, header.id);
+    result[8] = char(header.status);
+    result[9] = char(header.format);
+    result[10] = 0;
+    result[11] = 0;
+    return result;
+}
+
+/// @brief Decodes the header at the start of a request `payload`
+/// (i.e. of a frame without its size prefix).
+/// @returns The header, or `std::nullopt` if the payload is too short,
+/// if the format is invalid, or if the reserved bytes are not zero.
+[[nodiscard]]
+inline std::optional<Request_Header> decode_request_header(std::span<const char> payload)
+{
+    if (payload.size() < request_header_size || !is_valid_format(std::uint8_t(payload[5]))
+        || payload[7] != 0) {
+        return std::nullopt;
+    }
+    return Request_Header {
+        .id = load_u32(payload),
+        .lang = Lang(std::uint8_t(payload[4])),
+        .format = Output_Format(payload[5]),
+        .flags = Flag(std::uint8_t(payload[6])),
+    };
+}
+
+/// @brief Like `decode_request_header`, but for responses.
+[[nodiscard]]
+inline std::optional<Response_Header> decode_response_header(std::span<const char> payload)
+{
+    if (payload.size() < response_header_size || !is_valid_format(std::uint8_t(payload[5]))
+        || payload[6] != 0 || payload[7] != 0) {
+        return std::nullopt;
+    }
+    return Response_Header {
+        .id = load_u32(payload),
+        .status = Status(std::uint8_t(payload[4])),
+        .format = Output_Format(payload[5]),
+    };
+}
+
+// The following functions are only available on POSIX systems.
+
+/// @brief Reads from the file descriptor `fd` until `out` is full,
+/// retrying when interrupted by signals.
+/// @returns The number of bytes read,
+/// which is less than `out.size()` if the end of the file was reached or an error occurred.
+std::size_t read_exact(int fd, std::span<char> out) noexcept;
+
+/// @brief Writes all of `head` followed by all of `body` to the file descriptor `fd`,
+/// using as few system calls as possible.
+/// @returns `true` on success, `false` if an error occurred.
+[[nodiscard]]
+bool write_all(int fd, std::span<const char> head, std::span<const char> body = {}) noexcept;
+
+/// @brief Connects to the Unix domain socket at `path`.
+/// @returns The file descriptor of the socket, or `-1` on failure.
+[[nodiscard]]
+int connect_unix_socket(std::string_view path) noexcept;
+
+} // namespace ulight::server
+
+#endif
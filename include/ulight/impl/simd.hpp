@@ -0,0 +1,466 @@
+#ifndef ULIGHT_SIMD_HPP
+#define ULIGHT_SIMD_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define ULIGHT_X86_SSE2
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define ULIGHT_X86_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define ULIGHT_ARM_NEON
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#define ULIGHT_WASM_SIMD128
+#include <wasm_simd128.h>
+#endif
+
+#include "ulight/impl/assert.hpp"
+
+namespace ulight::simd {
+
+/// @brief The number of code units that the vectorized kernels process at once.
+inline constexpr std::size_t vector_size = 16;
+
+/// @brief `true` if the kernels in this file use SIMD instructions,
+/// and `false` if they fall back to scalar loops.
+#if defined(ULIGHT_X86_SSE2) || defined(ULIGHT_ARM_NEON) || defined(ULIGHT_WASM_SIMD128)
+inline constexpr bool is_vectorized = true;
+#else
+inline constexpr bool is_vectorized = false;
+#endif
+
+namespace detail {
+
+#if defined(ULIGHT_X86_SSE2)
+
+/// @brief Returns a mask where bit `i` is set if `data[i]` is one of `chars`.
+template <char8_t... chars>
+[[nodiscard]]
+inline std::uint32_t match_any(const char8_t* data) noexcept
+{
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i result = _mm_setzero_si128();
+    ((result = _mm_or_si128(result, _mm_cmpeq_epi8(v, _mm_set1_epi8(char(chars))))), ...);
+    return std::uint32_t(_mm_movemask_epi8(result));
+}
+
+/// @brief Returns a mask where bit `i` is set if `data[i]` is not ASCII.
+[[nodiscard]]
+inline std::uint32_t match_non_ascii(const char8_t* data) noexcept
+{
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    return std::uint32_t(_mm_movemask_epi8(v));
+}
+
+#elif defined(ULIGHT_ARM_NEON)
+
+/// @brief Like x86 `movemask`, for a single vector whose lanes are all zeros or all ones.
+[[nodiscard]]
+inline std::uint32_t to_mask_16(uint8x16_t v) noexcept
+{
+    const uint8x16_t bits = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+                              0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+    const uint8x16_t masked = vandq_u8(v, bits);
+    return std::uint32_t(vaddv_u8(vget_low_u8(masked)))
+        | (std::uint32_t(vaddv_u8(vget_high_u8(masked))) << 8);
+}
+
+/// @brief Returns a mask where bit `i` is set if `data[i]` is one of `chars`.
+template <char8_t... chars>
+[[nodiscard]]
+inline std::uint32_t match_any(const char8_t* data) noexcept
+{
+    const uint8x16_t v = vld1q_u8(reinterpret_cast<const std::uint8_t*>(data));
+    uint8x16_t result = vdupq_n_u8(0);
+    ((result = vorrq_u8(result, vceqq_u8(v, vdupq_n_u8(std::uint8_t(chars))))), ...);
+    return to_mask_16(result);
+}
+
+/// @brief Returns a mask where bit `i` is set if `data[i]` is not ASCII.
+[[nodiscard]]
+inline std::uint32_t match_non_ascii(const char8_t* data) noexcept
+{
+    const uint8x16_t v = vld1q_u8(reinterpret_cast<const std::uint8_t*>(data));
+    return to_mask_16(vcgeq_u8(v, vdupq_n_u8(0x80)));
+}
+
+#elif defined(ULIGHT_WASM_SIMD128)
+
+/// @brief Returns a mask where bit `i` is set if `data[i]` is one of `chars`.
+template <char8_t... chars>
+[[nodiscard]]
+inline std::uint32_t match_any(const char8_t* data) noexcept
+{
+    const v128_t v = wasm_v128_load(data);
+    v128_t result = wasm_i8x16_splat(0);
+    ((result = wasm_v128_or(result, wasm_i8x16_eq(v, wasm_i8x16_splat(char(chars))))), ...);
+    return std::uint32_t(wasm_i8x16_bitmask(result));
+}
+
+/// @brief Returns a mask where bit `i` is set if `data[i]` is not ASCII.
+[[nodiscard]]
+inline std::uint32_t match_non_ascii(const char8_t* data) noexcept
+{
+    return std::uint32_t(wasm_i8x16_bitmask(wasm_v128_load(data)));
+}
+
+#endif
+
+} // namespace detail
+
+/// @brief Returns the position of the first code unit in `str` that is one of `chars`,
+/// or `std::u8string_view::npos` if there is none.
+/// This is equivalent to `str.find_first_of(chars)`,
+/// but examines `vector_size` code units at once where SIMD is available.
+template <char8_t... chars>
+[[nodiscard]]
+std::size_t find_any(std::u8string_view str) noexcept
+{
+    std::size_t i = 0;
+#if defined(ULIGHT_X86_SSE2) || defined(ULIGHT_ARM_NEON) || defined(ULIGHT_WASM_SIMD128)
+    for (; i + vector_size <= str.length(); i += vector_size) {
+        if (const std::uint32_t mask = detail::match_any<chars...>(str.data() + i)) {
+            return i + std::size_t(std::countr_zero(mask));
+        }
+    }
+#endif
+    for (; i < str.length(); ++i) {
+        if (((str[i] == chars) || ...)) {
+            return i;
+        }
+    }
+    return std::u8string_view::npos;
+}
+
+/// @brief Like the `std::u8string_view` overload, but for `std::string_view`.
+template <char8_t... chars>
+[[nodiscard]]
+std::size_t find_any(std::string_view str) noexcept
+{
+    return find_any<chars...>(
+        std::u8string_view { reinterpret_cast<const char8_t*>(str.data()), str.length() }
+    );
+}
+
+/// @brief Returns the number of code units at the start of `str` that are ASCII.
+/// This is used to skip over ASCII text quickly, such as when validating UTF-8.
+[[nodiscard]]
+inline std::size_t ascii_prefix_length(std::u8string_view str) noexcept
+{
+    std::size_t i = 0;
+#if defined(ULIGHT_X86_SSE2) || defined(ULIGHT_ARM_NEON) || defined(ULIGHT_WASM_SIMD128)
+    for (; i + vector_size <= str.length(); i += vector_size) {
+        if (const std::uint32_t mask = detail::match_non_ascii(str.data() + i)) {
+            return i + std::size_t(std::countr_zero(mask));
+        }
+    }
+#endif
+    while (i < str.length() && str[i] < 0x80) {
+        ++i;
+    }
+    return i;
+}
+
+} // namespace ulight::simd
+
+// The JSON parsers classify the source in blocks using the same instruction sets,
+// so that they can skip over the contents of strings and whitespace quickly.
+namespace ulight::json {
+
+/// @brief The size of blocks that are classified at once.
+inline constexpr std::size_t block_size = 64;
+
+/// @brief The classification of up to 64 code units of JSON ("stage 1" in simdjson terminology).
+/// Bit `i` of each mask corresponds to the code unit at index `i` within the block.
+struct Block_Masks {
+    /// @brief `"`
+    std::uint64_t quote;
+    /// @brief `\`
+    std::uint64_t backslash;
+    /// @brief Space, tab, form feed, line feed, and carriage return, like `is_json_whitespace`.
+    std::uint64_t whitespace;
+    /// @brief Control characters (U+0000 to U+001F), which may not appear in strings.
+    /// Note that this overlaps with `whitespace`.
+    std::uint64_t control;
+    /// @brief Line feed.
+    /// Note that this overlaps with `whitespace` and `control`.
+    std::uint64_t newline;
+
+    [[nodiscard]]
+    friend constexpr bool operator==(const Block_Masks&, const Block_Masks&)
+        = default;
+};
+
+/// @brief Classifies `block_size` code units starting at `data` one at a time.
+/// This is the fallback for platforms without SIMD support,
+/// and a reference for the vectorized kernels.
+[[nodiscard]]
+constexpr Block_Masks classify_block_scalar(const char8_t* data) noexcept
+{
+    Block_Masks result {};
+    for (std::size_t i = 0; i < block_size; ++i) {
+        const std::uint64_t bit = std::uint64_t { 1 } << i;
+        switch (data[i]) {
+        case u8'"': result.quote |= bit; break;
+        case u8'\\': result.backslash |= bit; break;
+        case u8' ': result.whitespace |= bit; break;
+        case u8'\n': result.newline |= bit; [[fallthrough]];
+        case u8'\t':
+        case u8'\f':
+        case u8'\r': result.whitespace |= bit; result.control |= bit; break;
+        default: {
+            if (data[i] < 0x20) {
+                result.control |= bit;
+            }
+            break;
+        }
+        }
+    }
+    return result;
+}
+
+namespace detail {
+
+#if defined(ULIGHT_X86_AVX2)
+
+[[nodiscard]]
+inline Block_Masks classify_part(const char8_t* data) noexcept
+{
+    const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    const auto eq = [&](char c) { return _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(c)); };
+    const auto to_mask = [](__m256i v) {
+        return std::uint64_t(std::uint32_t(_mm256_movemask_epi8(v)));
+    };
+    // Unsigned x < 0x20 is equivalent to max(x, 0x1f) == 0x1f.
+    const __m256i control = _mm256_cmpeq_epi8(
+        _mm256_max_epu8(chars, _mm256_set1_epi8(0x1f)), _mm256_set1_epi8(0x1f)
+    );
+    const __m256i whitespace = _mm256_or_si256(
+        _mm256_or_si256(_mm256_or_si256(eq(' '), eq('\t')), _mm256_or_si256(eq('\n'), eq('\r'))),
+        eq('\f')
+    );
+    return { .quote = to_mask(eq('"')),
+             .backslash = to_mask(eq('\\')),
+             .whitespace = to_mask(whitespace),
+             .control = to_mask(control),
+             .newline = to_mask(eq('\n')) };
+}
+
+inline constexpr std::size_t simd_part_size = 32;
+
+#elif defined(ULIGHT_X86_SSE2)
+
+[[nodiscard]]
+inline Block_Masks classify_part(const char8_t* data) noexcept
+{
+    const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    const auto eq = [&](char c) { return _mm_cmpeq_epi8(chars, _mm_set1_epi8(c)); };
+    const auto to_mask = [](__m128i v) { return std::uint64_t(unsigned(_mm_movemask_epi8(v))); };
+    const __m128i control
+        = _mm_cmpeq_epi8(_mm_max_epu8(chars, _mm_set1_epi8(0x1f)), _mm_set1_epi8(0x1f));
+    const __m128i whitespace = _mm_or_si128(
+        _mm_or_si128(_mm_or_si128(eq(' '), eq('\t')), _mm_or_si128(eq('\n'), eq('\r'))), eq('\f')
+    );
+    return { .quote = to_mask(eq('"')),
+             .backslash = to_mask(eq('\\')),
+             .whitespace = to_mask(whitespace),
+             .control = to_mask(control),
+             .newline = to_mask(eq('\n')) };
+}
+
+inline constexpr std::size_t simd_part_size = 16;
+
+#elif defined(ULIGHT_ARM_NEON)
+
+/// @brief Like `simd::detail::to_mask_16`, but for all four vectors at once,
+/// which is cheaper than doing it one vector at a time.
+[[nodiscard]]
+inline std::uint64_t
+to_mask_64(uint8x16_t v0, uint8x16_t v1, uint8x16_t v2, uint8x16_t v3) noexcept
+{
+    const uint8x16_t bits = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+                              0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+    uint8x16_t sum0 = vpaddq_u8(vandq_u8(v0, bits), vandq_u8(v1, bits));
+    const uint8x16_t sum1 = vpaddq_u8(vandq_u8(v2, bits), vandq_u8(v3, bits));
+    sum0 = vpaddq_u8(sum0, sum1);
+    sum0 = vpaddq_u8(sum0, sum0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+}
+
+#elif defined(ULIGHT_WASM_SIMD128)
+
+[[nodiscard]]
+inline Block_Masks classify_part(const char8_t* data) noexcept
+{
+    const v128_t chars = wasm_v128_load(data);
+    const auto eq = [&](char c) { return wasm_i8x16_eq(chars, wasm_i8x16_splat(c)); };
+    const auto to_mask = [](v128_t v) { return std::uint64_t(wasm_i8x16_bitmask(v)); };
+    const v128_t control = wasm_u8x16_lt(chars, wasm_i8x16_splat(0x20));
+    const v128_t whitespace = wasm_v128_or(
+        wasm_v128_or(wasm_v128_or(eq(' '), eq('\t')), wasm_v128_or(eq('\n'), eq('\r'))), eq('\f')
+    );
+    return { .quote = to_mask(eq('"')),
+             .backslash = to_mask(eq('\\')),
+             .whitespace = to_mask(whitespace),
+             .control = to_mask(control),
+             .newline = to_mask(eq('\n')) };
+}
+
+inline constexpr std::size_t simd_part_size = 16;
+
+#endif
+
+} // namespace detail
+
+/// @brief Classifies `block_size` code units starting at `data`,
+/// using the best available SIMD instructions.
+/// The result is identical to `classify_block_scalar`.
+[[nodiscard]]
+inline Block_Masks classify_block(const char8_t* data) noexcept
+{
+#if defined(ULIGHT_X86_AVX2) || defined(ULIGHT_X86_SSE2) || defined(ULIGHT_WASM_SIMD128)
+    Block_Masks result {};
+    for (std::size_t i = 0; i < block_size; i += detail::simd_part_size) {
+        const Block_Masks part = detail::classify_part(data + i);
+        result.quote |= part.quote << i;
+        result.backslash |= part.backslash << i;
+        result.whitespace |= part.whitespace << i;
+        result.control |= part.control << i;
+        result.newline |= part.newline << i;
+    }
+    return result;
+#elif defined(ULIGHT_ARM_NEON)
+    const uint8x16_t c0 = vld1q_u8(reinterpret_cast<const std::uint8_t*>(data));
+    const uint8x16_t c1 = vld1q_u8(reinterpret_cast<const std::uint8_t*>(data + 16));
+    const uint8x16_t c2 = vld1q_u8(reinterpret_cast<const std::uint8_t*>(data + 32));
+    const uint8x16_t c3 = vld1q_u8(reinterpret_cast<const std::uint8_t*>(data + 48));
+
+    const auto classify = [&](auto predicate) {
+        return detail::to_mask_64(predicate(c0), predicate(c1), predicate(c2), predicate(c3));
+    };
+    const auto eq = [](uint8x16_t v, std::uint8_t c) { return vceqq_u8(v, vdupq_n_u8(c)); };
+
+    return {
+        .quote = classify([&](uint8x16_t v) { return eq(v, '"'); }),
+        .backslash = classify([&](uint8x16_t v) { return eq(v, '\\'); }),
+        .whitespace = classify([&](uint8x16_t v) {
+            return vorrq_u8(
+                vorrq_u8(vorrq_u8(eq(v, ' '), eq(v, '\t')), vorrq_u8(eq(v, '\n'), eq(v, '\r'))),
+                eq(v, '\f')
+            );
+        }),
+        .control = classify([&](uint8x16_t v) { return vcltq_u8(v, vdupq_n_u8(0x20)); }),
+        .newline = classify([&](uint8x16_t v) { return eq(v, '\n'); }),
+    };
+#else
+    return classify_block_scalar(data);
+#endif
+}
+
+/// @brief Classifies the block with the given index within `source`,
+/// where the block spans the code units `[block * block_size, (block + 1) * block_size)`.
+/// Bits past the end of the source are zero.
+[[nodiscard]]
+inline Block_Masks classify_block_of(std::u8string_view source, std::size_t block) noexcept
+{
+    const std::size_t begin = block * block_size;
+    ULIGHT_DEBUG_ASSERT(begin < source.length());
+    if (source.length() - begin >= block_size) {
+        return classify_block(source.data() + begin);
+    }
+    // The last block is copied into a padded buffer,
+    // since we must not read past the end of the source.
+    // The padding is a code unit that is not in any of the classes.
+    char8_t padded[block_size];
+    std::ranges::fill(padded, u8'_');
+    std::ranges::copy(source.substr(begin), padded);
+    return classify_block(padded);
+}
+
+/// @brief Lazily classifies a JSON source in blocks of `block_size` code units,
+/// starting at the beginning of the source.
+/// This allows the parser to find the next "interesting" code unit
+/// (e.g. the end of a string or of whitespace) without examining every code unit individually.
+///
+/// Only the most recently classified block is retained.
+/// Since the parser moves forward through the source, that block is reused for all queries within
+/// it, and every block is typically classified only once.
+struct Block_Index {
+private:
+    static constexpr std::size_t no_block = std::size_t(-1);
+
+    std::u8string_view m_source;
+    std::size_t m_block = no_block;
+    Block_Masks m_masks {};
+
+public:
+    [[nodiscard]]
+    explicit Block_Index(std::u8string_view source) noexcept
+        : m_source { source }
+    {
+    }
+
+    /// @brief Equivalent to `classify_block_of(source, block)`.
+    [[nodiscard]]
+    const Block_Masks& masks(std::size_t block) noexcept
+    {
+        if (block == m_block) {
+            return m_masks;
+        }
+        m_masks = classify_block_of(m_source, block);
+        m_block = block;
+        return m_masks;
+    }
+
+    /// @brief Returns the position of the first code unit at or after `start`
+    /// for which the corresponding bit in `select(masks)` is set,
+    /// or the length of the source if there is no such code unit.
+    template <typename Select>
+    [[nodiscard]]
+    std::size_t find(std::size_t start, Select select) noexcept
+    {
+        for (std::size_t block = start / block_size; block * block_size < m_source.length();
+             ++block) {
+            std::uint64_t bits = select(masks(block));
+            if (block == start / block_size) {
+                bits &= ~std::uint64_t { 0 } << (start % block_size);
+            }
+            if (bits != 0) {
+                return std::min(
+                    (block * block_size) + std::size_t(std::countr_zero(bits)), m_source.length()
+                );
+            }
+        }
+        return m_source.length();
+    }
+
+    /// @brief Returns the position of the first `"`, `\`, or control character
+    /// at or after `start`, i.e. the first code unit within a string that needs special handling.
+    [[nodiscard]]
+    std::size_t find_string_special(std::size_t start) noexcept
+    {
+        return find(start, [](const Block_Masks& m) {
+            return m.quote | m.backslash | m.control;
+        });
+    }
+
+    /// @brief Returns the position of the first code unit that is not whitespace
+    /// at or after `start`.
+    [[nodiscard]]
+    std::size_t find_non_whitespace(std::size_t start) noexcept
+    {
+        return find(start, [](const Block_Masks& m) { return ~m.whitespace; });
+    }
+};
+
+} // namespace ulight::json
+
+#endif
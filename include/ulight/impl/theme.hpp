@@ -0,0 +1,130 @@
+#ifndef ULIGHT_THEME_HPP
+#define ULIGHT_THEME_HPP
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "ulight/ulight.h"
+#include "ulight/ulight.hpp"
+
+namespace ulight {
+
+/// @brief A color with 8 bits per channel.
+struct RGB {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+
+    [[nodiscard]]
+    friend constexpr bool operator==(const RGB&, const RGB&)
+        = default;
+};
+
+/// @brief Parses a CSS color in the form `#rgb`, `#rgba`, `#rrggbb`, `#rrggbbaa`,
+/// or one of the basic named colors such as `green`.
+/// The alpha channel, if any, is ignored.
+/// @returns The parsed color, or `std::nullopt` if `str` is not in any supported format.
+[[nodiscard]]
+std::optional<RGB> parse_css_color(std::u8string_view str) noexcept;
+
+/// @brief Returns the `Highlight_Type` whose `highlight_type_long_string` is `str`,
+/// or `std::nullopt` if there is none.
+[[nodiscard]]
+std::optional<Highlight_Type> highlight_type_by_long_string(std::u8string_view str) noexcept;
+
+/// @brief The styling which a theme specifies for a single highlight type.
+/// Properties which are not specified by the theme are empty.
+struct Theme_Style {
+    std::optional<RGB> color = std::nullopt;
+    std::optional<RGB> background_color = std::nullopt;
+    std::optional<bool> bold = std::nullopt;
+    std::optional<bool> italic = std::nullopt;
+    std::optional<bool> underline = std::nullopt;
+    std::optional<bool> strikethrough = std::nullopt;
+
+    /// @brief Overrides every property of `*this` that is specified by `other`.
+    void merge(const Theme_Style& other) noexcept
+    {
+        const auto merge_one = [](auto& to, const auto& from) {
+            if (from) {
+                to = from;
+            }
+        };
+        merge_one(color, other.color);
+        merge_one(background_color, other.background_color);
+        merge_one(bold, other.bold);
+        merge_one(italic, other.italic);
+        merge_one(underline, other.underline);
+        merge_one(strikethrough, other.strikethrough);
+    }
+
+    /// @brief Returns `true` if the style leaves the text unchanged,
+    /// i.e. if no property is specified, or if the specified properties are all "off".
+    [[nodiscard]]
+    bool is_plain() const noexcept
+    {
+        return !color && !background_color && !bold.value_or(false) && !italic.value_or(false)
+            && !underline.value_or(false) && !strikethrough.value_or(false);
+    }
+
+    [[nodiscard]]
+    friend bool operator==(const Theme_Style&, const Theme_Style&)
+        = default;
+};
+
+/// @brief One variant of a theme, such as the `"dark"` variant of `themes/ulight.json`.
+struct Theme {
+    /// @brief The color of text without highlighting (`"foreground"`), if specified.
+    std::optional<RGB> foreground = std::nullopt;
+    /// @brief The background color of code blocks (`"background"`), if specified.
+    std::optional<RGB> background = std::nullopt;
+    /// @brief The resolved style of every `Highlight_Type`, indexed by its numeric value.
+    std::array<Theme_Style, 256> styles {};
+
+    /// @brief Returns `true` if text with the given `type` looks different from text without
+    /// highlighting.
+    /// Otherwise, it is unnecessary to mark up tokens of that type in HTML.
+    [[nodiscard]]
+    bool is_distinct(Highlight_Type type) const noexcept
+    {
+        Theme_Style style = styles[std::size_t(type)];
+        if (style.color == foreground) {
+            style.color = std::nullopt;
+        }
+        if (style.background_color == background) {
+            style.background_color = std::nullopt;
+        }
+        return !style.is_plain();
+    }
+};
+
+/// @brief Loads the `variant` (e.g. `"light"` or `"dark"`) of a theme in the format
+/// of `themes/*.json` and resolves the style for each highlight type.
+///
+/// Like in the CSS generated by `scripts/theme-to-css.js`,
+/// styles are inherited from less specific highlight types,
+/// so `id-function-decl` inherits from `id-function`, which inherits from `id`.
+/// Keys other than highlight types, `"foreground"`, and `"background"` are ignored,
+/// as are properties and values that cannot be represented.
+/// @returns `Status::ok` on success,
+/// `Status::bad_text` if `json` is not valid JSON,
+/// or `Status::bad_state` if the theme has no such variant.
+[[nodiscard]]
+Status load_theme(Theme& out, std::u8string_view json, std::u8string_view variant);
+
+/// @brief Writes an SGR escape sequence (`ESC [ ... m`) for `style` into `out`,
+/// which first resets all attributes, and then applies those of `style`.
+/// If `style.is_plain()` is `true`, nothing is written.
+/// @returns The length of the written sequence.
+[[nodiscard]]
+std::size_t to_ansi_sequence(
+    std::span<char, ULIGHT_ANSI_SEQUENCE_CAPACITY> out,
+    const Theme_Style& style
+) noexcept;
+
+} // namespace ulight
+
+#endif
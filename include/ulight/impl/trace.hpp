@@ -0,0 +1,111 @@
+#ifndef ULIGHT_TRACE_HPP
+#define ULIGHT_TRACE_HPP
+
+// Rule tracing is a profiling aid for highlighter development.
+// If the ULIGHT_TRACE_RULES macro is defined (see the CMake option of the same name),
+// every rule wrapped in ULIGHT_TRACE_RULE records how often it was attempted,
+// how often it matched, how many code units it consumed, and how many cycles it took.
+// A histogram of all rules is printed to stderr when the program exits.
+//
+// Otherwise, ULIGHT_TRACE_RULE(expr) expands to (expr), and no code is generated.
+
+#ifdef ULIGHT_TRACE_RULES
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+
+#include "ulight/ulight.hpp"
+
+namespace ulight::trace {
+
+/// @brief Counters for a single call site of `ULIGHT_TRACE_RULE`.
+/// Instances are trivially destructible so that they can still be read
+/// during program termination.
+struct Rule_Stats {
+    const char* name;
+    const char* file;
+    int line;
+
+    std::atomic<std::uint64_t> attempts = 0;
+    std::atomic<std::uint64_t> hits = 0;
+    std::atomic<std::uint64_t> bytes = 0;
+    std::atomic<std::uint64_t> cycles = 0;
+    /// @brief The next rule in the intrusive list of all registered rules.
+    Rule_Stats* next = nullptr;
+
+    [[nodiscard]]
+    Rule_Stats(const char* name, const char* file, int line) noexcept;
+};
+
+static_assert(std::is_trivially_destructible_v<Rule_Stats>);
+
+/// @brief Returns a timestamp in CPU cycles, or in nanoseconds on platforms
+/// where no cycle counter is available.
+[[nodiscard]]
+std::uint64_t cycles() noexcept;
+
+/// @brief Prints a histogram of all rules that have been registered so far to `out`,
+/// ordered by the total amount of cycles spent in each rule.
+void dump_rules(std::FILE* out);
+
+/// @brief Resets the counters of all rules that have been registered so far.
+void reset_rules() noexcept;
+
+/// @brief Invokes `rule`, recording its statistics in `stats`.
+/// A rule is considered to have matched if its result is `Status::ok`,
+/// if its result is otherwise `true` after contextual conversion to `bool`,
+/// or, if it returns `void`, if it has advanced `index`.
+template <typename F>
+decltype(auto) run_rule(Rule_Stats& stats, const std::size_t& index, F rule)
+{
+    const std::size_t start_index = index;
+    const std::uint64_t start_cycles = cycles();
+
+    const auto record = [&](bool hit) {
+        const std::uint64_t elapsed = cycles() - start_cycles;
+        stats.attempts.fetch_add(1, std::memory_order::relaxed);
+        stats.hits.fetch_add(hit ? 1 : 0, std::memory_order::relaxed);
+        stats.bytes.fetch_add(index - start_index, std::memory_order::relaxed);
+        stats.cycles.fetch_add(elapsed, std::memory_order::relaxed);
+    };
+
+    if constexpr (std::is_void_v<decltype(rule())>) {
+        rule();
+        record(index != start_index);
+    }
+    else {
+        auto result = rule();
+        if constexpr (std::is_same_v<decltype(result), Status>) {
+            record(result == Status::ok);
+        }
+        else {
+            record(static_cast<bool>(result));
+        }
+        return result;
+    }
+}
+
+} // namespace ulight::trace
+
+/// @brief Evaluates the given expression (typically a call to `expect_xyz()` or `consume_xyz()`)
+/// and records statistics about it for the enclosing call site.
+/// Must be used within a highlighter that has an `index` member.
+#define ULIGHT_TRACE_RULE(...)                                                                     \
+    (::ulight::trace::run_rule(                                                                    \
+        []() -> ::ulight::trace::Rule_Stats& {                                                     \
+            static ::ulight::trace::Rule_Stats stats { #__VA_ARGS__, __FILE__, __LINE__ };         \
+            return stats;                                                                          \
+        }(),                                                                                       \
+        index, [&]() -> decltype(auto) { return __VA_ARGS__; }                                     \
+    ))
+
+#else
+
+#define ULIGHT_TRACE_RULE(...) (__VA_ARGS__)
+
+#endif
+
+#endif
@@ -25,6 +25,8 @@
 #include "ulight/ulight.hpp"
 
 #include "ulight/impl/assert.hpp"
+#include "ulight/impl/simd.hpp"
+#include "ulight/impl/unicode_chars.hpp"
 
 namespace ulight::utf8 {
 
@@ -311,8 +313,7 @@ constexpr Code_Point_And_Length decode_and_length_or_replacement(std::u8string_v
 {
     const std::expected<Code_Point_And_Length, Error_Code> result = decode_and_length(str);
     if (!result) [[unlikely]] {
-        return { .code_point = U'\N{REPLACEMENT CHARACTER}',
-                 .length = std::max(1, int(str.length())) };
+        return { .code_point = U'\N{REPLACEMENT CHARACTER}', .length = str.empty() ? 0 : 1 };
     }
     return *result;
 }
@@ -324,10 +325,32 @@ constexpr char32_t decode_or_replacement(std::u8string_view str) noexcept
     return decode_and_length_or_replacement(str).code_point;
 }
 
+/// @brief Returns the number of code units in the first code point of `str`,
+/// or `1` if `str` does not begin with a correctly encoded code point,
+/// or `0` if `str` is empty.
+///
+/// Unlike `sequence_length`, the result is never zero for nonempty `str` and never exceeds
+/// `str.length()`, so lexers can use it to skip over malformed input.
+[[nodiscard]]
+constexpr std::size_t code_point_length_or_one(std::u8string_view str) noexcept
+{
+    if (!str.empty() && str[0] < 0x80) {
+        return 1;
+    }
+    return std::size_t(decode_and_length_or_replacement(str).length);
+}
+
 [[nodiscard]]
 constexpr std::expected<void, Error_Code> is_valid(std::u8string_view str) noexcept
 {
     while (!str.empty()) {
+        if !consteval {
+            // Most source code is ASCII, which is trivially valid.
+            str.remove_prefix(simd::ascii_prefix_length(str));
+            if (str.empty()) {
+                break;
+            }
+        }
         const std::expected<Code_Point_And_Length, Error_Code> next = decode_and_length(str);
         if (!next) {
             return std::unexpected(next.error());
@@ -381,40 +404,28 @@ public:
         return i.m_pointer == i.m_end;
     }
 
-    Code_Point_Iterator& operator++()
+    /// @brief Advances past the current code point,
+    /// or past a single code unit if it is not correctly encoded.
+    Code_Point_Iterator& operator++() noexcept
     {
-        const int length = sequence_length(*m_pointer);
-        if (length == 0 || length > m_end - m_pointer) {
-#ifdef ULIGHT_EXCEPTIONS
-            throw Unicode_Error { Error_Code::illegal_bits,
-                                  "Corrupted UTF-8 string or past the end." };
-#else
-            ULIGHT_ASSERT_UNREACHABLE(u8"Corrupted UTF-8 string or past the end.");
-#endif
-        }
-        m_pointer += length;
+        ULIGHT_DEBUG_ASSERT(m_pointer != m_end);
+        m_pointer += code_point_length_or_one({ m_pointer, m_end });
         return *this;
     }
 
-    Code_Point_Iterator operator++(int)
+    Code_Point_Iterator operator++(int) noexcept
     {
         Code_Point_Iterator copy = *this;
         ++*this;
         return copy;
     }
 
+    /// @brief Returns the current code point,
+    /// or U+FFFD REPLACEMENT CHARACTER if it is not correctly encoded.
     [[nodiscard]]
-    char32_t operator*() const
+    char32_t operator*() const noexcept
     {
-        const std::expected<Code_Point_And_Length, Error_Code> result = next();
-        if (!result) {
-#ifdef ULIGHT_EXCEPTIONS
-            throw Unicode_Error { result.error(), "Corrupted UTF-8 string or past the end." };
-#else
-            ULIGHT_ASSERT_UNREACHABLE(u8"Corrupted UTF-8 string or past the end.");
-#endif
-        }
-        return result->code_point;
+        return decode_or_replacement({ m_pointer, m_end });
     }
 
     [[nodiscard]]
@@ -526,4 +537,69 @@ constexpr Code_Units_And_Length encode8_unchecked(char32_t code_point) noexcept
 
 } // namespace ulight::utf8
 
+namespace ulight::utf16 {
+
+/// @brief The greatest amount of UTF-8 code units that a single UTF-16 code unit
+/// can be transcoded into.
+/// Code points in range [U+0800, U+FFFF] take three UTF-8 code units,
+/// whereas a surrogate pair only becomes four UTF-8 code units for two UTF-16 code units.
+inline constexpr std::size_t max_utf8_units_per_unit = 3;
+
+/// @brief Transcodes the UTF-16-encoded `str` into UTF-8, written to `out`.
+/// `out` needs to have room for at least `str.length() * max_utf8_units_per_unit` code units.
+/// @returns The amount of code units written to `out`,
+/// or the index of the first unpaired surrogate within `str`.
+[[nodiscard]]
+constexpr std::expected<std::size_t, std::size_t>
+to_utf8(std::u16string_view str, char8_t* out) noexcept
+{
+    std::size_t length = 0;
+    for (std::size_t i = 0; i < str.length(); ++i) {
+        char32_t code_point = str[i];
+        if (code_point < 0x80) {
+            out[length++] = char8_t(code_point);
+            continue;
+        }
+        if (is_surrogate(code_point)) {
+            if (!is_leading_surrogate(code_point) || i + 1 == str.length()
+                || !is_trailing_surrogate(char32_t(str[i + 1]))) {
+                return std::unexpected(i);
+            }
+            code_point = 0x10000 + ((code_point - 0xd800) << 10) + (str[++i] - 0xdc00);
+        }
+        const utf8::Code_Units_And_Length units = utf8::encode8_unchecked(code_point);
+        for (const char8_t unit : units) {
+            out[length++] = unit;
+        }
+    }
+    return length;
+}
+
+/// @brief Returns the length that the UTF-8-encoded `str` would have in UTF-16,
+/// in code units.
+/// `str` is assumed to be correctly encoded;
+/// only the leading code units of each sequence are examined.
+[[nodiscard]]
+constexpr std::size_t transcoded_length(std::u8string_view str) noexcept
+{
+    std::size_t result = 0;
+    for (std::size_t i = 0; i < str.length();) {
+        if !consteval {
+            const std::size_t ascii_length = simd::ascii_prefix_length(str.substr(i));
+            result += ascii_length;
+            i += ascii_length;
+            if (i == str.length()) {
+                break;
+            }
+        }
+        const char8_t c = str[i++];
+        // Continuation units contribute nothing,
+        // and four-unit sequences become surrogate pairs.
+        result += std::size_t((c & 0xc0) != 0x80) + std::size_t(c >= 0xf0);
+    }
+    return result;
+}
+
+} // namespace ulight::utf16
+
 #endif
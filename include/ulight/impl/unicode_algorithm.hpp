@@ -35,7 +35,6 @@ std::size_t find_if(std::u8string_view str, F predicate, bool expected, std::siz
 /// @brief Returns the position of the first code point `c` in `str` for which
 /// `predicate(c)` is `true`, in code units.
 /// If none could be found, returns `std::u8string_view::npos`.
-/// @throws Unicode_Error If decoding failed.
 template <typename F>
     requires std::is_invocable_r_v<bool, F, char32_t>
 [[nodiscard]]
@@ -48,7 +47,6 @@ find_if(std::u8string_view str, F predicate) noexcept(noexcept(predicate(char32_
 /// @brief Returns the position of the first code point `c` in `str` for which
 /// `predicate(c)` is `false`, in code units.
 /// If none could be found, returns `std::u8string_view::npos`.
-/// @throws Unicode_Error If decoding failed.
 template <typename F>
     requires std::is_invocable_r_v<bool, F, char32_t>
 [[nodiscard]]
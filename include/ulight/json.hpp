@@ -2,7 +2,11 @@
 #define ULIGHT_JSON_PARSER_HPP
 
 #include "ulight/impl/platform.h"
+#include <concepts>
+#include <string>
 #include <string_view>
+#include <type_traits>
+#include <vector>
 
 namespace ulight {
 
@@ -177,10 +181,28 @@ struct JSON_Options {
     bool allow_comments : 1 = false;
     /// @brief If `true`, converts numbers to `double` within the parser.
     bool parse_numbers : 1 = false;
+    /// @brief If `true`, the parser only keeps track of `Source_Position::code_unit`,
+    /// and `line` and `line_code_unit` are zero in all positions passed to the visitor,
+    /// except for `JSON_Visitor::error`.
+    /// This avoids searching every skipped piece of source for line breaks.
+    /// If needed, the full position can be obtained with `json_source_position`.
+    bool lazy_positions : 1 = false;
+    /// @brief If `true`, the source may contain any number of top-level values
+    /// separated by whitespace or comments, as in JSON Lines.
+    /// Otherwise, anything but whitespace and comments following the top-level value
+    /// results in `JSON_Error::illegal_character`.
+    bool allow_multiple_values : 1 = false;
     /// @brief How to handle escape sequences.
     Escape_Parsing escapes = Escape_Parsing::none;
 };
 
+/// @brief Returns the position of the code unit at the offset `code_unit` within `source`.
+/// This takes time linear in `code_unit`,
+/// so it is best used for occasional positions, such as those of errors.
+/// @param code_unit The offset, which is at most `source.length()`.
+[[nodiscard]]
+Source_Position json_source_position(std::u8string_view source, std::size_t code_unit) noexcept;
+
 /// @brief Parses a JSON string found in `source`.
 /// @param visitor The visitor,
 /// whose member functions are invoked when various part of the file are parsed.
@@ -188,12 +210,211 @@ struct JSON_Options {
 /// @param options Additional options.
 /// @returns `true` if the file was parsed successfully, else `false`.
 /// More detailed error feedback can be obtained by overriding `JSON_Visitor::error`.
+///
+/// Note that the whole source has to be consumed:
+/// content other than whitespace and comments following the top-level value is an error,
+/// unless `JSON_Options::allow_multiple_values` is set.
+/// Previously, such content was silently ignored.
 bool parse_json(JSON_Visitor& visitor, std::u8string_view source, JSON_Options options = {});
 
 /// @brief Like the overload taking `std::u8string_view`,
 /// but taking `std::string_view` for compatibility.
 bool parse_json(JSON_Visitor& visitor, std::string_view source, JSON_Options options = {});
 
+namespace json {
+
+// Whether a visitor has each of the callbacks of `JSON_Visitor`,
+// i.e. whether the callback can be invoked with the arguments that `JSON_Visitor` takes.
+// clang-format off
+template <typename T>
+concept has_line_comment = requires(T& v, const Source_Position& p, std::u8string_view s) { v.line_comment(p, s); };
+template <typename T>
+concept has_block_comment = requires(T& v, const Source_Position& p, std::u8string_view s) { v.block_comment(p, s); };
+template <typename T>
+concept has_literal = requires(T& v, const Source_Position& p, std::u8string_view s) { v.literal(p, s); };
+template <typename T>
+concept has_escape = requires(T& v, const Source_Position& p, std::u8string_view s) { v.escape(p, s); };
+template <typename T>
+concept has_escape_parse = requires(T& v, const Source_Position& p, std::u8string_view s) { v.escape(p, s, U'x'); };
+template <typename T>
+concept has_escape_parse_encode = requires(T& v, const Source_Position& p, std::u8string_view s) { v.escape(p, s, U'x', s); };
+template <typename T>
+concept has_number = requires(T& v, const Source_Position& p, std::u8string_view s) { v.number(p, s); };
+template <typename T>
+concept has_number_parse = requires(T& v, const Source_Position& p, std::u8string_view s) { v.number(p, s, 0.0); };
+template <typename T>
+concept has_null = requires(T& v, const Source_Position& p) { v.null(p); };
+template <typename T>
+concept has_boolean = requires(T& v, const Source_Position& p) { v.boolean(p, true); };
+template <typename T>
+concept has_push_string = requires(T& v, const Source_Position& p) { v.push_string(p); };
+template <typename T>
+concept has_pop_string = requires(T& v, const Source_Position& p) { v.pop_string(p); };
+template <typename T>
+concept has_push_property = requires(T& v, const Source_Position& p) { v.push_property(p); };
+template <typename T>
+concept has_pop_property = requires(T& v, const Source_Position& p) { v.pop_property(p); };
+template <typename T>
+concept has_push_object = requires(T& v, const Source_Position& p) { v.push_object(p); };
+template <typename T>
+concept has_pop_object = requires(T& v, const Source_Position& p) { v.pop_object(p); };
+template <typename T>
+concept has_push_array = requires(T& v, const Source_Position& p) { v.push_array(p); };
+template <typename T>
+concept has_pop_array = requires(T& v, const Source_Position& p) { v.pop_array(p); };
+template <typename T>
+concept has_error = requires(T& v, const Source_Position& p) {
+    { v.error(p, JSON_Error::error) } -> std::convertible_to<Error_Reaction>;
+};
+// clang-format on
+
+} // namespace json
+
+/// @brief A visitor for `parse_json` which is dispatched statically rather than virtually.
+/// Such a visitor has any nonempty subset of the member functions of `JSON_Visitor`,
+/// which need not be virtual, but have to be callable with the same arguments.
+/// Callbacks that the visitor does not have are not invoked,
+/// and cost nothing during parsing.
+/// For example, a visitor which only counts objects needs nothing but `push_object`.
+///
+/// Types derived from `JSON_Visitor` are not static visitors;
+/// they use the virtual overloads of `parse_json`.
+template <typename T>
+concept json_static_visitor = std::is_class_v<T> && !std::is_base_of_v<JSON_Visitor, T>
+    && (json::has_line_comment<T> || json::has_block_comment<T> || json::has_literal<T>
+        || json::has_escape<T> || json::has_escape_parse<T> || json::has_escape_parse_encode<T>
+        || json::has_number<T> || json::has_number_parse<T> || json::has_null<T>
+        || json::has_boolean<T> || json::has_push_string<T> || json::has_pop_string<T>
+        || json::has_push_property<T> || json::has_pop_property<T> || json::has_push_object<T>
+        || json::has_pop_object<T> || json::has_push_array<T> || json::has_pop_array<T>
+        || json::has_error<T>);
+
+/// @brief Like the overload taking `JSON_Visitor&`,
+/// but with callbacks dispatched statically.
+/// This allows callbacks to be inlined, and unused callbacks to be omitted entirely,
+/// which is considerably faster when the visitor is only interested in a few events.
+///
+/// This is defined in `ulight/impl/lang/json_parser.hpp`,
+/// which has to be included where it is called.
+template <json_static_visitor Visitor>
+bool parse_json(Visitor& visitor, std::u8string_view source, JSON_Options options = {});
+
+/// @brief Like the overload taking `std::u8string_view`,
+/// but taking `std::string_view` for compatibility.
+template <json_static_visitor Visitor>
+bool parse_json(Visitor& visitor, std::string_view source, JSON_Options options = {});
+
+namespace json {
+struct Chunk_Parser;
+} // namespace json
+
+/// @brief An incremental JSON parser which is given the source in chunks,
+/// and invokes the same visitor callbacks as `parse_json` would for the whole source.
+///
+/// Only the nesting stack and the text of a token which spans the boundary between chunks
+/// (e.g. a number, escape sequence, or comment) are retained between calls to `feed`,
+/// so memory usage is bounded by the nesting depth and the longest such token,
+/// regardless of the size of the source.
+/// Combined with `JSON_Options::allow_multiple_values`,
+/// this can be used to process JSON Lines or large arrays streamed from disk.
+///
+/// Strings are passed to `JSON_Visitor::literal` in pieces that do not cross chunk boundaries,
+/// so a string may result in more (but never fewer) calls than with `parse_json`.
+/// All `std::u8string_view` arguments of callbacks are only valid for the duration of the call.
+///
+/// Positions are relative to the start of the first chunk.
+/// If `JSON_Options::lazy_positions` is set,
+/// `line` and `line_code_unit` are zero in all positions,
+/// including those passed to `JSON_Visitor::error`,
+/// because the source is not retained for computing them.
+struct JSON_Push_Parser {
+private:
+    friend struct json::Chunk_Parser;
+
+    enum struct State : Underlying {
+        /// @brief Expecting the top-level value.
+        value,
+        /// @brief After `[`, expecting an element or `]`.
+        first_element,
+        /// @brief After `,` in an array, expecting an element.
+        element,
+        /// @brief After `{`, expecting a member or `}`.
+        first_member,
+        /// @brief After `,` in an object, expecting a member.
+        member,
+        /// @brief After a property, expecting `:`.
+        colon,
+        /// @brief After `:`, expecting the value of a member.
+        member_value,
+        /// @brief After an element or member value, expecting `,` or the end of the container.
+        after_value,
+        /// @brief Within a string or property.
+        string,
+        /// @brief After the top-level value.
+        end,
+        /// @brief An error has occurred, and all further input is rejected.
+        failed,
+    };
+
+    enum struct Token : Underlying {
+        /// @brief No token spans the boundary between chunks.
+        none,
+        number,
+        /// @brief `true`, `false`, or `null`.
+        keyword,
+        /// @brief An escape sequence within a string.
+        escape,
+        /// @brief A `/`, which may start a line or block comment.
+        comment,
+    };
+
+    enum struct Container : bool {
+        array,
+        object,
+    };
+
+    JSON_Visitor& m_visitor;
+    JSON_Options m_options;
+    State m_state = State::value;
+    /// @brief If `m_state` is `State::string`, whether the string is a property.
+    bool m_property = false;
+    /// @brief The arrays and objects which are currently open, from outermost to innermost.
+    std::vector<Container> m_stack;
+    /// @brief The position of the first code unit that has not been consumed.
+    /// If `m_token` is not `Token::none`, this is the start of that token.
+    Source_Position m_pos {};
+    /// @brief The kind of token which spans the boundary between chunks, if any.
+    Token m_token = Token::none;
+    /// @brief The code units of `m_token` that have been fed so far.
+    std::u8string m_token_text;
+
+public:
+    [[nodiscard]]
+    explicit JSON_Push_Parser(JSON_Visitor& visitor, JSON_Options options = {});
+
+    /// @brief Parses the next chunk of the source.
+    /// The chunk can be of any length, and does not need to end on a token or UTF-8 boundary.
+    /// @returns `true` if no error has occurred so far, else `false`.
+    /// Once an error has occurred, all further calls to `feed` and `finish` return `false`.
+    bool feed(std::u8string_view chunk);
+
+    /// @brief Like the overload taking `std::u8string_view`,
+    /// but taking `std::string_view` for compatibility.
+    bool feed(std::string_view chunk);
+
+    /// @brief Signals the end of the source,
+    /// completing any pending token and checking that the source is complete.
+    /// @returns `true` if the whole source was parsed successfully, else `false`.
+    bool finish();
+
+    /// @brief Returns the position of the first code unit that has not been fully consumed.
+    [[nodiscard]]
+    Source_Position position() const noexcept
+    {
+        return m_pos;
+    }
+};
+
 } // namespace ulight
 
 #endif
@@ -0,0 +1,162 @@
+#ifndef ULIGHT_JSON_DOCUMENT_HPP
+#define ULIGHT_JSON_DOCUMENT_HPP
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+
+#include "ulight/json.hpp"
+
+namespace ulight::json {
+
+enum struct Node_Type : Underlying {
+    null,
+    boolean,
+    number,
+    string,
+    array,
+    object,
+};
+
+struct Member;
+
+/// @brief A JSON value within a `Document`.
+/// Nodes are immutable and owned by the `Document` which they belong to.
+struct Node {
+private:
+    friend struct Document_Builder;
+
+    Node_Type m_type = Node_Type::null;
+    bool m_boolean = false;
+    /// @brief The length of the string, or the number of elements or members.
+    std::size_t m_size = 0;
+    union {
+        double m_number = 0;
+        const char8_t* m_string;
+        const Node* m_elements;
+        const Member* m_members;
+    };
+
+public:
+    [[nodiscard]]
+    Node_Type get_type() const noexcept
+    {
+        return m_type;
+    }
+
+    [[nodiscard]]
+    bool is_null() const noexcept
+    {
+        return m_type == Node_Type::null;
+    }
+
+    /// @brief Returns the value of a boolean node, or `false` for other types.
+    [[nodiscard]]
+    bool as_boolean() const noexcept
+    {
+        return m_type == Node_Type::boolean && m_boolean;
+    }
+
+    /// @brief Returns the value of a number node, or zero for other types.
+    [[nodiscard]]
+    double as_number() const noexcept
+    {
+        return m_type == Node_Type::number ? m_number : 0;
+    }
+
+    /// @brief Returns the value of a string node, or an empty string for other types.
+    /// The string either points into the source of the document
+    /// (if it contains no escape sequences),
+    /// or into the memory of the document.
+    [[nodiscard]]
+    std::u8string_view as_string() const noexcept
+    {
+        return m_type == Node_Type::string ? std::u8string_view { m_string, m_size }
+                                           : std::u8string_view {};
+    }
+
+    /// @brief Returns the elements of an array node, or an empty span for other types.
+    [[nodiscard]]
+    std::span<const Node> elements() const noexcept
+    {
+        return m_type == Node_Type::array ? std::span<const Node> { m_elements, m_size }
+                                          : std::span<const Node> {};
+    }
+
+    /// @brief Returns the members of an object node, sorted by key,
+    /// or an empty span for other types.
+    /// Members with the same key retain their order from the source.
+    [[nodiscard]]
+    std::span<const Member> members() const noexcept;
+
+    /// @brief Returns the number of elements or members of an array or object node,
+    /// or zero for other types.
+    [[nodiscard]]
+    std::size_t size() const noexcept
+    {
+        return m_type == Node_Type::array || m_type == Node_Type::object ? m_size : 0;
+    }
+
+    /// @brief Returns the value of the member with the given `key` in an object node,
+    /// or `nullptr` if there is no such member, or if this is not an object.
+    /// If the key appears multiple times, the first such member is returned.
+    /// This takes logarithmic time in the number of members.
+    [[nodiscard]]
+    const Node* find(std::u8string_view key) const noexcept;
+};
+
+struct Member {
+    std::u8string_view key;
+    Node value;
+};
+
+inline std::span<const Member> Node::members() const noexcept
+{
+    return m_type == Node_Type::object ? std::span<const Member> { m_members, m_size }
+                                       : std::span<const Member> {};
+}
+
+/// @brief A JSON document which provides random access to a parsed JSON source.
+///
+/// All nodes and all strings that cannot be referenced in the source directly
+/// (i.e. strings containing escape sequences) are allocated within a monotonic arena,
+/// and released at once when the document is destroyed or parsed again.
+/// The source must outlive the document.
+struct Document {
+private:
+    std::pmr::memory_resource* m_upstream;
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> m_arena;
+    const Node* m_root = nullptr;
+
+public:
+    /// @brief Constructs an empty document.
+    /// @param upstream The memory resource which the arena obtains memory from.
+    [[nodiscard]]
+    explicit Document(std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+    /// @brief Parses `source` and replaces the contents of the document with it.
+    /// Escape sequences are always decoded, and numbers are always converted to `double`,
+    /// so only `options.allow_comments` has an effect.
+    /// @returns `true` if parsing succeeded.
+    /// Otherwise, the document is empty.
+    [[nodiscard]]
+    bool parse(std::u8string_view source, JSON_Options options = {});
+
+    /// @brief Like the overload taking `std::u8string_view`,
+    /// but taking `std::string_view` for compatibility.
+    [[nodiscard]]
+    bool parse(std::string_view source, JSON_Options options = {});
+
+    /// @brief Returns the root node, or `nullptr` if the document is empty.
+    [[nodiscard]]
+    const Node* root() const noexcept
+    {
+        return m_root;
+    }
+};
+
+} // namespace ulight::json
+
+#endif
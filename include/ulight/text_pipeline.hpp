@@ -0,0 +1,164 @@
+#ifndef ULIGHT_TEXT_PIPELINE_HPP
+#define ULIGHT_TEXT_PIPELINE_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "ulight/function_ref.hpp"
+#include "ulight/ulight.hpp"
+
+#include "ulight/impl/assert.hpp"
+
+namespace ulight {
+
+/// @brief Decouples the generation of text (e.g. by `State::source_to_html`)
+/// from consuming it (e.g. writing it to a file or socket).
+///
+/// The pipeline owns `buffer_count` buffers of `buffer_size` characters.
+/// Whenever the text buffer of an attached `State` is flushed,
+/// its contents are handed over to a free buffer,
+/// which is then passed to the `sink` on a dedicated consumer thread,
+/// while highlighting continues on the calling thread.
+/// If all buffers are in flight, flushing blocks until the consumer has caught up,
+/// so the amount of memory in use is bounded.
+///
+/// The `sink` is always invoked from the consumer thread,
+/// once per flush and in the order of flushes.
+/// `finish()` (or the destructor) waits until all flushed text has been consumed.
+///
+/// This is not available in Emscripten builds, which do not support threads.
+struct [[nodiscard]] Text_Pipeline {
+    using Sink = Function_Ref<void(const char*, std::size_t)>;
+
+private:
+    struct Slot {
+        std::vector<char> data;
+        std::size_t size = 0;
+    };
+
+    Sink m_sink;
+    std::vector<char> m_staging;
+    std::vector<Slot> m_slots;
+    /// @brief The index of the next slot to be filled.
+    std::size_t m_write_index = 0;
+    /// @brief The index of the next slot to be consumed.
+    std::size_t m_read_index = 0;
+    /// @brief The amount of slots that have been filled, but not yet consumed.
+    std::size_t m_pending = 0;
+    bool m_stop = false;
+
+    std::mutex m_mutex;
+    std::condition_variable m_slot_filled;
+    std::condition_variable m_slot_freed;
+    std::thread m_consumer;
+
+public:
+    /// @param sink Receives the text in the order it was flushed.
+    /// @param buffer_size The size of each buffer,
+    /// which is also used for the text buffer of attached states.
+    /// @param buffer_count The amount of buffers that can be in flight at the same time,
+    /// which is at least `1`.
+    explicit Text_Pipeline(
+        Sink sink,
+        std::size_t buffer_size = 32 * 1024,
+        std::size_t buffer_count = 2
+    )
+        : m_sink { sink }
+        , m_staging(buffer_size)
+        , m_slots(buffer_count)
+    {
+        ULIGHT_ASSERT(buffer_size != 0);
+        ULIGHT_ASSERT(buffer_count != 0);
+        for (Slot& slot : m_slots) {
+            slot.data.resize(buffer_size);
+        }
+        m_consumer = std::thread { [this] { consume(); } };
+    }
+
+    Text_Pipeline(const Text_Pipeline&) = delete;
+    Text_Pipeline& operator=(const Text_Pipeline&) = delete;
+
+    ~Text_Pipeline()
+    {
+        finish();
+        {
+            const std::scoped_lock lock { m_mutex };
+            m_stop = true;
+        }
+        m_slot_filled.notify_one();
+        m_consumer.join();
+    }
+
+    /// @brief Sets the text buffer and `flush_text` of `state` so that text written by `state`
+    /// is passed through this pipeline.
+    /// The pipeline has to outlive any use of `state` that produces text.
+    void attach(State& state)
+    {
+        state.set_text_buffer(m_staging);
+        state.on_flush_text(this, [](const void* self, char* text, std::size_t length) {
+            const_cast<Text_Pipeline*>(static_cast<const Text_Pipeline*>(self))
+                ->submit({ text, length });
+        });
+    }
+
+    /// @brief Copies `text` into a free buffer and schedules it for consumption,
+    /// blocking while no buffer is free.
+    /// This function is not thread-safe; there may only be one producer at a time.
+    void submit(std::span<const char> text)
+    {
+        while (!text.empty()) {
+            std::unique_lock lock { m_mutex };
+            m_slot_freed.wait(lock, [this] { return m_pending < m_slots.size(); });
+
+            Slot& slot = m_slots[m_write_index];
+            // The slot is not accessed by the consumer until m_pending is incremented,
+            // so we can fill it without holding the lock.
+            lock.unlock();
+            slot.size = std::min(text.size(), slot.data.size());
+            std::memcpy(slot.data.data(), text.data(), slot.size);
+            text = text.subspan(slot.size);
+
+            lock.lock();
+            m_write_index = (m_write_index + 1) % m_slots.size();
+            ++m_pending;
+            lock.unlock();
+            m_slot_filled.notify_one();
+        }
+    }
+
+    /// @brief Blocks until all submitted text has been passed to the sink.
+    void finish()
+    {
+        std::unique_lock lock { m_mutex };
+        m_slot_freed.wait(lock, [this] { return m_pending == 0; });
+    }
+
+private:
+    void consume()
+    {
+        std::unique_lock lock { m_mutex };
+        while (true) {
+            m_slot_filled.wait(lock, [this] { return m_pending != 0 || m_stop; });
+            if (m_pending == 0) {
+                return;
+            }
+            const Slot& slot = m_slots[m_read_index];
+            lock.unlock();
+            m_sink(slot.data.data(), slot.size);
+            lock.lock();
+            m_read_index = (m_read_index + 1) % m_slots.size();
+            --m_pending;
+            m_slot_freed.notify_all();
+        }
+    }
+};
+
+} // namespace ulight
+
+#endif
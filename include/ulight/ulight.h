@@ -4,6 +4,7 @@
 
 #include <stdalign.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #ifdef __cpp_char8_t
@@ -13,6 +14,13 @@
 #define ULIGHT_HAS_CHAR8 1
 #endif
 
+#ifdef __cplusplus
+#define ULIGHT_HAS_CHAR16 1
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#include <uchar.h>
+#define ULIGHT_HAS_CHAR16 1
+#endif
+
 #ifdef __cplusplus
 #define ULIGHT_NOEXCEPT noexcept
 #else
@@ -161,7 +169,8 @@ typedef enum ulight_status {
     ULIGHT_STATUS_OK,
     /// @brief An output buffer wasn't set up properly.
     ULIGHT_STATUS_BAD_BUFFER,
-    /// @brief The provided `ulight_lang` is invalid.
+    /// @brief The provided `ulight_lang` is invalid,
+    /// or its highlighter is not built into the library.
     ULIGHT_STATUS_BAD_LANG,
     /// @brief The given source code is not correctly UTF-8 encoded.
     ULIGHT_STATUS_BAD_TEXT,
@@ -177,6 +186,12 @@ typedef enum ulight_status {
     ULIGHT_STATUS_BAD_ALLOC,
     /// @brief Something went wrong that is not described by any of the other statuses.
     ULIGHT_STATUS_INTERNAL_ERROR,
+    /// @brief Syntax highlighting stopped early because `ulight_state::is_cancelled` returned
+    /// nonzero, because `ulight_state::cancel_flag` was set,
+    /// or because `ulight_state::time_limit_ns` was exceeded.
+    /// The tokens emitted up to that point have been flushed and are valid,
+    /// but they only cover a prefix of the source code.
+    ULIGHT_STATUS_CANCELLED,
 } ulight_status;
 
 typedef enum ulight_flag {
@@ -202,6 +217,46 @@ typedef enum ulight_flag {
     /// By default, ulight "over-extends" its highlighting a bit to provide better UX,
     /// rather than maximizing conformance.
     ULIGHT_STRICT = 2,
+    /// @brief Within diffs, mark the changed words within runs of deleted lines
+    /// that are immediately followed by runs of inserted lines,
+    /// using `ULIGHT_HL_MARKUP_DELETION` and `ULIGHT_HL_MARKUP_INSERTION` tokens.
+    /// The unchanged parts of these lines remain `ULIGHT_HL_DIFF_DELETION` and
+    /// `ULIGHT_HL_DIFF_INSERTION`.
+    ///
+    /// If the lines differ too much, they are highlighted as a whole as usual,
+    /// which keeps the time taken linear in the size of the diff.
+    ULIGHT_DIFF_WORDS = 4,
+    /// @brief Within unified diffs, highlight the code in hunks
+    /// in the language of the file being changed,
+    /// as determined by `ulight_lang_from_path` for the path in the `+++` header
+    /// (or the `---` header if the file is deleted).
+    /// The old and the new version of each hunk are highlighted separately,
+    /// so constructs spanning multiple lines, like block comments, are highlighted correctly.
+    /// The leading `-`, `+`, or space of each line and any text not covered by code tokens
+    /// remain highlighted as usual.
+    ///
+    /// Hunks highlighted this way do not have changed words marked (see `ULIGHT_DIFF_WORDS`).
+    ULIGHT_DIFF_LANG = 8,
+    /// @brief Highlight source code which is not correctly UTF-8-encoded
+    /// such that the output is always correctly UTF-8-encoded.
+    /// Every malformed code unit is treated as U+FFFD REPLACEMENT CHARACTER
+    /// and is covered by a `ULIGHT_HL_ERROR` token.
+    /// Within those tokens, HTML and ANSI output replaces each malformed code unit with U+FFFD,
+    /// so the output is always correctly UTF-8-encoded.
+    ///
+    /// This is meant for untrusted input, such as crawled code.
+    /// The source is checked as tokens are produced,
+    /// instead of in a separate validation pass before highlighting,
+    /// so `ULIGHT_STATUS_BAD_TEXT` is never returned.
+    ULIGHT_LENIENT_UTF8 = 16,
+    /// @brief Do not check that the source code is correctly UTF-8-encoded before highlighting it.
+    ///
+    /// By default, the source code is checked in a separate pass before highlighting,
+    /// and `ULIGHT_STATUS_BAD_TEXT` is returned if it is not correctly UTF-8-encoded.
+    /// This flag saves that pass for source code which is known to be valid.
+    /// If the source code is malformed anyway, malformed code units are highlighted
+    /// like any other unexpected characters, and are passed through to the output as is.
+    ULIGHT_SKIP_UTF8_VALIDATION = 32,
 } ulight_flag;
 
 // TOKENS
@@ -485,6 +540,12 @@ typedef struct ulight_token {
     unsigned char type;
 } ulight_token;
 
+/// @brief A set of `ulight_highlight_type`s, with one bit per type.
+typedef struct ulight_highlight_mask {
+    /// @brief Bit `type % 8` of `bits[type / 8]` is set if `type` is in the set.
+    unsigned char bits[32];
+} ulight_highlight_mask;
+
 // MEMORY MANAGEMENT
 // =================================================================================================
 
@@ -498,9 +559,117 @@ void* ulight_alloc(size_t size, size_t alignment) ULIGHT_NOEXCEPT;
 /// passed to `ulight_alloc`.
 void ulight_free(void* pointer, size_t size, size_t alignment) ULIGHT_NOEXCEPT;
 
+// STATISTICS
+// =================================================================================================
+
+/// @brief Optional counters and timings, filled in while highlighting
+/// if `ulight_state::stats` is not null.
+///
+/// All members are accumulated rather than overwritten,
+/// so a zero-initialized `ulight_stats` object yields figures for a single document,
+/// whereas reusing the same object across calls yields totals.
+/// Times are measured using a monotonic clock and are given in nanoseconds.
+typedef struct ulight_stats {
+    /// @brief For each `ulight_highlight_type`,
+    /// the amount of tokens of that type that were emitted.
+    size_t tokens[256];
+    /// @brief The amount of times that `flush_tokens` was invoked.
+    size_t flush_tokens_calls;
+    /// @brief The amount of times that `flush_text` was invoked.
+    size_t flush_text_calls;
+    /// @brief The amount of source code units that were written to the HTML output as text,
+    /// both within tokens and in the gaps between them.
+    size_t html_text_bytes;
+    /// @brief The amount of times a nested language was highlighted,
+    /// such as CSS or JavaScript within HTML.
+    size_t nested_invocations;
+    /// @brief The greatest depth of nested languages that was reached,
+    /// where `0` means that no nested language was highlighted.
+    size_t max_nesting_depth;
+    /// @brief The time spent validating the `ulight_state` prior to highlighting.
+    unsigned long long validation_ns;
+    /// @brief The time spent lexing and highlighting,
+    /// not including the time spent within `flush_tokens`.
+    unsigned long long lexing_ns;
+    /// @brief The time spent converting tokens into HTML,
+    /// including the time spent within `flush_text`.
+    unsigned long long html_ns;
+} ulight_stats;
+
+// THEMES
+// =================================================================================================
+
+/// @brief The capacity of each escape sequence in `ulight_ansi_theme`.
+/// This is sufficient for any combination of 24-bit foreground and background colors,
+/// bold, italic, underlined, and strikethrough text.
+#define ULIGHT_ANSI_SEQUENCE_CAPACITY 48
+
+/// @brief A table of ANSI escape sequences (SGR, "Select Graphic Rendition"),
+/// used by `ulight_source_to_ansi` to style tokens in terminals.
+///
+/// Such a table is typically computed once by `ulight_ansi_theme_load_json`,
+/// and can then be reused for any amount of `ulight_source_to_ansi` calls,
+/// including concurrent ones.
+typedef struct ulight_ansi_theme {
+    /// @brief For each `ulight_highlight_type`,
+    /// the escape sequence which is written before tokens of that type.
+    /// The sequences are not null-terminated.
+    char sequences[256][ULIGHT_ANSI_SEQUENCE_CAPACITY];
+    /// @brief For each `ulight_highlight_type`, the length of the corresponding sequence.
+    /// If the length is zero, tokens of that type are written as plain text.
+    unsigned char sequence_lengths[256];
+} ulight_ansi_theme;
+
+/// @brief Initializes `theme` with a built-in theme that only uses the 16 basic terminal colors,
+/// and thus adapts to the color scheme of the terminal.
+ulight_ansi_theme* ulight_ansi_theme_init(ulight_ansi_theme* theme) ULIGHT_NOEXCEPT;
+
+/// @brief Loads the given `variant` (e.g. `"dark"` or `"light"`)
+/// of a JSON theme in the format of `themes/*.json` into `theme`,
+/// using 24-bit ("TrueColor") escape sequences.
+///
+/// Styles are inherited from less specific highlight types,
+/// like in the CSS generated from themes.
+/// For example, if the theme only specifies `id` and `id-function`,
+/// the style of `ULIGHT_HL_ID_FUNCTION_DECL` is that of `id`,
+/// overridden by the properties in `id-function`.
+/// `background` and `foreground` are ignored,
+/// so that the colors of the terminal are used for unhighlighted text.
+///
+/// Returns `ULIGHT_STATUS_BAD_TEXT` if `json` is not valid JSON,
+/// `ULIGHT_STATUS_BAD_STATE` if the theme has no such variant,
+/// and `ULIGHT_STATUS_BAD_ALLOC` if memory could not be allocated.
+/// In those cases, `theme` is left unchanged.
+ulight_status ulight_ansi_theme_load_json(
+    ulight_ansi_theme* theme,
+    const char* json,
+    size_t json_length,
+    const char* variant,
+    size_t variant_length
+) ULIGHT_NOEXCEPT;
+
+/// @brief Adds each highlight type to `mask` whose styling in the given `variant`
+/// of a JSON theme in the format of `themes/*.json` differs from unhighlighted text.
+/// Other bits in `mask` are left unchanged,
+/// so that multiple variants or themes can be combined.
+///
+/// The resulting mask can be used as `ulight_state::html_emit_mask`,
+/// so that only tokens which the theme actually styles are wrapped in HTML tags.
+/// Returns the same statuses as `ulight_ansi_theme_load_json`.
+ulight_status ulight_highlight_mask_add_theme(
+    ulight_highlight_mask* mask,
+    const char* json,
+    size_t json_length,
+    const char* variant,
+    size_t variant_length
+) ULIGHT_NOEXCEPT;
+
 // STATE AND HIGHLIGHTING
 // =================================================================================================
 
+/// @brief See `ulight_engine_new`.
+typedef struct ulight_engine ulight_engine;
+
 /// @brief Holds state for all functionality that ulight provides.
 /// Instances of ulight should be initialized using `ulight_init` (see below),
 /// and destroyed using `ulight_destroy`.
@@ -550,6 +719,72 @@ typedef struct ulight_state {
     const char* error;
     /// @brief The length of `error`, in code units.
     size_t error_length;
+
+    /// @brief If not null, statistics about highlighting are accumulated in the pointed-to
+    /// object.
+    /// If null (the default), no statistics are collected, and no overhead is incurred.
+    ulight_stats* stats;
+
+    /// @brief For HTML generation, if not null,
+    /// only tokens whose type is in the pointed-to mask are wrapped in tags.
+    /// All other tokens are written as HTML-escaped text,
+    /// merged with the adjacent text that has no highlighting.
+    /// If null (the default), every token is wrapped in tags.
+    const ulight_highlight_mask* html_emit_mask;
+
+    /// @brief Passed as the first argument into `is_cancelled`.
+    const void* is_cancelled_data;
+    /// @brief If not null, is invoked with `is_cancelled_data` periodically during highlighting.
+    /// If it returns nonzero, highlighting stops early,
+    /// and `ULIGHT_STATUS_CANCELLED` is returned.
+    /// This allows abandoning stale work, such as when the user keeps typing in an editor
+    /// while a large document is highlighted on another thread.
+    /// If null (the default), highlighting is never cancelled.
+    ///
+    /// Highlighters poll for cancellation once per iteration of their main loop,
+    /// and this function is invoked once every 256 polls.
+    /// An iteration usually matches one construct, such as an identifier, a string literal,
+    /// or a comment, each of which may span several tokens.
+    /// For TeX, an iteration matches a single character.
+    /// For COWEL, an iteration matches a run of text, an escape sequence, a comment,
+    /// or a whole directive within a document, block, or argument.
+    /// A single construct is not interrupted, however long it is,
+    /// unless it contains code in another language, such as a `<script>` element in HTML,
+    /// which is polled for cancellation on its own.
+    ///
+    /// When `ULIGHT_STATUS_CANCELLED` is returned,
+    /// the tokens emitted up to that point are a prefix of the tokens
+    /// that highlighting without cancellation emits.
+    /// `ulight_source_to_tokens` has flushed these tokens.
+    /// `ulight_source_to_html` and `ulight_source_to_ansi` have flushed the text
+    /// for the source code up to the end of the last of these tokens,
+    /// and leave out the rest of the source code.
+    /// The output of `ulight_source_to_ansi` still ends with the attributes reset.
+    int (*is_cancelled)(const void*);
+    /// @brief If not null, highlighting is cancelled once the pointed-to flag is nonzero,
+    /// as if `is_cancelled` had returned nonzero.
+    /// The flag is never modified by ulight, and it is read atomically (with relaxed ordering),
+    /// so another thread can set it while highlighting is in progress,
+    /// e.g. using `std::atomic_ref<int>` in C++.
+    /// It is checked about as often as `is_cancelled` is invoked.
+    int* cancel_flag;
+    /// @brief If nonzero, highlighting is cancelled once it has taken longer than this many
+    /// nanoseconds, measured from the start of highlighting with a monotonic clock,
+    /// as if `is_cancelled` had returned nonzero.
+    /// This allows callers to fall back to plain text within a latency budget,
+    /// such as when a huge file is pasted into an editor.
+    /// The clock is checked about as often as `is_cancelled` is invoked.
+    ///
+    /// This should not be used in WASM builds
+    /// because the WASI clock is not provided by `ulight.js`; use `is_cancelled` instead.
+    unsigned long long time_limit_ns;
+
+    /// @brief If not null, the engine which this state was initialized from
+    /// using `ulight_engine_init_state`.
+    /// Memory needed during highlighting is then obtained from the allocator of the engine,
+    /// and HTML is generated using the tags which the engine has precompiled,
+    /// as long as `html_tag_name` and `html_attr_name` are those of the engine.
+    const ulight_engine* engine;
 } ulight_state;
 
 ///  @brief "Default constructor" for `ulight_state`.
@@ -579,8 +814,35 @@ void ulight_delete(ulight_state* state) ULIGHT_NOEXCEPT;
 /// which is also user-provided.
 /// It is the caller's responsibility to store the tokens permanently if they want to,
 /// such as in a `std::vector` in C++.
+///
+/// If the source code is not correctly UTF-8-encoded,
+/// `ULIGHT_STATUS_BAD_TEXT` is returned before any tokens are produced,
+/// unless `ULIGHT_LENIENT_UTF8` or `ULIGHT_SKIP_UTF8_VALIDATION` is set.
+/// If memory cannot be allocated during highlighting, `ULIGHT_STATUS_BAD_ALLOC` is returned.
+/// Both are reported in builds with and without exceptions alike.
+///
+/// If `ULIGHT_STATUS_CANCELLED` is returned,
+/// the tokens emitted up to that point have been flushed (see `ulight_state::is_cancelled`).
 ulight_status ulight_source_to_tokens(ulight_state* state) ULIGHT_NOEXCEPT;
 
+#ifdef ULIGHT_HAS_CHAR16
+/// @brief Like `ulight_source_to_tokens`,
+/// but converts the given UTF-16-encoded code in range `[source, source + source_length)`,
+/// and the `begin` and `length` of every token are measured in UTF-16 code units.
+/// This is convenient for callers whose strings are UTF-16-encoded anyway,
+/// such as JavaScript, where editors need UTF-16 offsets for carets and selections.
+///
+/// `state->source` and `state->source_length` are not used.
+/// The source is transcoded to UTF-8 in a temporary buffer allocated with `ulight_alloc`,
+/// so `ULIGHT_STATUS_BAD_ALLOC` is returned if that allocation fails.
+/// If `source` contains unpaired surrogates, `ULIGHT_STATUS_BAD_TEXT` is returned.
+ulight_status ulight_source_to_tokens_utf16(
+    ulight_state* state,
+    const char16_t* source,
+    size_t source_length
+) ULIGHT_NOEXCEPT;
+#endif
+
 /// @brief Converts the given UTF-8-encoded code in range
 ///`[state->source, state->source + state->source_length)` into HTML,
 /// written to text buffer.
@@ -594,8 +856,227 @@ ulight_status ulight_source_to_tokens(ulight_state* state) ULIGHT_NOEXCEPT;
 ///
 /// Whenever the text buffer is full, `state->flush_text` is invoked.
 /// `state->flush_tokens` is automatically set.
+///
+/// If `ULIGHT_STATUS_CANCELLED` is returned,
+/// the HTML for the tokens emitted up to that point has been flushed,
+/// but the text following the last of these tokens is missing.
 ulight_status ulight_source_to_html(ulight_state* state) ULIGHT_NOEXCEPT;
 
+/// @brief Like `ulight_source_to_html`,
+/// but produces text that is styled for terminals using ANSI escape sequences from `theme`.
+///
+/// Consecutive tokens with the same styling share one escape sequence,
+/// and the output always ends with the attributes reset to their defaults.
+///
+/// The source code cannot inject its own control sequences into the output.
+/// To that end, C0 control characters other than tab, line feed, and carriage return,
+/// as well as U+007F DELETE, are replaced with their symbols in the Control Pictures block,
+/// such as U+241B SYMBOL FOR ESCAPE for U+001B ESCAPE.
+/// C1 control characters (U+0080 through U+009F), such as U+009B CONTROL SEQUENCE INTRODUCER,
+/// are replaced with U+FFFD REPLACEMENT CHARACTER.
+/// So is every malformed code unit, which some terminals interpret as a C1 control character,
+/// whether it is highlighted with `ULIGHT_LENIENT_UTF8` or `ULIGHT_SKIP_UTF8_VALIDATION`.
+///
+/// If `ULIGHT_STATUS_CANCELLED` is returned,
+/// the text for the tokens emitted up to that point has been flushed, followed by a reset,
+/// but the text following the last of these tokens is missing.
+///
+/// `state->html_tag_name` and `state->html_attr_name` are not used.
+ulight_status ulight_source_to_ansi(ulight_state* state, const ulight_ansi_theme* theme)
+    ULIGHT_NOEXCEPT;
+
+// SESSIONS
+// =================================================================================================
+
+/// @brief An opaque object which owns all the buffers needed to convert source code
+/// into HTML or into tokens, and keeps them alive between conversions.
+///
+/// This is useful when many sources are highlighted in succession,
+/// such as on every keystroke in a live editor,
+/// especially in WASM, where every allocation and every callback into JS has notable cost.
+/// The HTML is accumulated in a single output buffer,
+/// which can be read in one piece once highlighting is done.
+typedef struct ulight_session ulight_session;
+
+/// @brief Allocates and initializes a new session.
+/// If allocation fails, returns null.
+ulight_session* ulight_session_new(void) ULIGHT_NOEXCEPT;
+
+/// @brief Frees a session previously returned from `ulight_session_new`.
+/// `session` may be null.
+void ulight_session_delete(ulight_session* session) ULIGHT_NOEXCEPT;
+
+/// @brief Returns the state used by the session.
+/// Members such as `html_tag_name`, `stats`, `html_emit_mask`, or `is_cancelled`
+/// may be changed by the caller,
+/// and remain in effect for subsequent calls to `ulight_session_highlight`.
+/// The source, language, flags, buffers, and flush callbacks are managed by the session.
+ulight_state* ulight_session_state(ulight_session* session) ULIGHT_NOEXCEPT;
+
+/// @brief Returns a buffer owned by the session with room for at least `length` bytes,
+/// into which the source code can be written before calling `ulight_session_highlight`.
+/// This avoids allocating memory for every source in WASM.
+/// The buffer is suitably aligned for UTF-16 source code as well,
+/// which is passed to `ulight_session_tokens_utf16`.
+/// The buffer is valid until the next call to this function or until the session is deleted.
+/// If allocation fails, returns null.
+char* ulight_session_reserve_source(ulight_session* session, size_t length) ULIGHT_NOEXCEPT;
+
+/// @brief Converts the UTF-8-encoded code in range `[source, source + source_length)` into HTML,
+/// like `ulight_source_to_html`.
+/// `source` may point into the buffer returned by `ulight_session_reserve_source`.
+///
+/// The HTML replaces any previous output of the session,
+/// and can be obtained with `ulight_session_output` and `ulight_session_output_length`.
+/// If the result is not `ULIGHT_STATUS_OK`,
+/// the error is described by the `error` members of `ulight_session_state(session)`.
+ulight_status ulight_session_highlight(
+    ulight_session* session,
+    const char* source,
+    size_t source_length,
+    ulight_lang lang,
+    ulight_flag flags
+) ULIGHT_NOEXCEPT;
+
+/// @brief Returns the HTML produced by the most recent call to `ulight_session_highlight`.
+/// The output is valid until the next call to `ulight_session_highlight`
+/// or until the session is deleted.
+const char* ulight_session_output(const ulight_session* session) ULIGHT_NOEXCEPT;
+
+/// @brief Returns the length of `ulight_session_output(session)`, in bytes.
+size_t ulight_session_output_length(const ulight_session* session) ULIGHT_NOEXCEPT;
+
+/// @brief The number of `uint32_t` elements that make up one token record
+/// in `ulight_session_token_records`.
+#define ULIGHT_TOKEN_RECORD_SIZE 3
+
+/// @brief Converts the UTF-8-encoded code in range `[source, source + source_length)` into tokens,
+/// like `ulight_source_to_tokens`, but the tokens are stored within the session.
+/// `source` may point into the buffer returned by `ulight_session_reserve_source`.
+///
+/// The tokens replace any previous tokens of the session,
+/// and can be obtained with `ulight_session_token_records` and `ulight_session_token_count`.
+/// Unlike HTML, tokens are not serialized into text,
+/// so that e.g. an editor in the browser can view them in WASM memory as a `Uint32Array`,
+/// and create DOM ranges or draw text from them directly.
+///
+/// If `ULIGHT_STATUS_CANCELLED` is returned, the tokens emitted up to that point are kept.
+/// For any other failure, no tokens are kept.
+/// If `source_length` does not fit into `uint32_t`, `ULIGHT_STATUS_BAD_STATE` is returned.
+ulight_status ulight_session_tokens(
+    ulight_session* session,
+    const char* source,
+    size_t source_length,
+    ulight_lang lang,
+    ulight_flag flags
+) ULIGHT_NOEXCEPT;
+
+#ifdef ULIGHT_HAS_CHAR16
+/// @brief Like `ulight_session_tokens`,
+/// but for UTF-16-encoded code (see `ulight_source_to_tokens_utf16`),
+/// where the positions of tokens are measured in UTF-16 code units.
+ulight_status ulight_session_tokens_utf16(
+    ulight_session* session,
+    const char16_t* source,
+    size_t source_length,
+    ulight_lang lang,
+    ulight_flag flags
+) ULIGHT_NOEXCEPT;
+#endif
+
+/// @brief Returns the tokens produced by the most recent call to `ulight_session_tokens`
+/// or `ulight_session_tokens_utf16`.
+/// Each token is a record of `ULIGHT_TOKEN_RECORD_SIZE` consecutive elements,
+/// which are the `begin`, `length`, and `type` of the token, in that order.
+/// The records are valid until the next call to one of these functions
+/// or until the session is deleted.
+const uint32_t* ulight_session_token_records(const ulight_session* session) ULIGHT_NOEXCEPT;
+
+/// @brief Returns the number of tokens in `ulight_session_token_records(session)`,
+/// i.e. the number of records, not the number of elements.
+size_t ulight_session_token_count(const ulight_session* session) ULIGHT_NOEXCEPT;
+
+// ENGINES AND THREAD SAFETY
+// =================================================================================================
+
+// ulight has no global mutable state,
+// except for rule statistics in builds with the debugging option ULIGHT_TRACE_RULES.
+// Highlighting only writes to the `ulight_state` or `ulight_session` that is used,
+// to the memory provided by the caller (e.g. buffers and `stats`), and to allocated memory.
+// Therefore:
+//   - Functions which do not take a state, session, or other object to modify,
+//     such as `ulight_get_lang` or `ulight_highlight_type_short_string`,
+//     can be called from any number of threads concurrently.
+//   - A `ulight_state` or `ulight_session` must not be used by multiple threads at the same time,
+//     but it can be handed from one thread to another.
+//   - Read-only objects such as `ulight_ansi_theme`, `ulight_highlight_mask`, and `ulight_engine`
+//     can be shared by any number of threads, as long as they are not modified.
+//
+// For highlighting on many threads, it is recommended to create one `ulight_engine`
+// holding the shared configuration, and one session per thread,
+// obtained with `ulight_engine_session_new`.
+
+/// @brief The configuration of a `ulight_engine`,
+/// which should be initialized using `ulight_engine_options_init`.
+typedef struct ulight_engine_options {
+    /// @brief For HTML generation, the UTF-8-encoded name of tags.
+    const char* html_tag_name;
+    /// @brief For HTML generation, the length of tag names, in code units.
+    size_t html_tag_name_length;
+    /// @brief For HTML generation, the UTF-8-encoded name of attributes.
+    const char* html_attr_name;
+    /// @brief For HTML generation, the length of attribute names, in code units.
+    size_t html_attr_name_length;
+    /// @brief If not null, the mask which is used as `ulight_state::html_emit_mask`.
+    const ulight_highlight_mask* html_emit_mask;
+    /// @brief Allocates memory for the engine, for its sessions,
+    /// and during highlighting with states that use the engine.
+    /// Like `ulight_alloc`, it has to return null on failure,
+    /// and it has to be safe to call from multiple threads concurrently.
+    void* (*alloc)(size_t size, size_t alignment);
+    /// @brief Frees memory previously allocated with `alloc`.
+    void (*free)(void* pointer, size_t size, size_t alignment);
+} ulight_engine_options;
+
+/// @brief "Default constructor" for `ulight_engine_options`,
+/// which uses the same tag and attribute names as `ulight_init`,
+/// no emit mask, and `ulight_alloc` and `ulight_free`.
+ulight_engine_options* ulight_engine_options_init(ulight_engine_options* options) ULIGHT_NOEXCEPT;
+
+/// @brief Creates an engine, which is an immutable object holding everything
+/// that can be computed once and then shared by any number of threads.
+/// This includes the given `options`,
+/// and the opening and closing HTML tags for every highlight type.
+/// All strings and the mask in `options` are copied, so they need not outlive the engine.
+///
+/// The precomputed tables of the highlighters themselves (such as keywords)
+/// are compile-time constants, so they are shared even without an engine.
+///
+/// If `options` is null, default options are used (see `ulight_engine_options_init`).
+/// If allocation fails, or if `options` has null or empty names or a null allocator,
+/// returns null.
+ulight_engine* ulight_engine_new(const ulight_engine_options* options) ULIGHT_NOEXCEPT;
+
+/// @brief Frees an engine previously returned from `ulight_engine_new`.
+/// Every state and session using the engine has to be destroyed beforehand.
+/// `engine` may be null.
+void ulight_engine_delete(ulight_engine* engine) ULIGHT_NOEXCEPT;
+
+/// @brief Like `ulight_init`, but configures `state` according to `engine`,
+/// including the `html_tag_name`, `html_attr_name`, and `html_emit_mask` members,
+/// and sets `state->engine`.
+/// The engine has to outlive the state.
+ulight_state* ulight_engine_init_state(const ulight_engine* engine, ulight_state* state)
+    ULIGHT_NOEXCEPT;
+
+/// @brief Like `ulight_session_new`, but the state of the session is initialized
+/// by `ulight_engine_init_state`, and all memory of the session is allocated by the engine.
+/// This is a cheap, per-thread context:
+/// it holds the buffers of one thread, and refers to the shared engine for everything else.
+/// The engine has to outlive the session.
+/// If allocation fails, returns null.
+ulight_session* ulight_engine_session_new(const ulight_engine* engine) ULIGHT_NOEXCEPT;
+
 #ifdef __cplusplus
 }
 #endif
@@ -2,10 +2,12 @@
 #define ULIGHT_ULIGHT_HPP
 
 #include <cstddef>
+#include <cstdint>
 #include <new>
 #include <span>
 #include <string_view>
 #include <type_traits>
+#include <utility>
 
 #include "ulight.h"
 #include "ulight/function_ref.hpp"
@@ -90,6 +92,7 @@ enum struct Status : Underlying {
     bad_code = ULIGHT_STATUS_BAD_CODE,
     bad_alloc = ULIGHT_STATUS_BAD_ALLOC,
     internal_error = ULIGHT_STATUS_INTERNAL_ERROR,
+    cancelled = ULIGHT_STATUS_CANCELLED,
 };
 
 /// See `ulight_flag`.
@@ -97,6 +100,10 @@ enum struct Flag : Underlying {
     no_flags = ULIGHT_NO_FLAGS,
     coalesce = ULIGHT_COALESCE,
     strict = ULIGHT_STRICT,
+    diff_words = ULIGHT_DIFF_WORDS,
+    diff_lang = ULIGHT_DIFF_LANG,
+    lenient_utf8 = ULIGHT_LENIENT_UTF8,
+    skip_utf8_validation = ULIGHT_SKIP_UTF8_VALIDATION,
 };
 
 [[nodiscard]]
@@ -282,6 +289,137 @@ inline void free(void* pointer, std::size_t size, std::size_t alignment) noexcep
 using Alloc_Function = void*(std::size_t, std::size_t) noexcept;
 using Free_Function = void(void*, std::size_t, std::size_t) noexcept;
 
+/// See `ulight_stats`.
+using Stats = ulight_stats;
+
+/// See `ulight_highlight_mask`.
+struct [[nodiscard]] Highlight_Mask {
+    ulight_highlight_mask impl {};
+
+    /// @brief Returns a mask that contains every highlight type.
+    [[nodiscard]]
+    static constexpr Highlight_Mask all() noexcept
+    {
+        Highlight_Mask result;
+        for (unsigned char& byte : result.impl.bits) {
+            byte = 0xff;
+        }
+        return result;
+    }
+
+    [[nodiscard]]
+    constexpr bool contains(Highlight_Type type) const noexcept
+    {
+        const auto index = std::size_t(type);
+        return (impl.bits[index / 8] >> (index % 8)) & 1;
+    }
+
+    constexpr void insert(Highlight_Type type) noexcept
+    {
+        const auto index = std::size_t(type);
+        impl.bits[index / 8] |= static_cast<unsigned char>(1u << (index % 8));
+    }
+
+    constexpr void erase(Highlight_Type type) noexcept
+    {
+        const auto index = std::size_t(type);
+        impl.bits[index / 8] &= static_cast<unsigned char>(~(1u << (index % 8)));
+    }
+
+    /// See `ulight_highlight_mask_add_theme`.
+    [[nodiscard]]
+    Status add_theme(std::string_view json, std::string_view variant) noexcept
+    {
+        return Status(ulight_highlight_mask_add_theme(
+            &impl, json.data(), json.length(), variant.data(), variant.length()
+        ));
+    }
+};
+
+/// See `ulight_ansi_theme`.
+struct [[nodiscard]] ANSI_Theme {
+    ulight_ansi_theme impl;
+
+    /// See `ulight_ansi_theme_init`.
+    ANSI_Theme() noexcept
+    {
+        ulight_ansi_theme_init(&impl);
+    }
+
+    /// See `ulight_ansi_theme_load_json`.
+    [[nodiscard]]
+    Status load_json(std::string_view json, std::string_view variant) noexcept
+    {
+        return Status(ulight_ansi_theme_load_json(
+            &impl, json.data(), json.length(), variant.data(), variant.length()
+        ));
+    }
+
+    /// See `ulight_ansi_theme_load_json`.
+    [[nodiscard]]
+    Status load_json(std::u8string_view json, std::u8string_view variant) noexcept
+    {
+        return Status(ulight_ansi_theme_load_json(
+            &impl, reinterpret_cast<const char*>(json.data()), json.length(),
+            reinterpret_cast<const char*>(variant.data()), variant.length()
+        ));
+    }
+
+    /// @brief Returns the escape sequence that is written before tokens of the given `type`.
+    [[nodiscard]]
+    std::string_view get_sequence(Highlight_Type type) const noexcept
+    {
+        const auto index = std::size_t(type);
+        return { impl.sequences[index], impl.sequence_lengths[index] };
+    }
+};
+
+/// @brief An owning wrapper for `ulight_engine`.
+/// See `ulight_engine_new`.
+struct [[nodiscard]] Engine {
+    ulight_engine* impl;
+
+    /// See `ulight_engine_new`.
+    /// The engine uses default options.
+    /// If allocation fails, `impl` is null.
+    Engine() noexcept
+        : impl { ulight_engine_new(nullptr) }
+    {
+    }
+
+    /// See `ulight_engine_new`.
+    /// If allocation fails or `options` are invalid, `impl` is null.
+    explicit Engine(const ulight_engine_options& options) noexcept
+        : impl { ulight_engine_new(&options) }
+    {
+    }
+
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+
+    Engine(Engine&& other) noexcept
+        : impl { std::exchange(other.impl, nullptr) }
+    {
+    }
+
+    Engine& operator=(Engine&& other) noexcept
+    {
+        std::swap(impl, other.impl);
+        return *this;
+    }
+
+    ~Engine()
+    {
+        ulight_engine_delete(impl);
+    }
+
+    [[nodiscard]]
+    explicit operator bool() const noexcept
+    {
+        return impl != nullptr;
+    }
+};
+
 /// See `ulight_state`.
 struct [[nodiscard]] State {
     ulight_state impl;
@@ -292,6 +430,12 @@ struct [[nodiscard]] State {
         ulight_init(&impl);
     }
 
+    /// See `ulight_engine_init_state`.
+    explicit State(const Engine& engine) noexcept
+    {
+        ulight_engine_init_state(engine.impl, &impl);
+    }
+
     [[nodiscard]]
     std::string_view get_source() const noexcept
     {
@@ -375,7 +519,7 @@ struct [[nodiscard]] State {
     void set_html_attr_name(std::string_view name) noexcept
     {
         impl.html_attr_name = name.data();
-        impl.html_tag_name_length = name.length();
+        impl.html_attr_name_length = name.length();
     }
 
     void set_text_buffer(std::span<char> buffer)
@@ -425,6 +569,51 @@ struct [[nodiscard]] State {
                  impl.text_buffer_length };
     }
 
+    [[nodiscard]]
+    Stats* get_stats() const noexcept
+    {
+        return impl.stats;
+    }
+
+    /// See `ulight_state::stats`.
+    void set_stats(Stats* stats) noexcept
+    {
+        impl.stats = stats;
+    }
+
+    /// See `ulight_state::html_emit_mask`.
+    void set_html_emit_mask(const Highlight_Mask* mask) noexcept
+    {
+        impl.html_emit_mask = mask ? &mask->impl : nullptr;
+    }
+
+    /// See `ulight_state::is_cancelled`.
+    /// `action` may be null, in which case highlighting is never cancelled.
+    void on_poll_cancelled(const void* data, int action(const void*)) noexcept
+    {
+        impl.is_cancelled = action;
+        impl.is_cancelled_data = data;
+    }
+
+    /// See `ulight_state::is_cancelled`.
+    void on_poll_cancelled(Function_Ref<int()> action) noexcept
+    {
+        on_poll_cancelled(action.get_entity(), action.get_invoker());
+    }
+
+    /// See `ulight_state::cancel_flag`.
+    void set_cancel_flag(int* flag) noexcept
+    {
+        impl.cancel_flag = flag;
+    }
+
+    /// See `ulight_state::time_limit_ns`.
+    /// A limit of zero means that there is no limit.
+    void set_time_limit_ns(unsigned long long nanoseconds) noexcept
+    {
+        impl.time_limit_ns = nanoseconds;
+    }
+
     /// See `ulight_source_to_tokens`.
     [[nodiscard]]
     Status source_to_tokens() noexcept
@@ -432,6 +621,13 @@ struct [[nodiscard]] State {
         return Status(ulight_source_to_tokens(&impl));
     }
 
+    /// See `ulight_source_to_tokens_utf16`.
+    [[nodiscard]]
+    Status source_to_tokens_utf16(std::u16string_view source) noexcept
+    {
+        return Status(ulight_source_to_tokens_utf16(&impl, source.data(), source.length()));
+    }
+
     /// See `ulight_source_to_html`.
     [[nodiscard]]
     Status source_to_html() noexcept
@@ -439,6 +635,13 @@ struct [[nodiscard]] State {
         return Status(ulight_source_to_html(&impl));
     }
 
+    /// See `ulight_source_to_ansi`.
+    [[nodiscard]]
+    Status source_to_ansi(const ANSI_Theme& theme) noexcept
+    {
+        return Status(ulight_source_to_ansi(&impl, &theme.impl));
+    }
+
     [[nodiscard]]
     std::string_view get_error_string() const noexcept
     {
@@ -454,6 +657,136 @@ struct [[nodiscard]] State {
 
 static_assert(std::is_trivially_copyable_v<State>);
 
+/// @brief An owning wrapper for `ulight_session`.
+/// See `ulight_session_new`.
+struct [[nodiscard]] Session {
+    ulight_session* impl;
+
+    /// See `ulight_session_new`.
+    /// If allocation fails, `impl` is null.
+    Session() noexcept
+        : impl { ulight_session_new() }
+    {
+    }
+
+    /// See `ulight_engine_session_new`.
+    /// If allocation fails, `impl` is null.
+    explicit Session(const Engine& engine) noexcept
+        : impl { ulight_engine_session_new(engine.impl) }
+    {
+    }
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    Session(Session&& other) noexcept
+        : impl { std::exchange(other.impl, nullptr) }
+    {
+    }
+
+    Session& operator=(Session&& other) noexcept
+    {
+        std::swap(impl, other.impl);
+        return *this;
+    }
+
+    ~Session()
+    {
+        ulight_session_delete(impl);
+    }
+
+    [[nodiscard]]
+    explicit operator bool() const noexcept
+    {
+        return impl != nullptr;
+    }
+
+    /// See `ulight_session_state`.
+    [[nodiscard]]
+    ulight_state* get_state() noexcept
+    {
+        return ulight_session_state(impl);
+    }
+
+    /// See `ulight_session_reserve_source`.
+    [[nodiscard]]
+    std::span<char> reserve_source(std::size_t length) noexcept
+    {
+        char* const result = ulight_session_reserve_source(impl, length);
+        return { result, result ? length : 0 };
+    }
+
+    /// See `ulight_session_highlight`.
+    [[nodiscard]]
+    Status highlight(std::string_view source, Lang lang, Flag flags = Flag::no_flags) noexcept
+    {
+        return Status(ulight_session_highlight(
+            impl, source.data(), source.size(), ulight_lang(lang), ulight_flag(flags)
+        ));
+    }
+
+    /// See `ulight_session_highlight`.
+    [[nodiscard]]
+    Status highlight(std::u8string_view source, Lang lang, Flag flags = Flag::no_flags) noexcept
+    {
+        return Status(ulight_session_highlight(
+            impl, reinterpret_cast<const char*>(source.data()), source.size(), ulight_lang(lang),
+            ulight_flag(flags)
+        ));
+    }
+
+    /// See `ulight_session_output`.
+    [[nodiscard]]
+    std::string_view get_output() const noexcept
+    {
+        return { ulight_session_output(impl), ulight_session_output_length(impl) };
+    }
+
+    /// See `ulight_session_tokens`.
+    [[nodiscard]]
+    Status tokens(std::string_view source, Lang lang, Flag flags = Flag::no_flags) noexcept
+    {
+        return Status(ulight_session_tokens(
+            impl, source.data(), source.size(), ulight_lang(lang), ulight_flag(flags)
+        ));
+    }
+
+    /// See `ulight_session_tokens`.
+    [[nodiscard]]
+    Status tokens(std::u8string_view source, Lang lang, Flag flags = Flag::no_flags) noexcept
+    {
+        return Status(ulight_session_tokens(
+            impl, reinterpret_cast<const char*>(source.data()), source.size(), ulight_lang(lang),
+            ulight_flag(flags)
+        ));
+    }
+
+    /// See `ulight_session_tokens_utf16`.
+    [[nodiscard]]
+    Status tokens_utf16(std::u16string_view source, Lang lang, Flag flags = Flag::no_flags) noexcept
+    {
+        return Status(ulight_session_tokens_utf16(
+            impl, source.data(), source.size(), ulight_lang(lang), ulight_flag(flags)
+        ));
+    }
+
+    /// See `ulight_session_token_records`.
+    /// The size of the result is `ULIGHT_TOKEN_RECORD_SIZE` times the number of tokens.
+    [[nodiscard]]
+    std::span<const std::uint32_t> get_token_records() const noexcept
+    {
+        return { ulight_session_token_records(impl),
+                 ulight_session_token_count(impl) * ULIGHT_TOKEN_RECORD_SIZE };
+    }
+
+    [[nodiscard]]
+    std::string_view get_error_string() const noexcept
+    {
+        const ulight_state* const state = ulight_session_state(impl);
+        return { state->error, state->error_length };
+    }
+};
+
 } // namespace ulight
 
 #endif
@@ -0,0 +1,54 @@
+#ifndef ULIGHT_BENCH_HPP
+#define ULIGHT_BENCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <span>
+#include <string_view>
+
+#include "ulight/function_ref.hpp"
+
+namespace ulight::bench {
+
+/// @brief Runs `f` `repetitions` times and returns the fastest run in nanoseconds.
+/// The fastest run is the least affected by noise, such as other processes or frequency scaling.
+[[nodiscard]]
+inline double fastest_ns(Function_Ref<void()> f, std::size_t repetitions = 10)
+{
+    double result = 0;
+    for (std::size_t i = 0; i < repetitions; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const auto end = std::chrono::steady_clock::now();
+        const double ns = double(std::chrono::nanoseconds(end - start).count());
+        result = i == 0 ? ns : std::min(result, ns);
+    }
+    return result;
+}
+
+inline void print_result(std::string_view label, double ns, std::size_t bytes)
+{
+    const double mib_per_s = double(bytes) / (ns / 1e9) / (1024.0 * 1024.0);
+    std::cout << "  " << label << ": " << (ns / 1'000'000.0) << " ms (" << mib_per_s
+              << " MiB/s)\n";
+}
+
+/// @brief Compares building `ulight::json::Document` against building an equivalent tree with a
+/// `JSON_Visitor` that uses standard containers.
+/// @param args Optionally, the path of a JSON file to use instead of generated input.
+int json_document(std::span<const std::string_view> args);
+
+/// @brief Compares the conversion of JSON numbers to `double` against `std::strtod`,
+/// for numbers as they typically appear in metrics dumps.
+int json_numbers(std::span<const std::string_view> args);
+
+/// @brief Measures how the throughput of HTML generation scales with the number of threads,
+/// where every thread has its own session, and all threads share one `ulight::Engine`.
+/// @param args Optionally, the paths of source files to use instead of generated input.
+int engine_scaling(std::span<const std::string_view> args);
+
+} // namespace ulight::bench
+
+#endif
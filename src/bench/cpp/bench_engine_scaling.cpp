@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ulight/ulight.hpp"
+
+#include "ulight/impl/io.hpp"
+
+#include "bench.hpp"
+
+namespace ulight::bench {
+namespace {
+
+struct Corpus_File {
+    std::u8string source;
+    Lang lang;
+};
+
+/// @brief Generates a mix of C++ and JavaScript code with comments, strings, and numbers,
+/// so that the output contains plenty of tags and escaped characters.
+[[nodiscard]]
+std::vector<Corpus_File> generate_corpus()
+{
+    std::u8string cpp;
+    std::u8string js;
+    for (int i = 0; i < 2000; ++i) {
+        cpp += u8"// Computes the sum of the elements.\n"
+               u8"template <typename T>\n"
+               u8"T sum(const std::vector<T>& v) { T r = 0; for (auto x : v) r += x * 2.5; "
+               u8"return r < 0 ? -r : r; }\n";
+        js += u8"const element = document.querySelector(\"#main > .item\"); // <&>\n"
+              u8"let total = 0x1f + 1e3; function f(a, b) { return a?.b ?? `t${a}`; }\n";
+    }
+    return { { std::move(cpp), Lang::cpp }, { std::move(js), Lang::javascript } };
+}
+
+/// @brief Highlights every file of `corpus` to HTML `rounds` times using `session`.
+/// @returns The total size of the output, which prevents the work from being optimized away.
+std::size_t highlight_corpus(Session& session, std::span<const Corpus_File> corpus, int rounds)
+{
+    std::size_t output_size = 0;
+    for (int round = 0; round < rounds; ++round) {
+        for (const Corpus_File& file : corpus) {
+            if (session.highlight(file.source, file.lang) != Status::ok) {
+                std::cerr << "Highlighting failed: " << session.get_error_string() << '\n';
+                return 0;
+            }
+            output_size += session.get_output().size();
+        }
+    }
+    return output_size;
+}
+
+} // namespace
+
+int engine_scaling(std::span<const std::string_view> args)
+{
+    std::vector<Corpus_File> corpus;
+    for (const std::string_view path : args) {
+        std::vector<char8_t> file;
+        if (!load_utf8_file_or_error(file, path)) {
+            return 1;
+        }
+        const Lang lang = lang_from_path(path);
+        if (lang == Lang::none) {
+            std::cerr << "Unknown language of file: " << path << '\n';
+            return 1;
+        }
+        corpus.push_back({ { file.begin(), file.end() }, lang });
+    }
+    if (corpus.empty()) {
+        corpus = generate_corpus();
+    }
+
+    std::size_t corpus_bytes = 0;
+    for (const Corpus_File& file : corpus) {
+        corpus_bytes += file.source.size();
+    }
+    constexpr int rounds = 4;
+    const unsigned max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::cout << "engine_scaling (" << corpus.size() << " files, " << corpus_bytes
+              << " bytes, up to " << max_threads << " threads)\n";
+
+    // Every thread shares the same engine, and only ever writes to its own session.
+    const Engine engine;
+    if (!engine) {
+        std::cerr << "Creating the engine failed.\n";
+        return 1;
+    }
+
+    double single_thread_ns = 0;
+    for (unsigned thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+        std::vector<Session> sessions;
+        for (unsigned i = 0; i < thread_count; ++i) {
+            sessions.emplace_back(engine);
+            if (!sessions.back()) {
+                std::cerr << "Creating a session failed.\n";
+                return 1;
+            }
+        }
+        std::vector<std::size_t> output_sizes(thread_count);
+
+        const auto run = [&] {
+            std::vector<std::jthread> threads;
+            threads.reserve(thread_count);
+            for (unsigned i = 0; i < thread_count; ++i) {
+                threads.emplace_back([&, i] {
+                    output_sizes[i] = highlight_corpus(sessions[i], corpus, rounds);
+                });
+            }
+        };
+        const double ns = fastest_ns(run, 5);
+        if (thread_count == 1) {
+            single_thread_ns = ns;
+        }
+
+        // Every thread does the same amount of work,
+        // so perfect scaling keeps the time constant as threads are added.
+        const std::string label = std::to_string(thread_count) + " threads";
+        print_result(label, ns, corpus_bytes * rounds * thread_count);
+        std::cout << "    speedup " << (single_thread_ns * thread_count / ns) << "x (output "
+                  << output_sizes[0] << " bytes per thread)\n";
+    }
+    return 0;
+}
+
+} // namespace ulight::bench
@@ -0,0 +1,215 @@
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ulight/json.hpp"
+#include "ulight/json_document.hpp"
+
+#include "ulight/impl/io.hpp"
+
+#include "bench.hpp"
+
+namespace ulight::bench {
+namespace {
+
+// A straightforward tree that one would build without an arena:
+// every string, array, and object is a separate allocation, and lookup is linear.
+struct Naive_Value;
+using Naive_Array = std::vector<Naive_Value>;
+using Naive_Object = std::vector<std::pair<std::u8string, Naive_Value>>;
+
+struct Naive_Value {
+    std::variant<std::nullptr_t, bool, double, std::u8string, Naive_Array, Naive_Object> value;
+};
+
+[[nodiscard]]
+const Naive_Value* naive_find(const Naive_Value& object, std::u8string_view key)
+{
+    const auto* const members = std::get_if<Naive_Object>(&object.value);
+    if (!members) {
+        return nullptr;
+    }
+    for (const auto& [k, v] : *members) {
+        if (k == key) {
+            return &v;
+        }
+    }
+    return nullptr;
+}
+
+struct Naive_Visitor final : JSON_Visitor {
+    std::vector<Naive_Value> stack;
+    std::vector<std::u8string> keys;
+    std::u8string current;
+    std::optional<Naive_Value> root;
+
+    void literal(const Source_Position&, std::u8string_view chars) final
+    {
+        current += chars;
+    }
+    void escape(const Source_Position&, std::u8string_view, char32_t, std::u8string_view code_units)
+        final
+    {
+        current += code_units;
+    }
+    void number(const Source_Position&, std::u8string_view, double value) final
+    {
+        insert({ value });
+    }
+    void null(const Source_Position&) final
+    {
+        insert({ nullptr });
+    }
+    void boolean(const Source_Position&, bool value) final
+    {
+        insert({ value });
+    }
+    void push_string(const Source_Position&) final
+    {
+        current.clear();
+    }
+    void pop_string(const Source_Position&) final
+    {
+        insert({ current });
+    }
+    void push_property(const Source_Position&) final
+    {
+        current.clear();
+    }
+    void pop_property(const Source_Position&) final
+    {
+        keys.push_back(current);
+    }
+    void push_object(const Source_Position&) final
+    {
+        stack.push_back({ Naive_Object {} });
+    }
+    void pop_object(const Source_Position&) final
+    {
+        pop();
+    }
+    void push_array(const Source_Position&) final
+    {
+        stack.push_back({ Naive_Array {} });
+    }
+    void pop_array(const Source_Position&) final
+    {
+        pop();
+    }
+
+private:
+    void pop()
+    {
+        Naive_Value value = std::move(stack.back());
+        stack.pop_back();
+        insert(std::move(value));
+    }
+
+    void insert(Naive_Value&& value)
+    {
+        if (stack.empty()) {
+            root = std::move(value);
+        }
+        else if (auto* const array = std::get_if<Naive_Array>(&stack.back().value)) {
+            array->push_back(std::move(value));
+        }
+        else if (auto* const object = std::get_if<Naive_Object>(&stack.back().value)) {
+            object->emplace_back(std::move(keys.back()), std::move(value));
+            keys.pop_back();
+        }
+    }
+};
+
+/// @brief Generates an array of objects resembling a typical API response.
+[[nodiscard]]
+std::u8string generate_source(std::size_t objects)
+{
+    std::u8string result = u8"[\n";
+    for (std::size_t i = 0; i < objects; ++i) {
+        const std::string digits = std::to_string(i);
+        const std::u8string n { digits.begin(), digits.end() };
+        result += u8R"(  { "id": )" + n + u8R"(, "name": "item )" + n
+            + u8R"(", "tags": ["a", "b\tc"], "price": 12.5, "active": true, "parent": null,)"
+            + u8R"( "description": "A somewhat longer piece of text without escapes",)"
+            + u8R"( "nested": { "x": 1, "y": 2, "z": 3 }, "zeta": false })";
+        result += i + 1 == objects ? u8"\n" : u8",\n";
+    }
+    result += u8"]\n";
+    return result;
+}
+
+constexpr std::u8string_view lookup_keys[] { u8"id", u8"zeta", u8"nested", u8"missing" };
+
+} // namespace
+
+int json_document(std::span<const std::string_view> args)
+{
+    std::u8string source;
+    if (!args.empty()) {
+        std::vector<char8_t> file;
+        if (!load_utf8_file_or_error(file, args[0])) {
+            return 1;
+        }
+        source.assign(file.begin(), file.end());
+    }
+    else {
+        source = generate_source(20'000);
+    }
+    std::cout << "json_document (" << source.size() << " bytes)\n";
+
+    constexpr JSON_Options options { .parse_numbers = true,
+                                     .escapes = Escape_Parsing::parse_encode };
+
+    std::optional<Naive_Value> naive_root;
+    const auto build_naive = [&] {
+        Naive_Visitor visitor;
+        if (!parse_json(visitor, source, options)) {
+            std::cerr << "Parsing failed.\n";
+            std::exit(1);
+        }
+        naive_root = std::move(visitor.root);
+    };
+    json::Document document;
+    const auto build_document = [&] {
+        if (!document.parse(source)) {
+            std::cerr << "Parsing failed.\n";
+            std::exit(1);
+        }
+    };
+    print_result("build naive", fastest_ns(build_naive), source.size());
+    print_result("build document", fastest_ns(build_document), source.size());
+
+    // Lookups of every key in every object which is an element of the root array.
+    std::size_t found = 0;
+    const auto lookup_naive = [&] {
+        for (const Naive_Value& element : std::get<Naive_Array>(naive_root->value)) {
+            for (const std::u8string_view key : lookup_keys) {
+                found += naive_find(element, key) != nullptr;
+            }
+        }
+    };
+    const auto lookup_document = [&] {
+        for (const json::Node& element : document.root()->elements()) {
+            for (const std::u8string_view key : lookup_keys) {
+                found += element.find(key) != nullptr;
+            }
+        }
+    };
+    if (std::holds_alternative<Naive_Array>(naive_root->value)) {
+        print_result("lookup naive", fastest_ns(lookup_naive), source.size());
+        print_result("lookup document", fastest_ns(lookup_document), source.size());
+    }
+    // Printing the count prevents the lookups from being optimized away.
+    std::cout << "  (" << found << " lookups succeeded)\n";
+    return 0;
+}
+
+} // namespace ulight::bench
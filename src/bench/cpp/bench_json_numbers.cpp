@@ -0,0 +1,110 @@
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ulight/json.hpp"
+
+#include "ulight/impl/lang/json.hpp"
+#include "ulight/impl/lang/json_number.hpp"
+#include "ulight/impl/lang/json_parser.hpp"
+
+#include "bench.hpp"
+
+namespace ulight::bench {
+namespace {
+
+/// @brief Generates numbers like those found in metrics dumps:
+/// mostly integers such as counters and timestamps, and some decimals with few digits.
+[[nodiscard]]
+std::vector<std::string> generate_numbers(std::size_t count)
+{
+    std::default_random_engine rng { 12345 };
+    std::uniform_int_distribution<int> kind_distribution { 0, 9 };
+    std::uniform_int_distribution<long long> counter_distribution { 0, 1'000'000 };
+    std::uniform_int_distribution<long long> timestamp_distribution { 1'600'000'000'000,
+                                                                      1'800'000'000'000 };
+    std::uniform_real_distribution<double> ratio_distribution { 0, 1 };
+
+    std::vector<std::string> result;
+    result.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const int kind = kind_distribution(rng);
+        if (kind < 5) {
+            result.push_back(std::to_string(counter_distribution(rng)));
+        }
+        else if (kind < 7) {
+            result.push_back(std::to_string(timestamp_distribution(rng)));
+        }
+        else if (kind < 9) {
+            // e.g. "0.734", like a ratio rounded to a few digits
+            const auto thousandths = static_cast<int>(ratio_distribution(rng) * 1000);
+            result.push_back("0." + std::to_string(1000 + thousandths).substr(1));
+        }
+        else {
+            // e.g. "3.141592653589793e-5", like a value printed with full precision
+            result.push_back(std::to_string(ratio_distribution(rng)) + "123456789e-5");
+        }
+    }
+    return result;
+}
+
+struct Sum_Visitor {
+    double sum = 0;
+
+    void number(const Source_Position&, std::u8string_view, double value)
+    {
+        sum += value;
+    }
+};
+
+} // namespace
+
+int json_numbers(std::span<const std::string_view>)
+{
+    const std::vector<std::string> numbers = generate_numbers(1'000'000);
+    std::size_t total_bytes = 0;
+    std::u8string source = u8"[";
+    for (const std::string& n : numbers) {
+        total_bytes += n.size();
+        source.append(n.begin(), n.end());
+        source += u8',';
+    }
+    source.back() = u8']';
+    std::cout << "json_numbers (" << numbers.size() << " numbers, " << source.size()
+              << " bytes)\n";
+
+    double sum = 0;
+    const auto convert_strtod = [&] {
+        for (const std::string& n : numbers) {
+            sum += std::strtod(n.c_str(), nullptr);
+        }
+    };
+    const auto convert_ulight = [&] {
+        for (const std::string& n : numbers) {
+            const std::u8string_view str { reinterpret_cast<const char8_t*>(n.data()), n.size() };
+            sum += json::parse_number(str, json::match_number(str)).value_or(0);
+        }
+    };
+    const auto parse_document = [&] {
+        Sum_Visitor visitor;
+        if (!parse_json(visitor, source, { .parse_numbers = true })) {
+            std::cerr << "Parsing failed.\n";
+            std::exit(1);
+        }
+        sum += visitor.sum;
+    };
+
+    print_result("std::strtod", fastest_ns(convert_strtod), total_bytes);
+    print_result("json::parse_number", fastest_ns(convert_ulight), total_bytes);
+    print_result("parse_json", fastest_ns(parse_document), source.size());
+    // Printing the sum prevents the conversions from being optimized away.
+    std::cout << "  (sum " << sum << ")\n";
+    return 0;
+}
+
+} // namespace ulight::bench
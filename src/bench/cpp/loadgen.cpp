@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <semaphore>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ulight/ulight.hpp"
+
+#include "ulight/impl/assert.hpp"
+#include "ulight/impl/io.hpp"
+#include "ulight/impl/server_protocol.hpp"
+
+namespace ulight::server {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void print_usage(std::string_view program)
+{
+    std::cerr << "Usage: " << program
+              << " --socket=PATH [--connections=N] [--depth=N] [--requests=N]"
+                 " [--format=html|ansi|tokens] [FILE...]\n";
+    std::cerr << "Sends requests to a running ulight-server and reports throughput and latency.\n";
+    std::cerr << "  --socket=PATH      The socket that ulight-server listens on.\n";
+    std::cerr << "  --connections=N    The number of concurrent connections (default: 1).\n";
+    std::cerr << "  --depth=N          The number of requests in flight per connection\n"
+                 "                     (default: 32).\n";
+    std::cerr << "  --requests=N       The number of requests per connection (default: 10000).\n";
+    std::cerr << "  --format=FORMAT    The requested output format (default: html).\n";
+    std::cerr << "  FILE...            The files to send in turn (default: generated C++ code).\n";
+}
+
+struct Request_Source {
+    std::string source;
+    Lang lang;
+};
+
+struct Connection_Result {
+    /// @brief The time from sending each request to receiving its response, in nanoseconds.
+    std::vector<double> latencies_ns;
+    std::size_t source_bytes = 0;
+    std::size_t output_bytes = 0;
+    std::size_t errors = 0;
+    bool failed = false;
+};
+
+/// @brief Sends `requests` requests on a new connection to `socket`,
+/// keeping up to `depth` of them in flight,
+/// and receives the responses, which may arrive in any order.
+[[nodiscard]]
+Connection_Result run_connection(
+    std::string_view socket,
+    std::span<const Request_Source> sources,
+    Output_Format format,
+    std::uint32_t requests,
+    std::ptrdiff_t depth
+)
+{
+    Connection_Result result;
+    const int fd = connect_unix_socket(socket);
+    if (fd < 0) {
+        std::cerr << socket << ": failed to connect: " << std::strerror(errno) << '\n';
+        result.failed = true;
+        return result;
+    }
+
+    // The sender stores the time at which each request is sent,
+    // and the receiver loads it once the response with the same id arrives.
+    std::vector<std::atomic<Clock::rep>> send_times(requests);
+    std::counting_semaphore<> window { depth };
+    std::atomic<bool> send_failed = false;
+
+    std::jthread sender { [&] {
+        for (std::uint32_t id = 0; id < requests; ++id) {
+            window.acquire();
+            const Request_Source& request = sources[id % sources.size()];
+            const Request_Prefix prefix = encode_request_prefix(
+                { .id = id, .lang = request.lang, .format = format, .flags = Flag::no_flags },
+                request.source.size()
+            );
+            const Clock::rep now = Clock::now().time_since_epoch().count();
+            send_times[id].store(now, std::memory_order::release);
+            if (!write_all(fd, prefix, request.source)) {
+                send_failed = true;
+                break;
+            }
+            result.source_bytes += request.source.size();
+        }
+        // Closing our side lets the server know that no more requests follow,
+        // but it still sends the remaining responses.
+        ::shutdown(fd, SHUT_WR);
+    } };
+
+    result.latencies_ns.reserve(requests);
+    std::vector<char> payload;
+    for (std::uint32_t received = 0; received < requests; ++received) {
+        std::array<char, frame_size_size> size_bytes;
+        if (read_exact(fd, size_bytes) != size_bytes.size()) {
+            if (!send_failed) {
+                std::cerr << "The server closed the connection unexpectedly.\n";
+            }
+            result.failed = true;
+            break;
+        }
+        payload.resize(load_u32(size_bytes));
+        const std::optional<Response_Header> header = read_exact(fd, payload) == payload.size()
+            ? decode_response_header(payload)
+            : std::nullopt;
+        if (!header || header->id >= requests) {
+            std::cerr << "Received a malformed response.\n";
+            result.failed = true;
+            break;
+        }
+        const auto now = Clock::now().time_since_epoch().count();
+        const auto sent = send_times[header->id].load(std::memory_order::acquire);
+        result.latencies_ns.push_back(double(now - sent));
+        result.output_bytes += payload.size() - response_header_size;
+        result.errors += header->status != Status::ok;
+        window.release();
+    }
+
+    if (result.failed) {
+        // Unblocks the sender, whether it waits for the window or for the socket.
+        ::shutdown(fd, SHUT_RDWR);
+        window.release(depth);
+    }
+    sender.join();
+    ::close(fd);
+    return result;
+}
+
+/// @brief Generates a C++ source file of roughly `size` bytes.
+[[nodiscard]]
+std::string generate_source(std::size_t size)
+{
+    static constexpr std::string_view snippet
+        = "// Computes the sum of the elements.\n"
+          "template <typename T>\n"
+          "T sum(const std::vector<T>& v) { T r = 0; for (auto x : v) r += x * 2.5; return r; }\n";
+    std::string result;
+    while (result.size() < size) {
+        result += snippet;
+    }
+    return result;
+}
+
+[[nodiscard]]
+bool parse_positive(std::string_view arg, std::string_view prefix, std::size_t& out)
+{
+    const std::string_view value = arg.substr(prefix.length());
+    const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), out);
+    if (ec != std::errc {} || end != value.data() + value.size() || out == 0) {
+        std::cerr << arg << ": expected a positive number.\n";
+        return false;
+    }
+    return true;
+}
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+int main(int argc, const char** argv)
+{
+    const std::span<const char*> args { argv, std::size_t(argc) };
+    ULIGHT_ASSERT(!args.empty());
+
+    std::string_view socket;
+    std::size_t connections = 1;
+    std::size_t depth = 32;
+    std::size_t requests = 10'000;
+    Output_Format format = Output_Format::html;
+    std::vector<Request_Source> sources;
+    for (const std::string_view arg : args.subspan(1)) {
+        if (arg.starts_with("--socket=")) {
+            socket = arg.substr(std::string_view("--socket=").length());
+        }
+        else if (arg.starts_with("--connections=")) {
+            if (!parse_positive(arg, "--connections=", connections)) {
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg.starts_with("--depth=")) {
+            if (!parse_positive(arg, "--depth=", depth)) {
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg.starts_with("--requests=")) {
+            if (!parse_positive(arg, "--requests=", requests)) {
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "--format=html") {
+            format = Output_Format::html;
+        }
+        else if (arg == "--format=ansi") {
+            format = Output_Format::ansi;
+        }
+        else if (arg == "--format=tokens") {
+            format = Output_Format::tokens;
+        }
+        else if (arg.starts_with("--")) {
+            std::cerr << arg << ": unknown option.\n";
+            print_usage(args[0]);
+            return EXIT_FAILURE;
+        }
+        else {
+            std::vector<char8_t> file;
+            if (!load_utf8_file_or_error(file, arg)) {
+                return EXIT_FAILURE;
+            }
+            const Lang lang = lang_from_path(arg);
+            if (lang == Lang::none) {
+                std::cerr << arg << ": failed to recognize language from file path.\n";
+                return EXIT_FAILURE;
+            }
+            sources.push_back({ { file.begin(), file.end() }, lang });
+        }
+    }
+    if (socket.empty() || requests > std::numeric_limits<std::uint32_t>::max()) {
+        print_usage(args[0]);
+        return EXIT_FAILURE;
+    }
+    if (sources.empty()) {
+        sources.push_back({ generate_source(4096), Lang::cpp });
+    }
+
+    std::vector<Connection_Result> results(connections);
+    const auto start = Clock::now();
+    {
+        std::vector<std::jthread> threads;
+        for (std::size_t i = 0; i < connections; ++i) {
+            threads.emplace_back([&, i] {
+                results[i] = run_connection(
+                    socket, sources, format, std::uint32_t(requests), std::ptrdiff_t(depth)
+                );
+            });
+        }
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> latencies;
+    std::size_t source_bytes = 0;
+    std::size_t output_bytes = 0;
+    std::size_t errors = 0;
+    bool failed = false;
+    for (const Connection_Result& r : results) {
+        latencies.insert(latencies.end(), r.latencies_ns.begin(), r.latencies_ns.end());
+        source_bytes += r.source_bytes;
+        output_bytes += r.output_bytes;
+        errors += r.errors;
+        failed |= r.failed;
+    }
+    if (latencies.empty()) {
+        std::cerr << "No responses were received.\n";
+        return EXIT_FAILURE;
+    }
+    std::ranges::sort(latencies);
+    const auto percentile_us = [&](double p) {
+        const auto index = std::size_t(p / 100.0 * double(latencies.size() - 1));
+        return latencies[index] / 1000.0;
+    };
+
+    constexpr double mib = 1024.0 * 1024.0;
+    std::cout << "ulight-loadgen (" << connections << " connections, depth " << depth << ", "
+              << latencies.size() << " responses)\n";
+    std::cout << "  throughput: " << (double(latencies.size()) / seconds) << " requests/s, "
+              << (double(source_bytes) / mib / seconds) << " MiB/s of source, "
+              << (double(output_bytes) / mib / seconds) << " MiB/s of output\n";
+    std::cout << "  latency: p50 " << percentile_us(50) << " us, p90 " << percentile_us(90)
+              << " us, p99 " << percentile_us(99) << " us, p99.9 " << percentile_us(99.9)
+              << " us, max " << (latencies.back() / 1000.0) << " us\n";
+    std::cout << "  errors: " << errors << '\n';
+    return failed || errors != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+} // namespace
+} // namespace ulight::server
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+int main(int argc, const char** argv)
+{
+    return ulight::server::main(argc, argv);
+}
@@ -0,0 +1,50 @@
+#include <iostream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace ulight::bench {
+namespace {
+
+struct Benchmark {
+    std::string_view name;
+    int (*run)(std::span<const std::string_view> args);
+};
+
+constexpr Benchmark benchmarks[] {
+    { "json_document", json_document },
+    { "json_numbers", json_numbers },
+    { "engine_scaling", engine_scaling },
+};
+
+void print_usage(std::string_view program)
+{
+    std::cerr << "Usage: " << program << " BENCHMARK [ARGS...]\n";
+    std::cerr << "Available benchmarks:\n";
+    for (const Benchmark& b : benchmarks) {
+        std::cerr << "  " << b.name << '\n';
+    }
+}
+
+} // namespace
+} // namespace ulight::bench
+
+int main(int argc, const char** argv)
+{
+    using namespace ulight::bench;
+
+    const std::vector<std::string_view> args(argv, argv + argc);
+    if (args.size() < 2) {
+        print_usage(args.empty() ? "ulight-bench" : args[0]);
+        return 1;
+    }
+    for (const Benchmark& b : benchmarks) {
+        if (b.name == args[1]) {
+            return b.run(std::span { args }.subspan(2));
+        }
+    }
+    print_usage(args[0]);
+    return 1;
+}
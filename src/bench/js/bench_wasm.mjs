@@ -0,0 +1,107 @@
+// Benchmarks WASM builds of ulight in a headless JS runtime, such as Node.js.
+//
+// Usage (from the repository root, after building with Emscripten):
+//     node src/bench/js/bench_wasm.mjs [www/ulight.wasm [www/ulight-simd.wasm ...]]
+//
+// Every given module converts the same corpus (all files in test/highlight) to HTML with toHtml,
+// and to token records with toTokens, both from bytes and from strings,
+// and the fastest of several rounds is reported for each.
+
+import { readFile, readdir } from "node:fs/promises";
+import { extname, join } from "node:path";
+import { performance } from "node:perf_hooks";
+
+import {
+    UlightWasm, isSimdSupported, tokenRecordSize, wasmImportObject
+} from "../../../www/js/ulight.js";
+
+const corpusDirectory = "test/highlight";
+const rounds = 20;
+
+/**
+ * @param {string} directory
+ * @returns {Promise<string[]>} The paths of all files in `directory`, recursively.
+ */
+async function listFiles(directory) {
+    const entries = await readdir(directory, { withFileTypes: true, recursive: true });
+    return entries
+        .filter(entry => entry.isFile())
+        .map(entry => join(entry.parentPath ?? entry.path, entry.name))
+        .sort();
+}
+
+/**
+ * @param {UlightWasm} wasm
+ * @returns {Promise<{source:Uint8Array;text:string;lang:number}[]>}
+ */
+async function loadCorpus(wasm) {
+    const decoder = new TextDecoder();
+    const corpus = [];
+    for (const path of await listFiles(corpusDirectory)) {
+        const lang = wasm.getLanguageId(extname(path).substring(1));
+        if (lang !== 0) {
+            const source = await readFile(path);
+            corpus.push({ source, text: decoder.decode(source), lang });
+        }
+    }
+    return corpus;
+}
+
+/**
+ * @param {string} path The path of the `.wasm` file.
+ * @returns {Promise<UlightWasm>}
+ */
+async function instantiate(path) {
+    const bytes = await readFile(path);
+    const wasm = new UlightWasm(await WebAssembly.instantiate(bytes, wasmImportObject));
+    await wasm.init();
+    return wasm;
+}
+
+/**
+ * Runs `convert` over the whole corpus several times.
+ * @param {{source:Uint8Array;text:string;lang:number}[]} corpus
+ * @param {(entry:{source:Uint8Array;text:string;lang:number}) => number} convert
+ * Converts one entry and returns the size of the output.
+ * @returns {{fastest:number;outputSize:number}}
+ * The fastest time in milliseconds, and the total size of the output.
+ */
+function measure(corpus, convert) {
+    let fastest = Infinity;
+    let outputSize = 0;
+    for (let round = 0; round < rounds; ++round) {
+        outputSize = 0;
+        const start = performance.now();
+        for (const entry of corpus) {
+            outputSize += convert(entry);
+        }
+        fastest = Math.min(fastest, performance.now() - start);
+    }
+    return { fastest, outputSize };
+}
+
+const paths = process.argv.length > 2
+    ? process.argv.slice(2)
+    : ["www/ulight.wasm", ...(isSimdSupported() ? ["www/ulight-simd.wasm"] : [])];
+
+let corpus = null;
+for (const path of paths) {
+    const wasm = await instantiate(path);
+    corpus ??= await loadCorpus(wasm);
+    const totalBytes = corpus.reduce((sum, { source }) => sum + source.length, 0);
+
+    const count = records => records.length / tokenRecordSize;
+    const benchmarks = [
+        ["toHtml(bytes)", ({ source, lang }) => wasm.toHtml(source, lang).length, "chars of HTML"],
+        ["toHtml(string)", ({ text, lang }) => wasm.toHtml(text, lang).length, "chars of HTML"],
+        ["toTokens(bytes)", ({ source, lang }) => count(wasm.toTokens(source, lang)), "tokens"],
+        ["toTokens(string)", ({ text, lang }) => count(wasm.toTokens(text, lang)), "tokens"],
+    ];
+    for (const [name, convert, unit] of benchmarks) {
+        const { fastest, outputSize } = measure(corpus, convert);
+        const megabytesPerSecond = totalBytes / 1e6 / (fastest / 1e3);
+        console.log(
+            `${path} ${name}: ${fastest.toFixed(2)} ms for ${corpus.length} files, `
+            + `${totalBytes} bytes (${megabytesPerSecond.toFixed(1)} MB/s, ${outputSize} ${unit})`);
+    }
+}
@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ulight/json.hpp"
+#include "ulight/json_document.hpp"
+
+#include "ulight/impl/assert.hpp"
+
+#include "ulight/impl/lang/json_parser.hpp"
+
+namespace ulight::json {
+
+/// @brief A static JSON visitor (see `json_static_visitor`) which builds the nodes of a document.
+///
+/// Values are collected in `pending` until their enclosing array or object is complete,
+/// at which point they are moved into a contiguous allocation in the arena.
+/// Thus, the elements and members of every array and object are contiguous,
+/// and only one allocation is made per array and object.
+struct Document_Builder {
+private:
+    std::pmr::memory_resource* m_arena;
+    /// @brief The elements and members of all arrays and objects that are not yet complete.
+    /// Elements of arrays have an empty key.
+    std::vector<Member> m_pending;
+    /// @brief For every array and object that is not yet complete,
+    /// the index of its first element or member in `m_pending`.
+    /// The member before that is a placeholder which holds the key of the array or object.
+    std::vector<std::size_t> m_frames;
+
+    /// @brief The most recently parsed property key.
+    std::u8string_view m_key;
+    /// @brief The string that is currently being parsed, as long as it consists of at most one
+    /// piece of literal text, which can be referenced in the source.
+    std::u8string_view m_string;
+    /// @brief The string that is currently being parsed, if it could not be referenced in the
+    /// source because it is made up of multiple pieces or escape sequences.
+    std::u8string m_string_buffer;
+    bool m_string_buffered = false;
+
+public:
+    Node root;
+
+    [[nodiscard]]
+    explicit Document_Builder(std::pmr::memory_resource* arena)
+        : m_arena { arena }
+    {
+    }
+
+    void literal(const Source_Position&, std::u8string_view chars)
+    {
+        if (!m_string_buffered && m_string.empty()) {
+            m_string = chars;
+            return;
+        }
+        buffer_string();
+        m_string_buffer += chars;
+    }
+    void escape(const Source_Position&, std::u8string_view, char32_t, std::u8string_view code_units)
+    {
+        // The code units are only valid for the duration of the call, so they must be copied.
+        buffer_string();
+        m_string_buffer += code_units;
+    }
+
+    void number(const Source_Position&, std::u8string_view, double value)
+    {
+        Node node;
+        node.m_type = Node_Type::number;
+        node.m_number = value;
+        insert_value(node);
+    }
+    void null(const Source_Position&)
+    {
+        insert_value(Node {});
+    }
+    void boolean(const Source_Position&, bool value)
+    {
+        Node node;
+        node.m_type = Node_Type::boolean;
+        node.m_boolean = value;
+        insert_value(node);
+    }
+
+    void push_string(const Source_Position&)
+    {
+        begin_string();
+    }
+    void pop_string(const Source_Position&)
+    {
+        const std::u8string_view str = end_string();
+        Node node;
+        node.m_type = Node_Type::string;
+        node.m_size = str.size();
+        node.m_string = str.data();
+        insert_value(node);
+    }
+
+    void push_property(const Source_Position&)
+    {
+        begin_string();
+    }
+    void pop_property(const Source_Position&)
+    {
+        m_key = end_string();
+    }
+
+    void push_object(const Source_Position&)
+    {
+        push_container();
+    }
+    void pop_object(const Source_Position&)
+    {
+        const auto [key, start] = pop_container();
+        const std::span<const Member> members { m_pending.begin() + std::ptrdiff_t(start),
+                                                m_pending.end() };
+        auto* const result = allocate<Member>(members.size());
+        std::ranges::uninitialized_copy(members, std::span { result, members.size() });
+        std::ranges::stable_sort(result, result + members.size(), {}, &Member::key);
+
+        Node node;
+        node.m_type = Node_Type::object;
+        node.m_size = members.size();
+        node.m_members = result;
+        finish_container(key, start, node);
+    }
+
+    void push_array(const Source_Position&)
+    {
+        push_container();
+    }
+    void pop_array(const Source_Position&)
+    {
+        const auto [key, start] = pop_container();
+        const std::span<const Member> elements { m_pending.begin() + std::ptrdiff_t(start),
+                                                 m_pending.end() };
+        auto* const result = allocate<Node>(elements.size());
+        std::ranges::uninitialized_copy(
+            elements | std::views::transform(&Member::value), std::span { result, elements.size() }
+        );
+
+        Node node;
+        node.m_type = Node_Type::array;
+        node.m_size = elements.size();
+        node.m_elements = result;
+        finish_container(key, start, node);
+    }
+
+private:
+    template <typename T>
+    [[nodiscard]]
+    T* allocate(std::size_t count)
+    {
+        if (count == 0) {
+            return nullptr;
+        }
+        return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void begin_string()
+    {
+        m_string = {};
+        m_string_buffer.clear();
+        m_string_buffered = false;
+    }
+
+    void buffer_string()
+    {
+        if (!m_string_buffered) {
+            m_string_buffer = m_string;
+            m_string_buffered = true;
+        }
+    }
+
+    [[nodiscard]]
+    std::u8string_view end_string()
+    {
+        if (!m_string_buffered) {
+            return m_string;
+        }
+        auto* const result = allocate<char8_t>(m_string_buffer.size());
+        std::ranges::copy(m_string_buffer, result);
+        return { result, m_string_buffer.size() };
+    }
+
+    void insert_value(const Node& node)
+    {
+        if (m_frames.empty()) {
+            root = node;
+        }
+        else {
+            m_pending.push_back({ std::exchange(m_key, {}), node });
+        }
+    }
+
+    void push_container()
+    {
+        m_pending.push_back({ std::exchange(m_key, {}), Node {} });
+        m_frames.push_back(m_pending.size());
+    }
+
+    struct Container {
+        std::u8string_view key;
+        std::size_t start;
+    };
+
+    [[nodiscard]]
+    Container pop_container()
+    {
+        ULIGHT_ASSERT(!m_frames.empty());
+        const std::size_t start = m_frames.back();
+        m_frames.pop_back();
+        return { m_pending[start - 1].key, start };
+    }
+
+    void finish_container(std::u8string_view key, std::size_t start, const Node& node)
+    {
+        m_pending.resize(start - 1);
+        m_key = key;
+        insert_value(node);
+    }
+};
+
+const Node* Node::find(std::u8string_view key) const noexcept
+{
+    const std::span<const Member> all = members();
+    const auto it = std::ranges::lower_bound(all, key, {}, &Member::key);
+    return it != all.end() && it->key == key ? &it->value : nullptr;
+}
+
+Document::Document(std::pmr::memory_resource* upstream)
+    : m_upstream { upstream }
+{
+}
+
+bool Document::parse(std::u8string_view source, JSON_Options options)
+{
+    // The size of the source is a reasonable initial size for the arena,
+    // which grows geometrically if more memory is needed.
+    m_arena = std::make_unique<std::pmr::monotonic_buffer_resource>(
+        std::max(source.size(), std::size_t { 1024 }), m_upstream
+    );
+    m_root = nullptr;
+
+    options.parse_numbers = true;
+    options.lazy_positions = true;
+    options.allow_multiple_values = false;
+    options.escapes = Escape_Parsing::parse_encode;
+
+    Document_Builder builder { m_arena.get() };
+    if (!parse_json(builder, source, options)) {
+        m_arena.reset();
+        return false;
+    }
+    auto* const root = static_cast<Node*>(m_arena->allocate(sizeof(Node), alignof(Node)));
+    std::construct_at(root, builder.root);
+    m_root = root;
+    return true;
+}
+
+bool Document::parse(std::string_view source, JSON_Options options)
+{
+    const std::u8string_view u8source { reinterpret_cast<const char8_t*>(source.data()),
+                                        source.length() };
+    return parse(u8source, options);
+}
+
+} // namespace ulight::json
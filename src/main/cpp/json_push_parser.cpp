@@ -0,0 +1,625 @@
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "ulight/json.hpp"
+
+#include "ulight/impl/ascii_chars.hpp"
+#include "ulight/impl/assert.hpp"
+#include "ulight/impl/simd.hpp"
+#include "ulight/impl/unicode.hpp"
+
+#include "ulight/impl/lang/json.hpp"
+#include "ulight/impl/lang/json_number.hpp"
+
+namespace ulight {
+namespace json {
+
+/// @brief Parses a single chunk on behalf of a `JSON_Push_Parser`.
+///
+/// All state which outlives the chunk is stored in the `JSON_Push_Parser`,
+/// so this is only a view of the chunk along with helpers for consuming it.
+/// The behavior (including the callbacks and the positions and kinds of errors)
+/// mirrors `json::Parser`, except that strings may be split into multiple literals.
+struct Chunk_Parser {
+private:
+    using State = JSON_Push_Parser::State;
+    using Token = JSON_Push_Parser::Token;
+    using Container = JSON_Push_Parser::Container;
+
+    JSON_Push_Parser& self;
+    JSON_Visitor& out;
+    std::u8string_view chunk;
+    /// @brief The offset of the first code unit in `chunk` that has not been consumed.
+    std::size_t offset = 0;
+    /// @brief Used to skip over whitespace and the contents of strings in bulk.
+    Block_Index index;
+
+public:
+    [[nodiscard]]
+    Chunk_Parser(JSON_Push_Parser& self, std::u8string_view chunk)
+        : self { self }
+        , out { self.m_visitor }
+        , chunk { chunk }
+        , index { chunk }
+    {
+    }
+
+    /// @brief Consumes the whole chunk.
+    /// If a token at the end of the chunk is incomplete, it is retained in `self.m_token_text`.
+    [[nodiscard]]
+    bool operator()()
+    {
+        if (!continue_token()) {
+            return false;
+        }
+        while (offset < chunk.length()) {
+            if (!step()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief Completes any pending token and checks that the source may end at this point.
+    [[nodiscard]]
+    bool finish()
+    {
+        while (self.m_token != Token::none) {
+            // There is no more input, so everything retained is the token
+            // (or a prefix of it, which the token-specific functions diagnose).
+            const Token token = std::exchange(self.m_token, Token::none);
+            const std::u8string text = std::exchange(self.m_token_text, {});
+            if (!consume_token_and_rest(token, text, text.length())) {
+                return false;
+            }
+        }
+
+        switch (self.m_state) {
+        case State::end: return true;
+        case State::value: return error(JSON_Error::error);
+        case State::string: return error(JSON_Error::unterminated_string);
+        case State::first_element:
+        case State::element: return error(JSON_Error::unterminated_array);
+        case State::first_member:
+        case State::member: return error(JSON_Error::unterminated_object);
+        case State::colon:
+        case State::member_value: return error(JSON_Error::valueless_member);
+        case State::after_value: {
+            return error(
+                self.m_stack.back() == Container::array ? JSON_Error::unterminated_array
+                                                        : JSON_Error::unterminated_object
+            );
+        }
+        case State::failed: return false;
+        }
+        ULIGHT_ASSERT_UNREACHABLE(u8"Invalid state.");
+    }
+
+private:
+    /// @brief Reports `e` to the visitor at the current position.
+    /// @returns `false`, for convenience.
+    bool error(JSON_Error e)
+    {
+        out.error(self.m_pos, e);
+        self.m_state = State::failed;
+        return false;
+    }
+
+    /// @brief Reports an error for a character which is not allowed in the current state.
+    bool unexpected_character()
+    {
+        return error(
+            self.m_state == State::colon ? JSON_Error::valueless_member
+                                         : JSON_Error::illegal_character
+        );
+    }
+
+    /// @brief Moves the current position past `text`, which may contain line breaks.
+    void advance(std::u8string_view text)
+    {
+        self.m_pos.code_unit += text.length();
+        if (self.m_options.lazy_positions) {
+            return;
+        }
+        const std::size_t last_newline = text.rfind(u8'\n');
+        if (last_newline == std::u8string_view::npos) {
+            self.m_pos.line_code_unit += text.length();
+            return;
+        }
+        self.m_pos.line += std::size_t(std::ranges::count(text, u8'\n'));
+        self.m_pos.line_code_unit = text.length() - last_newline - 1;
+    }
+
+    /// @brief Moves the current position by `amount` code units, none of which are line breaks.
+    void advance_on_same_line(std::size_t amount)
+    {
+        self.m_pos.code_unit += amount;
+        if (!self.m_options.lazy_positions) {
+            self.m_pos.line_code_unit += amount;
+        }
+    }
+
+    /// @brief Consumes `amount` code units of the chunk, which may contain line breaks.
+    void skip(std::size_t amount)
+    {
+        advance(chunk.substr(offset, amount));
+        offset += amount;
+    }
+
+    /// @brief Consumes `amount` code units of the chunk, none of which are line breaks.
+    void skip_on_same_line(std::size_t amount)
+    {
+        advance_on_same_line(amount);
+        offset += amount;
+    }
+
+    [[nodiscard]]
+    bool step()
+    {
+        if (self.m_state == State::string) {
+            return consume_string_contents();
+        }
+
+        skip(index.find_non_whitespace(offset) - offset);
+        if (offset == chunk.length()) {
+            return true;
+        }
+        const char8_t c = chunk[offset];
+        if (c == u8'/' && self.m_options.allow_comments) {
+            return begin_token(Token::comment);
+        }
+
+        switch (self.m_state) {
+        case State::value:
+        case State::element:
+        case State::first_element: {
+            if (self.m_state == State::first_element && c == u8']') {
+                return close(Container::array);
+            }
+            return begin_value(c);
+        }
+        case State::member_value: {
+            if (c == u8'}' || c == u8',') {
+                return error(JSON_Error::valueless_member);
+            }
+            return begin_value(c);
+        }
+        case State::first_member:
+        case State::member: {
+            if (self.m_state == State::first_member && c == u8'}') {
+                return close(Container::object);
+            }
+            if (c != u8'"') {
+                return unexpected_character();
+            }
+            out.push_property(self.m_pos);
+            skip_on_same_line(1);
+            self.m_state = State::string;
+            self.m_property = true;
+            return true;
+        }
+        case State::colon: {
+            if (c != u8':') {
+                return unexpected_character();
+            }
+            skip_on_same_line(1);
+            self.m_state = State::member_value;
+            return true;
+        }
+        case State::after_value: {
+            const Container container = self.m_stack.back();
+            if (c == u8',') {
+                skip_on_same_line(1);
+                self.m_state = container == Container::array ? State::element : State::member;
+                return true;
+            }
+            if (c == (container == Container::array ? u8']' : u8'}')) {
+                return close(container);
+            }
+            return unexpected_character();
+        }
+        case State::end: {
+            if (!self.m_options.allow_multiple_values) {
+                return unexpected_character();
+            }
+            return begin_value(c);
+        }
+        case State::string:
+        case State::failed: break;
+        }
+        ULIGHT_ASSERT_UNREACHABLE(u8"Invalid state.");
+    }
+
+    [[nodiscard]]
+    bool begin_value(char8_t c)
+    {
+        switch (c) {
+        case u8'"': {
+            out.push_string(self.m_pos);
+            skip_on_same_line(1);
+            self.m_state = State::string;
+            self.m_property = false;
+            return true;
+        }
+        case u8'[': {
+            out.push_array(self.m_pos);
+            skip_on_same_line(1);
+            self.m_stack.push_back(Container::array);
+            self.m_state = State::first_element;
+            return true;
+        }
+        case u8'{': {
+            out.push_object(self.m_pos);
+            skip_on_same_line(1);
+            self.m_stack.push_back(Container::object);
+            self.m_state = State::first_member;
+            return true;
+        }
+        case u8'-':
+        case u8'0':
+        case u8'1':
+        case u8'2':
+        case u8'3':
+        case u8'4':
+        case u8'5':
+        case u8'6':
+        case u8'7':
+        case u8'8':
+        case u8'9': {
+            return begin_token(Token::number);
+        }
+        case u8't':
+        case u8'f':
+        case u8'n': {
+            return begin_token(Token::keyword);
+        }
+        default: return unexpected_character();
+        }
+    }
+
+    /// @brief Consumes the closing `]` or `}` of the innermost container.
+    [[nodiscard]]
+    bool close(Container container)
+    {
+        ULIGHT_DEBUG_ASSERT(!self.m_stack.empty() && self.m_stack.back() == container);
+        if (container == Container::array) {
+            out.pop_array(self.m_pos);
+        }
+        else {
+            out.pop_object(self.m_pos);
+        }
+        skip_on_same_line(1);
+        self.m_stack.pop_back();
+        end_value();
+        return true;
+    }
+
+    void end_value()
+    {
+        self.m_state = self.m_stack.empty() ? State::end : State::after_value;
+    }
+
+    [[nodiscard]]
+    bool consume_string_contents()
+    {
+        // Everything up to the next quote, backslash, or control character is literal.
+        const std::size_t special = index.find_string_special(offset);
+        if (special != offset) {
+            out.literal(self.m_pos, chunk.substr(offset, special - offset));
+            skip_on_same_line(special - offset);
+        }
+        if (offset == chunk.length()) {
+            return true;
+        }
+        switch (chunk[offset]) {
+        case u8'"': {
+            if (self.m_property) {
+                out.pop_property(self.m_pos);
+                skip_on_same_line(1);
+                self.m_state = State::colon;
+            }
+            else {
+                out.pop_string(self.m_pos);
+                skip_on_same_line(1);
+                end_value();
+            }
+            return true;
+        }
+        case u8'\\': {
+            return begin_token(Token::escape);
+        }
+        default: {
+            ULIGHT_DEBUG_ASSERT(chunk[offset] < 0x20);
+            return error(JSON_Error::illegal_character);
+        }
+        }
+    }
+
+    /// @brief Returns the length of the token at the start of `text`,
+    /// or `std::nullopt` if `text` ends before the end of the token can be determined.
+    /// @param from The length of a prefix of `text` which was previously searched
+    /// for the end of the token without success.
+    [[nodiscard]]
+    static std::optional<std::size_t> find_token_end(
+        Token token,
+        std::u8string_view text,
+        std::size_t from
+    )
+    {
+        switch (token) {
+        case Token::number: {
+            // A number ends before the first character that cannot be part of any number.
+            // If the result is not a valid number, this is diagnosed later.
+            for (std::size_t i = from; i < text.length(); ++i) {
+                const char8_t c = text[i];
+                if (!is_ascii_digit(c) && c != u8'.' && c != u8'e' && c != u8'E' && c != u8'+'
+                    && c != u8'-') {
+                    return i;
+                }
+            }
+            return {};
+        }
+        case Token::keyword: {
+            const std::size_t length = text.starts_with(u8'f') ? 5 : 4;
+            return text.length() >= length ? std::optional<std::size_t> { length } : std::nullopt;
+        }
+        case Token::escape: {
+            if (text.length() < 2) {
+                return {};
+            }
+            const std::size_t length = text[1] == u8'u' ? 6 : 2;
+            return text.length() >= length ? std::optional<std::size_t> { length } : std::nullopt;
+        }
+        case Token::comment: {
+            if (text.length() < 2) {
+                return {};
+            }
+            if (text[1] == u8'/') {
+                // Line terminators are up to three code units long,
+                // so the last two code units of the previous search are searched again.
+                for (std::size_t i = std::max(from, 4uz) - 2; i < text.length(); ++i) {
+                    if (text[i] == u8'\n' || text[i] == u8'\r') {
+                        return i;
+                    }
+                    if (text[i] == 0xe2) {
+                        if (i + 3 > text.length()) {
+                            return {};
+                        }
+                        if (text.substr(i).starts_with(u8"\N{LINE SEPARATOR}")
+                            || text.substr(i).starts_with(u8"\N{PARAGRAPH SEPARATOR}")) {
+                            return i;
+                        }
+                    }
+                }
+                return {};
+            }
+            if (text[1] == u8'*') {
+                const std::size_t end = text.find(u8"*/", std::max(from, 3uz) - 1);
+                return end == std::u8string_view::npos ? std::nullopt
+                                                       : std::optional<std::size_t> { end + 2 };
+            }
+            return 1;
+        }
+        case Token::none: break;
+        }
+        ULIGHT_ASSERT_UNREACHABLE(u8"Invalid token.");
+    }
+
+    /// @brief Begins a token at the current offset,
+    /// and either consumes it entirely or retains it until the next chunk.
+    [[nodiscard]]
+    bool begin_token(Token token)
+    {
+        const std::u8string_view rest = chunk.substr(offset);
+        if (const std::optional<std::size_t> end = find_token_end(token, rest, 0)) {
+            std::size_t length = 0;
+            if (!consume_token(token, rest.substr(0, *end), length)) {
+                return false;
+            }
+            offset += length;
+            return true;
+        }
+        self.m_token = token;
+        self.m_token_text.assign(rest);
+        offset = chunk.length();
+        return true;
+    }
+
+    /// @brief Continues the token retained from previous chunks, if any.
+    [[nodiscard]]
+    bool continue_token()
+    {
+        while (self.m_token != Token::none) {
+            // The chunk is appended one block at a time
+            // so that the whole chunk is not copied when the token ends near its start.
+            const std::size_t searched = self.m_token_text.length();
+            const std::size_t appended = std::min(chunk.length() - offset, block_size);
+            self.m_token_text.append(chunk.substr(offset, appended));
+            offset += appended;
+
+            const std::optional<std::size_t> end
+                = find_token_end(self.m_token, self.m_token_text, searched);
+            if (!end) {
+                if (offset == chunk.length()) {
+                    return true;
+                }
+                continue;
+            }
+            const Token token = std::exchange(self.m_token, Token::none);
+            const std::u8string text = std::exchange(self.m_token_text, {});
+            if (!consume_token_and_rest(token, text, *end)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief Consumes a token whose text was retained,
+    /// and then the rest of `text` that does not belong to the token.
+    /// This is the part following `end`,
+    /// and possibly more if the token is shorter than expected, such as `-3` in `12-3`.
+    [[nodiscard]]
+    bool consume_token_and_rest(Token token, std::u8string_view text, std::size_t end)
+    {
+        std::size_t length = 0;
+        if (!consume_token(token, text.substr(0, end), length)) {
+            return false;
+        }
+        return length == text.length() || Chunk_Parser { self, text.substr(length) }();
+    }
+
+    /// @brief Consumes the token at the start of `text`,
+    /// where `text` is the whole token as determined by `find_token_end`
+    /// or everything up to the end of the source.
+    /// @param length Set to the number of code units that were consumed,
+    /// which may be less than the length of `text`.
+    [[nodiscard]]
+    bool consume_token(Token token, std::u8string_view text, std::size_t& length)
+    {
+        switch (token) {
+        case Token::number: return consume_number(text, length);
+        case Token::keyword: return consume_keyword(text, length);
+        case Token::escape: return consume_escape(text, length);
+        case Token::comment: return consume_comment(text, length);
+        case Token::none: break;
+        }
+        ULIGHT_ASSERT_UNREACHABLE(u8"Invalid token.");
+    }
+
+    [[nodiscard]]
+    bool consume_number(std::u8string_view text, std::size_t& length)
+    {
+        const Number_Result number = match_number(text);
+        if (!number || number.erroneous) {
+            return error(JSON_Error::illegal_number);
+        }
+        const std::u8string_view number_string = text.substr(0, number.length);
+        if (self.m_options.parse_numbers) {
+            const std::optional<double> value = parse_number(number_string, number);
+            if (!value) {
+                return error(JSON_Error::illegal_number);
+            }
+            out.number(self.m_pos, number_string, *value);
+        }
+        else {
+            out.number(self.m_pos, number_string);
+        }
+        advance_on_same_line(number.length);
+        length = number.length;
+        end_value();
+        return true;
+    }
+
+    [[nodiscard]]
+    bool consume_keyword(std::u8string_view text, std::size_t& length)
+    {
+        if (text.starts_with(u8"true") || text.starts_with(u8"false")) {
+            const bool value = text[0] == u8't';
+            out.boolean(self.m_pos, value);
+            length = value ? 4 : 5;
+        }
+        else if (text.starts_with(u8"null")) {
+            out.null(self.m_pos);
+            length = 4;
+        }
+        else {
+            return error(JSON_Error::illegal_character);
+        }
+        advance_on_same_line(length);
+        end_value();
+        return true;
+    }
+
+    [[nodiscard]]
+    bool consume_escape(std::u8string_view text, std::size_t& length)
+    {
+        const Escape_Policy policy = self.m_options.escapes == Escape_Parsing::none
+            ? Escape_Policy::match_only
+            : Escape_Policy::parse;
+        const Escape_Result escape = match_escape_sequence(text, policy);
+        if (!escape || escape.value == Escape_Result::no_value) {
+            return error(JSON_Error::illegal_escape);
+        }
+
+        const std::u8string_view escape_string = text.substr(0, escape.length);
+        switch (self.m_options.escapes) {
+        case Escape_Parsing::none: {
+            out.escape(self.m_pos, escape_string);
+            break;
+        }
+        case Escape_Parsing::parse: {
+            out.escape(self.m_pos, escape_string, escape.value);
+            break;
+        }
+        case Escape_Parsing::parse_encode: {
+            const auto [code_units, code_units_length] = utf8::encode8_unchecked(escape.value);
+            const std::u8string_view encoded { code_units.data(), std::size_t(code_units_length) };
+            out.escape(self.m_pos, escape_string, escape.value, encoded);
+            break;
+        }
+        }
+        advance_on_same_line(escape.length);
+        length = escape.length;
+        return true;
+    }
+
+    [[nodiscard]]
+    bool consume_comment(std::u8string_view text, std::size_t& length)
+    {
+        if (text.starts_with(u8"//")) {
+            length = match_line_comment(text);
+            out.line_comment(self.m_pos, text.substr(0, length));
+            advance_on_same_line(length);
+            return true;
+        }
+        if (text.starts_with(u8"/*")) {
+            const Comment_Result comment = match_block_comment(text);
+            if (!comment.is_terminated) {
+                return error(JSON_Error::comment);
+            }
+            length = comment.length;
+            out.block_comment(self.m_pos, text.substr(0, length));
+            advance(text.substr(0, length));
+            return true;
+        }
+        // A slash that does not start a comment is not allowed anywhere outside of strings.
+        return unexpected_character();
+    }
+};
+
+} // namespace json
+
+JSON_Push_Parser::JSON_Push_Parser(JSON_Visitor& visitor, JSON_Options options)
+    : m_visitor { visitor }
+    , m_options { options }
+{
+}
+
+bool JSON_Push_Parser::feed(std::u8string_view chunk)
+{
+    if (m_state == State::failed) {
+        return false;
+    }
+    return json::Chunk_Parser { *this, chunk }();
+}
+
+bool JSON_Push_Parser::feed(std::string_view chunk)
+{
+    const std::u8string_view u8chunk { reinterpret_cast<const char8_t*>(chunk.data()),
+                                       chunk.length() };
+    return feed(u8chunk);
+}
+
+bool JSON_Push_Parser::finish()
+{
+    if (m_state == State::failed) {
+        return false;
+    }
+    return json::Chunk_Parser { *this, {} }.finish();
+}
+
+} // namespace ulight
@@ -175,7 +175,7 @@ public:
 private:
     void consume_commands(Context context)
     {
-        while (!remainder.empty()) {
+        while (!remainder.empty() && !cancelled()) {
             switch (remainder[0]) {
             case u8'\\': {
                 consume_escape_character();
@@ -145,6 +145,16 @@ struct Consumer {
     virtual void push_arguments() { }
     virtual void pop_arguments() { }
     virtual void unexpected_eof() { }
+
+    /// @brief Returns `true` if matching should stop early.
+    /// This is checked between the contents of a document, block, or argument.
+    /// Once it returns `true`, no further closing brackets or unexpected ends of file
+    /// are reported, so unfinished directives are simply left unfinished.
+    [[nodiscard]]
+    virtual bool cancelled()
+    {
+        return false;
+    }
 };
 
 [[nodiscard]]
@@ -238,6 +248,9 @@ std::size_t match_content_sequence(Consumer& out, std::u8string_view str, Conten
     std::size_t length = 0;
 
     while (!str.empty() && !is_terminated_by(context, str[0])) {
+        if (out.cancelled()) {
+            break;
+        }
         const std::size_t content_length = match_content(out, str, context, levels);
         ULIGHT_ASSERT(content_length != 0);
         str.remove_prefix(content_length);
@@ -282,6 +295,10 @@ std::size_t match_argument_list(Consumer& out, std::u8string_view str)
         if (str.empty()) {
             break;
         }
+        // The argument may have been cut short anywhere.
+        if (out.cancelled()) {
+            return length;
+        }
         if (str[0] == u8'}') {
             out.pop_arguments();
             return length;
@@ -316,6 +333,10 @@ std::size_t match_block(Consumer& out, std::u8string_view str)
     const std::size_t content_length = match_content_sequence(out, str, Content_Context::block);
     str.remove_prefix(content_length);
 
+    // The content may have been cut short anywhere.
+    if (out.cancelled()) {
+        return content_length + 1;
+    }
     if (str.starts_with(u8'}')) {
         out.closing_brace();
         return content_length + 2;
@@ -630,6 +651,11 @@ public:
         try_flush_special_consumer();
     }
 
+    bool cancelled() final
+    {
+        return m_normal.self.cancelled();
+    }
+
     void try_flush_special_consumer()
     {
         Highlighter& self = m_normal.self;
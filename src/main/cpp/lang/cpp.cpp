@@ -14,6 +14,7 @@
 #include "ulight/impl/escapes.hpp"
 #include "ulight/impl/highlight.hpp"
 #include "ulight/impl/numbers.hpp"
+#include "ulight/impl/trace.hpp"
 #include "ulight/impl/unicode.hpp"
 
 #include "ulight/impl/lang/cpp.hpp"
@@ -649,19 +650,26 @@ private:
         return source.substr(index);
     }
 
+    /// @brief Equivalent to `is_cancelled(options)`.
+    [[nodiscard]]
+    bool cancelled() const
+    {
+        return is_cancelled(options);
+    }
+
 public:
     bool operator()()
     {
-        while (index < source.size()) {
-            const bool any_matched = expect_whitespace() //
-                || expect_line_comment() //
-                || expect_block_comment() //
-                || expect_string_literal() //
-                || expect_character_literal() //
-                || expect_pp_number() //
-                || expect_identifier_or_keyword(usual_fallback_highlight) //
-                || expect_preprocessing_op_or_punc() //
-                || expect_non_whitespace();
+        while (index < source.size() && !cancelled()) {
+            const bool any_matched = ULIGHT_TRACE_RULE(expect_whitespace()) //
+                || ULIGHT_TRACE_RULE(expect_line_comment()) //
+                || ULIGHT_TRACE_RULE(expect_block_comment()) //
+                || ULIGHT_TRACE_RULE(expect_string_literal()) //
+                || ULIGHT_TRACE_RULE(expect_character_literal()) //
+                || ULIGHT_TRACE_RULE(expect_pp_number()) //
+                || ULIGHT_TRACE_RULE(expect_identifier_or_keyword(usual_fallback_highlight)) //
+                || ULIGHT_TRACE_RULE(expect_preprocessing_op_or_punc()) //
+                || ULIGHT_TRACE_RULE(expect_non_whitespace());
             ULIGHT_ASSERT(any_matched);
         }
         return true;
@@ -817,7 +825,7 @@ public:
                 fresh_line = true;
                 return;
             }
-            const auto code_units = std::size_t(utf8::sequence_length(source[index], 1));
+            const std::size_t code_units = utf8::code_point_length_or_one(source.substr(index));
             chars_length += code_units;
             advance(code_units);
         }
@@ -9,6 +9,7 @@
 #include "ulight/impl/highlight.hpp"
 #include "ulight/impl/highlighter.hpp"
 #include "ulight/impl/strings.hpp"
+#include "ulight/impl/trace.hpp"
 #include "ulight/impl/unicode.hpp"
 
 #include "ulight/impl/lang/cpp.hpp"
@@ -99,7 +100,7 @@ std::size_t match_escaped_code_point(std::u8string_view str)
         }
         return length;
     }
-    return std::size_t(utf8::sequence_length(str[0]));
+    return utf8::code_point_length_or_one(str);
 }
 
 std::size_t match_ident_sequence(std::u8string_view str)
@@ -182,8 +183,8 @@ public:
 
     bool operator()()
     {
-        while (!remainder.empty()) {
-            consume_comments();
+        while (!remainder.empty() && !cancelled()) {
+            ULIGHT_TRACE_RULE(consume_comments());
             if (remainder.empty()) {
                 break;
             }
@@ -200,12 +201,12 @@ public:
             case u8'\r':
             case u8'\n':
             case u8'\f': {
-                consume_whitespace();
+                ULIGHT_TRACE_RULE(consume_whitespace());
                 break;
             }
             case u8'"':
             case u8'\'': {
-                consume_string_token(c);
+                ULIGHT_TRACE_RULE(consume_string_token(c));
                 break;
             }
             case u8'#': {
@@ -216,7 +217,7 @@ public:
                         ? Highlight_Type::value
                         : contextual_highlight_type;
                     emit_and_advance(1, highlight_type);
-                    consume_ident_like_token(highlight_type);
+                    ULIGHT_TRACE_RULE(consume_ident_like_token(highlight_type));
                 }
                 else {
                     advance(1);
@@ -230,7 +231,7 @@ public:
             }
             case u8'.': {
                 if (starts_with_number(remainder)) {
-                    consume_numeric_token();
+                    ULIGHT_TRACE_RULE(consume_numeric_token());
                 }
                 else if (context == Context::top_level) {
                     emit_and_advance(1, selector_highlight_type, Coalescing::forced);
@@ -243,7 +244,7 @@ public:
             case u8'+':
             case u8'-': {
                 if (starts_with_number(remainder)) {
-                    consume_numeric_token();
+                    ULIGHT_TRACE_RULE(consume_numeric_token());
                     break;
                 }
                 if (c == u8'-') {
@@ -253,7 +254,7 @@ public:
                         break;
                     }
                     if (starts_with_ident_sequence(remainder.substr(1))) {
-                        consume_ident_like_token(Highlight_Type::id);
+                        ULIGHT_TRACE_RULE(consume_ident_like_token(Highlight_Type::id));
                         break;
                     }
                 }
@@ -321,7 +322,7 @@ public:
                 context = Context::at_prelude;
                 if (starts_with_ident_sequence(remainder.substr(1))) {
                     emit_and_advance(1, Highlight_Type::macro);
-                    consume_ident_like_token(Highlight_Type::macro);
+                    ULIGHT_TRACE_RULE(consume_ident_like_token(Highlight_Type::macro));
                 }
                 else {
                     emit_and_advance(1, Highlight_Type::error);
@@ -353,7 +354,7 @@ public:
             }
             case u8'\\': {
                 if (starts_with_valid_escape(remainder)) {
-                    consume_ident_like_token(contextual_highlight_type);
+                    ULIGHT_TRACE_RULE(consume_ident_like_token(contextual_highlight_type));
                 }
                 else {
                     emit_and_advance(1, Highlight_Type::error);
@@ -386,15 +387,15 @@ public:
             case u8'7':
             case u8'8':
             case u8'9': {
-                consume_numeric_token();
+                ULIGHT_TRACE_RULE(consume_numeric_token());
                 break;
             }
             default: {
                 if (is_css_identifier_start(c)) {
-                    consume_ident_like_token(contextual_highlight_type);
+                    ULIGHT_TRACE_RULE(consume_ident_like_token(contextual_highlight_type));
                 }
                 else {
-                    advance(std::size_t(utf8::sequence_length(c)));
+                    advance(utf8::code_point_length_or_one(remainder));
                 }
                 break;
             }
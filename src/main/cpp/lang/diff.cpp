@@ -1,6 +1,17 @@
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <span>
 #include <string_view>
 
+#include "ulight/function_ref.hpp"
+#include "ulight/ulight.hpp"
+
+#include "ulight/impl/ascii_algorithm.hpp"
+#include "ulight/impl/ascii_chars.hpp"
 #include "ulight/impl/buffer.hpp"
+#include "ulight/impl/edit_script.hpp"
+#include "ulight/impl/fallible_vector.hpp"
 #include "ulight/impl/highlight.hpp"
 #include "ulight/impl/highlighter.hpp"
 #include "ulight/impl/parse_utils.hpp"
@@ -34,30 +45,225 @@ Highlight_Type choose_line_highlight(std::u8string_view line)
     }
 }
 
+std::size_t match_word(std::u8string_view str)
+{
+    ULIGHT_ASSERT(!str.empty());
+    // Non-ASCII code units are treated as word characters,
+    // which keeps multi-byte characters intact.
+    constexpr auto is_word_char
+        = [](char8_t c) { return c >= 0x80 || c == u8'_' || is_ascii_alphanumeric(c); };
+    constexpr auto is_blank = [](char8_t c) { return c == u8' ' || c == u8'\t'; };
+    if (is_word_char(str[0])) {
+        return ascii::length_if(str, is_word_char);
+    }
+    if (is_blank(str[0])) {
+        return ascii::length_if(str, is_blank);
+    }
+    return 1;
+}
+
 namespace {
 
+/// @brief The maximum number of changed words within a block of deletions and insertions
+/// for which the changed words are marked.
+/// Blocks with more changes are highlighted line by line as usual.
+/// Such blocks have too little in common for marking words to be helpful,
+/// and the limit keeps the time taken per block linear in its length.
+constexpr std::size_t max_word_edits = 256;
+
+/// @brief Returns the language of the file named in a `---` or `+++` header line.
+[[nodiscard]]
+Lang header_lang(std::u8string_view line)
+{
+    ULIGHT_ASSERT(line.starts_with(u8"--- ") || line.starts_with(u8"+++ "));
+    std::u8string_view path = line.substr(4);
+    // Anything after a tab is a timestamp.
+    path = path.substr(0, path.find(u8'\t'));
+    // Git quotes paths with unusual characters.
+    if (path.length() >= 2 && path.starts_with(u8'"') && path.ends_with(u8'"')) {
+        path = path.substr(1, path.length() - 2);
+    }
+    return lang_from_path(path);
+}
+
+/// @brief Matches a line range in a hunk heading, like `12,3` or `12`,
+/// and removes it from the start of `str`.
+/// @returns The number of lines in the range, or `std::nullopt` if there is no range.
+[[nodiscard]]
+std::optional<std::size_t> match_hunk_range(std::u8string_view& str)
+{
+    constexpr auto is_digit = [](char8_t c) { return is_ascii_digit(c); };
+    // Twelve digits is more lines than any diff that can be processed in practice,
+    // and much less than would overflow.
+    constexpr std::size_t max_digits = 12;
+
+    const std::size_t start_length = ascii::length_if(str, is_digit);
+    if (start_length == 0) {
+        return {};
+    }
+    str.remove_prefix(start_length);
+    if (!str.starts_with(u8',')) {
+        return 1;
+    }
+    const std::size_t count_length = ascii::length_if(str.substr(1), is_digit);
+    if (count_length == 0 || count_length > max_digits) {
+        return {};
+    }
+    std::size_t count = 0;
+    for (const char8_t c : str.substr(1, count_length)) {
+        count = (count * 10) + std::size_t(c - u8'0');
+    }
+    str.remove_prefix(count_length + 1);
+    return count;
+}
+
+struct Hunk_Counts {
+    std::size_t old_lines;
+    std::size_t new_lines;
+};
+
+/// @brief Parses the line counts from a unified hunk heading like `@@ -1,7 +1,6 @@`.
+[[nodiscard]]
+std::optional<Hunk_Counts> parse_hunk_heading(std::u8string_view line)
+{
+    if (!line.starts_with(u8"@@ -")) {
+        return {};
+    }
+    line.remove_prefix(4);
+    const std::optional<std::size_t> old_lines = match_hunk_range(line);
+    if (!old_lines || !line.starts_with(u8" +")) {
+        return {};
+    }
+    line.remove_prefix(2);
+    const std::optional<std::size_t> new_lines = match_hunk_range(line);
+    if (!new_lines || !line.starts_with(u8" @@")) {
+        return {};
+    }
+    return Hunk_Counts { *old_lines, *new_lines };
+}
+
 struct Highlighter : Highlighter_Base {
+private:
+    /// @brief A line within a block of deletions or insertions.
+    struct Line {
+        /// @brief The offset of the line from the start of the block.
+        std::size_t begin;
+        std::size_t length;
+    };
+
+    /// @brief A word within a block of deletions or insertions.
+    struct Word {
+        /// @brief The offset of the word from the start of the block.
+        std::size_t begin;
+        std::size_t length;
+        bool changed = false;
+    };
+
+    /// @brief The words of all deleted or inserted lines in a block,
+    /// with line breaks represented by `line_break` elements,
+    /// which makes the alignment of words prefer to keep lines together.
+    struct Side {
+        Fallible_Vector<Line> lines;
+        Fallible_Vector<Word> words;
+        Fallible_Vector<std::u8string_view> word_strings;
+
+        [[nodiscard]]
+        explicit Side(std::pmr::memory_resource* memory)
+            : lines { memory }
+            , words { memory }
+            , word_strings { memory }
+        {
+        }
+    };
+
+    static constexpr std::u8string_view line_break = u8"\n";
+
+    /// @brief A line within a hunk.
+    struct Hunk_Line {
+        /// @brief The offset of the line from the start of the hunk heading.
+        std::size_t begin;
+        /// @brief The length of the line,
+        /// including the leading `-`, `+`, or space, but excluding the terminator.
+        std::size_t length;
+        /// @brief The leading `-`, `+`, space, or backslash.
+        /// Empty lines are treated as unchanged lines.
+        char8_t kind;
+        /// @brief The offset of the contents of the line within the old version of the hunk
+        /// for deletions, or within the new version otherwise.
+        std::size_t code_begin = 0;
+    };
+
+    /// @brief The old or new version of the contents of a hunk,
+    /// with the leading `-`, `+`, or space removed from each line.
+    struct Hunk_Version {
+        Fallible_Vector<char8_t> code;
+        Fallible_Vector<Token> tokens;
+        /// @brief The index of the first token in `tokens` which may overlap the next line.
+        std::size_t next_token = 0;
+
+        [[nodiscard]]
+        explicit Hunk_Version(std::pmr::memory_resource* memory)
+            : code { memory }
+            , tokens { memory }
+        {
+        }
+    };
+
+    Side m_deletions { memory };
+    Side m_insertions { memory };
+    Fallible_Vector<Edit_Type> m_edits { memory };
+
+    Lang m_old_lang = Lang::none;
+    Lang m_new_lang = Lang::none;
+    Fallible_Vector<Hunk_Line> m_hunk_lines { memory };
+    Hunk_Version m_old_version { memory };
+    Hunk_Version m_new_version { memory };
+    /// @brief Set when an allocation has failed, which ends highlighting.
+    /// The memory resource remembers the failure,
+    /// so that it is reported as `ULIGHT_STATUS_BAD_ALLOC`.
+    bool m_out_of_memory = false;
+
+public:
 
     Highlighter(
         Non_Owning_Buffer<Token>& out,
         std::u8string_view source,
+        std::pmr::memory_resource* memory,
         const Highlight_Options& options
     )
-        : Highlighter_Base { out, source, options }
+        : Highlighter_Base { out, source, memory, options }
     {
     }
 
     bool operator()()
     {
-        while (!remainder.empty()) {
+        while (!remainder.empty() && !cancelled() && !m_out_of_memory) {
             const Line_Result line = match_crlf_line(remainder);
             // If there are remaining characters in the file,
             // how could there not be a remaining line?!
             ULIGHT_ASSERT(line.content_length != 0 || line.terminator_length != 0);
-            highlight_line(remainder.substr(0, line.content_length));
+            const std::u8string_view content = remainder.substr(0, line.content_length);
+            if (options.diff_lang) {
+                if (content.starts_with(u8"--- ")) {
+                    m_old_lang = header_lang(content);
+                    m_new_lang = Lang::none;
+                }
+                else if (content.starts_with(u8"+++ ")) {
+                    m_new_lang = header_lang(content);
+                }
+                else if (content.starts_with(u8"@@ ") && highlight_hunk(line)) {
+                    continue;
+                }
+            }
+            if (options.diff_words && !content.empty()
+                && choose_line_highlight(content) == Highlight_Type::diff_deletion) {
+                highlight_changed_block();
+                continue;
+            }
+            highlight_line(content);
             advance(line.terminator_length);
         }
-        return true;
+        return !m_out_of_memory;
     }
 
     void highlight_line(std::u8string_view line)
@@ -68,6 +274,279 @@ struct Highlighter : Highlighter_Base {
         const Highlight_Type type = choose_line_highlight(line);
         emit_and_advance(line.length(), type);
     }
+
+private:
+    /// @brief Highlights a unified hunk, starting with its heading,
+    /// where the old and new version of the contents are highlighted in the language of the file.
+    /// @param heading The heading line of the hunk.
+    /// @returns `true` if the hunk was highlighted,
+    /// or `false` if nothing was done because the language or the hunk size is unknown,
+    /// or if highlighting the contents failed.
+    [[nodiscard]]
+    bool highlight_hunk(const Line_Result& heading)
+    {
+        // For deleted files, the new path is /dev/null, so the old path is more useful.
+        const Lang lang = m_new_lang != Lang::none ? m_new_lang : m_old_lang;
+        if (lang == Lang::none) {
+            return false;
+        }
+        const std::optional<Hunk_Counts> counts
+            = parse_hunk_heading(remainder.substr(0, heading.content_length));
+        if (!counts) {
+            return false;
+        }
+
+        const std::size_t hunk_length = collect_hunk_lines(*counts, heading);
+        if (m_out_of_memory || !highlight_version(m_old_version, lang)
+            || !highlight_version(m_new_version, lang)) {
+            return false;
+        }
+
+        emit(index, heading.content_length, Highlight_Type::diff_heading_hunk);
+        for (const Hunk_Line& line : m_hunk_lines) {
+            emit_hunk_line(line);
+        }
+        advance(hunk_length);
+        return true;
+    }
+
+    /// @brief Collects the lines of the hunk following `heading`,
+    /// and builds the old and new version of its contents.
+    /// The line counts in the heading determine where the hunk ends,
+    /// so that deleted lines such as `-- comment` are not mistaken for headers.
+    /// @returns The length of the hunk, including the heading,
+    /// which is only meaningful if no allocation has failed.
+    [[nodiscard]]
+    std::size_t collect_hunk_lines(Hunk_Counts counts, const Line_Result& heading)
+    {
+        m_hunk_lines.clear();
+        m_old_version.code.clear();
+        m_new_version.code.clear();
+
+        const auto append_code = [&](Hunk_Version& version, std::u8string_view content) {
+            const std::size_t code_begin = version.code.size();
+            if (!version.code.append(content.substr(std::min(content.length(), std::size_t { 1 })))
+                || !version.code.push_back(u8'\n')) {
+                m_out_of_memory = true;
+            }
+            return code_begin;
+        };
+
+        std::size_t offset = heading.content_length + heading.terminator_length;
+        while (offset < remainder.length()) {
+            const Line_Result line = match_crlf_line(remainder.substr(offset));
+            const std::u8string_view content = remainder.substr(offset, line.content_length);
+            Hunk_Line hunk_line { .begin = offset,
+                                  .length = content.length(),
+                                  .kind = content.empty() ? u8' ' : content[0] };
+            if (hunk_line.kind == u8' ' && counts.old_lines != 0 && counts.new_lines != 0) {
+                --counts.old_lines;
+                --counts.new_lines;
+                append_code(m_old_version, content);
+                hunk_line.code_begin = append_code(m_new_version, content);
+            }
+            else if (hunk_line.kind == u8'-' && counts.old_lines != 0) {
+                --counts.old_lines;
+                hunk_line.code_begin = append_code(m_old_version, content);
+            }
+            else if (hunk_line.kind == u8'+' && counts.new_lines != 0) {
+                --counts.new_lines;
+                hunk_line.code_begin = append_code(m_new_version, content);
+            }
+            // "\ No newline at end of file" is not part of either version.
+            else if (hunk_line.kind != u8'\\') {
+                break;
+            }
+            if (!m_hunk_lines.push_back(hunk_line)) {
+                m_out_of_memory = true;
+            }
+            offset += line.content_length + line.terminator_length;
+        }
+        return offset;
+    }
+
+    /// @brief Highlights the code of one version of a hunk as a whole,
+    /// so that constructs spanning multiple lines are highlighted correctly.
+    [[nodiscard]]
+    bool highlight_version(Hunk_Version& version, Lang lang)
+    {
+        version.tokens.clear();
+        version.next_token = 0;
+        if (version.code.empty()) {
+            return true;
+        }
+        const auto append = [&](Token* tokens, std::size_t amount) {
+            if (!version.tokens.append({ tokens, amount })) {
+                m_out_of_memory = true;
+            }
+        };
+        const Function_Ref<void(Token*, std::size_t)> append_ref = append;
+
+        Token nested_tokens[1024];
+        Non_Owning_Buffer<Token> nested_out { nested_tokens, append_ref };
+        const std::u8string_view code { version.code.data(), version.code.size() };
+        if (highlight_nested(nested_out, code, lang) != Status::ok) {
+            return false;
+        }
+        nested_out.flush();
+        return !m_out_of_memory;
+    }
+
+    /// @brief Emits the tokens for a line in a hunk,
+    /// where the tokens of the code in the line are taken from the old or new version,
+    /// and the leading `-`, `+`, or space and any gaps between tokens have the usual highlight.
+    void emit_hunk_line(const Hunk_Line& line)
+    {
+        if (line.length == 0) {
+            return;
+        }
+        if (line.kind == u8'\\') {
+            emit(index + line.begin, line.length, Highlight_Type::diff_common);
+            return;
+        }
+        const Highlight_Type line_type = line.kind == u8'-' ? Highlight_Type::diff_deletion
+            : line.kind == u8'+'                            ? Highlight_Type::diff_insertion
+                                                            : Highlight_Type::diff_common;
+        emit(index + line.begin, 1, line_type);
+
+        Hunk_Version& version = line.kind == u8'-' ? m_old_version : m_new_version;
+        const std::size_t code_end = line.code_begin + line.length - 1;
+        const auto emit_code = [&](std::size_t begin, std::size_t end, Highlight_Type type) {
+            if (begin != end) {
+                emit(index + line.begin + 1 + (begin - line.code_begin), end - begin, type);
+            }
+        };
+
+        const std::span<const Token> tokens = version.tokens;
+        std::size_t& t = version.next_token;
+        // Tokens of preceding lines which are part of the other version are skipped.
+        while (t < tokens.size() && tokens[t].begin + tokens[t].length <= line.code_begin) {
+            ++t;
+        }
+        std::size_t pos = line.code_begin;
+        // Tokens which extend past the end of the line are revisited for the next line.
+        for (std::size_t i = t; i < tokens.size() && tokens[i].begin < code_end; ++i) {
+            const std::size_t begin = std::max(tokens[i].begin, line.code_begin);
+            const std::size_t end = std::min(tokens[i].begin + tokens[i].length, code_end);
+            emit_code(pos, begin, line_type);
+            emit_code(begin, end, Highlight_Type(tokens[i].type));
+            pos = end;
+        }
+        emit_code(pos, code_end, line_type);
+    }
+
+    /// @brief Highlights a run of deleted lines
+    /// and the run of inserted lines immediately following it,
+    /// marking the words which differ between them.
+    void highlight_changed_block()
+    {
+        std::size_t block_length = 0;
+        collect_lines(m_deletions, block_length, Highlight_Type::diff_deletion);
+        collect_lines(m_insertions, block_length, Highlight_Type::diff_insertion);
+        if (m_out_of_memory) {
+            return;
+        }
+        ULIGHT_ASSERT(!m_deletions.lines.empty());
+
+        m_edits.clear();
+        // If the search runs out of memory, the lines are simply not marked,
+        // and the failure is reported through the memory resource.
+        const bool words_marked = !m_insertions.lines.empty()
+            && shortest_edit_script<std::u8string_view>(
+                   m_edits, m_deletions.word_strings, m_insertions.word_strings, max_word_edits,
+                   memory
+            );
+        if (words_marked) {
+            std::size_t d = 0;
+            std::size_t i = 0;
+            for (const Edit_Type edit : m_edits) {
+                switch (edit) {
+                case Edit_Type::common: {
+                    ++d;
+                    ++i;
+                    break;
+                }
+                case Edit_Type::del: {
+                    m_deletions.words[d++].changed = true;
+                    break;
+                }
+                case Edit_Type::ins: {
+                    m_insertions.words[i++].changed = true;
+                    break;
+                }
+                }
+            }
+        }
+
+        if (words_marked) {
+            emit_lines(m_deletions, Highlight_Type::diff_deletion, Highlight_Type::markup_deletion);
+            emit_lines(
+                m_insertions, Highlight_Type::diff_insertion, Highlight_Type::markup_insertion
+            );
+        }
+        else {
+            // Without marked words, the lines are highlighted exactly as they would be otherwise.
+            for (const Line& line : m_deletions.lines) {
+                emit(index + line.begin, line.length, Highlight_Type::diff_deletion);
+            }
+            for (const Line& line : m_insertions.lines) {
+                emit(index + line.begin, line.length, Highlight_Type::diff_insertion);
+            }
+        }
+        advance(block_length);
+    }
+
+    /// @brief Collects the lines of the given type starting at `offset` within the remainder,
+    /// and splits their contents (excluding the leading `-` or `+`) into words.
+    /// If an allocation fails, `m_out_of_memory` is set, and `side` is incomplete.
+    void collect_lines(Side& side, std::size_t& offset, Highlight_Type type)
+    {
+        side.lines.clear();
+        side.words.clear();
+        side.word_strings.clear();
+        while (offset < remainder.length()) {
+            const Line_Result line = match_crlf_line(remainder.substr(offset));
+            const std::u8string_view content = remainder.substr(offset, line.content_length);
+            if (content.empty() || choose_line_highlight(content) != type) {
+                break;
+            }
+            bool ok = side.lines.push_back({ offset, content.length() });
+            for (std::size_t pos = 1; ok && pos < content.length();) {
+                const std::size_t length = match_word(content.substr(pos));
+                ok = side.words.push_back({ offset + pos, length })
+                    && side.word_strings.push_back(content.substr(pos, length));
+                pos += length;
+            }
+            ok = ok && side.words.push_back({ offset + content.length(), 0 })
+                && side.word_strings.push_back(line_break);
+            if (!ok) {
+                m_out_of_memory = true;
+                return;
+            }
+            offset += line.content_length + line.terminator_length;
+        }
+    }
+
+    void emit_lines(const Side& side, Highlight_Type line_type, Highlight_Type changed_type)
+    {
+        auto word = side.words.begin();
+        for (const Line& line : side.lines) {
+            // The leading "-" or "+" is never part of a change.
+            emit(index + line.begin, 1, line_type);
+            // Adjacent words with the same status form a single token.
+            while (word->length != 0) {
+                const bool changed = word->changed;
+                const std::size_t begin = word->begin;
+                std::size_t length = 0;
+                for (; word->length != 0 && word->changed == changed; ++word) {
+                    length += word->length;
+                }
+                emit(index + begin, length, changed ? changed_type : line_type);
+            }
+            // Skip the line break.
+            ++word;
+        }
+    }
 };
 
 } // namespace
@@ -76,11 +555,11 @@ struct Highlighter : Highlighter_Base {
 bool highlight_diff(
     Non_Owning_Buffer<Token>& out,
     std::u8string_view source,
-    std::pmr::memory_resource*,
+    std::pmr::memory_resource* memory,
     const Highlight_Options& options
 )
 {
-    return diff::Highlighter { out, source, options }();
+    return diff::Highlighter { out, source, memory, options }();
 }
 
 } // namespace ulight
@@ -10,6 +10,7 @@
 #include "ulight/impl/buffer.hpp"
 #include "ulight/impl/highlight.hpp"
 #include "ulight/impl/highlighter.hpp"
+#include "ulight/impl/simd.hpp"
 #include "ulight/impl/strings.hpp"
 #include "ulight/impl/unicode_algorithm.hpp"
 
@@ -125,7 +126,7 @@ match_escapable_raw_text_piece(std::u8string_view str, std::u8string_view closin
     std::size_t length = 0;
 
     while (!str.empty()) {
-        const std::size_t safe_length = str.find_first_of(u8"<&");
+        const std::size_t safe_length = simd::find_any<u8'<', u8'&'>(str);
         if (safe_length == std::u8string_view::npos) {
             return { .raw_length = length + str.length(), .ref_length = 0 };
         }
@@ -280,7 +281,7 @@ struct Highlighter : Highlighter_Base {
     bool operator()()
     {
         expect_bom();
-        while (!remainder.empty()) {
+        while (!remainder.empty() && !cancelled()) {
             if (expect_comment() || //
                 expect_doctype() || //
                 expect_cdata() || //
@@ -525,7 +526,7 @@ private:
     bool expect_normal_text()
     {
         while (!remainder.empty()) {
-            const std::size_t safe_length = remainder.find_first_of(u8"<&");
+            const std::size_t safe_length = simd::find_any<u8'<', u8'&'>(remainder);
             if (safe_length == std::u8string_view::npos) {
                 advance(remainder.length());
                 break;
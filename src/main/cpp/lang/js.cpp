@@ -12,6 +12,8 @@
 #include "ulight/impl/buffer.hpp"
 #include "ulight/impl/highlight.hpp"
 #include "ulight/impl/highlighter.hpp"
+#include "ulight/impl/simd.hpp"
+#include "ulight/impl/trace.hpp"
 #include "ulight/impl/unicode.hpp"
 #include "ulight/impl/unicode_algorithm.hpp"
 
@@ -1077,7 +1079,7 @@ public:
 
     bool operator()()
     {
-        while (!remainder.empty()) {
+        while (!remainder.empty() && !cancelled()) {
             consume_token();
         }
         return true;
@@ -1115,18 +1117,18 @@ private:
 
     void consume_token()
     {
-        if (expect_whitespace() || //
-            expect_hashbang_comment() || //
-            expect_line_comment() || //
-            expect_block_comment() || //
-            expect_jsx_in_js() || //
-            expect_string_literal() || //
-            expect_template() || //
-            expect_regex() || //
-            expect_numeric_literal() || //
-            expect_private_identifier() || //
-            expect_symbols() || //
-            expect_operator_or_punctuation()) {
+        if (ULIGHT_TRACE_RULE(expect_whitespace()) || //
+            ULIGHT_TRACE_RULE(expect_hashbang_comment()) || //
+            ULIGHT_TRACE_RULE(expect_line_comment()) || //
+            ULIGHT_TRACE_RULE(expect_block_comment()) || //
+            ULIGHT_TRACE_RULE(expect_jsx_in_js()) || //
+            ULIGHT_TRACE_RULE(expect_string_literal()) || //
+            ULIGHT_TRACE_RULE(expect_template()) || //
+            ULIGHT_TRACE_RULE(expect_regex()) || //
+            ULIGHT_TRACE_RULE(expect_numeric_literal()) || //
+            ULIGHT_TRACE_RULE(expect_private_identifier()) || //
+            ULIGHT_TRACE_RULE(expect_symbols()) || //
+            ULIGHT_TRACE_RULE(expect_operator_or_punctuation())) {
             return;
         }
         consume_error();
@@ -1232,7 +1234,8 @@ private:
         std::u8string_view rem = remainder;
         while (!rem.empty()) {
             // https://facebook.github.io/jsx/#prod-JSXText
-            const std::size_t safe_length = rem.find_first_of(u8"&{}<>");
+            const std::size_t safe_length
+                = simd::find_any<u8'&', u8'{', u8'}', u8'<', u8'>'>(rem);
             if (safe_length == std::u8string_view::npos) {
                 advance(rem.length());
                 break;
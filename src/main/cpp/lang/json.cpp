@@ -1,6 +1,9 @@
 #include <charconv>
 #include <cstdlib>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <system_error>
 
 #include "ulight/json.hpp"
 #include "ulight/ulight.hpp"
@@ -15,6 +18,8 @@
 
 #include "ulight/impl/lang/json.hpp"
 #include "ulight/impl/lang/json_chars.hpp"
+#include "ulight/impl/lang/json_number.hpp"
+#include "ulight/impl/lang/json_parser.hpp"
 
 namespace ulight {
 namespace json {
@@ -42,8 +47,14 @@ Escape_Result match_escape_sequence(std::u8string_view str, Escape_Policy policy
         return {};
     }
     // Almost all escape sequences are two characters.
-    if (str[1] != u8'u') {
-        return { .length = 2, .value = char32_t(str[1]) };
+    switch (str[1]) {
+    case u8'b': return { .length = 2, .value = U'\b' };
+    case u8'f': return { .length = 2, .value = U'\f' };
+    case u8'n': return { .length = 2, .value = U'\n' };
+    case u8'r': return { .length = 2, .value = U'\r' };
+    case u8't': return { .length = 2, .value = U'\t' };
+    case u8'u': break;
+    default: return { .length = 2, .value = char32_t(str[1]) };
     }
     // "\", "u", hex, hex, hex, hex
     const auto [length, erroneous] = match_common_escape<Common_Escape::hex_4>(str, 2);
@@ -130,6 +141,33 @@ Number_Result match_number(std::u8string_view str)
              .erroneous = erroneous };
 }
 
+std::optional<double> parse_number_slow(std::u8string_view str)
+{
+    const auto* const begin = reinterpret_cast<const char*>(str.data());
+    const auto* const end = begin + str.length();
+#ifdef __cpp_lib_to_chars
+    // This is correctly rounded, and typically implemented using the Eisel-Lemire algorithm,
+    // with a fallback to arbitrary-precision arithmetic for the hardest cases.
+    double value;
+    const auto [ptr, ec] = std::from_chars(begin, end, value);
+    if (ec == std::errc {}) {
+        return ptr == end ? std::optional<double> { value } : std::nullopt;
+    }
+    if (ec != std::errc::result_out_of_range) {
+        return {};
+    }
+#endif
+    // std::strtod turns values that are out of range (e.g. 1e400) into infinity or zero,
+    // but it requires a null-terminated string.
+    const std::string terminated { begin, end };
+    char* str_end = nullptr;
+    const double value_or_huge = std::strtod(terminated.c_str(), &str_end);
+    if (str_end != terminated.c_str() + terminated.length()) {
+        return {};
+    }
+    return value_or_huge;
+}
+
 namespace {
 
 enum struct Comment_Policy : bool {
@@ -137,11 +175,6 @@ enum struct Comment_Policy : bool {
     always_allow,
 };
 
-enum struct String_Type : bool {
-    value,
-    property,
-};
-
 struct Highlighter : Highlighter_Base {
 private:
     const bool has_comments;
@@ -313,7 +346,7 @@ private:
         }
         emit_and_advance(1, Highlight_Type::sym_brace);
 
-        while (!remainder.empty()) {
+        while (!remainder.empty() && !cancelled()) {
             consume_member();
             if (remainder.starts_with(u8'}')) {
                 emit_and_advance(1, Highlight_Type::sym_brace);
@@ -366,7 +399,7 @@ private:
         }
         emit_and_advance(1, Highlight_Type::sym_square);
 
-        while (!remainder.empty()) {
+        while (!remainder.empty() && !cancelled()) {
             consume_whitespace_comments();
             if (remainder.starts_with(u8']')) {
                 emit_and_advance(1, Highlight_Type::sym_square);
@@ -403,412 +436,10 @@ private:
     }
 };
 
-struct Parser {
-private:
-    JSON_Visitor& out;
-    const std::size_t source_length;
-    const JSON_Options options;
-
-    std::u8string_view remainder;
-    Source_Position pos {};
-
-public:
-    [[nodiscard]]
-    Parser(JSON_Visitor& out, std::u8string_view source, JSON_Options options)
-        : out { out }
-        , source_length { source.length() }
-        , options { options }
-        , remainder { source }
-    {
-    }
-
-    [[nodiscard]]
-    bool operator()()
-    {
-        return consume_whitespace_comments() && consume_value() && consume_whitespace_comments();
-    }
-
-private:
-    void error(JSON_Error error)
-    {
-        out.error(pos, error);
-    }
-
-    void advance_on_same_line(std::size_t amount)
-    {
-        pos.code_unit += amount;
-        pos.line_code_unit += amount;
-        remainder.remove_prefix(amount);
-    }
-
-    void advance(std::size_t amount)
-    {
-        while (amount != 0) {
-            const std::size_t newline_pos = remainder.substr(0, amount).find(u8'\n');
-            if (newline_pos == std::u8string_view::npos) {
-                advance_on_same_line(amount);
-                return;
-            }
-            const std::size_t remaining_line_length = newline_pos + 1;
-            pos.code_unit += remaining_line_length;
-            pos.line += 1;
-            pos.line_code_unit = 0;
-            remainder.remove_prefix(remaining_line_length);
-
-            ULIGHT_DEBUG_ASSERT(amount >= remaining_line_length);
-            amount -= remaining_line_length;
-        }
-    }
-
-    [[nodiscard]]
-    bool consume_whitespace_comments()
-    {
-        if (!options.allow_comments) {
-            const std::size_t white_length = match_whitespace(remainder);
-            advance(white_length);
-            return true;
-        }
-        while (true) {
-            const std::size_t white_length = match_whitespace(remainder);
-            advance(white_length);
-            if (remainder.starts_with(u8"//")) {
-                if (!consume_line_comment()) {
-                    return false;
-                }
-                continue;
-            }
-            if (remainder.starts_with(u8"/*")) {
-                if (!consume_block_comment()) {
-                    return false;
-                }
-                continue;
-            }
-            break;
-        }
-        return true;
-    }
-
-    [[nodiscard]]
-    bool consume_line_comment()
-    {
-        if (const std::size_t length = match_line_comment(remainder)) {
-            out.line_comment(pos, remainder.substr(0, length));
-            advance_on_same_line(length);
-            return true;
-        }
-        ULIGHT_DEBUG_ASSERT_UNREACHABLE(u8"// should have been tested.");
-        error(JSON_Error::error);
-        return false;
-    }
-
-    [[nodiscard]]
-    bool consume_block_comment()
-    {
-        if (const js::Comment_Result block_comment = match_block_comment(remainder)) {
-            if (!block_comment.is_terminated) {
-                error(JSON_Error::comment);
-                return false;
-            }
-            advance(block_comment.length);
-            out.block_comment(pos, remainder.substr(0, block_comment.length));
-            return true;
-        }
-        ULIGHT_DEBUG_ASSERT_UNREACHABLE(u8"/* should have been tested.");
-        error(JSON_Error::error);
-        return false;
-    }
-
-    [[nodiscard]]
-    bool consume_value()
-    {
-        switch (remainder[0]) {
-        case u8'"': {
-            return consume_string(String_Type::value);
-        }
-        case u8'[': {
-            return consume_array();
-        }
-        case u8'{': {
-            return consume_object();
-        }
-        case u8'0':
-        case u8'1':
-        case u8'2':
-        case u8'3':
-        case u8'4':
-        case u8'5':
-        case u8'6':
-        case u8'7':
-        case u8'8':
-        case u8'9': {
-            return consume_number();
-        }
-        case u8't': {
-            if (remainder.starts_with(u8"true")) {
-                out.boolean(pos, true);
-                advance_on_same_line(4);
-                return true;
-            }
-            return false;
-        }
-        case u8'f': {
-            if (remainder.starts_with(u8"false")) {
-                out.boolean(pos, false);
-                advance_on_same_line(5);
-                return true;
-            }
-            return false;
-        }
-        case u8'n': {
-            if (remainder.starts_with(u8"null")) {
-                out.null(pos);
-                advance_on_same_line(4);
-                return true;
-            }
-            return false;
-        }
-        default: error(JSON_Error::illegal_escape); return false;
-        }
-    }
-
-    [[nodiscard]]
-    bool consume_string(String_Type type)
-    {
-        if (!remainder.starts_with(u8'"')) {
-            ULIGHT_DEBUG_ASSERT_UNREACHABLE(u8"Should have checked for quotes already.");
-            return false;
-        }
-        if (type == String_Type::property) {
-            out.push_property(pos);
-        }
-        else {
-            out.push_string(pos);
-        }
-        std::size_t length = 0;
-        advance_on_same_line(1);
-
-        const auto flush = [&] {
-            if (length != 0) {
-                out.literal(pos, remainder.substr(0, length));
-                advance_on_same_line(length);
-                length = 0;
-            }
-        };
-
-        while (length < remainder.length()) {
-            switch (const char8_t c = remainder[length]) {
-            case u8'"': {
-                flush();
-                if (type == String_Type::property) {
-                    out.pop_property(pos);
-                }
-                else {
-                    out.pop_string(pos);
-                }
-                advance_on_same_line(1);
-                return true;
-            }
-            case u8'\\': {
-                flush();
-                if (!consume_escape()) {
-                    return false;
-                }
-                continue;
-            }
-            default: {
-                if (c < 0x20) {
-                    flush();
-                    error(JSON_Error::illegal_character);
-                    return false;
-                }
-                ++length;
-                break;
-            }
-            }
-        }
-
-        error(JSON_Error::unterminated_string);
-        return false;
-    }
-
-    [[nodiscard]]
-    bool consume_escape()
-    {
-        const auto policy = options.escapes == Escape_Parsing::none ? Escape_Policy::match_only
-                                                                    : Escape_Policy::parse;
-        const Escape_Result escape = match_escape_sequence(remainder, policy);
-        if (!escape || escape.value == Escape_Result::no_value) {
-            error(JSON_Error::illegal_escape);
-            return false;
-        }
-
-        switch (options.escapes) {
-        case Escape_Parsing::none: //
-            out.escape(pos, remainder.substr(0, escape.length));
-            break;
-        case Escape_Parsing::parse: //
-            out.escape(pos, remainder.substr(0, escape.length), escape.value);
-            break;
-        case Escape_Parsing::parse_encode: {
-            const auto [code_units, length] = utf8::encode8_unchecked(escape.value);
-            const std::u8string_view encoded { code_units.data(), std::size_t(length) };
-            out.escape(pos, remainder.substr(0, escape.length), escape.value, encoded);
-            break;
-        }
-        }
-
-        advance_on_same_line(escape.length);
-        return true;
-    }
-
-    [[nodiscard]]
-    bool consume_number()
-    {
-        const Number_Result number = match_number(remainder);
-        if (!number || number.erroneous) {
-            error(JSON_Error::illegal_number);
-            return false;
-        }
-
-        const std::u8string_view number_string = remainder.substr(0, number.length);
-        if (options.parse_numbers) {
-            const auto* const str_begin = reinterpret_cast<const char*>(number_string.data());
-            char* str_end = nullptr;
-            const double value = std::strtod(str_begin, &str_end);
-            if (str_end == str_begin) {
-                error(JSON_Error::illegal_number);
-                return false;
-            }
-            out.number(pos, number_string, value);
-        }
-        else {
-            out.number(pos, number_string);
-        }
-        advance_on_same_line(number.length);
-        return true;
-    }
-
-    [[nodiscard]]
-    bool consume_object()
-    {
-        if (!remainder.starts_with(u8'{')) {
-            ULIGHT_DEBUG_ASSERT_UNREACHABLE(u8"This should have been tested outside.");
-            error(JSON_Error::error);
-            return false;
-        }
-        out.push_object(pos);
-        advance_on_same_line(1);
-
-        bool first_member = true;
-        while (!remainder.empty()) {
-            if (!consume_whitespace_comments()) {
-                return false;
-            }
-            if (remainder.starts_with(u8'}')) {
-                out.pop_object(pos);
-                advance_on_same_line(1);
-                return true;
-            }
-            if (first_member) {
-                if (!consume_member()) {
-                    return false;
-                }
-                first_member = false;
-                continue;
-            }
-            if (remainder.starts_with(u8',')) {
-                advance_on_same_line(1);
-                if (!consume_whitespace_comments() || !consume_member()) {
-                    return false;
-                }
-                continue;
-            }
-            error(JSON_Error::illegal_character);
-            return false;
-        }
-
-        error(JSON_Error::unterminated_object);
-        return false;
-    }
-
-    [[nodiscard]]
-    bool consume_member()
-    {
-        if (!consume_string(String_Type::property)) {
-            return false;
-        }
-
-        const auto at_end = [&] {
-            return remainder.empty() || remainder.starts_with(u8'}')
-                || remainder.starts_with(u8',');
-        };
-        if (!consume_whitespace_comments()) {
-            return false;
-        }
-        if (!remainder.starts_with(u8':')) {
-            error(JSON_Error::valueless_member);
-            return false;
-        }
-        advance_on_same_line(1);
-
-        if (!consume_whitespace_comments()) {
-            return false;
-        }
-        if (at_end()) {
-            error(JSON_Error::valueless_member);
-            return false;
-        }
-        return consume_value();
-    }
-
-    [[nodiscard]]
-    bool consume_array()
-    {
-        if (!remainder.starts_with(u8'[')) {
-            ULIGHT_DEBUG_ASSERT_UNREACHABLE(u8"This should have been tested outside.");
-            error(JSON_Error::error);
-            return false;
-        }
-        out.push_array(pos);
-        advance_on_same_line(1);
-        if (!consume_whitespace_comments()) {
-            return false;
-        }
-
-        bool first_element = true;
-        while (!remainder.empty()) {
-            if (!consume_whitespace_comments()) {
-                return false;
-            }
-            if (remainder.starts_with(u8']')) {
-                out.pop_array(pos);
-                advance_on_same_line(1);
-                return true;
-            }
-            if (first_element) {
-                if (!consume_value()) {
-                    return false;
-                }
-                first_element = false;
-                continue;
-            }
-            if (remainder.starts_with(u8',')) {
-                advance_on_same_line(1);
-                if (!consume_whitespace_comments() || !consume_value()) {
-                    return false;
-                }
-                continue;
-            }
-            error(JSON_Error::illegal_character);
-            return false;
-        }
+} // namespace
 
-        error(JSON_Error::unterminated_array);
-        return false;
-    }
-};
+template struct Parser<JSON_Visitor>;
 
-} // namespace
 } // namespace json
 
 bool highlight_json(
@@ -832,9 +463,14 @@ bool highlight_jsonc(
     return json::Highlighter { out, source, memory, options, json::Comment_Policy::always_allow }();
 }
 
+Source_Position json_source_position(std::u8string_view source, std::size_t code_unit) noexcept
+{
+    return json::Line_Index { source }.position(code_unit);
+}
+
 bool parse_json(JSON_Visitor& visitor, std::u8string_view source, JSON_Options options)
 {
-    return json::Parser { visitor, source, options }();
+    return json::Parser<JSON_Visitor> { visitor, source, options }();
 }
 
 bool parse_json(JSON_Visitor& visitor, std::string_view source, JSON_Options options)
@@ -546,10 +546,11 @@ bool highlight_lua(
             out.emplace_back(begin, length, Underlying(type));
         }
     };
+    const auto cancelled = [&] { return is_cancelled(options); };
 
     std::size_t index = 0;
 
-    while (index < source.size()) {
+    while (index < source.size() && !cancelled()) {
         const std::u8string_view remainder = source.substr(index);
 
         // Special case (s).
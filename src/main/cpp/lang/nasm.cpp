@@ -356,7 +356,7 @@ public:
 
     bool operator()()
     {
-        while (!eof()) {
+        while (!eof() && !cancelled()) {
             consume_anything();
         }
         return true;
@@ -36,7 +36,7 @@ struct Highlighter : Highlighter_Base {
             }
         };
 
-        while (text_length < remainder.length()) {
+        while (text_length < remainder.length() && !cancelled()) {
             switch (const char8_t c = remainder[text_length]) {
             case u8'[':
             case u8']': {
@@ -7,6 +7,7 @@
 #include "ulight/impl/highlight.hpp"
 #include "ulight/impl/highlighter.hpp"
 #include "ulight/impl/strings.hpp"
+#include "ulight/impl/trace.hpp"
 #include "ulight/impl/unicode.hpp"
 
 #include "ulight/ulight.hpp"
@@ -82,13 +83,13 @@ struct XML_Highlighter : Highlighter_Base {
     // TODO: add prolog (declaration)
     bool operator()()
     {
-        while (!remainder.empty()) {
-            if (expect_comment() || //
-                expect_cdata_section() || //
-                expect_processing_instruction() || //
-                expect_end_tag() || //
-                expect_start_tag() || //
-                expect_text()) {
+        while (!remainder.empty() && !cancelled()) {
+            if (ULIGHT_TRACE_RULE(expect_comment()) || //
+                ULIGHT_TRACE_RULE(expect_cdata_section()) || //
+                ULIGHT_TRACE_RULE(expect_processing_instruction()) || //
+                ULIGHT_TRACE_RULE(expect_end_tag()) || //
+                ULIGHT_TRACE_RULE(expect_start_tag()) || //
+                ULIGHT_TRACE_RULE(expect_text())) {
                 continue;
             }
 
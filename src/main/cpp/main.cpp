@@ -1,9 +1,15 @@
+#include <chrono>
+#include <cstddef>
 #include <cstdlib>
 #include <expected>
 #include <iostream>
+#include <optional>
 #include <span>
 #include <string_view>
+#include <utility>
+#include <vector>
 
+#include "ulight/text_pipeline.hpp"
 #include "ulight/ulight.hpp"
 
 #include "ulight/impl/assert.hpp"
@@ -12,35 +18,132 @@
 namespace ulight {
 namespace {
 
+void print_usage(std::string_view program)
+{
+    std::cerr << "Usage: " << program
+              << " [--stats] [--pipelined] [--lenient-utf8] [--html | --ansi] [--theme=FILE]"
+                 " [--variant=NAME] INPUT_FILE [OUTPUT_FILE]\n";
+    std::cerr << "  --html          Write HTML (default).\n";
+    std::cerr << "  --ansi          Write text with ANSI escape sequences for terminals.\n";
+    std::cerr << "  --theme=FILE    A JSON theme such as themes/ulight.json.\n"
+                 "                  With --ansi, it is used instead of the basic terminal colors.\n"
+                 "                  With --html, only tokens that the theme styles are marked up.\n";
+    std::cerr << "  --variant=NAME  The variant of the theme to use\n"
+                 "                  (default: dark for --ansi, all variants for --html).\n";
+    std::cerr << "  --lenient-utf8  Highlight malformed UTF-8 as errors instead of failing.\n";
+}
+
+enum struct Output_Mode : Underlying {
+    html,
+    ansi,
+};
+
+void print_nanoseconds(std::string_view label, unsigned long long ns)
+{
+    std::cerr << "  " << label << ": " << (double(ns) / 1'000'000.0) << " ms\n";
+}
+
+void print_stats(const Stats& stats, unsigned long long load_ns)
+{
+    std::size_t total_tokens = 0;
+    for (const std::size_t count : stats.tokens) {
+        total_tokens += count;
+    }
+
+    std::cerr << "Tokens: " << total_tokens << '\n';
+    for (std::size_t i = 0; i < std::size(stats.tokens); ++i) {
+        if (stats.tokens[i] != 0) {
+            std::cerr << "  " << highlight_type_long_string(Highlight_Type(i)) << ": "
+                      << stats.tokens[i] << '\n';
+        }
+    }
+    std::cerr << "Calls:\n";
+    std::cerr << "  flush_tokens: " << stats.flush_tokens_calls << '\n';
+    std::cerr << "  flush_text: " << stats.flush_text_calls << '\n';
+    std::cerr << "HTML text bytes: " << stats.html_text_bytes << '\n';
+    std::cerr << "Nested languages:\n";
+    std::cerr << "  invocations: " << stats.nested_invocations << '\n';
+    std::cerr << "  max depth: " << stats.max_nesting_depth << '\n';
+    std::cerr << "Time:\n";
+    print_nanoseconds("loading and UTF-8 validation", load_ns);
+    print_nanoseconds("state validation", stats.validation_ns);
+    print_nanoseconds("lexing", stats.lexing_ns);
+    print_nanoseconds("HTML emission", stats.html_ns);
+}
+
 // NOLINTNEXTLINE(bugprone-exception-escape)
 int main(int argc, const char** argv)
 {
     const std::span<const char*> args { argv, std::size_t(argc) };
-    if (args.size() < 2) {
-        ULIGHT_ASSERT(!args.empty());
-        std::cerr << "Usage: " << args[0] << " INPUT_FILE [OUTPUT_FILE]\n";
+    ULIGHT_ASSERT(!args.empty());
+
+    bool print_statistics = false;
+    bool pipelined = false;
+    bool lenient_utf8 = false;
+    Output_Mode mode = Output_Mode::html;
+    std::string_view theme_path;
+    std::string_view variant;
+    std::vector<std::string_view> paths;
+    for (const std::string_view arg : args.subspan(1)) {
+        if (arg == "--stats") {
+            print_statistics = true;
+        }
+        else if (arg == "--pipelined") {
+            pipelined = true;
+        }
+        else if (arg == "--lenient-utf8") {
+            lenient_utf8 = true;
+        }
+        else if (arg == "--html") {
+            mode = Output_Mode::html;
+        }
+        else if (arg == "--ansi") {
+            mode = Output_Mode::ansi;
+        }
+        else if (arg.starts_with("--theme=")) {
+            theme_path = arg.substr(std::string_view("--theme=").length());
+        }
+        else if (arg.starts_with("--variant=")) {
+            variant = arg.substr(std::string_view("--variant=").length());
+        }
+        else if (arg.starts_with("--")) {
+            std::cerr << arg << ": unknown option.\n";
+            print_usage(args[0]);
+            return EXIT_FAILURE;
+        }
+        else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty() || paths.size() > 2) {
+        print_usage(args[0]);
         return EXIT_FAILURE;
     }
 
-    const std::string_view in_path = args[1];
+    const std::string_view in_path = paths[0];
     const Lang lang = lang_from_path(in_path);
     if (lang == Lang::none) {
         std::cerr << in_path << ": failed to recognize language from file path.\n";
         return EXIT_FAILURE;
     }
 
-    const std::expected<std::vector<char8_t>, IO_Error_Code> input = load_utf8_file(args[1]);
-    if (!input) {
+    // The input is not validated here because highlighting already does that,
+    // or, with --lenient-utf8, handles malformed UTF-8 without a separate pass.
+    const auto load_start = std::chrono::steady_clock::now();
+    std::vector<char8_t> input;
+    const std::expected<void, IO_Error_Code> loaded_input = file_to_bytes(input, in_path);
+    const auto load_duration = std::chrono::steady_clock::now() - load_start;
+    if (!loaded_input) {
         std::cerr << in_path << ": failed to load file.\n";
         return EXIT_FAILURE;
     }
-    const std::u8string_view source_string { input->data(), input->size() };
+    const std::u8string_view source_string { input.data(), input.size() };
 
     Unique_File unique_out;
     std::FILE* out_file = stdout;
-    if (args.size() > 2) {
-        const std::string_view out_path = args[2];
-        unique_out = fopen_unique(args[2], "wb");
+    if (paths.size() > 1) {
+        const std::string_view out_path = paths[1];
+        unique_out = fopen_unique(out_path.data(), "wb");
         if (!unique_out) {
             std::cerr << out_path << ": failed to open file for output.\n";
             return EXIT_FAILURE;
@@ -48,26 +151,113 @@ int main(int argc, const char** argv)
         out_file = unique_out.get();
     }
 
+    std::vector<char8_t> theme_json;
+    if (!theme_path.empty()) {
+        std::expected<std::vector<char8_t>, IO_Error_Code> loaded = load_utf8_file(theme_path);
+        if (!loaded) {
+            std::cerr << theme_path << ": failed to load file.\n";
+            return EXIT_FAILURE;
+        }
+        theme_json = std::move(*loaded);
+    }
+    const std::string_view theme_string { reinterpret_cast<const char*>(theme_json.data()),
+                                          theme_json.size() };
+    const auto check_theme_status = [&](Status theme_status, std::string_view theme_variant) {
+        if (theme_status == Status::bad_state) {
+            std::cerr << theme_path << ": theme has no variant \"" << theme_variant << "\".\n";
+            return false;
+        }
+        if (theme_status != Status::ok) {
+            std::cerr << theme_path << ": failed to parse theme.\n";
+            return false;
+        }
+        return true;
+    };
+
+    std::optional<ANSI_Theme> theme;
+    if (mode == Output_Mode::ansi) {
+        theme.emplace();
+        const std::string_view ansi_variant = variant.empty() ? "dark" : variant;
+        if (!theme_path.empty()
+            && !check_theme_status(theme->load_json(theme_string, ansi_variant), ansi_variant)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    // For HTML, a theme is only used to omit the markup of tokens that the theme doesn't style.
+    // Unless a specific variant is requested, the markup has to work for any of them.
+    std::optional<Highlight_Mask> emit_mask;
+    if (mode == Output_Mode::html && !theme_path.empty()) {
+        emit_mask.emplace();
+        if (!variant.empty()) {
+            if (!check_theme_status(emit_mask->add_theme(theme_string, variant), variant)) {
+                return EXIT_FAILURE;
+            }
+        }
+        else {
+            bool any_variant = false;
+            for (const std::string_view v : { "light", "dark" }) {
+                const Status theme_status = emit_mask->add_theme(theme_string, v);
+                if (theme_status != Status::bad_state && !check_theme_status(theme_status, v)) {
+                    return EXIT_FAILURE;
+                }
+                any_variant |= theme_status == Status::ok;
+            }
+            if (!any_variant) {
+                std::cerr << theme_path << ": theme has neither a light nor a dark variant.\n";
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
     State state;
     state.set_source(source_string);
     state.set_lang(lang);
+    if (lenient_utf8) {
+        state.set_flags(Flag::lenient_utf8);
+    }
 
     Token token_buffer[1024];
     char text_buffer[1024 * 32];
     state.set_token_buffer(token_buffer);
     state.set_text_buffer(text_buffer);
+    if (emit_mask) {
+        state.set_html_emit_mask(&*emit_mask);
+    }
 
     constexpr auto on_flush_text_lambda = [](std::FILE* file, char* str, std::size_t length) { //
         std::fwrite(str, 1, length, file);
     };
     state.on_flush_text({ Constant<on_flush_text_lambda> {}, out_file });
 
-    Status status = state.source_to_html();
+    // With --pipelined, output is written on a separate thread while highlighting continues.
+    const auto write_to_out_file = [out_file](const char* str, std::size_t length) {
+        std::fwrite(str, 1, length, out_file);
+    };
+    std::optional<Text_Pipeline> pipeline;
+    if (pipelined) {
+        pipeline.emplace(write_to_out_file, sizeof(text_buffer));
+        pipeline->attach(state);
+    }
+
+    Stats stats {};
+    if (print_statistics) {
+        state.set_stats(&stats);
+    }
+
+    Status status = theme ? state.source_to_ansi(*theme) : state.source_to_html();
+    if (pipeline) {
+        pipeline->finish();
+    }
     if (status != Status::ok) {
         std::cerr << "Error: " << state.get_error_string() << '\n';
     }
+    if (print_statistics) {
+        const auto load_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(load_duration);
+        print_stats(stats, static_cast<unsigned long long>(load_ns.count()));
+    }
 
-    return 0;
+    return status == Status::ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 } // namespace
@@ -0,0 +1,461 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ulight/ulight.hpp"
+
+#include "ulight/impl/assert.hpp"
+#include "ulight/impl/server_protocol.hpp"
+
+namespace ulight::server {
+namespace {
+
+void print_usage(std::string_view program)
+{
+    std::cerr << "Usage: " << program << " [--socket=PATH] [--workers=N]\n";
+    std::cerr << "  --socket=PATH  Listen for connections on a Unix domain socket at PATH.\n"
+                 "                 Otherwise, requests are read from stdin,\n"
+                 "                 and responses are written to stdout.\n";
+    std::cerr << "  --workers=N    The number of threads which highlight\n"
+                 "                 (default: the number of hardware threads).\n";
+    std::cerr << "See include/ulight/impl/server_protocol.hpp for the protocol.\n";
+}
+
+/// @brief A client from which requests are read, and to which responses are written.
+/// A connection is shared by the thread reading its requests,
+/// and by the workers processing them.
+/// The file descriptors are closed when the last of them is done with the connection,
+/// so responses can still be sent after the client has stopped sending requests.
+struct Connection {
+    int in_fd;
+    int out_fd;
+    /// @brief If `true`, `in_fd` is a socket which is owned by this connection,
+    /// and which is the same as `out_fd`.
+    bool is_socket;
+
+    /// @brief Prevents responses from different workers from interleaving.
+    std::mutex write_mutex;
+    bool write_failed = false;
+
+    Connection(int in_fd, int out_fd, bool is_socket) noexcept
+        : in_fd { in_fd }
+        , out_fd { out_fd }
+        , is_socket { is_socket }
+    {
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    ~Connection()
+    {
+        if (is_socket) {
+            ::close(in_fd);
+        }
+    }
+
+    /// @brief Writes a complete response frame.
+    /// If writing fails, all further responses are discarded,
+    /// and a socket is shut down, so that its reader stops as well.
+    void respond(const Response_Header& header, std::span<const char> body)
+    {
+        const Response_Prefix prefix = encode_response_prefix(header, body.size());
+        const std::scoped_lock lock { write_mutex };
+        if (write_failed) {
+            return;
+        }
+        if (!write_all(out_fd, prefix, body)) {
+            write_failed = true;
+            if (is_socket) {
+                ::shutdown(in_fd, SHUT_RDWR);
+            }
+        }
+    }
+};
+
+struct Job {
+    std::shared_ptr<Connection> connection;
+    Request_Header header;
+    /// @brief The payload of the request frame, where the source code follows the header.
+    std::vector<char> payload;
+};
+
+/// @brief A bounded queue of jobs, shared by all connections and workers.
+/// When the queue is full, readers block,
+/// which stops them from reading further requests until the workers have caught up.
+///
+/// The queue also keeps the payload buffers of completed jobs,
+/// so that at a steady state, reading requests does not allocate.
+struct Job_Queue {
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_not_empty;
+    std::condition_variable m_not_full;
+    std::deque<Job> m_jobs;
+    std::vector<std::vector<char>> m_spare_buffers;
+    std::size_t m_capacity;
+    bool m_closed = false;
+
+public:
+    explicit Job_Queue(std::size_t capacity)
+        : m_capacity { capacity }
+    {
+        ULIGHT_ASSERT(capacity != 0);
+    }
+
+    /// @brief Adds `job` to the queue, blocking while the queue is full.
+    void push(Job&& job)
+    {
+        {
+            std::unique_lock lock { m_mutex };
+            m_not_full.wait(lock, [this] { return m_jobs.size() < m_capacity; });
+            m_jobs.push_back(std::move(job));
+        }
+        m_not_empty.notify_one();
+    }
+
+    /// @brief Removes the oldest job from the queue, blocking while the queue is empty.
+    /// @returns The job, or `std::nullopt` if the queue has been closed and is empty.
+    [[nodiscard]]
+    std::optional<Job> pop()
+    {
+        std::optional<Job> result;
+        {
+            std::unique_lock lock { m_mutex };
+            m_not_empty.wait(lock, [this] { return !m_jobs.empty() || m_closed; });
+            if (m_jobs.empty()) {
+                return result;
+            }
+            result.emplace(std::move(m_jobs.front()));
+            m_jobs.pop_front();
+        }
+        m_not_full.notify_one();
+        return result;
+    }
+
+    /// @brief Makes `pop` return `std::nullopt` once all remaining jobs have been taken.
+    void close()
+    {
+        {
+            const std::scoped_lock lock { m_mutex };
+            m_closed = true;
+        }
+        m_not_empty.notify_all();
+    }
+
+    /// @brief Returns a previously recycled buffer, or an empty buffer if there is none.
+    [[nodiscard]]
+    std::vector<char> take_buffer()
+    {
+        const std::scoped_lock lock { m_mutex };
+        if (m_spare_buffers.empty()) {
+            return {};
+        }
+        std::vector<char> result = std::move(m_spare_buffers.back());
+        m_spare_buffers.pop_back();
+        return result;
+    }
+
+    /// @brief Keeps `buffer` for reuse by `take_buffer`.
+    void recycle_buffer(std::vector<char>&& buffer)
+    {
+        const std::scoped_lock lock { m_mutex };
+        // Roughly as many buffers as there can be jobs are needed;
+        // keeping more would only hold on to memory.
+        if (m_spare_buffers.size() < m_capacity * 2) {
+            m_spare_buffers.push_back(std::move(buffer));
+        }
+    }
+};
+
+/// @brief The state of one worker thread, which is reused for all of its jobs.
+struct Worker {
+    Session session;
+    State ansi_state;
+    const ANSI_Theme& ansi_theme;
+    std::string ansi_output;
+    /// @brief Only used on big-endian platforms, where token records need to be byte-swapped.
+    std::vector<std::uint32_t> swapped_records;
+    Token token_buffer[1024];
+    char text_buffer[8192];
+
+    Worker(const Engine& engine, const ANSI_Theme& theme) noexcept
+        : session { engine }
+        , ansi_state { engine }
+        , ansi_theme { theme }
+    {
+        ansi_state.set_token_buffer(token_buffer);
+        ansi_state.set_text_buffer(text_buffer);
+        ansi_state.on_flush_text(&ansi_output, [](const void* out, char* text, std::size_t length) {
+            const_cast<std::string*>(static_cast<const std::string*>(out))->append(text, length);
+        });
+    }
+
+    void run(Job_Queue& queue)
+    {
+        while (std::optional<Job> job = queue.pop()) {
+            process(*job);
+            queue.recycle_buffer(std::move(job->payload));
+        }
+    }
+
+private:
+    void process(const Job& job)
+    {
+        const Request_Header& request = job.header;
+        const std::string_view source { job.payload.data() + request_header_size,
+                                        job.payload.size() - request_header_size };
+
+        Status status {};
+        std::span<const char> output;
+        switch (request.format) {
+        case Output_Format::html: {
+            status = session.highlight(source, request.lang, request.flags);
+            output = session.get_output();
+            break;
+        }
+        case Output_Format::ansi: {
+            ansi_output.clear();
+            ansi_state.set_source(source);
+            ansi_state.set_lang(request.lang);
+            ansi_state.set_flags(request.flags);
+            status = ansi_state.source_to_ansi(ansi_theme);
+            output = ansi_output;
+            break;
+        }
+        case Output_Format::tokens: {
+            status = session.tokens(source, request.lang, request.flags);
+            const std::span<const std::uint32_t> records = session.get_token_records();
+            if constexpr (std::endian::native == std::endian::big) {
+                swapped_records.assign(records.begin(), records.end());
+                std::ranges::transform(swapped_records, swapped_records.begin(), [](auto r) {
+                    return std::byteswap(r);
+                });
+                output = { reinterpret_cast<const char*>(swapped_records.data()),
+                           swapped_records.size() * sizeof(std::uint32_t) };
+            }
+            else {
+                output = { reinterpret_cast<const char*>(records.data()), records.size_bytes() };
+            }
+            break;
+        }
+        }
+
+        if (status != Status::ok) {
+            output = request.format == Output_Format::ansi ? ansi_state.get_error_string()
+                                                           : session.get_error_string();
+        }
+        job.connection->respond(
+            { .id = request.id, .status = status, .format = request.format }, output
+        );
+    }
+};
+
+/// @brief Reads requests from `connection` and adds them to `queue`
+/// until the client closes the connection, or until a protocol error occurs.
+void serve_connection(const std::shared_ptr<Connection>& connection, Job_Queue& queue)
+{
+    const auto protocol_error = [](std::string_view message) {
+        std::cerr << "ulight-server: " << message << " The connection is closed.\n";
+    };
+
+    while (true) {
+        std::array<char, frame_size_size> size_bytes;
+        const std::size_t size_read = read_exact(connection->in_fd, size_bytes);
+        if (size_read == 0) {
+            return;
+        }
+        if (size_read != size_bytes.size()) {
+            return protocol_error("Truncated frame.");
+        }
+        const std::uint32_t size = load_u32(size_bytes);
+        if (size < request_header_size || size > max_frame_size) {
+            return protocol_error("Invalid frame size.");
+        }
+
+        std::vector<char> payload = queue.take_buffer();
+        payload.resize(size);
+        if (read_exact(connection->in_fd, payload) != size) {
+            return protocol_error("Truncated frame.");
+        }
+        const std::optional<Request_Header> header = decode_request_header(payload);
+        if (!header) {
+            return protocol_error("Malformed request header.");
+        }
+        queue.push({ .connection = connection, .header = *header, .payload = std::move(payload) });
+    }
+}
+
+/// @brief The path of the listening socket,
+/// which is removed by `on_terminate` when the server is stopped.
+char socket_path[sizeof(sockaddr_un::sun_path)] {};
+
+extern "C" void on_terminate(int)
+{
+    // Only async-signal-safe functions may be called here.
+    ::unlink(socket_path);
+    ::_exit(EXIT_SUCCESS);
+}
+
+/// @brief Creates a Unix domain socket which listens at `path`.
+/// If a socket (but no other kind of file) already exists at `path`,
+/// it is assumed to be left over from a previous run, and replaced.
+/// @returns The file descriptor of the socket, or `-1` on failure.
+[[nodiscard]]
+int listen_unix_socket(std::string_view path)
+{
+    sockaddr_un address {};
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << path << ": socket path is too long.\n";
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    std::ranges::copy(path, address.sun_path);
+
+    struct stat existing {};
+    if (::stat(address.sun_path, &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+        ::unlink(address.sun_path);
+    }
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << "Failed to create socket: " << std::strerror(errno) << '\n';
+        return -1;
+    }
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+        || ::listen(fd, SOMAXCONN) != 0) {
+        std::cerr << path << ": failed to listen: " << std::strerror(errno) << '\n';
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+int main(int argc, const char** argv)
+{
+    const std::span<const char*> args { argv, std::size_t(argc) };
+    ULIGHT_ASSERT(!args.empty());
+
+    std::string_view listen_path;
+    std::size_t worker_count = std::max(std::thread::hardware_concurrency(), 1u);
+    for (const std::string_view arg : args.subspan(1)) {
+        if (arg.starts_with("--socket=")) {
+            listen_path = arg.substr(std::string_view("--socket=").length());
+        }
+        else if (arg.starts_with("--workers=")) {
+            const std::string_view value = arg.substr(std::string_view("--workers=").length());
+            const auto [end, ec]
+                = std::from_chars(value.data(), value.data() + value.size(), worker_count);
+            if (ec != std::errc {} || end != value.data() + value.size() || worker_count == 0) {
+                std::cerr << arg << ": expected a positive number of workers.\n";
+                return EXIT_FAILURE;
+            }
+        }
+        else {
+            std::cerr << arg << ": unknown argument.\n";
+            print_usage(args[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Writing to a client which has disconnected should fail with EPIPE rather than
+    // terminate the server.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // The engine is shared by all workers, and each worker has its own session.
+    const Engine engine;
+    const ANSI_Theme ansi_theme;
+    if (!engine) {
+        std::cerr << "Failed to create the engine.\n";
+        return EXIT_FAILURE;
+    }
+
+    // A few jobs per worker are enough to keep every worker busy,
+    // while bounding the memory used by requests which have been read but not processed.
+    Job_Queue queue { worker_count * 4 };
+    std::vector<std::jthread> workers;
+    workers.reserve(worker_count);
+    for (std::size_t i = 0; i < worker_count; ++i) {
+        workers.emplace_back([&] {
+            const auto worker = std::make_unique<Worker>(engine, ansi_theme);
+            ULIGHT_ASSERT(worker->session);
+            worker->run(queue);
+        });
+    }
+
+    if (listen_path.empty()) {
+        serve_connection(
+            std::make_shared<Connection>(STDIN_FILENO, STDOUT_FILENO, false), queue
+        );
+        // The workers finish the remaining jobs before they are joined.
+        queue.close();
+        return EXIT_SUCCESS;
+    }
+
+    const int listen_fd = listen_unix_socket(listen_path);
+    if (listen_fd < 0) {
+        queue.close();
+        return EXIT_FAILURE;
+    }
+    std::ranges::copy(listen_path, socket_path);
+    std::signal(SIGINT, on_terminate);
+    std::signal(SIGTERM, on_terminate);
+
+    while (true) {
+        const int client_fd = ::accept(listen_fd, nullptr, nullptr);
+        if (client_fd < 0) {
+            const int error = errno;
+            if (error == EINTR || error == ECONNABORTED) {
+                continue;
+            }
+            std::cerr << "Failed to accept connection: " << std::strerror(error) << '\n';
+            // Running out of file descriptors is usually temporary.
+            if (error == EMFILE || error == ENFILE) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            ::unlink(socket_path);
+            // Connection threads may still refer to the queue and the engine,
+            // so we exit without destroying them.
+            std::_Exit(EXIT_FAILURE);
+        }
+        std::thread { [connection = std::make_shared<Connection>(client_fd, client_fd, true),
+                        &queue] { serve_connection(connection, queue); } }
+            .detach();
+    }
+}
+
+} // namespace
+} // namespace ulight::server
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+int main(int argc, const char** argv)
+{
+    return ulight::server::main(argc, argv);
+}
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ulight/impl/server_protocol.hpp"
+
+namespace ulight::server {
+
+std::size_t read_exact(int fd, std::span<char> out) noexcept
+{
+    std::size_t total = 0;
+    while (total < out.size()) {
+        const ssize_t result = ::read(fd, out.data() + total, out.size() - total);
+        if (result > 0) {
+            total += std::size_t(result);
+        }
+        else if (result == 0 || errno != EINTR) {
+            break;
+        }
+    }
+    return total;
+}
+
+bool write_all(int fd, std::span<const char> head, std::span<const char> body) noexcept
+{
+    // writev lets the header and the body (typically the output of a session) be sent
+    // in a single system call, without first copying them into a contiguous buffer.
+    iovec parts[2] {
+        { const_cast<char*>(head.data()), head.size() },
+        { const_cast<char*>(body.data()), body.size() },
+    };
+    iovec* remaining = parts;
+    int remaining_count = 2;
+    while (remaining_count != 0) {
+        if (remaining->iov_len == 0) {
+            ++remaining;
+            --remaining_count;
+            continue;
+        }
+        const ssize_t result = ::writev(fd, remaining, remaining_count);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        auto written = std::size_t(result);
+        while (remaining_count != 0 && written >= remaining->iov_len) {
+            written -= remaining->iov_len;
+            ++remaining;
+            --remaining_count;
+        }
+        if (remaining_count != 0) {
+            remaining->iov_base = static_cast<char*>(remaining->iov_base) + written;
+            remaining->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+int connect_unix_socket(std::string_view path) noexcept
+{
+    sockaddr_un address {};
+    if (path.size() >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    std::ranges::copy(path, address.sun_path);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        const int error = errno;
+        ::close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace ulight::server
@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "ulight/json.hpp"
+#include "ulight/ulight.hpp"
+
+#include "ulight/impl/assert.hpp"
+#include "ulight/impl/theme.hpp"
+
+namespace ulight {
+namespace {
+
+struct Named_Color {
+    std::u8string_view name;
+    RGB color;
+};
+
+// https://www.w3.org/TR/css-color-4/#named-colors
+// Only the basic colors are supported; they are also the only ones used by the bundled themes.
+constexpr Named_Color named_colors[] {
+    { u8"aqua", { 0x00, 0xff, 0xff } },    { u8"black", { 0x00, 0x00, 0x00 } },
+    { u8"blue", { 0x00, 0x00, 0xff } },    { u8"fuchsia", { 0xff, 0x00, 0xff } },
+    { u8"gray", { 0x80, 0x80, 0x80 } },    { u8"green", { 0x00, 0x80, 0x00 } },
+    { u8"grey", { 0x80, 0x80, 0x80 } },    { u8"lime", { 0x00, 0xff, 0x00 } },
+    { u8"maroon", { 0x80, 0x00, 0x00 } },  { u8"navy", { 0x00, 0x00, 0x80 } },
+    { u8"olive", { 0x80, 0x80, 0x00 } },   { u8"orange", { 0xff, 0xa5, 0x00 } },
+    { u8"purple", { 0x80, 0x00, 0x80 } },  { u8"red", { 0xff, 0x00, 0x00 } },
+    { u8"silver", { 0xc0, 0xc0, 0xc0 } },  { u8"teal", { 0x00, 0x80, 0x80 } },
+    { u8"white", { 0xff, 0xff, 0xff } },   { u8"yellow", { 0xff, 0xff, 0x00 } },
+};
+
+[[nodiscard]]
+std::optional<unsigned char> parse_hex_digit(char8_t c) noexcept
+{
+    if (c >= u8'0' && c <= u8'9') {
+        return static_cast<unsigned char>(c - u8'0');
+    }
+    if (c >= u8'a' && c <= u8'f') {
+        return static_cast<unsigned char>(c - u8'a' + 10);
+    }
+    if (c >= u8'A' && c <= u8'F') {
+        return static_cast<unsigned char>(c - u8'A' + 10);
+    }
+    return {};
+}
+
+/// @brief Returns `true` if `list` contains `word`,
+/// where `list` is a sequence of words separated by whitespace,
+/// like the value of the CSS `text-decoration` property.
+[[nodiscard]]
+bool contains_word(std::u8string_view list, std::u8string_view word) noexcept
+{
+    std::size_t pos = 0;
+    while ((pos = list.find(word, pos)) != std::u8string_view::npos) {
+        const std::size_t end = pos + word.length();
+        const bool starts_word = pos == 0 || list[pos - 1] == u8' ';
+        const bool ends_word = end == list.length() || list[end] == u8' ';
+        if (starts_word && ends_word) {
+            return true;
+        }
+        pos = end;
+    }
+    return false;
+}
+
+/// @brief Applies a single CSS declaration, like `font-weight: bold`, to `style`.
+void apply_css_property(
+    Theme_Style& style,
+    std::u8string_view property,
+    std::u8string_view value
+) noexcept
+{
+    // Colors which cannot be parsed are ignored rather than resetting the inherited color.
+    if (property == u8"color") {
+        if (const std::optional<RGB> color = parse_css_color(value)) {
+            style.color = color;
+        }
+    }
+    else if (property == u8"background-color") {
+        if (const std::optional<RGB> color = parse_css_color(value)) {
+            style.background_color = color;
+        }
+    }
+    else if (property == u8"font-style") {
+        if (value == u8"italic" || value == u8"oblique") {
+            style.italic = true;
+        }
+        else if (value == u8"normal") {
+            style.italic = false;
+        }
+    }
+    else if (property == u8"font-weight") {
+        int weight = 0;
+        const auto* const begin = reinterpret_cast<const char*>(value.data());
+        const auto [end, ec] = std::from_chars(begin, begin + value.size(), weight);
+        if (ec == std::errc {} && end == begin + value.size()) {
+            style.bold = weight >= 600;
+        }
+        else if (value == u8"bold" || value == u8"bolder") {
+            style.bold = true;
+        }
+        else if (value == u8"normal" || value == u8"lighter") {
+            style.bold = false;
+        }
+    }
+    else if (property == u8"text-decoration" || property == u8"text-decoration-line") {
+        style.underline = contains_word(value, u8"underline");
+        style.strikethrough = contains_word(value, u8"line-through");
+    }
+}
+
+/// @brief Collects the styles declared in one variant of a theme.
+///
+/// The expected structure is
+/// `{ "<variant>": { "<type>": "<color>" | { "<property>": "<value>", ... }, ... }, ... }`.
+/// Anything else (metadata, other variants, arrays, numbers, etc.) is skipped.
+struct Theme_Visitor final : JSON_Visitor {
+    /// @brief Receives the special `"foreground"` and `"background"` colors.
+    Theme& theme;
+    /// @brief The styles that are declared directly, without inheritance.
+    std::array<std::optional<Theme_Style>, 256>& declared;
+    std::u8string_view variant;
+    bool found_variant = false;
+
+private:
+    static constexpr std::size_t max_depth = 3;
+
+    /// @brief The names of the properties at each depth of objects,
+    /// such as `["dark", "comment", "font-style"]`.
+    std::array<std::u8string, max_depth> keys;
+    /// @brief The text of the string or property name that is currently being parsed.
+    std::u8string current_string;
+    std::size_t object_depth = 0;
+    std::size_t array_depth = 0;
+    bool in_variant = false;
+
+public:
+    Theme_Visitor(
+        Theme& theme,
+        std::array<std::optional<Theme_Style>, 256>& declared,
+        std::u8string_view variant
+    )
+        : theme { theme }
+        , declared { declared }
+        , variant { variant }
+    {
+    }
+
+    void literal(const Source_Position&, std::u8string_view chars) final
+    {
+        current_string += chars;
+    }
+    void escape(const Source_Position&, std::u8string_view, char32_t, std::u8string_view code_units)
+        final
+    {
+        current_string += code_units;
+    }
+
+    void push_string(const Source_Position&) final
+    {
+        current_string.clear();
+    }
+    void pop_string(const Source_Position&) final
+    {
+        if (in_variant && array_depth == 0) {
+            on_value(current_string);
+        }
+    }
+
+    void push_property(const Source_Position&) final
+    {
+        current_string.clear();
+    }
+    void pop_property(const Source_Position&) final
+    {
+        if (object_depth != 0 && object_depth <= max_depth) {
+            keys[object_depth - 1] = current_string;
+        }
+    }
+
+    void push_object(const Source_Position&) final
+    {
+        ++object_depth;
+        if (object_depth == 2 && array_depth == 0 && keys[0] == variant) {
+            in_variant = true;
+            found_variant = true;
+        }
+    }
+    void pop_object(const Source_Position&) final
+    {
+        if (object_depth == 2) {
+            in_variant = false;
+        }
+        --object_depth;
+    }
+
+    void push_array(const Source_Position&) final
+    {
+        ++array_depth;
+    }
+    void pop_array(const Source_Position&) final
+    {
+        --array_depth;
+    }
+
+private:
+    void on_value(std::u8string_view value)
+    {
+        if (object_depth == 2) {
+            if (keys[1] == u8"foreground") {
+                theme.foreground = parse_css_color(value);
+            }
+            else if (keys[1] == u8"background") {
+                theme.background = parse_css_color(value);
+            }
+            // "id": "#abcdef" is a shorthand for "id": { "color": "#abcdef" }
+            else if (Theme_Style* const style = style_of(keys[1])) {
+                apply_css_property(*style, u8"color", value);
+            }
+        }
+        else if (object_depth == 3) {
+            if (Theme_Style* const style = style_of(keys[1])) {
+                apply_css_property(*style, keys[2], value);
+            }
+        }
+    }
+
+    [[nodiscard]]
+    Theme_Style* style_of(std::u8string_view key)
+    {
+        const std::optional<Highlight_Type> type = highlight_type_by_long_string(key);
+        if (!type) {
+            return nullptr;
+        }
+        std::optional<Theme_Style>& result = declared[std::size_t(*type)];
+        if (!result) {
+            result.emplace();
+        }
+        return &*result;
+    }
+};
+
+} // namespace
+
+std::optional<RGB> parse_css_color(std::u8string_view str) noexcept
+{
+    if (str.starts_with(u8'#')) {
+        const std::u8string_view digits = str.substr(1);
+        const bool is_short = digits.length() == 3 || digits.length() == 4;
+        const bool is_long = digits.length() == 6 || digits.length() == 8;
+        if (!is_short && !is_long) {
+            return {};
+        }
+        unsigned char channels[3];
+        for (std::size_t i = 0; i < 3; ++i) {
+            const auto high = parse_hex_digit(digits[is_short ? i : i * 2]);
+            const auto low = parse_hex_digit(digits[is_short ? i : (i * 2) + 1]);
+            if (!high || !low) {
+                return {};
+            }
+            channels[i] = static_cast<unsigned char>((*high << 4) | *low);
+        }
+        return RGB { channels[0], channels[1], channels[2] };
+    }
+
+    const auto* const named = std::ranges::find(named_colors, str, &Named_Color::name);
+    if (named != std::ranges::end(named_colors)) {
+        return named->color;
+    }
+    return {};
+}
+
+std::optional<Highlight_Type> highlight_type_by_long_string(std::u8string_view str) noexcept
+{
+    for (std::size_t i = 0; i < 256; ++i) {
+        const auto type = Highlight_Type(i);
+        if (!str.empty() && highlight_type_long_string_u8(type) == str) {
+            return type;
+        }
+    }
+    return {};
+}
+
+Status load_theme(Theme& out, std::u8string_view json, std::u8string_view variant)
+{
+    Theme result;
+    std::array<std::optional<Theme_Style>, 256> declared {};
+    Theme_Visitor visitor { result, declared, variant };
+
+    constexpr JSON_Options options { .allow_comments = true,
+                                     .escapes = Escape_Parsing::parse_encode };
+    if (!parse_json(visitor, json, options)) {
+        return Status::bad_text;
+    }
+    if (!visitor.found_variant) {
+        return Status::bad_state;
+    }
+
+    for (std::size_t i = 0; i < result.styles.size(); ++i) {
+        const std::u8string_view long_name = highlight_type_long_string_u8(Highlight_Type(i));
+        Theme_Style style {};
+        // Ancestors are visited from least to most specific,
+        // e.g. "id", "id-function", "id-function-decl",
+        // so that more specific declarations take precedence.
+        for (std::size_t end = 0; end != std::u8string_view::npos;) {
+            end = long_name.find(u8'-', end + 1);
+            const std::u8string_view ancestor = long_name.substr(0, end);
+            if (const auto type = highlight_type_by_long_string(ancestor)) {
+                if (const std::optional<Theme_Style>& d = declared[std::size_t(*type)]) {
+                    style.merge(*d);
+                }
+            }
+        }
+        result.styles[i] = style;
+    }
+    out = result;
+    return Status::ok;
+}
+
+std::size_t to_ansi_sequence(
+    std::span<char, ULIGHT_ANSI_SEQUENCE_CAPACITY> out,
+    const Theme_Style& style
+) noexcept
+{
+    if (style.is_plain()) {
+        return 0;
+    }
+    // The longest possible sequence is "\x1B[0;1;3;4;9;38;2;255;255;255;48;2;255;255;255m",
+    // which fits into ULIGHT_ANSI_SEQUENCE_CAPACITY.
+    std::size_t length = 0;
+    const auto append = [&](std::string_view str) {
+        ULIGHT_ASSERT(length + str.length() <= out.size());
+        std::ranges::copy(str, out.data() + length);
+        length += str.length();
+    };
+
+    append("\x1B[0");
+    if (style.bold.value_or(false)) {
+        append(";1");
+    }
+    if (style.italic.value_or(false)) {
+        append(";3");
+    }
+    if (style.underline.value_or(false)) {
+        append(";4");
+    }
+    if (style.strikethrough.value_or(false)) {
+        append(";9");
+    }
+    const auto append_color = [&](std::string_view prefix, RGB color) {
+        append(prefix);
+        for (const unsigned char channel : { color.r, color.g, color.b }) {
+            char digits[4] { ';' };
+            const auto [end, ec] = std::to_chars(digits + 1, std::end(digits), channel);
+            ULIGHT_ASSERT(ec == std::errc {});
+            append({ digits, end });
+        }
+    };
+    if (style.color) {
+        append_color(";38;2", *style.color);
+    }
+    if (style.background_color) {
+        append_color(";48;2", *style.background_color);
+    }
+    append("m");
+    return length;
+}
+
+} // namespace ulight
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+#include "ulight/impl/trace.hpp"
+
+namespace ulight::trace {
+namespace {
+
+/// @brief The head of the intrusive list of all registered rules.
+constinit std::atomic<Rule_Stats*> rules_head = nullptr;
+
+/// @brief Prints the histogram of rules to stderr upon program termination.
+struct Exit_Dumper {
+    Exit_Dumper() = default;
+    Exit_Dumper(const Exit_Dumper&) = delete;
+    Exit_Dumper& operator=(const Exit_Dumper&) = delete;
+
+    ~Exit_Dumper()
+    {
+        dump_rules(stderr);
+    }
+} exit_dumper;
+
+} // namespace
+
+Rule_Stats::Rule_Stats(const char* name, const char* file, int line) noexcept
+    : name { name }
+    , file { file }
+    , line { line }
+{
+    Rule_Stats* head = rules_head.load(std::memory_order::relaxed);
+    do {
+        next = head;
+    } while (!rules_head.compare_exchange_weak(
+        head, this, std::memory_order::release, std::memory_order::relaxed
+    ));
+}
+
+std::uint64_t cycles() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t result;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(result));
+    return result;
+#else
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+#endif
+}
+
+void dump_rules(std::FILE* out)
+{
+    std::vector<const Rule_Stats*> rules;
+    for (const Rule_Stats* r = rules_head.load(std::memory_order::acquire); r; r = r->next) {
+        rules.push_back(r);
+    }
+    if (rules.empty()) {
+        return;
+    }
+    std::ranges::sort(rules, [](const Rule_Stats* x, const Rule_Stats* y) {
+        return x->cycles.load(std::memory_order::relaxed)
+            > y->cycles.load(std::memory_order::relaxed);
+    });
+
+    std::fprintf(
+        out, "%-40s %12s %12s %7s %14s %16s %10s  %s\n", "rule", "attempts", "hits", "hit%",
+        "bytes", "cycles", "cyc/try", "location"
+    );
+    for (const Rule_Stats* r : rules) {
+        const std::uint64_t attempts = r->attempts.load(std::memory_order::relaxed);
+        const std::uint64_t hits = r->hits.load(std::memory_order::relaxed);
+        const std::uint64_t bytes = r->bytes.load(std::memory_order::relaxed);
+        const std::uint64_t total_cycles = r->cycles.load(std::memory_order::relaxed);
+        const double hit_percentage = attempts == 0 ? 0.0 : 100.0 * double(hits) / double(attempts);
+        const double cycles_per_attempt
+            = attempts == 0 ? 0.0 : double(total_cycles) / double(attempts);
+        std::fprintf(
+            out, "%-40.40s %12llu %12llu %6.2f%% %14llu %16llu %10.1f  %s:%d\n", r->name,
+            static_cast<unsigned long long>(attempts), static_cast<unsigned long long>(hits),
+            hit_percentage, static_cast<unsigned long long>(bytes),
+            static_cast<unsigned long long>(total_cycles), cycles_per_attempt, r->file, r->line
+        );
+    }
+}
+
+void reset_rules() noexcept
+{
+    for (Rule_Stats* r = rules_head.load(std::memory_order::acquire); r; r = r->next) {
+        r->attempts.store(0, std::memory_order::relaxed);
+        r->hits.store(0, std::memory_order::relaxed);
+        r->bytes.store(0, std::memory_order::relaxed);
+        r->cycles.store(0, std::memory_order::relaxed);
+    }
+}
+
+} // namespace ulight::trace
@@ -1,31 +1,213 @@
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
 #include <new>
+#include <optional>
 #include <string_view>
 
 #include "ulight/function_ref.hpp"
 #include "ulight/ulight.h"
 #include "ulight/ulight.hpp"
 
+#include "ulight/impl/ansi.hpp"
 #include "ulight/impl/assert.hpp"
 #include "ulight/impl/buffer.hpp"
 #include "ulight/impl/highlight.hpp"
 #include "ulight/impl/memory.hpp"
 #include "ulight/impl/platform.h"
+#include "ulight/impl/simd.hpp"
 #include "ulight/impl/strings.hpp"
+#include "ulight/impl/theme.hpp"
 #include "ulight/impl/unicode.hpp"
 
+struct ulight_engine {
+    /// @brief The options that the engine was created with,
+    /// where the names point into `strings`, and the mask points to `emit_mask`.
+    ulight_engine_options options;
+    ulight_highlight_mask emit_mask;
+    /// @brief For each highlight type, the opening HTML tag, such as `<h- data-h=kw>`.
+    std::string_view open_tags[256];
+    /// @brief The closing HTML tag, such as `</h->`.
+    std::string_view close_tag;
+    /// @brief The storage of all the strings above, allocated with `options.alloc`.
+    char* strings;
+    std::size_t strings_size;
+};
+
 namespace ulight {
 namespace {
 
-ulight::Highlight_Options to_options(ulight_flag flags) noexcept
+ulight::Highlight_Options to_options(ulight_flag flags, ulight_stats* stats) noexcept
 {
     return {
         .coalescing = (flags & ULIGHT_COALESCE) != 0,
         .strict = (flags & ULIGHT_STRICT) != 0,
+        .diff_words = (flags & ULIGHT_DIFF_WORDS) != 0,
+        .diff_lang = (flags & ULIGHT_DIFF_LANG) != 0,
+        .stats = stats,
     };
 }
 
+using Stats_Clock = std::chrono::steady_clock;
+
+/// @brief Returns `Stats_Clock::now()` if `stats` is not null,
+/// otherwise a default-constructed time point, without querying the clock.
+[[nodiscard]]
+Stats_Clock::time_point stats_now(const ulight_stats* stats) noexcept
+{
+    return stats ? Stats_Clock::now() : Stats_Clock::time_point {};
+}
+
+[[nodiscard]]
+unsigned long long nanoseconds_since(Stats_Clock::time_point start) noexcept
+{
+    const auto elapsed = Stats_Clock::now() - start;
+    return static_cast<unsigned long long>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()
+    );
+}
+
+/// @brief Forwards to a user-provided `flush_tokens` function,
+/// while counting tokens and measuring the time spent within that function.
+struct Stats_Token_Flush {
+    ulight_stats* stats;
+    const void* flush_data;
+    void (*flush)(const void*, ulight_token*, std::size_t);
+    unsigned long long flush_ns = 0;
+
+    void operator()(ulight_token* tokens, std::size_t amount)
+    {
+        ++stats->flush_tokens_calls;
+        for (std::size_t i = 0; i < amount; ++i) {
+            ++stats->tokens[tokens[i].type];
+        }
+        const auto start = Stats_Clock::now();
+        flush(flush_data, tokens, amount);
+        flush_ns += nanoseconds_since(start);
+    }
+};
+
+/// @brief Converts the `begin` and `length` of tokens from UTF-8 code units
+/// into UTF-16 code units, and forwards them to a user-provided `flush_tokens` function.
+/// Tokens are flushed in ascending order, so the conversion only ever moves forward
+/// through `source`, and takes linear time for the whole source.
+struct Utf16_Token_Flush {
+    std::u8string_view source;
+    const void* flush_data;
+    void (*flush)(const void*, ulight_token*, std::size_t);
+    std::size_t utf8_position = 0;
+    std::size_t utf16_position = 0;
+
+    [[nodiscard]]
+    std::size_t to_utf16(std::size_t utf8_offset) noexcept
+    {
+        ULIGHT_DEBUG_ASSERT(utf8_offset >= utf8_position);
+        utf16_position
+            += utf16::transcoded_length(source.substr(utf8_position, utf8_offset - utf8_position));
+        utf8_position = utf8_offset;
+        return utf16_position;
+    }
+
+    void operator()(ulight_token* tokens, std::size_t amount)
+    {
+        for (std::size_t i = 0; i < amount; ++i) {
+            const std::size_t begin = to_utf16(tokens[i].begin);
+            const std::size_t end = to_utf16(tokens[i].begin + tokens[i].length);
+            tokens[i].begin = begin;
+            tokens[i].length = end - begin;
+        }
+        flush(flush_data, tokens, amount);
+    }
+};
+
+/// @brief Splits tokens so that every malformed code unit in the source
+/// is covered by a `ULIGHT_HL_ERROR` token, and forwards them to `out`.
+/// Tokens are flushed in ascending order, so the source is checked in a single forward pass
+/// while it is being highlighted, rather than in a separate validation pass.
+struct Lenient_Token_Flush {
+    std::u8string_view source;
+    Non_Owning_Buffer<ulight_token>& out;
+    /// @brief The position up to which the source has been checked.
+    /// This can be past the end of the last token if a code point extends beyond it.
+    std::size_t checked = 0;
+
+    void operator()(ulight_token* tokens, std::size_t amount)
+    {
+        for (std::size_t i = 0; i < amount; ++i) {
+            const ulight_token& t = tokens[i];
+            forward(checked, t.begin, {});
+            forward(t.begin, t.begin + t.length, t.type);
+        }
+    }
+
+    /// @brief Checks the remainder of the source after the last token.
+    void finish()
+    {
+        forward(checked, source.length(), {});
+    }
+
+private:
+    /// @brief Forwards `[begin, end)` as tokens of the given `type`,
+    /// or nothing for a gap between tokens,
+    /// except for malformed code units, which are forwarded as error tokens.
+    void forward(std::size_t begin, std::size_t end, std::optional<unsigned char> type)
+    {
+        // Malformed code units within error tokens need not be split off.
+        if (type == ULIGHT_HL_ERROR) {
+            emit(begin, end, type);
+            checked = std::max(checked, end);
+            return;
+        }
+        std::size_t piece_begin = begin;
+        std::size_t pos = std::max(checked, begin);
+        while (pos < end) {
+            pos += simd::ascii_prefix_length(source.substr(pos, end - pos));
+            if (pos >= end) {
+                break;
+            }
+            if (const auto next = utf8::decode_and_length(source.substr(pos))) {
+                pos += std::size_t(next->length);
+                continue;
+            }
+            const std::size_t malformed_begin = pos;
+            do {
+                ++pos;
+            } while (pos < end && !utf8::decode_and_length(source.substr(pos)));
+            emit(piece_begin, malformed_begin, type);
+            emit(malformed_begin, pos, ULIGHT_HL_ERROR);
+            piece_begin = pos;
+        }
+        emit(piece_begin, end, type);
+        checked = std::max(pos, end);
+    }
+
+    void emit(std::size_t begin, std::size_t end, std::optional<unsigned char> type)
+    {
+        if (type && begin < end) {
+            out.push_back({ .begin = begin, .length = end - begin, .type = *type });
+        }
+    }
+};
+
+/// @brief Forwards to a user-provided `flush_text` function,
+/// while counting the amount of calls.
+struct Stats_Text_Flush {
+    ulight_stats* stats;
+    const void* flush_data;
+    void (*flush)(const void*, char*, std::size_t);
+
+    void operator()(char* text, std::size_t length) const
+    {
+        ++stats->flush_text_calls;
+        flush(flush_data, text, length);
+    }
+};
+
 [[nodiscard]]
 std::u8string_view html_entity_of(char8_t c)
 {
@@ -41,9 +223,8 @@ std::u8string_view html_entity_of(char8_t c)
 
 void append_html_escaped(Non_Owning_Buffer<char>& out, std::string_view text)
 {
-    constexpr std::u8string_view escaped_chars = u8"<>&";
     while (!text.empty()) {
-        const std::size_t bracket_pos = text.find_first_of(as_string_view(escaped_chars));
+        const std::size_t bracket_pos = simd::find_any<u8'<', u8'>', u8'&'>(text);
         const auto snippet = text.substr(0, std::min(text.length(), bracket_pos));
         out.append_range(snippet);
         if (bracket_pos == std::string_view::npos) {
@@ -54,6 +235,133 @@ void append_html_escaped(Non_Owning_Buffer<char>& out, std::string_view text)
     }
 }
 
+/// @brief Like `append_html_escaped`, but for terminal output.
+/// C0 control characters other than tab and line breaks, as well as DEL,
+/// are replaced with their symbols in the Control Pictures block (e.g. U+241B SYMBOL FOR ESCAPE).
+/// C1 control characters (e.g. U+009B CONTROL SEQUENCE INTRODUCER) and malformed code units,
+/// which some terminals interpret as C1 controls, are replaced with U+FFFD REPLACEMENT CHARACTER.
+/// This way, the source code cannot inject control sequences into the output.
+void append_terminal_escaped(Non_Owning_Buffer<char>& out, std::string_view text)
+{
+    constexpr std::u8string_view replacement = u8"\uFFFD";
+    const auto is_passed_through = [](char8_t c) {
+        return (c >= u8' ' && c < u8'\x7F') || c == u8'\t' || c == u8'\n' || c == u8'\r';
+    };
+
+    const std::u8string_view str { reinterpret_cast<const char8_t*>(text.data()), text.length() };
+    std::size_t plain_begin = 0;
+    std::size_t pos = 0;
+    while (pos < str.length()) {
+        const char8_t c = str[pos];
+        if (is_passed_through(c)) {
+            ++pos;
+            continue;
+        }
+        if (c < 0x80) {
+            out.append_range(text.substr(plain_begin, pos - plain_begin));
+            // U+2400 SYMBOL FOR NULL onwards, or U+2421 SYMBOL FOR DELETE.
+            const char symbol[] { '\xE2', '\x90', char(c == 0x7F ? 0xA1 : 0x80 + c) };
+            out.append_range(std::string_view { symbol, sizeof(symbol) });
+            plain_begin = ++pos;
+            continue;
+        }
+        const std::expected<utf8::Code_Point_And_Length, utf8::Error_Code> next
+            = utf8::decode_and_length(str.substr(pos));
+        if (next && next->code_point > 0x9F) {
+            pos += std::size_t(next->length);
+            continue;
+        }
+        out.append_range(text.substr(plain_begin, pos - plain_begin));
+        out.append_range(as_string_view(replacement));
+        pos += next ? std::size_t(next->length) : 1;
+        plain_begin = pos;
+    }
+    out.append_range(text.substr(plain_begin));
+}
+
+/// @brief Appends `text` to `out` using `append`,
+/// except that every malformed code unit is replaced with U+FFFD REPLACEMENT CHARACTER,
+/// so that the output is correctly UTF-8-encoded even if `text` is not.
+void append_replacing_malformed(
+    Non_Owning_Buffer<char>& out,
+    std::string_view text,
+    void append(Non_Owning_Buffer<char>&, std::string_view)
+)
+{
+    constexpr std::u8string_view replacement = u8"\uFFFD";
+    const std::u8string_view str { reinterpret_cast<const char8_t*>(text.data()), text.length() };
+    std::size_t valid_begin = 0;
+    std::size_t pos = 0;
+    while (pos < str.length()) {
+        pos += simd::ascii_prefix_length(str.substr(pos));
+        if (pos == str.length()) {
+            break;
+        }
+        if (const auto next = utf8::decode_and_length(str.substr(pos))) {
+            pos += std::size_t(next->length);
+            continue;
+        }
+        append(out, text.substr(valid_begin, pos - valid_begin));
+        out.append_range(as_string_view(replacement));
+        valid_begin = ++pos;
+    }
+    append(out, text.substr(valid_begin));
+}
+
+struct Default_ANSI_Style {
+    /// @brief The long string of a highlight type,
+    /// which also applies to more specific types, like `"string"` to `"string-delim"`.
+    std::string_view type;
+    std::string_view sequence;
+};
+
+/// @brief The styles of the theme used by `ulight_ansi_theme_init`.
+constexpr Default_ANSI_Style default_ansi_styles[] {
+    { "error", ansi::red },
+    { "comment", ansi::h_black },
+    { "value", ansi::cyan },
+    { "string", ansi::green },
+    { "escape", ansi::yellow },
+    { "null", ansi::magenta },
+    { "bool", ansi::magenta },
+    { "this", ansi::magenta },
+    { "number", ansi::cyan },
+    { "keyword", ansi::blue },
+    { "macro", ansi::magenta },
+    { "id-function", ansi::yellow },
+    { "id-type", ansi::cyan },
+    { "attr", ansi::yellow },
+    { "diff-heading", ansi::h_blue },
+    { "diff-deletion", ansi::red },
+    { "diff-insertion", ansi::green },
+    { "diff-modification", ansi::yellow },
+    { "markup-tag", ansi::blue },
+    { "markup-attr", ansi::yellow },
+    { "markup-deletion", ansi::red },
+    { "markup-insertion", ansi::green },
+    { "shell-command", ansi::blue },
+    { "shell-option", ansi::cyan },
+    { "asm-instruction", ansi::blue },
+};
+
+/// @brief Returns the sequence of the most specific entry in `default_ansi_styles`
+/// that applies to the highlight type with the given `long_name`.
+[[nodiscard]]
+std::string_view default_ansi_sequence(std::string_view long_name) noexcept
+{
+    std::string_view result;
+    std::size_t result_type_length = 0;
+    for (const auto& [type, sequence] : default_ansi_styles) {
+        const bool applies = long_name.starts_with(type)
+            && (long_name.length() == type.length() || long_name[type.length()] == '-');
+        if (applies && type.length() > result_type_length) {
+            result = sequence;
+            result_type_length = type.length();
+        }
+    }
+    return result;
+}
+
 } // namespace
 } // namespace ulight
 
@@ -232,7 +540,7 @@ ulight_lang ulight_lang_from_path(const char* path, size_t path_length) noexcept
 ULIGHT_EXPORT
 ulight_lang ulight_lang_from_path_u8(const char8_t* path, size_t path_length) noexcept
 {
-    return ulight_get_lang(reinterpret_cast<const char*>(path), path_length);
+    return ulight_lang_from_path(reinterpret_cast<const char*>(path), path_length);
 }
 
 ULIGHT_EXPORT
@@ -318,6 +626,16 @@ ulight_state* ulight_init(ulight_state* state) ULIGHT_NOEXCEPT
     state->error = nullptr;
     state->error_length = 0;
 
+    state->stats = nullptr;
+    state->html_emit_mask = nullptr;
+
+    state->is_cancelled_data = nullptr;
+    state->is_cancelled = nullptr;
+    state->cancel_flag = nullptr;
+    state->time_limit_ns = 0;
+
+    state->engine = nullptr;
+
     return state;
 }
 
@@ -341,6 +659,30 @@ void ulight_delete(ulight_state* state) noexcept
 
 namespace {
 
+/// @brief Allocates memory using the engine of `state`, if any, or else using `ulight_alloc`.
+[[nodiscard]]
+void* state_alloc(const ulight_state* state, std::size_t size, std::size_t alignment) noexcept
+{
+    return state->engine ? state->engine->options.alloc(size, alignment)
+                         : ulight_alloc(size, alignment);
+}
+
+/// @brief Frees memory previously allocated with `state_alloc`.
+void state_free(
+    const ulight_state* state,
+    void* pointer,
+    std::size_t size,
+    std::size_t alignment
+) noexcept
+{
+    if (state->engine) {
+        state->engine->options.free(pointer, size, alignment);
+    }
+    else {
+        ulight_free(pointer, size, alignment);
+    }
+}
+
 ulight_status error(ulight_state* state, ulight_status status, std::u8string_view text) noexcept
 {
     state->error = reinterpret_cast<const char*>(text.data());
@@ -364,17 +706,13 @@ void check_flush_validity(ulight_state* state, std::span<const ulight_token> tok
     }
 }
 
-} // namespace
-
-ULIGHT_EXPORT
-// NOLINTNEXTLINE(bugprone-exception-escape)
-ulight_status ulight_source_to_tokens(ulight_state* state) noexcept
+[[nodiscard]]
+ulight_status check_tokens_state(ulight_state* state) noexcept
 {
     if (state->source == nullptr && state->source_length != 0) {
         return error(
             state, ULIGHT_STATUS_BAD_STATE, u8"source is null, but source_length is nonzero."
         );
-        return ULIGHT_STATUS_BAD_STATE;
     }
     if (state->token_buffer == nullptr) {
         return error(state, ULIGHT_STATUS_BAD_BUFFER, u8"token_buffer must not be null.");
@@ -390,33 +728,154 @@ ulight_status ulight_source_to_tokens(ulight_state* state) noexcept
             state, ULIGHT_STATUS_BAD_LANG, u8"The given language (numeric value) is invalid."
         );
     }
+    if (!ulight::is_lang_enabled(ulight::Lang(state->lang))) {
+        return error(
+            state, ULIGHT_STATUS_BAD_LANG,
+            u8"The given language is not built into this library (see ULIGHT_ENABLED_LANGS)."
+        );
+    }
+    return ULIGHT_STATUS_OK;
+}
+
+/// @brief Checks the members of `state` that are needed for producing text,
+/// such as HTML.
+[[nodiscard]]
+ulight_status check_text_state(ulight_state* state) noexcept
+{
+    if (state->token_buffer == nullptr && state->token_buffer_length != 0) {
+        return error(
+            state, ULIGHT_STATUS_BAD_BUFFER,
+            u8"token_buffer is null, but token_buffer_length is nonzero."
+        );
+    }
+    if (state->text_buffer == nullptr) {
+        return error(state, ULIGHT_STATUS_BAD_BUFFER, u8"text_buffer must not be null.");
+    }
+    if (state->text_buffer_length == 0) {
+        return error(state, ULIGHT_STATUS_BAD_BUFFER, u8"text_buffer_length must be nonzero.");
+    }
+    if (state->flush_text == nullptr) {
+        return error(state, ULIGHT_STATUS_BAD_BUFFER, u8"flush_text must not be null.");
+    }
+    return ULIGHT_STATUS_OK;
+}
+
+/// @brief Whether the source code of a `ulight_state` has to be checked for UTF-8 validity.
+enum struct Utf8_Check : bool {
+    /// @brief The source code comes from the user, and is checked unless the flags say otherwise.
+    validate,
+    /// @brief The source code is known to be valid, such as after transcoding from UTF-16.
+    trusted,
+};
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+ulight_status source_to_tokens(ulight_state* state, Utf8_Check check) noexcept
+{
+    ulight_stats* const stats = state->stats;
+
+    const auto validation_start = ulight::stats_now(stats);
+    if (const ulight_status status = check_tokens_state(state); status != ULIGHT_STATUS_OK) {
+        return status;
+    }
+    // Validating up front means that the highlighters never have to report malformed text,
+    // which keeps error handling (and exceptions in particular) out of their hot loops.
+    // In lenient mode, malformed code units are instead found as the tokens are flushed.
+    const bool lenient = check == Utf8_Check::validate && (state->flags & ULIGHT_LENIENT_UTF8) != 0;
+    const bool validate = check == Utf8_Check::validate && !lenient
+        && (state->flags & ULIGHT_SKIP_UTF8_VALIDATION) == 0;
+    if (validate
+        && !ulight::utf8::is_valid({ reinterpret_cast<const char8_t*>(state->source),
+                                     state->source_length })) {
+        return error(
+            state, ULIGHT_STATUS_BAD_TEXT, u8"The given source code is not correctly UTF-8-encoded."
+        );
+    }
+    if (stats) {
+        stats->validation_ns += ulight::nanoseconds_since(validation_start);
+    }
 
-    ulight::Non_Owning_Buffer<ulight_token> buffer { state->token_buffer,
-                                                     state->token_buffer_length,
-                                                     state->flush_tokens_data,
-                                                     state->flush_tokens };
+    // When collecting statistics, the user-provided flush_tokens is wrapped.
+    // Otherwise, it is used directly so that we don't pay for what we don't use.
+    ulight::Stats_Token_Flush stats_flush { stats, state->flush_tokens_data, state->flush_tokens };
+    const ulight::Function_Ref<void(ulight_token*, std::size_t)> stats_flush_ref = stats_flush;
+
+    ulight::Non_Owning_Buffer<ulight_token> buffer
+        = stats ? ulight::Non_Owning_Buffer<ulight_token> { state->token_buffer,
+                                                            state->token_buffer_length,
+                                                            stats_flush_ref.get_entity(),
+                                                            stats_flush_ref.get_invoker() }
+                : ulight::Non_Owning_Buffer<ulight_token> { state->token_buffer,
+                                                            state->token_buffer_length,
+                                                            state->flush_tokens_data,
+                                                            state->flush_tokens };
     // This may actually lead to undefined behavior.
     // Counterpoint: it works on my machine.
     const std::u8string_view source { std::launder(reinterpret_cast<const char8_t*>(state->source)),
                                       state->source_length };
-    ulight::Global_Memory_Resource memory;
-    const ulight::Highlight_Options options = ulight::to_options(state->flags);
+
+    ulight::Lenient_Token_Flush lenient_flush { source, buffer };
+    const ulight::Function_Ref<void(ulight_token*, std::size_t)> lenient_flush_ref = lenient_flush;
+    ulight_token lenient_tokens[256];
+    ulight::Non_Owning_Buffer<ulight_token> lenient_buffer { lenient_tokens, lenient_flush_ref };
+    ulight::Non_Owning_Buffer<ulight_token>& highlight_buffer = lenient ? lenient_buffer : buffer;
+
+    ulight::Function_Memory_Resource memory { ulight_alloc, ulight_free };
+    if (state->engine) {
+        memory = { state->engine->options.alloc, state->engine->options.free };
+    }
+    ulight::Highlight_Options options = ulight::to_options(state->flags, stats);
+    ulight::Cancellation cancellation { .data = state->is_cancelled_data,
+                                        .is_cancelled = state->is_cancelled,
+                                        .flag = state->cancel_flag };
+    if (state->time_limit_ns != 0) {
+        using Clock = ulight::Cancellation::Clock;
+        const Clock::time_point now = Clock::now();
+        // Limits that would overflow the deadline, such as ULLONG_MAX, never expire.
+        const auto max_limit
+            = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::time_point::max() - now);
+        if (state->time_limit_ns < static_cast<unsigned long long>(max_limit.count())) {
+            cancellation.deadline
+                = now + std::chrono::nanoseconds(static_cast<long long>(state->time_limit_ns));
+        }
+    }
+    if (state->is_cancelled || state->cancel_flag || state->time_limit_ns != 0) {
+        options.cancellation = &cancellation;
+    }
 
 #ifdef ULIGHT_EXCEPTIONS
     try {
 #endif
-        const ulight::Status result
-            = ulight::highlight(buffer, source, ulight::Lang(state->lang), &memory, options);
+        const auto lexing_start = ulight::stats_now(stats);
+        const ulight::Status result = ulight::highlight(
+            highlight_buffer, source, ulight::Lang(state->lang), &memory, options
+        );
         // We've already checked for language validity.
         // bad_lang at this point can only be developer error.
         ULIGHT_ASSERT(result != ulight::Status::bad_lang);
+        if (lenient) {
+            lenient_buffer.flush();
+            // When cancelled, the remaining source is not covered by tokens at all.
+            if (result == ulight::Status::ok && !cancellation.cancelled) {
+                lenient_flush.finish();
+            }
+        }
         buffer.flush();
+        if (stats) {
+            stats->lexing_ns += ulight::nanoseconds_since(lexing_start) - stats_flush.flush_ns;
+        }
+        // Highlighters stop when an allocation fails, and the memory resource remembers that,
+        // so allocation failure is reported correctly without relying on exceptions.
+        if (memory.failed()) {
+            return error(
+                state, ULIGHT_STATUS_BAD_ALLOC,
+                u8"An attempt to allocate memory during highlighting failed."
+            );
+        }
+        if (result == ulight::Status::ok && cancellation.cancelled) {
+            return error(state, ULIGHT_STATUS_CANCELLED, u8"Highlighting was cancelled.");
+        }
         return ulight_status(result);
 #ifdef ULIGHT_EXCEPTIONS
-    } catch (const ulight::utf8::Unicode_Error&) {
-        return error(
-            state, ULIGHT_STATUS_BAD_TEXT, u8"The given source code is not correctly UTF-8-encoded."
-        );
     } catch (const std::bad_alloc&) {
         return error(
             state, ULIGHT_STATUS_BAD_ALLOC,
@@ -428,27 +887,94 @@ ulight_status ulight_source_to_tokens(ulight_state* state) noexcept
 #endif
 }
 
+} // namespace
+
 ULIGHT_EXPORT
-// Suppress false positive: https://github.com/llvm/llvm-project/issues/132605
 // NOLINTNEXTLINE(bugprone-exception-escape)
-ulight_status ulight_source_to_html(ulight_state* state) noexcept
+ulight_status ulight_source_to_tokens(ulight_state* state) noexcept
 {
-    using namespace std::literals;
+    return source_to_tokens(state, Utf8_Check::validate);
+}
 
-    if (state->token_buffer == nullptr && state->token_buffer_length != 0) {
+ULIGHT_EXPORT
+ulight_status ulight_source_to_tokens_utf16(
+    ulight_state* state,
+    const char16_t* source,
+    size_t source_length
+) noexcept
+{
+    if (source == nullptr && source_length != 0) {
         return error(
-            state, ULIGHT_STATUS_BAD_BUFFER,
-            u8"token_buffer is null, but token_buffer_length is nonzero."
+            state, ULIGHT_STATUS_BAD_STATE, u8"source is null, but source_length is nonzero."
         );
     }
-    if (state->text_buffer == nullptr) {
-        return error(state, ULIGHT_STATUS_BAD_BUFFER, u8"text_buffer must not be null.");
+    if (const ulight_status status = check_tokens_state(state); status != ULIGHT_STATUS_OK) {
+        return status;
     }
-    if (state->text_buffer_length == 0) {
-        return error(state, ULIGHT_STATUS_BAD_BUFFER, u8"text_buffer_length must be nonzero.");
+    if (source_length > std::size_t(-1) / ulight::utf16::max_utf8_units_per_unit) {
+        return error(
+            state, ULIGHT_STATUS_BAD_ALLOC, u8"The given source code is too long to be transcoded."
+        );
     }
-    if (state->flush_text == nullptr) {
-        return error(state, ULIGHT_STATUS_BAD_BUFFER, u8"flush_text must not be null.");
+
+    // The highlighters only operate on UTF-8, so the source is transcoded up front,
+    // and token positions are converted back to UTF-16 as the tokens are flushed.
+    const std::size_t capacity
+        = std::max(source_length * ulight::utf16::max_utf8_units_per_unit, std::size_t { 1 });
+    auto* const utf8_source = static_cast<char8_t*>(state_alloc(state, capacity, 1));
+    if (utf8_source == nullptr) {
+        return error(
+            state, ULIGHT_STATUS_BAD_ALLOC,
+            u8"An attempt to allocate memory for transcoding the source code failed."
+        );
+    }
+    const std::expected<std::size_t, std::size_t> utf8_length
+        = ulight::utf16::to_utf8({ source, source_length }, utf8_source);
+    if (!utf8_length) {
+        state_free(state, utf8_source, capacity, 1);
+        return error(
+            state, ULIGHT_STATUS_BAD_TEXT,
+            u8"The given source code is not correctly UTF-16-encoded."
+        );
+    }
+
+    ulight::Utf16_Token_Flush utf16_flush { { utf8_source, *utf8_length },
+                                            state->flush_tokens_data,
+                                            state->flush_tokens };
+    const ulight::Function_Ref<void(ulight_token*, std::size_t)> utf16_flush_ref = utf16_flush;
+
+    // The members that are substituted for the duration of the conversion are restored afterwards,
+    // so that the caller's state is left as it was.
+    const char* const old_source = state->source;
+    const std::size_t old_source_length = state->source_length;
+    state->source = reinterpret_cast<const char*>(utf8_source);
+    state->source_length = *utf8_length;
+    state->flush_tokens_data = utf16_flush_ref.get_entity();
+    state->flush_tokens = utf16_flush_ref.get_invoker();
+
+    // Transcoding has already rejected unpaired surrogates, so the result is valid UTF-8.
+    const ulight_status result = source_to_tokens(state, Utf8_Check::trusted);
+
+    state->source = old_source;
+    state->source_length = old_source_length;
+    state->flush_tokens_data = utf16_flush.flush_data;
+    state->flush_tokens = utf16_flush.flush;
+    state_free(state, utf8_source, capacity, 1);
+    return result;
+}
+
+ULIGHT_EXPORT
+// Suppress false positive: https://github.com/llvm/llvm-project/issues/132605
+// NOLINTNEXTLINE(bugprone-exception-escape)
+ulight_status ulight_source_to_html(ulight_state* state) noexcept
+{
+    using namespace std::literals;
+
+    ulight_stats* const stats = state->stats;
+    const auto validation_start = ulight::stats_now(stats);
+
+    if (const ulight_status status = check_text_state(state); status != ULIGHT_STATUS_OK) {
+        return status;
     }
     if (state->html_tag_name == nullptr) {
         return error(state, ULIGHT_STATUS_BAD_STATE, u8"html_tag_name must not be null.");
@@ -462,13 +988,46 @@ ulight_status ulight_source_to_html(ulight_state* state) noexcept
     if (state->html_attr_name_length == 0) {
         return error(state, ULIGHT_STATUS_BAD_STATE, u8"html_attr_name_length must be nonzero.");
     }
+    if (stats) {
+        stats->validation_ns += ulight::nanoseconds_since(validation_start);
+    }
 
     const std::string_view source_string { state->source, state->source_length };
     const std::string_view html_tag_name { state->html_tag_name, state->html_tag_name_length };
     const std::string_view html_attr_name { state->html_attr_name, state->html_attr_name_length };
 
-    ulight::Non_Owning_Buffer<char> buffer { state->text_buffer, state->text_buffer_length,
-                                             state->flush_text_data, state->flush_text };
+    const ulight::Stats_Text_Flush stats_flush { stats, state->flush_text_data, state->flush_text };
+    const ulight::Function_Ref<void(char*, std::size_t)> stats_flush_ref = stats_flush;
+
+    ulight::Non_Owning_Buffer<char> buffer
+        = stats ? ulight::Non_Owning_Buffer<char> { state->text_buffer, state->text_buffer_length,
+                                                    stats_flush_ref.get_entity(),
+                                                    stats_flush_ref.get_invoker() }
+                : ulight::Non_Owning_Buffer<char> { state->text_buffer, state->text_buffer_length,
+                                                    state->flush_text_data, state->flush_text };
+
+    const ulight_highlight_mask* const emit_mask = state->html_emit_mask;
+    // The tags that the engine precomputed can only be used
+    // if the state still uses the names that the engine was created with.
+    const ulight_engine* const engine = state->engine
+            && state->html_tag_name == state->engine->options.html_tag_name
+            && state->html_tag_name_length == state->engine->options.html_tag_name_length
+            && state->html_attr_name == state->engine->options.html_attr_name
+            && state->html_attr_name_length == state->engine->options.html_attr_name_length
+        ? state->engine
+        : nullptr;
+
+    // In lenient mode, all malformed code units are within error tokens.
+    const bool lenient = (state->flags & ULIGHT_LENIENT_UTF8) != 0;
+    const auto append_escaped = [&](const ulight_token& t) {
+        const std::string_view text = source_string.substr(t.begin, t.length);
+        if (lenient && t.type == ULIGHT_HL_ERROR) {
+            ulight::append_replacing_malformed(buffer, text, ulight::append_html_escaped);
+        }
+        else {
+            ulight::append_html_escaped(buffer, text);
+        }
+    };
 
     std::size_t previous_end = 0;
     auto flush_text = // clang-format off
@@ -477,16 +1036,32 @@ ulight_status ulight_source_to_html(ulight_state* state) noexcept
         check_flush_validity(state, {tokens, amount}); 
         #endif
 
+        const auto html_start = ulight::stats_now(stats);
+        const std::size_t flush_begin = previous_end;
         for (std::size_t i = 0; i < amount; ++i) {
             const auto& t = tokens[i];
             if (t.begin > previous_end) {
                 const std::string_view source_gap { state->source + previous_end, t.begin - previous_end };
                 buffer.append_range(source_gap);
             }
+            // Tokens that are masked out are written as plain text,
+            // so runs of them merge with each other and with the surrounding gaps.
+            if (emit_mask && !((emit_mask->bits[t.type / 8] >> (t.type % 8)) & 1)) {
+                append_escaped(t);
+                previous_end = t.begin + t.length;
+                continue;
+            }
+
+            if (engine) {
+                buffer.append_range(engine->open_tags[t.type]);
+                append_escaped(t);
+                buffer.append_range(engine->close_tag);
+                previous_end = t.begin + t.length;
+                continue;
+            }
 
             const std::string_view id
                 = highlight_type_short_string(ulight::Highlight_Type(t.type));
-            const auto source_part = source_string.substr(t.begin, t.length);
 
             buffer.push_back('<');
             buffer.append_range(html_tag_name);
@@ -495,13 +1070,18 @@ ulight_status ulight_source_to_html(ulight_state* state) noexcept
             buffer.push_back('=');
             buffer.append_range(id);
             buffer.push_back('>');
-            ulight::append_html_escaped(buffer, source_part);
+            append_escaped(t);
             buffer.append_range("</"sv);
             buffer.append_range(html_tag_name);
             buffer.push_back('>');
 
             previous_end = t.begin + t.length;
         }
+        if (stats) {
+            // This includes the gaps between the tokens, not just the tokens themselves.
+            stats->html_text_bytes += previous_end - flush_begin;
+            stats->html_ns += ulight::nanoseconds_since(html_start);
+        }
     };
     ulight::Function_Ref<void( ulight_token*, std::size_t)> flush_text_ref = flush_text;
 
@@ -510,7 +1090,7 @@ ulight_status ulight_source_to_html(ulight_state* state) noexcept
     state->flush_tokens = flush_text_ref.get_invoker();
 
     const ulight_status result = ulight_source_to_tokens(state);
-    if (result != ULIGHT_STATUS_OK) {
+    if (result != ULIGHT_STATUS_OK && result != ULIGHT_STATUS_CANCELLED) {
         return result;
     }
 #ifdef ULIGHT_EXCEPTIONS
@@ -519,11 +1099,212 @@ ulight_status ulight_source_to_html(ulight_state* state) noexcept
         // It is common that the final token doesn't encompass the last code unit in the source.
         // For example, there can be a trailing '\n' at the end of the file, without highlighting.
         ULIGHT_ASSERT(previous_end <= state->source_length);
-        if (previous_end != state->source_length) {
+        const auto html_start = ulight::stats_now(stats);
+        // When cancelled, the remaining source code is left out rather than written unhighlighted.
+        const std::size_t end = result == ULIGHT_STATUS_OK ? state->source_length : previous_end;
+        if (previous_end != end) {
             ulight::append_html_escaped(buffer, source_string.substr(previous_end));
         }
         buffer.flush();
+        if (stats) {
+            stats->html_text_bytes += end - previous_end;
+            stats->html_ns += ulight::nanoseconds_since(html_start);
+        }
+        return result;
+#ifdef ULIGHT_EXCEPTIONS
+    } catch (...) {
+        return error(state, ULIGHT_STATUS_INTERNAL_ERROR, u8"An internal error occurred.");
+    }
+#endif
+}
+
+ULIGHT_EXPORT
+ulight_ansi_theme* ulight_ansi_theme_init(ulight_ansi_theme* theme) noexcept
+{
+    for (std::size_t i = 0; i < 256; ++i) {
+        const std::string_view long_name
+            = ulight::highlight_type_long_string(ulight::Highlight_Type(i));
+        const std::string_view sequence = ulight::default_ansi_sequence(long_name);
+        ULIGHT_ASSERT(sequence.length() <= ULIGHT_ANSI_SEQUENCE_CAPACITY);
+        std::ranges::copy(sequence, theme->sequences[i]);
+        theme->sequence_lengths[i] = static_cast<unsigned char>(sequence.length());
+    }
+    return theme;
+}
+
+ULIGHT_EXPORT
+// NOLINTNEXTLINE(bugprone-exception-escape)
+ulight_status ulight_ansi_theme_load_json(
+    ulight_ansi_theme* theme,
+    const char* json,
+    size_t json_length,
+    const char* variant,
+    size_t variant_length
+) noexcept
+{
+    const std::u8string_view json_string { std::launder(reinterpret_cast<const char8_t*>(json)),
+                                           json_length };
+    const std::u8string_view variant_string {
+        std::launder(reinterpret_cast<const char8_t*>(variant)), variant_length
+    };
+#ifdef ULIGHT_EXCEPTIONS
+    try {
+#endif
+        ulight::Theme loaded;
+        const ulight::Status result = ulight::load_theme(loaded, json_string, variant_string);
+        if (result != ulight::Status::ok) {
+            return ulight_status(result);
+        }
+        for (std::size_t i = 0; i < loaded.styles.size(); ++i) {
+            const std::size_t length
+                = ulight::to_ansi_sequence(theme->sequences[i], loaded.styles[i]);
+            theme->sequence_lengths[i] = static_cast<unsigned char>(length);
+        }
+        return ULIGHT_STATUS_OK;
+#ifdef ULIGHT_EXCEPTIONS
+    } catch (const std::bad_alloc&) {
+        return ULIGHT_STATUS_BAD_ALLOC;
+    } catch (...) {
+        return ULIGHT_STATUS_INTERNAL_ERROR;
+    }
+#endif
+}
+
+ULIGHT_EXPORT
+// NOLINTNEXTLINE(bugprone-exception-escape)
+ulight_status ulight_highlight_mask_add_theme(
+    ulight_highlight_mask* mask,
+    const char* json,
+    size_t json_length,
+    const char* variant,
+    size_t variant_length
+) noexcept
+{
+    const std::u8string_view json_string { std::launder(reinterpret_cast<const char8_t*>(json)),
+                                           json_length };
+    const std::u8string_view variant_string {
+        std::launder(reinterpret_cast<const char8_t*>(variant)), variant_length
+    };
+#ifdef ULIGHT_EXCEPTIONS
+    try {
+#endif
+        ulight::Theme loaded;
+        const ulight::Status result = ulight::load_theme(loaded, json_string, variant_string);
+        if (result != ulight::Status::ok) {
+            return ulight_status(result);
+        }
+        for (std::size_t i = 0; i < loaded.styles.size(); ++i) {
+            if (loaded.is_distinct(ulight::Highlight_Type(i))) {
+                mask->bits[i / 8] |= static_cast<unsigned char>(1u << (i % 8));
+            }
+        }
         return ULIGHT_STATUS_OK;
+#ifdef ULIGHT_EXCEPTIONS
+    } catch (const std::bad_alloc&) {
+        return ULIGHT_STATUS_BAD_ALLOC;
+    } catch (...) {
+        return ULIGHT_STATUS_INTERNAL_ERROR;
+    }
+#endif
+}
+
+ULIGHT_EXPORT
+// NOLINTNEXTLINE(bugprone-exception-escape)
+ulight_status ulight_source_to_ansi(ulight_state* state, const ulight_ansi_theme* theme) noexcept
+{
+    ulight_stats* const stats = state->stats;
+    const auto validation_start = ulight::stats_now(stats);
+
+    if (const ulight_status status = check_text_state(state); status != ULIGHT_STATUS_OK) {
+        return status;
+    }
+    if (theme == nullptr) {
+        return error(state, ULIGHT_STATUS_BAD_STATE, u8"theme must not be null.");
+    }
+    if (stats) {
+        stats->validation_ns += ulight::nanoseconds_since(validation_start);
+    }
+
+    const std::string_view source_string { state->source, state->source_length };
+
+    const ulight::Stats_Text_Flush stats_flush { stats, state->flush_text_data, state->flush_text };
+    const ulight::Function_Ref<void(char*, std::size_t)> stats_flush_ref = stats_flush;
+
+    ulight::Non_Owning_Buffer<char> buffer
+        = stats ? ulight::Non_Owning_Buffer<char> { state->text_buffer, state->text_buffer_length,
+                                                    stats_flush_ref.get_entity(),
+                                                    stats_flush_ref.get_invoker() }
+                : ulight::Non_Owning_Buffer<char> { state->text_buffer, state->text_buffer_length,
+                                                    state->flush_text_data, state->flush_text };
+
+    // In lenient mode, all malformed code units are within error tokens.
+    const bool lenient = (state->flags & ULIGHT_LENIENT_UTF8) != 0;
+    std::size_t previous_end = 0;
+    // The escape sequence that is currently in effect, or empty if none is.
+    std::string_view active_sequence;
+    const auto reset = [&] {
+        if (!active_sequence.empty()) {
+            buffer.append_range(ulight::ansi::reset);
+            active_sequence = {};
+        }
+    };
+
+    auto flush_text = [&](ulight_token* tokens, std::size_t amount) mutable {
+#ifndef NDEBUG
+        check_flush_validity(state, { tokens, amount });
+#endif
+        for (std::size_t i = 0; i < amount; ++i) {
+            const auto& t = tokens[i];
+            if (t.begin > previous_end) {
+                reset();
+                ulight::append_terminal_escaped(
+                    buffer, source_string.substr(previous_end, t.begin - previous_end)
+                );
+            }
+
+            const std::string_view sequence { theme->sequences[t.type],
+                                              theme->sequence_lengths[t.type] };
+            if (sequence.empty()) {
+                reset();
+            }
+            else if (sequence != active_sequence) {
+                // Every sequence begins by resetting all attributes,
+                // so there is no need to reset between two styled tokens.
+                buffer.append_range(sequence);
+                active_sequence = sequence;
+            }
+            const std::string_view text = source_string.substr(t.begin, t.length);
+            if (lenient && t.type == ULIGHT_HL_ERROR) {
+                ulight::append_replacing_malformed(buffer, text, ulight::append_terminal_escaped);
+            }
+            else {
+                ulight::append_terminal_escaped(buffer, text);
+            }
+
+            previous_end = t.begin + t.length;
+        }
+    };
+    ulight::Function_Ref<void(ulight_token*, std::size_t)> flush_text_ref = flush_text;
+
+    state->flush_tokens_data = flush_text_ref.get_entity();
+    state->flush_tokens = flush_text_ref.get_invoker();
+
+    const ulight_status result = ulight_source_to_tokens(state);
+    if (result != ULIGHT_STATUS_OK && result != ULIGHT_STATUS_CANCELLED) {
+        return result;
+    }
+#ifdef ULIGHT_EXCEPTIONS
+    try {
+#endif
+        ULIGHT_ASSERT(previous_end <= state->source_length);
+        // Even when cancelled, the output is completed so that the terminal is left unstyled.
+        reset();
+        // When cancelled, the remaining source code is left out rather than written unhighlighted.
+        if (result == ULIGHT_STATUS_OK && previous_end != state->source_length) {
+            ulight::append_terminal_escaped(buffer, source_string.substr(previous_end));
+        }
+        buffer.flush();
+        return result;
 #ifdef ULIGHT_EXCEPTIONS
     } catch (...) {
         return error(state, ULIGHT_STATUS_INTERNAL_ERROR, u8"An internal error occurred.");
@@ -531,4 +1312,469 @@ ulight_status ulight_source_to_html(ulight_state* state) noexcept
 #endif
 }
 
+namespace {
+
+/// @brief The number of tokens in the token buffer of a session.
+constexpr std::size_t session_token_buffer_length = 1024;
+/// @brief The size of the text buffer of a session, in bytes.
+constexpr std::size_t session_text_buffer_length = 8192;
+/// @brief The size of one token record in `ulight_session_token_records`, in bytes.
+constexpr std::size_t token_record_bytes = ULIGHT_TOKEN_RECORD_SIZE * sizeof(std::uint32_t);
+
+/// @brief A growable byte buffer for sessions which is allocated using `ulight_alloc`
+/// (or the allocator of an engine),
+/// and which reports allocation failure instead of throwing.
+struct Session_Buffer {
+    /// @brief The alignment of `data`,
+    /// which is sufficient for UTF-16 source code and for token records.
+    static constexpr std::size_t alignment = alignof(std::uint32_t);
+
+    void* (*alloc)(std::size_t size, std::size_t alignment) = ulight_alloc;
+    void (*free)(void* pointer, std::size_t size, std::size_t alignment) = ulight_free;
+    char* data = nullptr;
+    std::size_t size = 0;
+    std::size_t capacity = 0;
+
+    /// @brief Ensures that the buffer has room for at least `required` bytes,
+    /// preserving the first `size` bytes.
+    /// The capacity grows geometrically, so repeated appending takes amortized linear time.
+    /// @returns `true` on success, `false` if allocation failed.
+    [[nodiscard]]
+    bool reserve(std::size_t required) noexcept
+    {
+        if (required <= capacity) {
+            return true;
+        }
+        const std::size_t new_capacity = std::max({ required, capacity * 2, std::size_t { 4096 } });
+        auto* const new_data = static_cast<char*>(alloc(new_capacity, alignment));
+        if (new_data == nullptr) {
+            return false;
+        }
+        std::ranges::copy(data, data + size, new_data);
+        release();
+        data = new_data;
+        capacity = new_capacity;
+        return true;
+    }
+
+    void release() noexcept
+    {
+        if (data != nullptr) {
+            free(data, capacity, alignment);
+        }
+        data = nullptr;
+        capacity = 0;
+    }
+};
+
+} // namespace
+
+struct ulight_session {
+    ulight_state state;
+    /// @brief The engine which allocated the session, or null.
+    const ulight_engine* engine;
+    Session_Buffer source;
+    Session_Buffer output;
+    /// @brief The token records produced by `ulight_session_tokens`.
+    Session_Buffer tokens;
+    /// @brief `true` if appending to `output` or `tokens` failed during the current conversion.
+    bool output_failed;
+    ulight_token token_buffer[session_token_buffer_length];
+    char text_buffer[session_text_buffer_length];
+};
+
+ULIGHT_EXPORT
+ulight_session* ulight_session_new() noexcept
+{
+    void* const memory = ulight_alloc(sizeof(ulight_session), alignof(ulight_session));
+    if (memory == nullptr) {
+        return nullptr;
+    }
+    auto* const session = new (memory) ulight_session {};
+    ulight_init(&session->state);
+    return session;
+}
+
+ULIGHT_EXPORT
+void ulight_session_delete(ulight_session* session) noexcept
+{
+    if (session == nullptr) {
+        return;
+    }
+    session->source.release();
+    session->output.release();
+    session->tokens.release();
+    const ulight_engine* const engine = session->engine;
+    session->~ulight_session();
+    if (engine) {
+        engine->options.free(session, sizeof(ulight_session), alignof(ulight_session));
+    }
+    else {
+        ulight_free(session, sizeof(ulight_session), alignof(ulight_session));
+    }
+}
+
+ULIGHT_EXPORT
+ulight_state* ulight_session_state(ulight_session* session) noexcept
+{
+    return &session->state;
+}
+
+ULIGHT_EXPORT
+char* ulight_session_reserve_source(ulight_session* session, size_t length) noexcept
+{
+    // Reserving at least one byte ensures that the result is only null on failure.
+    if (!session->source.reserve(std::max(length, std::size_t { 1 }))) {
+        return nullptr;
+    }
+    return session->source.data;
+}
+
+ULIGHT_EXPORT
+ulight_status ulight_session_highlight(
+    ulight_session* session,
+    const char* source,
+    size_t source_length,
+    ulight_lang lang,
+    ulight_flag flags
+) noexcept
+{
+    constexpr auto flush_text = [](const void* data, char* text, std::size_t length) noexcept {
+        // The session is passed as flush_text_data below, so it is not actually const.
+        auto* const self = static_cast<ulight_session*>(const_cast<void*>(data));
+        Session_Buffer& output = self->output;
+        if (self->output_failed || !output.reserve(output.size + length)) {
+            self->output_failed = true;
+            return;
+        }
+        std::ranges::copy(text, text + length, output.data + output.size);
+        output.size += length;
+    };
+
+    ulight_state& state = session->state;
+    state.source = source;
+    state.source_length = source_length;
+    state.lang = lang;
+    state.flags = flags;
+    state.token_buffer = session->token_buffer;
+    state.token_buffer_length = session_token_buffer_length;
+    state.text_buffer = session->text_buffer;
+    state.text_buffer_length = session_text_buffer_length;
+    state.flush_text_data = session;
+    state.flush_text = flush_text;
+
+    session->output.size = 0;
+    session->output_failed = false;
+
+    const ulight_status result = ulight_source_to_html(&state);
+    if ((result == ULIGHT_STATUS_OK || result == ULIGHT_STATUS_CANCELLED)
+        && session->output_failed) {
+        session->output.size = 0;
+        return error(
+            &state, ULIGHT_STATUS_BAD_ALLOC,
+            u8"An attempt to allocate memory for the output failed."
+        );
+    }
+    return result;
+}
+
+namespace {
+
+/// @brief Prepares `session` for `ulight_session_tokens` and `ulight_session_tokens_utf16`,
+/// where each flushed token is appended to `session->tokens` as a record.
+void prepare_session_tokens(ulight_session* session, ulight_lang lang, ulight_flag flags) noexcept
+{
+    constexpr auto flush_tokens
+        = [](const void* data, ulight_token* tokens, std::size_t amount) noexcept {
+            // The session is passed as flush_tokens_data below, so it is not actually const.
+            auto* const self = static_cast<ulight_session*>(const_cast<void*>(data));
+            Session_Buffer& records = self->tokens;
+            const std::size_t required = records.size + (amount * token_record_bytes);
+            if (self->output_failed || !records.reserve(required)) {
+                self->output_failed = true;
+                return;
+            }
+            auto* const out = reinterpret_cast<std::uint32_t*>(records.data + records.size);
+            // Token positions fit into 32 bits because the source length was checked beforehand.
+            for (std::size_t i = 0; i < amount; ++i) {
+                out[(i * ULIGHT_TOKEN_RECORD_SIZE) + 0] = std::uint32_t(tokens[i].begin);
+                out[(i * ULIGHT_TOKEN_RECORD_SIZE) + 1] = std::uint32_t(tokens[i].length);
+                out[(i * ULIGHT_TOKEN_RECORD_SIZE) + 2] = std::uint32_t(tokens[i].type);
+            }
+            records.size += amount * token_record_bytes;
+        };
+
+    ulight_state& state = session->state;
+    state.lang = lang;
+    state.flags = flags;
+    state.token_buffer = session->token_buffer;
+    state.token_buffer_length = session_token_buffer_length;
+    state.flush_tokens_data = session;
+    state.flush_tokens = flush_tokens;
+
+    session->tokens.size = 0;
+    session->output_failed = false;
+}
+
+/// @brief Completes `ulight_session_tokens` and `ulight_session_tokens_utf16`,
+/// given the `result` of converting the source code.
+[[nodiscard]]
+ulight_status finish_session_tokens(ulight_session* session, ulight_status result) noexcept
+{
+    const bool succeeded = result == ULIGHT_STATUS_OK || result == ULIGHT_STATUS_CANCELLED;
+    if (!succeeded || session->output_failed) {
+        session->tokens.size = 0;
+    }
+    if (succeeded && session->output_failed) {
+        return error(
+            &session->state, ULIGHT_STATUS_BAD_ALLOC,
+            u8"An attempt to allocate memory for the tokens failed."
+        );
+    }
+    return result;
+}
+
+[[nodiscard]]
+bool fits_in_token_record(std::size_t source_length) noexcept
+{
+    return source_length <= std::numeric_limits<std::uint32_t>::max();
+}
+
+} // namespace
+
+ULIGHT_EXPORT
+ulight_status ulight_session_tokens(
+    ulight_session* session,
+    const char* source,
+    size_t source_length,
+    ulight_lang lang,
+    ulight_flag flags
+) noexcept
+{
+    if (!fits_in_token_record(source_length)) {
+        return error(
+            &session->state, ULIGHT_STATUS_BAD_STATE,
+            u8"The given source code is too long for 32-bit token records."
+        );
+    }
+    prepare_session_tokens(session, lang, flags);
+    session->state.source = source;
+    session->state.source_length = source_length;
+    return finish_session_tokens(session, ulight_source_to_tokens(&session->state));
+}
+
+ULIGHT_EXPORT
+ulight_status ulight_session_tokens_utf16(
+    ulight_session* session,
+    const char16_t* source,
+    size_t source_length,
+    ulight_lang lang,
+    ulight_flag flags
+) noexcept
+{
+    if (!fits_in_token_record(source_length)) {
+        return error(
+            &session->state, ULIGHT_STATUS_BAD_STATE,
+            u8"The given source code is too long for 32-bit token records."
+        );
+    }
+    prepare_session_tokens(session, lang, flags);
+    return finish_session_tokens(
+        session, ulight_source_to_tokens_utf16(&session->state, source, source_length)
+    );
+}
+
+ULIGHT_EXPORT
+const uint32_t* ulight_session_token_records(const ulight_session* session) noexcept
+{
+    return reinterpret_cast<const std::uint32_t*>(session->tokens.data);
+}
+
+ULIGHT_EXPORT
+size_t ulight_session_token_count(const ulight_session* session) noexcept
+{
+    return session->tokens.size / token_record_bytes;
+}
+
+ULIGHT_EXPORT
+const char* ulight_session_output(const ulight_session* session) noexcept
+{
+    return session->output.data;
+}
+
+ULIGHT_EXPORT
+size_t ulight_session_output_length(const ulight_session* session) noexcept
+{
+    return session->output.size;
+}
+
+ULIGHT_EXPORT
+ulight_engine_options* ulight_engine_options_init(ulight_engine_options* options) noexcept
+{
+    constexpr std::string_view default_tag_name = "h-";
+    constexpr std::string_view default_attr_name = "data-h";
+
+    options->html_tag_name = default_tag_name.data();
+    options->html_tag_name_length = default_tag_name.length();
+    options->html_attr_name = default_attr_name.data();
+    options->html_attr_name_length = default_attr_name.length();
+    options->html_emit_mask = nullptr;
+    options->alloc = ulight_alloc;
+    options->free = ulight_free;
+
+    return options;
+}
+
+namespace {
+
+/// @brief Appends strings to `data`,
+/// or only computes their total `size` if `data` is null.
+/// This allows measuring the storage required by an engine in a first pass,
+/// and filling it in a second pass.
+struct Engine_Tag_Writer {
+    char* data;
+    std::size_t size = 0;
+
+    std::string_view append(std::string_view str) noexcept
+    {
+        const std::size_t begin = size;
+        if (data) {
+            std::ranges::copy(str, data + size);
+        }
+        size += str.length();
+        return data ? std::string_view { data + begin, str.length() } : std::string_view {};
+    }
+};
+
+/// @brief Writes the names and tags of `engine` using `writer`.
+/// If `writer.data` is not null, the members of `engine` are updated to refer to the written
+/// strings.
+void write_engine_strings(
+    ulight_engine& engine,
+    const ulight_engine_options& options,
+    Engine_Tag_Writer& writer
+) noexcept
+{
+    using namespace std::literals;
+
+    const std::string_view tag_name { options.html_tag_name, options.html_tag_name_length };
+    const std::string_view attr_name { options.html_attr_name, options.html_attr_name_length };
+
+    const std::string_view tag_name_copy = writer.append(tag_name);
+    const std::string_view attr_name_copy = writer.append(attr_name);
+
+    for (std::size_t i = 0; i < std::size(engine.open_tags); ++i) {
+        const std::string_view id = ulight::highlight_type_short_string(ulight::Highlight_Type(i));
+        const std::size_t begin = writer.size;
+        writer.append("<"sv);
+        writer.append(tag_name);
+        writer.append(" "sv);
+        writer.append(attr_name);
+        writer.append("="sv);
+        writer.append(id);
+        writer.append(">"sv);
+        if (writer.data) {
+            engine.open_tags[i] = { writer.data + begin, writer.size - begin };
+        }
+    }
+
+    const std::size_t close_begin = writer.size;
+    writer.append("</"sv);
+    writer.append(tag_name);
+    writer.append(">"sv);
+
+    if (writer.data) {
+        engine.close_tag = { writer.data + close_begin, writer.size - close_begin };
+        engine.options.html_tag_name = tag_name_copy.data();
+        engine.options.html_attr_name = attr_name_copy.data();
+    }
+}
+
+} // namespace
+
+ULIGHT_EXPORT
+ulight_engine* ulight_engine_new(const ulight_engine_options* options) noexcept
+{
+    ulight_engine_options default_options;
+    if (options == nullptr) {
+        options = ulight_engine_options_init(&default_options);
+    }
+    if (options->html_tag_name == nullptr || options->html_tag_name_length == 0
+        || options->html_attr_name == nullptr || options->html_attr_name_length == 0
+        || options->alloc == nullptr || options->free == nullptr) {
+        return nullptr;
+    }
+
+    void* const memory = options->alloc(sizeof(ulight_engine), alignof(ulight_engine));
+    if (memory == nullptr) {
+        return nullptr;
+    }
+    auto* const engine = new (memory) ulight_engine {};
+    engine->options = *options;
+
+    Engine_Tag_Writer measure { nullptr };
+    write_engine_strings(*engine, *options, measure);
+
+    engine->strings = static_cast<char*>(options->alloc(measure.size, 1));
+    if (engine->strings == nullptr) {
+        engine->~ulight_engine();
+        options->free(memory, sizeof(ulight_engine), alignof(ulight_engine));
+        return nullptr;
+    }
+    engine->strings_size = measure.size;
+
+    Engine_Tag_Writer writer { engine->strings };
+    write_engine_strings(*engine, *options, writer);
+    ULIGHT_ASSERT(writer.size == measure.size);
+
+    if (options->html_emit_mask) {
+        engine->emit_mask = *options->html_emit_mask;
+        engine->options.html_emit_mask = &engine->emit_mask;
+    }
+    return engine;
+}
+
+ULIGHT_EXPORT
+void ulight_engine_delete(ulight_engine* engine) noexcept
+{
+    if (engine == nullptr) {
+        return;
+    }
+    const ulight_engine_options options = engine->options;
+    options.free(engine->strings, engine->strings_size, 1);
+    engine->~ulight_engine();
+    options.free(engine, sizeof(ulight_engine), alignof(ulight_engine));
+}
+
+ULIGHT_EXPORT
+ulight_state* ulight_engine_init_state(const ulight_engine* engine, ulight_state* state) noexcept
+{
+    ulight_init(state);
+    state->html_tag_name = engine->options.html_tag_name;
+    state->html_tag_name_length = engine->options.html_tag_name_length;
+    state->html_attr_name = engine->options.html_attr_name;
+    state->html_attr_name_length = engine->options.html_attr_name_length;
+    state->html_emit_mask = engine->options.html_emit_mask;
+    state->engine = engine;
+    return state;
+}
+
+ULIGHT_EXPORT
+ulight_session* ulight_engine_session_new(const ulight_engine* engine) noexcept
+{
+    void* const memory
+        = engine->options.alloc(sizeof(ulight_session), alignof(ulight_session));
+    if (memory == nullptr) {
+        return nullptr;
+    }
+    auto* const session = new (memory) ulight_session {};
+    ulight_engine_init_state(engine, &session->state);
+    session->engine = engine;
+    for (Session_Buffer* const buffer : { &session->source, &session->output, &session->tokens }) {
+        buffer->alloc = engine->options.alloc;
+        buffer->free = engine->options.free;
+    }
+    return session;
+}
+
 } // extern "C"
@@ -0,0 +1,3 @@
+(module
+  (func (export "f") (import "m" "f") (param i32) (result i32))
+)
@@ -0,0 +1,196 @@
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ulight/ulight.hpp"
+
+#include "ulight/impl/ansi.hpp"
+#include "ulight/impl/io.hpp"
+#include "ulight/impl/strings.hpp"
+#include "ulight/impl/theme.hpp"
+
+namespace ulight {
+namespace {
+
+namespace fs = std::filesystem;
+using namespace std::literals;
+
+TEST(ANSI, parse_css_color)
+{
+    EXPECT_EQ(parse_css_color(u8"#abc"), (RGB { 0xaa, 0xbb, 0xcc }));
+    EXPECT_EQ(parse_css_color(u8"#abcd"), (RGB { 0xaa, 0xbb, 0xcc }));
+    EXPECT_EQ(parse_css_color(u8"#0a1B2c"), (RGB { 0x0a, 0x1b, 0x2c }));
+    EXPECT_EQ(parse_css_color(u8"#0a1b2c80"), (RGB { 0x0a, 0x1b, 0x2c }));
+    EXPECT_EQ(parse_css_color(u8"green"), (RGB { 0x00, 0x80, 0x00 }));
+
+    EXPECT_EQ(parse_css_color(u8""), std::nullopt);
+    EXPECT_EQ(parse_css_color(u8"#"), std::nullopt);
+    EXPECT_EQ(parse_css_color(u8"#abcde"), std::nullopt);
+    EXPECT_EQ(parse_css_color(u8"#abcdeg"), std::nullopt);
+    EXPECT_EQ(parse_css_color(u8"d4d4d4"), std::nullopt);
+}
+
+TEST(ANSI, load_theme_inherits_from_less_specific_types)
+{
+    static constexpr std::u8string_view theme = u8R"({
+    "meta": { "name": "test" },
+    "light": { "id": "#ffffff" },
+    "dark": {
+        "background": "#000000",
+        "id": { "color": "#010203", "font-style": "italic" },
+        "id-function": "#040506",
+        "id-function-decl": { "font-style": "normal", "text-decoration": "underline" },
+        "comment": { "font-weight": "bold" },
+        "not-a-highlight-type": "#ffffff"
+    }
+})";
+
+    Theme loaded;
+    ASSERT_EQ(load_theme(loaded, theme, u8"dark"), Status::ok);
+    EXPECT_EQ(loaded.background, (RGB { 0, 0, 0 }));
+    EXPECT_EQ(loaded.foreground, std::nullopt);
+
+    const auto style_of = [&](Highlight_Type type) -> const Theme_Style& {
+        return loaded.styles[std::size_t(type)];
+    };
+
+    const Theme_Style id { .color = RGB { 1, 2, 3 }, .italic = true };
+    EXPECT_EQ(style_of(Highlight_Type::id), id);
+    EXPECT_EQ(style_of(Highlight_Type::id_var), id);
+
+    const Theme_Style id_function { .color = RGB { 4, 5, 6 }, .italic = true };
+    EXPECT_EQ(style_of(Highlight_Type::id_function), id_function);
+
+    const Theme_Style id_function_decl {
+        .color = RGB { 4, 5, 6 },
+        .italic = false,
+        .underline = true,
+        .strikethrough = false,
+    };
+    EXPECT_EQ(style_of(Highlight_Type::id_function_decl), id_function_decl);
+
+    EXPECT_EQ(style_of(Highlight_Type::comment_delim), Theme_Style { .bold = true });
+    EXPECT_EQ(style_of(Highlight_Type::keyword), Theme_Style {});
+}
+
+TEST(ANSI, load_theme_errors)
+{
+    Theme loaded;
+    EXPECT_EQ(load_theme(loaded, u8R"({ "dark": { "id": "#fff" )", u8"dark"), Status::bad_text);
+    EXPECT_EQ(
+        load_theme(loaded, u8R"({ "dark": { "id": "#fff" } })", u8"light"), Status::bad_state
+    );
+}
+
+TEST(ANSI, to_ansi_sequence)
+{
+    char buffer[ULIGHT_ANSI_SEQUENCE_CAPACITY];
+
+    EXPECT_EQ(to_ansi_sequence(buffer, Theme_Style {}), 0);
+    EXPECT_EQ(to_ansi_sequence(buffer, Theme_Style { .bold = false }), 0);
+
+    const Theme_Style everything {
+        .color = RGB { 255, 255, 255 },
+        .background_color = RGB { 255, 255, 255 },
+        .bold = true,
+        .italic = true,
+        .underline = true,
+        .strikethrough = true,
+    };
+    const std::size_t length = to_ansi_sequence(buffer, everything);
+    EXPECT_EQ(
+        std::string_view(buffer, length), "\x1B[0;1;3;4;9;38;2;255;255;255;48;2;255;255;255m"sv
+    );
+}
+
+TEST(ANSI, bundled_themes_load)
+{
+    for (const auto& entry : fs::directory_iterator { "themes" }) {
+        std::vector<char8_t> json;
+        ASSERT_TRUE(load_utf8_file_or_error(json, entry.path().c_str()));
+        const std::u8string_view json_string { json.data(), json.size() };
+
+        std::size_t loaded_variants = 0;
+        for (const std::string_view variant : { "light"sv, "dark"sv }) {
+            ANSI_Theme theme;
+            const Status status = theme.load_json(as_string_view(json_string), variant);
+            EXPECT_TRUE(status == Status::ok || status == Status::bad_state)
+                << entry.path() << ' ' << variant;
+            loaded_variants += status == Status::ok;
+        }
+        EXPECT_NE(loaded_variants, 0) << entry.path();
+    }
+}
+
+TEST(ANSI, source_to_ansi)
+{
+    static constexpr std::u8string_view source = u8"x // \x1B[31m\n";
+
+    ANSI_Theme theme;
+    ASSERT_EQ(theme.load_json(u8R"({ "dark": { "comment": "#ff0000" } })", u8"dark"), Status::ok);
+
+    // Both comment-delim and comment inherit the same style, so they share a sequence.
+    // The escape character within the comment is replaced with U+241B.
+    const std::string expected
+        = "x \x1B[0;38;2;255;0;0m// \xE2\x90\x9B[31m"s + std::string(ansi::reset) + "\n";
+
+    std::string actual;
+    const auto append = [&](char* text, std::size_t length) { actual.append(text, length); };
+
+    Token token_buffer[1];
+    char text_buffer[4];
+
+    State state;
+    state.set_source(source);
+    state.set_lang(Lang::cpp);
+    state.set_token_buffer(token_buffer);
+    state.set_text_buffer(text_buffer);
+    state.on_flush_text(append);
+    ASSERT_EQ(state.source_to_ansi(theme), Status::ok);
+
+    EXPECT_EQ(actual, expected);
+}
+
+TEST(ANSI, source_to_ansi_control_characters)
+{
+    // BEL, BS, DEL, U+009B CONTROL SEQUENCE INTRODUCER, a lone 0x9B code unit,
+    // and U+00DB, whose encoding contains 0x9B as well.
+    static constexpr std::u8string_view source = u8"\t\x07\x08\x7F\u009B\x9B\u00DB\r\n";
+    const std::string expected = "\t\xE2\x90\x87\xE2\x90\x88\xE2\x90\xA1"
+                                 "\xEF\xBF\xBD\xEF\xBF\xBD\xC3\x9B\r\n";
+
+    std::string actual;
+    const auto append = [&](char* text, std::size_t length) { actual.append(text, length); };
+
+    Token token_buffer[1];
+    char text_buffer[4];
+
+    State state;
+    state.set_source(source);
+    state.set_lang(Lang::txt);
+    // The lone 0x9B code unit would otherwise be rejected before it is escaped.
+    state.set_flags(Flag::skip_utf8_validation);
+    state.set_token_buffer(token_buffer);
+    state.set_text_buffer(text_buffer);
+    state.on_flush_text(append);
+    ASSERT_EQ(state.source_to_ansi(ANSI_Theme {}), Status::ok);
+
+    EXPECT_EQ(actual, expected);
+}
+
+TEST(ANSI, default_theme)
+{
+    const ANSI_Theme theme;
+    EXPECT_EQ(theme.get_sequence(Highlight_Type::comment), ansi::h_black);
+    EXPECT_EQ(theme.get_sequence(Highlight_Type::comment_delim), ansi::h_black);
+    EXPECT_EQ(theme.get_sequence(Highlight_Type::string_delim), ansi::green);
+    EXPECT_EQ(theme.get_sequence(Highlight_Type::id_function_decl), ansi::yellow);
+    EXPECT_EQ(theme.get_sequence(Highlight_Type::id), ""sv);
+}
+
+} // namespace
+} // namespace ulight
@@ -1,11 +1,16 @@
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <span>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -14,6 +19,7 @@
 #include "ulight/impl/io.hpp"
 #include "ulight/impl/string_diff.hpp"
 #include "ulight/impl/strings.hpp"
+#include "ulight/impl/unicode.hpp"
 #include "ulight/ulight.hpp"
 
 namespace ulight {
@@ -70,6 +76,73 @@ std::vector<fs::path> paths_in_directory(const fs::path& directory)
     return result;
 }
 
+/// @brief A `State` whose HTML or ANSI output is appended to `text`.
+/// The buffers are small, so that the output spans many flushes.
+struct Text_State {
+    Token token_buffer[4];
+    char text_buffer[16];
+    std::string text;
+    State state;
+
+    [[nodiscard]]
+    Text_State(std::u8string_view source, Lang lang, Flag flags = Flag::no_flags)
+    {
+        init(source, lang, flags);
+    }
+
+    [[nodiscard]]
+    Text_State(const Engine& engine, std::u8string_view source, Lang lang)
+        : state { engine }
+    {
+        init(source, lang, Flag::no_flags);
+    }
+
+    Text_State(const Text_State&) = delete;
+    Text_State& operator=(const Text_State&) = delete;
+
+    /// @brief Replaces `text` with the HTML output.
+    [[nodiscard]]
+    Status to_html()
+    {
+        text.clear();
+        return state.source_to_html();
+    }
+
+    /// @brief Replaces `text` with the ANSI output.
+    [[nodiscard]]
+    Status to_ansi(const ANSI_Theme& theme = {})
+    {
+        text.clear();
+        return state.source_to_ansi(theme);
+    }
+
+    void operator()(char* data, std::size_t length)
+    {
+        text.append(data, length);
+    }
+
+private:
+    void init(std::u8string_view source, Lang lang, Flag flags)
+    {
+        state.set_source(source);
+        state.set_lang(lang);
+        state.set_flags(flags);
+        state.set_token_buffer(token_buffer);
+        state.set_text_buffer(text_buffer);
+        state.on_flush_text(*this);
+    }
+};
+
+/// @brief Returns the HTML output for `source`, expecting highlighting to succeed.
+[[nodiscard]]
+std::string to_html(std::u8string_view source, Lang lang, const Highlight_Mask* mask = nullptr)
+{
+    Text_State html { source, lang };
+    html.state.set_html_emit_mask(mask);
+    EXPECT_EQ(html.to_html(), Status::ok);
+    return std::move(html.text);
+}
+
 TEST_F(Highlight_Test, file_tests)
 {
     Token token_buffer[4096];
@@ -151,6 +224,620 @@ TEST_F(Highlight_Test, file_tests)
     }
 }
 
+TEST_F(Highlight_Test, stats)
+{
+    static constexpr std::u8string_view source
+        = u8"<style>b { color: red; }</style>\n<script>let x = 1 < 2;</script>\n";
+
+    std::size_t flushed_tokens = 0;
+
+    Text_State html { source, Lang::html };
+    State& state = html.state;
+    ASSERT_EQ(html.to_html(), Status::ok);
+
+    Stats stats {};
+    state.set_stats(&stats);
+    ASSERT_EQ(html.to_html(), Status::ok);
+
+    std::size_t total_tokens = 0;
+    for (const std::size_t count : stats.tokens) {
+        total_tokens += count;
+    }
+    EXPECT_NE(total_tokens, 0);
+    EXPECT_NE(stats.tokens[ULIGHT_HL_MARKUP_TAG], 0);
+    EXPECT_NE(stats.tokens[ULIGHT_HL_KEYWORD], 0);
+    EXPECT_NE(stats.flush_tokens_calls, 0);
+    EXPECT_NE(stats.flush_text_calls, 0);
+    EXPECT_EQ(stats.html_text_bytes, source.length());
+    EXPECT_EQ(stats.nested_invocations, 2);
+    EXPECT_EQ(stats.max_nesting_depth, 1);
+
+    auto count_tokens = [&](Token*, std::size_t amount) { flushed_tokens += amount; };
+    state.on_flush_tokens(count_tokens);
+    const Stats html_stats = stats;
+    ASSERT_EQ(state.source_to_tokens(), Status::ok);
+    EXPECT_EQ(flushed_tokens, total_tokens);
+    EXPECT_EQ(stats.tokens[ULIGHT_HL_MARKUP_TAG], 2 * html_stats.tokens[ULIGHT_HL_MARKUP_TAG]);
+    EXPECT_EQ(stats.flush_text_calls, html_stats.flush_text_calls);
+
+    // Text between tokens, such as the content of HTML elements, is counted too.
+    static constexpr std::u8string_view text_source = u8"<b>x < y &amp; z</b>\n";
+    state.set_source(text_source);
+    state.on_flush_text(html);
+    stats = {};
+    ASSERT_EQ(html.to_html(), Status::ok);
+    EXPECT_EQ(stats.html_text_bytes, text_source.length());
+    EXPECT_TRUE(
+        html.text.contains("x <h- data-h=sym_punc>&lt;</h-> y <h- data-h=esc>&amp;amp;</h-> z")
+    );
+}
+
+TEST_F(Highlight_Test, html_emit_mask)
+{
+    static constexpr std::u8string_view source = u8"int x = 1 < 2;";
+
+    const std::string unmasked = to_html(source, Lang::cpp);
+
+    const Highlight_Mask all = Highlight_Mask::all();
+    EXPECT_EQ(to_html(source, Lang::cpp, &all), unmasked);
+
+    Highlight_Mask numbers;
+    numbers.insert(Highlight_Type::number);
+    EXPECT_EQ(
+        to_html(source, Lang::cpp, &numbers),
+        "int x = <h- data-h=num>1</h-> &lt; <h- data-h=num>2</h->;"
+    );
+
+    const Highlight_Mask none;
+    EXPECT_EQ(to_html(source, Lang::cpp, &none), "int x = 1 &lt; 2;");
+}
+
+TEST_F(Highlight_Test, diff_words)
+{
+    static constexpr std::u8string_view source = u8"@@ -1 +1 @@\n"
+                                                 u8"-int x = 1;\n"
+                                                 u8"+int y = 1;\n"
+                                                 u8" same\n";
+
+    const std::string lines = to_html(source, Lang::diff);
+
+    Text_State html { source, Lang::diff, Flag::diff_words };
+    ASSERT_EQ(html.to_html(), Status::ok);
+    EXPECT_NE(html.text, lines);
+    EXPECT_NE(html.text.find(">x</h->"), std::string::npos);
+    EXPECT_NE(html.text.find(">y</h->"), std::string::npos);
+    EXPECT_NE(html.text.find(">int </h->"), std::string::npos);
+    EXPECT_NE(html.text.find("> = 1;</h->"), std::string::npos);
+
+    // Lines without a counterpart are highlighted as a whole.
+    static constexpr std::u8string_view unpaired = u8"-int x = 1;\n"
+                                                   u8" same\n";
+    html.state.set_source(unpaired);
+    ASSERT_EQ(html.to_html(), Status::ok);
+    const std::string marked_unpaired = std::move(html.text);
+    html.state.set_flags(Flag::coalesce);
+    ASSERT_EQ(html.to_html(), Status::ok);
+    EXPECT_EQ(html.text, marked_unpaired);
+}
+
+TEST_F(Highlight_Test, diff_lang)
+{
+    // The block comment only spans the old version of the hunk,
+    // and "--- x" is a deleted line, not a header.
+    static constexpr std::u8string_view source = u8"--- a/main.c\n"
+                                                 u8"+++ b/main.c\n"
+                                                 u8"@@ -1,3 +1,2 @@\n"
+                                                 u8"-/* old\n"
+                                                 u8"--- x */ int x;\n"
+                                                 u8"+int y;\n"
+                                                 u8" return 0;\n"
+                                                 u8"not part of the hunk\n";
+
+    Text_State html { source, Lang::diff, Flag::diff_lang };
+    ASSERT_EQ(html.to_html(), Status::ok);
+    const auto contains = [&](std::string_view part) { return html.text.contains(part); };
+    EXPECT_TRUE(contains("<h- data-h=diff_del>-</h-><h- data-h=cmt>-- x </h->"));
+    EXPECT_TRUE(contains("<h- data-h=diff_ins>+</h-><h- data-h=kw_type>int</h->"));
+    EXPECT_TRUE(contains("<h- data-h=diff_eq> </h-><h- data-h=kw_ctrl>return</h->"));
+    EXPECT_TRUE(contains("<h- data-h=diff_eq>not part of the hunk</h->"));
+
+    // Without a known language, hunks are highlighted line by line.
+    static constexpr std::u8string_view unknown = u8"--- a/notes\n"
+                                                  u8"+++ b/notes\n"
+                                                  u8"@@ -1 +1 @@\n"
+                                                  u8"-int x;\n"
+                                                  u8"+int y;\n";
+    html.state.set_source(unknown);
+    ASSERT_EQ(html.to_html(), Status::ok);
+    const std::string unknown_lang = std::move(html.text);
+    html.state.set_flags(Flag::coalesce);
+    ASSERT_EQ(html.to_html(), Status::ok);
+    EXPECT_EQ(html.text, unknown_lang);
+}
+
+bool fail_allocations = false;
+
+void* failing_alloc(std::size_t size, std::size_t alignment) noexcept
+{
+    return fail_allocations ? nullptr : ulight_alloc(size, alignment);
+}
+
+TEST_F(Highlight_Test, error_status)
+{
+    Text_State html { u8"int x = \"\xff\";", Lang::cpp };
+    EXPECT_EQ(html.to_html(), Status::bad_text);
+    EXPECT_TRUE(html.text.empty());
+
+    // Without validation, malformed text is highlighted and passed through.
+    html.state.set_flags(Flag::skip_utf8_validation);
+    ASSERT_EQ(html.to_html(), Status::ok);
+    EXPECT_TRUE(html.text.contains("\xff"));
+
+    // Allocation failure within a highlighter is reported as such,
+    // rather than throwing or terminating.
+    ulight_engine_options options;
+    ulight_engine_options_init(&options);
+    options.alloc = failing_alloc;
+    const Engine engine { options };
+    ASSERT_TRUE(engine);
+    Text_State engine_html { engine, u8"-int x = 1;\n+int y = 1;\n", Lang::diff };
+    engine_html.state.set_flags(Flag::diff_words);
+    ASSERT_EQ(engine_html.to_html(), Status::ok);
+
+    fail_allocations = true;
+    EXPECT_EQ(engine_html.to_html(), Status::bad_alloc);
+    fail_allocations = false;
+}
+
+TEST_F(Highlight_Test, lenient_utf8)
+{
+    // A malformed code unit in a string, a truncated sequence in a comment,
+    // and a lone leading code unit at the end.
+    static constexpr std::u8string_view source = u8"int x = \"a\xff\"; // \xe2\x82\n\xc3";
+    constexpr std::string_view replacement = "\xEF\xBF\xBD";
+
+    std::vector<Token> tokens;
+    const auto append_tokens
+        = [&](Token* t, std::size_t amount) { tokens.insert(tokens.end(), t, t + amount); };
+
+    Text_State output { source, Lang::cpp, Flag::lenient_utf8 };
+    output.state.on_flush_tokens(append_tokens);
+    ASSERT_EQ(output.state.source_to_tokens(), Status::ok);
+
+    // Every malformed code unit is covered by an error token.
+    for (std::size_t i = 0; i < source.length(); ++i) {
+        if (utf8::decode_and_length(source.substr(i))) {
+            continue;
+        }
+        const auto covering = std::ranges::find_if(tokens, [&](const Token& t) {
+            return t.begin <= i && i < t.begin + t.length;
+        });
+        ASSERT_NE(covering, tokens.end()) << "at " << i;
+        EXPECT_EQ(Highlight_Type(covering->type), Highlight_Type::error) << "at " << i;
+    }
+    // The rest of the string is still highlighted as a string.
+    EXPECT_TRUE(std::ranges::any_of(tokens, [](const Token& t) {
+        return t.begin == 9 && t.length == 1 && Highlight_Type(t.type) == Highlight_Type::string;
+    }));
+
+    // Every malformed code unit is replaced, so the output is correctly encoded.
+    const std::string& text = output.text;
+    const auto is_valid_text = [&] {
+        return bool(utf8::is_valid({ reinterpret_cast<const char8_t*>(text.data()), text.size() }));
+    };
+    const auto count_replacements = [&] {
+        std::size_t count = 0;
+        for (std::size_t pos = text.find(replacement); pos != std::string::npos;
+             pos = text.find(replacement, pos + 1)) {
+            ++count;
+        }
+        return count;
+    };
+    ASSERT_EQ(output.to_html(), Status::ok);
+    EXPECT_TRUE(is_valid_text());
+    EXPECT_EQ(count_replacements(), 4);
+
+    ASSERT_EQ(output.to_ansi(), Status::ok);
+    EXPECT_TRUE(is_valid_text());
+    EXPECT_EQ(count_replacements(), 4);
+}
+
+TEST_F(Highlight_Test, malformed_utf8_all_langs)
+{
+    // Openers which put the lexers of the various languages into different states,
+    // followed by stray continuation units and leading units truncated by the end of the source.
+    static constexpr std::u8string_view prefixes[] {
+        u8"",  u8"\"",  u8"'", u8"\\", u8"\"\\", u8"//", u8"/*", u8"#",    u8"--",
+        u8"<", u8"<a ", u8"&", u8"$",  u8"`",    u8"%",  u8"@",  u8"r\"(", u8"0x",
+    };
+    static constexpr std::u8string_view suffixes[] {
+        u8"\x80", u8"\xbf\x80", u8"\xf0",    u8"\xf0\x9f",  u8"\xe2\x82",
+        u8"\xc3", u8"\xff",     u8"\x80x\n", u8"\xf0\"x", u8"\xe2\x82'\n",
+    };
+
+    std::u8string source;
+    Text_State html { source, Lang::txt };
+    State& state = html.state;
+    const std::string& text = html.text;
+
+    // By default, malformed text is rejected before it reaches the highlighters.
+    // Otherwise, it is highlighted, but only in lenient mode
+    // is the output guaranteed to be correctly encoded.
+    for (const Flag flags : { Flag::no_flags, Flag::skip_utf8_validation, Flag::lenient_utf8 }) {
+        state.set_flags(flags);
+        for (int lang = 1; lang < ULIGHT_LANG_COUNT; ++lang) {
+            for (const std::u8string_view prefix : prefixes) {
+                for (const std::u8string_view suffix : suffixes) {
+                    source = prefix;
+                    source += suffix;
+                    state.set_source(source);
+                    state.set_lang(Lang(lang));
+                    const std::string_view input = as_string_view(std::u8string_view { source });
+                    if (flags == Flag::no_flags) {
+                        ASSERT_EQ(html.to_html(), Status::bad_text)
+                            << "lang " << lang << ": " << input;
+                        EXPECT_TRUE(text.empty()) << "lang " << lang << ": " << input;
+                        continue;
+                    }
+                    ASSERT_EQ(html.to_html(), Status::ok) << "lang " << lang << ": " << input;
+                    if (flags == Flag::lenient_utf8) {
+                        EXPECT_TRUE(utf8::is_valid(
+                            { reinterpret_cast<const char8_t*>(text.data()), text.size() }
+                        )) << "lang " << lang << ": " << input;
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_F(Highlight_Test, session)
+{
+    Session session;
+    ASSERT_TRUE(session);
+
+    static constexpr std::u8string_view small = u8"int x = 1 < 2;";
+    ASSERT_EQ(session.highlight(small, Lang::cpp), Status::ok);
+    EXPECT_EQ(session.get_output(), to_html(small, Lang::cpp));
+
+    // The output of a large source spans many flushes of the internal buffers.
+    std::u8string large;
+    for (int i = 0; i < 10'000; ++i) {
+        large += u8"let x = \"<&>\" + 1; // comment\n";
+    }
+    ASSERT_EQ(session.highlight(large, Lang::javascript), Status::ok);
+    EXPECT_EQ(session.get_output(), to_html(large, Lang::javascript));
+
+    // The output is replaced rather than appended to, and the source may be staged.
+    const std::span<char> staged = session.reserve_source(small.length());
+    ASSERT_EQ(staged.size(), small.length());
+    std::ranges::copy(small, staged.begin());
+    const std::string_view staged_source { staged.data(), staged.size() };
+    ASSERT_EQ(session.highlight(staged_source, Lang::cpp), Status::ok);
+    EXPECT_EQ(session.get_output(), to_html(small, Lang::cpp));
+
+    ASSERT_EQ(session.highlight(small, Lang::none), Status::bad_lang);
+    EXPECT_FALSE(session.get_error_string().empty());
+}
+
+TEST_F(Highlight_Test, engine)
+{
+    static constexpr std::u8string_view source = u8"int x = 1 < 2; // comment";
+
+    const Engine default_engine;
+    ASSERT_TRUE(default_engine);
+    Session default_session { default_engine };
+    ASSERT_TRUE(default_session);
+    ASSERT_EQ(default_session.highlight(source, Lang::cpp), Status::ok);
+    EXPECT_EQ(default_session.get_output(), to_html(source, Lang::cpp));
+
+    // The names and the mask are copied into the engine.
+    Highlight_Mask numbers;
+    numbers.insert(Highlight_Type::number);
+    ulight_engine_options options;
+    ulight_engine_options_init(&options);
+    std::string tag_name = "span";
+    std::string attr_name = "class";
+    options.html_tag_name = tag_name.data();
+    options.html_tag_name_length = tag_name.length();
+    options.html_attr_name = attr_name.data();
+    options.html_attr_name_length = attr_name.length();
+    options.html_emit_mask = &numbers.impl;
+    const Engine engine { options };
+    ASSERT_TRUE(engine);
+    tag_name.assign(tag_name.length(), 'x');
+    attr_name.assign(attr_name.length(), 'x');
+    numbers = {};
+
+    static constexpr std::string_view expected
+        = "int x = <span class=num>1</span> &lt; <span class=num>2</span>; // comment";
+
+    Session session { engine };
+    ASSERT_TRUE(session);
+    ASSERT_EQ(session.highlight(source, Lang::cpp), Status::ok);
+    EXPECT_EQ(session.get_output(), expected);
+
+    // States that use an engine can still be reconfigured.
+    Text_State html { engine, source, Lang::cpp };
+    ASSERT_EQ(html.to_html(), Status::ok);
+    EXPECT_EQ(html.text, expected);
+    html.state.set_html_tag_name("b");
+    html.state.set_html_emit_mask(nullptr);
+    ASSERT_EQ(html.to_html(), Status::ok);
+    EXPECT_TRUE(html.text.starts_with("<b class="));
+    EXPECT_EQ(html.text.find("span"), std::string::npos);
+
+    options.html_tag_name_length = 0;
+    EXPECT_EQ(ulight_engine_new(&options), nullptr);
+
+    // One engine can be shared by any number of threads, each with its own session.
+    std::u8string large;
+    for (int i = 0; i < 1000; ++i) {
+        large += u8"let x = \"<&>\" + 1; // comment\n";
+    }
+    std::string expected_large;
+    {
+        Session reference { default_engine };
+        ASSERT_EQ(reference.highlight(large, Lang::javascript), Status::ok);
+        expected_large = reference.get_output();
+    }
+    constexpr int thread_count = 4;
+    bool matches[thread_count] {};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; ++i) {
+        threads.emplace_back([&, i] {
+            Session thread_session { default_engine };
+            matches[i] = thread_session
+                && thread_session.highlight(large, Lang::javascript) == Status::ok
+                && thread_session.get_output() == expected_large;
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (const bool match : matches) {
+        EXPECT_TRUE(match);
+    }
+}
+
+TEST_F(Highlight_Test, source_to_tokens_utf16)
+{
+    const auto to_tokens = [](auto source, Lang lang) {
+        Token token_buffer[2];
+        std::vector<Token> tokens;
+        const auto append = [&](Token* data, std::size_t amount) {
+            tokens.insert(tokens.end(), data, data + amount);
+        };
+
+        State state;
+        state.set_lang(lang);
+        state.set_token_buffer(token_buffer);
+        state.on_flush_tokens(append);
+        if constexpr (std::is_same_v<decltype(source), std::u16string_view>) {
+            EXPECT_EQ(state.source_to_tokens_utf16(source), Status::ok);
+        }
+        else {
+            state.set_source(source);
+            EXPECT_EQ(state.source_to_tokens(), Status::ok);
+        }
+        return tokens;
+    };
+
+    // Every identifier is preceded by characters of different UTF-8 and UTF-16 lengths.
+    static constexpr std::u16string_view utf16 = u"\"\u00e4\" x; \"\U0001F600\" y; \"\u20ac\" z;";
+    static constexpr std::u8string_view utf8 = u8"\"\u00e4\" x; \"\U0001F600\" y; \"\u20ac\" z;";
+
+    const std::vector<Token> utf16_tokens = to_tokens(utf16, Lang::javascript);
+    const std::vector<Token> utf8_tokens = to_tokens(utf8, Lang::javascript);
+    ASSERT_EQ(utf16_tokens.size(), utf8_tokens.size());
+    for (std::size_t i = 0; i < utf16_tokens.size(); ++i) {
+        const Token& token = utf8_tokens[i];
+        const std::size_t begin = utf16::transcoded_length(utf8.substr(0, token.begin));
+        const std::size_t length
+            = utf16::transcoded_length(utf8.substr(token.begin, token.length));
+        EXPECT_EQ(utf16_tokens[i].begin, begin);
+        EXPECT_EQ(utf16_tokens[i].length, length);
+        EXPECT_EQ(utf16_tokens[i].type, token.type);
+    }
+    ASSERT_FALSE(utf16_tokens.empty());
+    EXPECT_EQ(utf16.substr(utf16_tokens.back().begin, utf16_tokens.back().length), u";");
+
+    State state;
+    Token token_buffer[2];
+    state.set_lang(Lang::javascript);
+    state.set_token_buffer(token_buffer);
+    const auto ignore = [](Token*, std::size_t) { };
+    state.on_flush_tokens(ignore);
+    static constexpr char16_t lone_surrogate[] { u'x', 0xd800 };
+    EXPECT_EQ(state.source_to_tokens_utf16({ lone_surrogate, 2 }), Status::bad_text);
+    EXPECT_FALSE(state.get_error_string().empty());
+}
+
+TEST_F(Highlight_Test, session_tokens)
+{
+    const auto expect_records = [](std::span<const std::uint32_t> records,
+                                   std::span<const Token> tokens) {
+        ASSERT_EQ(records.size(), tokens.size() * ULIGHT_TOKEN_RECORD_SIZE);
+        for (std::size_t i = 0; i < tokens.size(); ++i) {
+            EXPECT_EQ(records[(i * ULIGHT_TOKEN_RECORD_SIZE) + 0], tokens[i].begin);
+            EXPECT_EQ(records[(i * ULIGHT_TOKEN_RECORD_SIZE) + 1], tokens[i].length);
+            EXPECT_EQ(records[(i * ULIGHT_TOKEN_RECORD_SIZE) + 2], tokens[i].type);
+        }
+    };
+
+    std::u8string source;
+    std::u16string source_utf16;
+    for (int i = 0; i < 1000; ++i) {
+        source += u8"let \u00e4 = \"\U0001F600\" + 1; // comment\n";
+        source_utf16 += u"let \u00e4 = \"\U0001F600\" + 1; // comment\n";
+    }
+
+    Token token_buffer[16];
+    std::vector<Token> tokens;
+    const auto append = [&](Token* data, std::size_t amount) {
+        tokens.insert(tokens.end(), data, data + amount);
+    };
+    State state;
+    state.set_lang(Lang::javascript);
+    state.set_token_buffer(token_buffer);
+    state.on_flush_tokens(append);
+
+    Session session;
+    ASSERT_TRUE(session);
+
+    state.set_source(source);
+    ASSERT_EQ(state.source_to_tokens(), Status::ok);
+    ASSERT_EQ(session.tokens(source, Lang::javascript), Status::ok);
+    expect_records(session.get_token_records(), tokens);
+
+    tokens.clear();
+    ASSERT_EQ(state.source_to_tokens_utf16(source_utf16), Status::ok);
+    ASSERT_EQ(session.tokens_utf16(source_utf16, Lang::javascript), Status::ok);
+    expect_records(session.get_token_records(), tokens);
+
+    // Tokens and HTML are kept separately, and failure leaves no tokens behind.
+    ASSERT_EQ(session.highlight(u8"int x;", Lang::cpp), Status::ok);
+    expect_records(session.get_token_records(), tokens);
+    ASSERT_EQ(session.tokens(source, Lang::none), Status::bad_lang);
+    EXPECT_TRUE(session.get_token_records().empty());
+}
+
+TEST_F(Highlight_Test, cancellation)
+{
+    const auto to_tokens = [](std::u8string_view source, Lang lang, int cancel_after_polls) {
+        Token token_buffer[16];
+        std::vector<Token> tokens;
+        const auto append = [&](Token* data, std::size_t amount) {
+            tokens.insert(tokens.end(), data, data + amount);
+        };
+        int polls = 0;
+        const auto is_cancelled = [&] { return int(++polls > cancel_after_polls); };
+
+        State state;
+        state.set_source(source);
+        state.set_lang(lang);
+        state.set_token_buffer(token_buffer);
+        state.on_flush_tokens(append);
+        state.on_poll_cancelled(is_cancelled);
+        const Status status = state.source_to_tokens();
+        return std::pair { status, tokens };
+    };
+    const auto expect_cancelled_prefix = [&](std::u8string_view source, Lang lang) {
+        const auto [complete_status, complete] = to_tokens(source, lang, 1'000'000);
+        ASSERT_EQ(complete_status, Status::ok);
+
+        // Cancelled highlighting emits a proper prefix of the tokens.
+        const auto [status, partial] = to_tokens(source, lang, 2);
+        EXPECT_EQ(status, Status::cancelled);
+        ASSERT_LT(partial.size(), complete.size());
+        EXPECT_FALSE(partial.empty());
+        for (std::size_t i = 0; i < partial.size(); ++i) {
+            EXPECT_EQ(partial[i].begin, complete[i].begin);
+            EXPECT_EQ(partial[i].length, complete[i].length);
+            EXPECT_EQ(partial[i].type, complete[i].type);
+        }
+    };
+
+    struct Case {
+        Lang lang;
+        std::u8string_view line;
+    };
+    static constexpr Case cases[] {
+        { Lang::bash, u8"echo \"$x\" | grep -v y # comment\n" },
+        { Lang::cowel, u8"\\b{text} \\i[x=1]{y} \\comment{z}\n" },
+        { Lang::cpp, u8"int x = y + 1; // comment\n" },
+        { Lang::css, u8".a > b { color: red; }\n" },
+        { Lang::html, u8"<b class=x>text &amp; more</b>\n" },
+        { Lang::javascript, u8"let x = \"y\" + 1; // comment\n" },
+        { Lang::json, u8"[1, \"x\", true, null],\n" },
+        { Lang::lua, u8"local x = y + 1 -- comment\n" },
+        { Lang::xml, u8"<a b=\"c\">text</a>\n" },
+    };
+    for (const auto& [lang, line] : cases) {
+        std::u8string source;
+        for (int i = 0; i < 1000; ++i) {
+            source += line;
+        }
+        expect_cancelled_prefix(source, lang);
+    }
+    // Within a single COWEL block or argument, highlighting can be cancelled too.
+    for (const std::u8string_view opener : { u8"\\b{", u8"\\b[x=" }) {
+        std::u8string source { opener };
+        for (int i = 0; i < 1000; ++i) {
+            source += u8"text \\i{y} \\comment{z}\n";
+        }
+        expect_cancelled_prefix(source, Lang::cowel);
+    }
+
+    std::u8string source;
+    for (int i = 0; i < 1000; ++i) {
+        source += u8"int x = y + 1; // comment\n";
+    }
+    Token token_buffer[16];
+    const auto ignore = [](Token*, std::size_t) { };
+    State state;
+    state.set_source(source);
+    state.set_lang(Lang::cpp);
+    state.set_token_buffer(token_buffer);
+    state.on_flush_tokens(ignore);
+
+    int cancel_flag = 1;
+    state.set_cancel_flag(&cancel_flag);
+    EXPECT_EQ(state.source_to_tokens(), Status::cancelled);
+    cancel_flag = 0;
+    EXPECT_EQ(state.source_to_tokens(), Status::ok);
+    state.set_cancel_flag(nullptr);
+
+    // Even the fastest highlighting takes longer than a nanosecond.
+    state.set_time_limit_ns(1);
+    EXPECT_EQ(state.source_to_tokens(), Status::cancelled);
+    state.set_time_limit_ns(0);
+    EXPECT_EQ(state.source_to_tokens(), Status::ok);
+    // Limits too long to compute a deadline for do not overflow into the past.
+    state.set_time_limit_ns(std::numeric_limits<unsigned long long>::max());
+    EXPECT_EQ(state.source_to_tokens(), Status::ok);
+    state.set_time_limit_ns(std::numeric_limits<long long>::max());
+    EXPECT_EQ(state.source_to_tokens(), Status::ok);
+    state.set_time_limit_ns(0);
+
+    // Cancelled ANSI output is flushed and ends with the attributes reset,
+    // but leaves out the source code that was not highlighted.
+    Text_State ansi { source, Lang::cpp };
+    int polls = 0;
+    const auto is_cancelled = [&] { return int(++polls > 2); };
+    ansi.state.on_poll_cancelled(is_cancelled);
+    ASSERT_EQ(ansi.to_ansi(), Status::cancelled);
+    EXPECT_FALSE(ansi.text.empty());
+    EXPECT_LT(ansi.text.length(), source.length());
+    EXPECT_TRUE(ansi.text.ends_with(ansi::reset));
+}
+
+TEST_F(Highlight_Test, html_emit_mask_from_theme)
+{
+    static constexpr std::string_view theme = R"({
+    "dark": {
+        "foreground": "#d4d4d4",
+        "id": "#d4d4d4",
+        "sym": { "color": "#d4d4d4" },
+        "keyword": "#0000ff",
+        "comment": { "font-style": "normal" },
+        "comment-delim": { "font-style": "italic" }
+    }
+})";
+
+    Highlight_Mask mask;
+    ASSERT_EQ(mask.add_theme(theme, "dark"), Status::ok);
+    EXPECT_TRUE(mask.contains(Highlight_Type::keyword));
+    EXPECT_TRUE(mask.contains(Highlight_Type::keyword_type));
+    EXPECT_TRUE(mask.contains(Highlight_Type::comment_delim));
+    EXPECT_FALSE(mask.contains(Highlight_Type::comment));
+    EXPECT_FALSE(mask.contains(Highlight_Type::id));
+    EXPECT_FALSE(mask.contains(Highlight_Type::sym_punc));
+    EXPECT_FALSE(mask.contains(Highlight_Type::number));
+
+    EXPECT_EQ(mask.add_theme(theme, "light"), Status::bad_state);
+}
+
 TEST_F(Highlight_Test, exhaustive_one_char)
 {
     Token token_buffer[16];
@@ -1,3 +1,8 @@
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
 #include <variant>
 #include <vector>
 
@@ -6,11 +11,18 @@
 #include "ulight/json.hpp"
 
 #include "ulight/impl/io.hpp"
+#include "ulight/impl/lang/json.hpp"
 #include "ulight/impl/lang/json_chars.hpp"
+#include "ulight/impl/lang/json_number.hpp"
+#include "ulight/impl/lang/json_parser.hpp"
 #include "ulight/impl/platform.h"
+#include "ulight/impl/simd.hpp"
+#include "ulight/impl/strings.hpp"
 #include "ulight/impl/unicode.hpp"
 
 namespace ulight::json {
+// The types are local to this file so that they don't clash with those of json_document.hpp.
+namespace {
 
 struct Value;
 struct Member;
@@ -151,8 +163,6 @@ std::ostream& operator<<(std::ostream& out, const Value& value)
 
 // NOLINTEND
 
-namespace {
-
 struct Test_Visitor final : JSON_Visitor {
     std::size_t line_comment_count = 0;
     std::size_t block_comment_count = 0;
@@ -335,6 +345,12 @@ TEST(JSON, parse_float_with_exponent)
     EXPECT_EQ(value, 100'000.0);
 }
 
+TEST(JSON, parse_negative)
+{
+    std::optional<Value> value = parse(u8"[-5, -0.5e1, -0]");
+    EXPECT_EQ(value, (Array { -5.0, -5.0, -0.0 }));
+}
+
 TEST(JSON, parse_string)
 {
     const std::u8string expected = u8"awoo";
@@ -385,5 +401,645 @@ TEST(JSON, parse_nested)
     EXPECT_EQ(value, expected);
 }
 
+struct Counting_Visitor {
+    std::size_t objects = 0;
+    std::size_t arrays = 0;
+
+    void push_object(const Source_Position&)
+    {
+        ++objects;
+    }
+    void push_array(const Source_Position&)
+    {
+        ++arrays;
+    }
+};
+
+struct Misspelled_Visitor {
+    void push_objects(const Source_Position&) { }
+};
+
+struct Wrong_Signature_Visitor {
+    void push_object() { }
+    void error(const Source_Position&, JSON_Error) { }
+};
+
+static_assert(json_static_visitor<Counting_Visitor>);
+static_assert(!json_static_visitor<Test_Visitor>);
+// Static visitors need at least one callback that can be called like that of `JSON_Visitor`.
+static_assert(!json_static_visitor<Misspelled_Visitor>);
+static_assert(!json_static_visitor<Wrong_Signature_Visitor>);
+static_assert(!json_static_visitor<std::string>);
+
+TEST(JSON, parse_static_visitor_counting)
+{
+    std::vector<char8_t> source;
+    ASSERT_TRUE(load_utf8_file_or_error(source, "test/json/nested.json"));
+
+    Counting_Visitor visitor;
+    EXPECT_TRUE(parse_json(visitor, std::u8string_view { source.data(), source.size() }));
+    EXPECT_EQ(visitor.objects, 8);
+    EXPECT_EQ(visitor.arrays, 3);
+}
+
+TEST(JSON, parse_static_visitor_extracting)
+{
+    // Extracts the value of the top-level "string" property.
+    struct Extracting_Visitor {
+        std::size_t depth = 0;
+        std::u8string current;
+        std::u8string key;
+        std::optional<std::u8string> result;
+        std::optional<JSON_Error> error_code;
+
+        void literal(const Source_Position&, std::u8string_view chars)
+        {
+            current += chars;
+        }
+        void escape(const Source_Position&, std::u8string_view, char32_t, std::u8string_view units)
+        {
+            current += units;
+        }
+        void push_string(const Source_Position&)
+        {
+            current.clear();
+        }
+        void pop_string(const Source_Position&)
+        {
+            if (depth == 1 && key == u8"string") {
+                result = current;
+            }
+        }
+        void push_property(const Source_Position&)
+        {
+            current.clear();
+        }
+        void pop_property(const Source_Position&)
+        {
+            key = current;
+        }
+        void push_object(const Source_Position&)
+        {
+            ++depth;
+        }
+        void pop_object(const Source_Position&)
+        {
+            --depth;
+        }
+        Error_Reaction error(const Source_Position&, JSON_Error e)
+        {
+            error_code = e;
+            return Error_Reaction::abort;
+        }
+    };
+
+    std::vector<char8_t> source;
+    ASSERT_TRUE(load_utf8_file_or_error(source, "test/json/values.json"));
+    const std::u8string_view source_string { source.data(), source.size() };
+
+    constexpr JSON_Options options { .escapes = Escape_Parsing::parse_encode };
+    Extracting_Visitor visitor;
+    EXPECT_TRUE(parse_json(visitor, source_string, options));
+    EXPECT_EQ(visitor.result, u8"str\"ing");
+    EXPECT_EQ(visitor.error_code, std::nullopt);
+
+    Extracting_Visitor error_visitor;
+    EXPECT_FALSE(parse_json(error_visitor, "{\"string\": 01}"));
+    EXPECT_EQ(error_visitor.error_code, JSON_Error::illegal_number);
+}
+
+TEST(JSON, parse_long_string)
+{
+    // Strings spanning multiple blocks, with special characters on block boundaries.
+    std::u8string expected(200, u8'x');
+    expected[63] = u8'"';
+    expected[64] = u8'\\';
+    expected[127] = u8'\\';
+    std::u8string source = u8"\"" + expected + u8"\"";
+    source.replace(64, 1, u8"\\\"");
+    source.replace(66, 1, u8"\\\\");
+    source.replace(130, 1, u8"\\\\");
+
+    const std::optional<Value> value = parse(source);
+    EXPECT_TRUE(value == Value { expected });
+}
+
+struct Error_Visitor final : JSON_Visitor {
+    std::optional<JSON_Error> error_code;
+    std::size_t error_position = 0;
+    Source_Position error_source_position {};
+
+    Error_Reaction error(const Source_Position& pos, JSON_Error e) final
+    {
+        error_code = e;
+        error_position = pos.code_unit;
+        error_source_position = pos;
+        return Error_Reaction::abort;
+    }
+};
+
+TEST(JSON, parse_control_character_in_string)
+{
+    for (const std::size_t position : { 1uz, 62uz, 63uz, 64uz, 65uz, 127uz, 128uz, 150uz }) {
+        std::u8string source = u8"\"" + std::u8string(150, u8'x') + u8"\"";
+        source[position] = u8'\n';
+
+        Error_Visitor visitor;
+        EXPECT_FALSE(parse_json(visitor, source));
+        EXPECT_EQ(visitor.error_code, JSON_Error::illegal_character);
+        EXPECT_EQ(visitor.error_position, position);
+    }
+}
+
+TEST(JSON, parse_trailing_content)
+{
+    struct Case {
+        std::u8string_view source;
+        std::size_t error_position;
+        bool is_multiple_values;
+    };
+    static constexpr Case cases[] {
+        { u8"{} x", 3, false },
+        { u8"[1] [2]", 4, true },
+        { u8"12-3", 2, true },
+        { u8"null /", 5, false },
+    };
+    for (const auto& [source, error_position, is_multiple_values] : cases) {
+        Error_Visitor visitor;
+        EXPECT_FALSE(parse_json(visitor, source)) << as_string_view(source);
+        EXPECT_EQ(visitor.error_code, JSON_Error::illegal_character) << as_string_view(source);
+        EXPECT_EQ(visitor.error_position, error_position) << as_string_view(source);
+
+        Error_Visitor multiple_visitor;
+        EXPECT_EQ(
+            parse_json(multiple_visitor, source, { .allow_multiple_values = true }),
+            is_multiple_values
+        ) << as_string_view(source);
+    }
+
+    // Whitespace and comments may follow the top-level value.
+    Error_Visitor visitor;
+    EXPECT_TRUE(parse_json(visitor, u8"{} \n"));
+    EXPECT_TRUE(parse_json(visitor, u8"{} // x\n/* y */", { .allow_comments = true }));
+    EXPECT_FALSE(visitor.error_code);
+}
+
+TEST(JSON, json_source_position)
+{
+    std::u8string source;
+    for (std::size_t i = 0; i < 300; ++i) {
+        source += i % 7 == 0 || i % 61 == 0 ? u8'\n' : u8'x';
+    }
+
+    Source_Position expected {};
+    for (std::size_t i = 0; i <= source.length(); ++i) {
+        const Source_Position actual = json_source_position(source, i);
+        EXPECT_EQ(actual.code_unit, i);
+        EXPECT_EQ(actual.line, expected.line);
+        EXPECT_EQ(actual.line_code_unit, expected.line_code_unit);
+
+        if (i < source.length() && source[i] == u8'\n') {
+            ++expected.line;
+            expected.line_code_unit = 0;
+        }
+        else {
+            ++expected.line_code_unit;
+        }
+    }
+}
+
+TEST(JSON, parse_lazy_positions)
+{
+    static constexpr std::u8string_view sources[] {
+        u8"{\n  \"a\": [1, 2,\n  3],\n  \"b\": \"x\n\"\n}",
+        u8"[\n\n\n  01]",
+        u8"{\"a\":\n\n}",
+        u8"\n\n\n   /* unterminated",
+        u8"[true,\n false,\n nul]",
+    };
+
+    for (const std::u8string_view source : sources) {
+        Error_Visitor eager;
+        Error_Visitor lazy;
+        EXPECT_FALSE(parse_json(eager, source, { .allow_comments = true }));
+        EXPECT_FALSE(parse_json(lazy, source, { .allow_comments = true, .lazy_positions = true }));
+        EXPECT_EQ(eager.error_code, lazy.error_code);
+        EXPECT_EQ(eager.error_source_position.code_unit, lazy.error_source_position.code_unit);
+        EXPECT_EQ(eager.error_source_position.line, lazy.error_source_position.line);
+        EXPECT_EQ(
+            eager.error_source_position.line_code_unit, lazy.error_source_position.line_code_unit
+        );
+    }
+}
+
+TEST(JSON, parse_eight_digits)
+{
+    const auto load = [](std::u8string_view str) { return load_eight_chars(str.data()); };
+    EXPECT_TRUE(is_eight_digits(load(u8"01234567")));
+    EXPECT_TRUE(is_eight_digits(load(u8"99999999")));
+    EXPECT_FALSE(is_eight_digits(load(u8"0123456.")));
+    EXPECT_FALSE(is_eight_digits(load(u8"/1234567")));
+    EXPECT_FALSE(is_eight_digits(load(u8"0123:567")));
+    EXPECT_FALSE(is_eight_digits(load(u8"1234567e")));
+
+    EXPECT_EQ(parse_eight_digits(load(u8"00000000")), 0);
+    EXPECT_EQ(parse_eight_digits(load(u8"01234567")), 1234567);
+    EXPECT_EQ(parse_eight_digits(load(u8"87654321")), 87654321);
+    EXPECT_EQ(parse_eight_digits(load(u8"99999999")), 99999999);
+}
+
+[[nodiscard]]
+std::optional<double> parse_number_string(const std::u8string& str)
+{
+    const Number_Result number = match_number(str);
+    if (number.length != str.length() || number.erroneous) {
+        return {};
+    }
+    return parse_number(str, number);
+}
+
+/// @brief Returns `true` if `str` is converted to exactly the same `double` as by `std::strtod`.
+[[nodiscard]]
+bool matches_strtod(const std::u8string& str)
+{
+    const std::optional<double> actual = parse_number_string(str);
+    const double expected = std::strtod(reinterpret_cast<const char*>(str.c_str()), nullptr);
+    return actual
+        && std::bit_cast<std::uint64_t>(*actual) == std::bit_cast<std::uint64_t>(expected);
+}
+
+TEST(JSON, parse_number_edge_cases)
+{
+    static constexpr std::u8string_view cases[] {
+        u8"0",
+        u8"-0",
+        u8"0.1",
+        u8"1e22",
+        u8"1e23",
+        u8"-1e-22",
+        u8"9007199254740992",
+        u8"9007199254740993",
+        u8"9999999999999999999",
+        u8"12345678901234567890",
+        u8"0.30000000000000004",
+        u8"2.2250738585072011e-308",
+        u8"4.9406564584124654e-324",
+        u8"1.7976931348623157e308",
+        u8"1e400",
+        u8"-1e400",
+        u8"1e-400",
+        u8"123456789012345678901234567890e-30",
+        u8"0.000000000000000000000000000001",
+        u8"1E+0005",
+        u8"1e00000000000000000001",
+    };
+    for (const std::u8string_view str : cases) {
+        EXPECT_TRUE(matches_strtod(std::u8string { str })) << as_string_view(str);
+    }
+}
+
+TEST(JSON, parse_number_random)
+{
+    std::default_random_engine rng { 12345 };
+    const auto random = [&](int min, int max) {
+        return std::uniform_int_distribution<int> { min, max }(rng);
+    };
+    const auto append_digits = [&](std::u8string& out, int count) {
+        for (int i = 0; i < count; ++i) {
+            out += char8_t(u8'0' + random(0, 9));
+        }
+    };
+
+    for (int i = 0; i < 100'000; ++i) {
+        std::u8string str;
+        if (random(0, 1)) {
+            str += u8'-';
+        }
+        const int integer_digits = random(1, 24);
+        if (integer_digits == 1) {
+            append_digits(str, 1);
+        }
+        else {
+            str += char8_t(u8'0' + random(1, 9));
+            append_digits(str, integer_digits - 1);
+        }
+        if (random(0, 1)) {
+            str += u8'.';
+            append_digits(str, random(1, 24));
+        }
+        if (random(0, 1)) {
+            str += random(0, 1) ? u8'e' : u8'E';
+            const int sign = random(0, 2);
+            if (sign != 0) {
+                str += sign == 1 ? u8'+' : u8'-';
+            }
+            const int exponent_value = random(0, 1) ? random(0, 30) : random(0, 350);
+            const std::string exponent = std::to_string(exponent_value);
+            str.append(exponent.begin(), exponent.end());
+        }
+        ASSERT_TRUE(matches_strtod(str)) << as_string_view(str);
+    }
+}
+
+TEST(JSON, classify_block)
+{
+    std::default_random_engine rng { 12345 };
+    // Biased towards characters which are relevant to JSON.
+    constexpr std::u8string_view interesting = u8"\"\\{}[]:, \t\f\n\r\x1f\x7f\x80\xff";
+    std::uniform_int_distribution<int> byte_distribution { 0, 255 };
+    std::uniform_int_distribution<std::size_t> interesting_distribution { 0,
+                                                                          interesting.size() - 1 };
+
+    char8_t block[block_size];
+    for (int i = 0; i < 1000; ++i) {
+        for (char8_t& c : block) {
+            c = byte_distribution(rng) < 128 ? interesting[interesting_distribution(rng)]
+                                             : char8_t(byte_distribution(rng));
+        }
+        EXPECT_EQ(classify_block(block), classify_block_scalar(block));
+    }
+}
+
+TEST(JSON, block_index_find)
+{
+    std::u8string source(200, u8'a');
+    source[3] = u8' ';
+    source[4] = u8'\f';
+    source[70] = u8'"';
+    source[128] = u8'\\';
+    source[190] = u8'\x01';
+    for (std::size_t i = 130; i < 190; ++i) {
+        source[i] = u8'\t';
+    }
+
+    Block_Index index { source };
+    const auto naive_find = [&](std::size_t start, auto predicate) {
+        while (start < source.length() && !predicate(source[start])) {
+            ++start;
+        }
+        return start;
+    };
+    const auto is_string_special
+        = [](char8_t c) { return c == u8'"' || c == u8'\\' || c < 0x20; };
+    const auto is_not_whitespace = [](char8_t c) { return !is_json_whitespace(c); };
+
+    for (std::size_t start = 0; start <= source.length(); ++start) {
+        EXPECT_EQ(index.find_string_special(start), naive_find(start, is_string_special));
+        EXPECT_EQ(index.find_non_whitespace(start), naive_find(start, is_not_whitespace));
+    }
+}
+
+/// @brief Records every callback, with adjacent literals merged,
+/// since the push parser may split literals at chunk boundaries.
+struct Recording_Visitor final : JSON_Visitor {
+    struct Event {
+        std::string kind;
+        std::size_t code_unit;
+        std::size_t line;
+        std::size_t line_code_unit;
+        std::u8string text;
+
+        [[nodiscard]]
+        friend bool operator==(const Event&, const Event&)
+            = default;
+
+        friend std::ostream& operator<<(std::ostream& out, const Event& event)
+        {
+            return out << event.kind << '@' << event.code_unit << ':' << event.line << ':'
+                       << event.line_code_unit << ' ' << as_string_view(event.text);
+        }
+    };
+
+    std::vector<Event> events;
+
+    void record(std::string kind, const Source_Position& pos, std::u8string_view text = {})
+    {
+        events.push_back({ std::move(kind), pos.code_unit, pos.line, pos.line_code_unit,
+                           std::u8string { text } });
+    }
+
+    void line_comment(const Source_Position& pos, std::u8string_view comment) final
+    {
+        record("line_comment", pos, comment);
+    }
+    void block_comment(const Source_Position& pos, std::u8string_view comment) final
+    {
+        record("block_comment", pos, comment);
+    }
+    void literal(const Source_Position& pos, std::u8string_view chars) final
+    {
+        if (!events.empty() && events.back().kind == "literal"
+            && events.back().code_unit + events.back().text.length() == pos.code_unit) {
+            events.back().text += chars;
+            return;
+        }
+        record("literal", pos, chars);
+    }
+    void escape(const Source_Position& pos, std::u8string_view escape) final
+    {
+        record("escape", pos, escape);
+    }
+    void escape(const Source_Position& pos, std::u8string_view escape, char32_t code_point) final
+    {
+        record("escape " + std::to_string(std::uint32_t(code_point)), pos, escape);
+    }
+    void escape(
+        const Source_Position& pos,
+        std::u8string_view escape,
+        char32_t code_point,
+        std::u8string_view code_units
+    ) final
+    {
+        record("escape " + std::to_string(std::uint32_t(code_point)), pos, code_units);
+        events.back().text += escape;
+    }
+    void number(const Source_Position& pos, std::u8string_view number) final
+    {
+        record("number", pos, number);
+    }
+    void number(const Source_Position& pos, std::u8string_view number, double value) final
+    {
+        record("number " + std::to_string(value), pos, number);
+    }
+    void null(const Source_Position& pos) final
+    {
+        record("null", pos);
+    }
+    void boolean(const Source_Position& pos, bool value) final
+    {
+        record(value ? "true" : "false", pos);
+    }
+    void push_string(const Source_Position& pos) final
+    {
+        record("push_string", pos);
+    }
+    void pop_string(const Source_Position& pos) final
+    {
+        record("pop_string", pos);
+    }
+    void push_property(const Source_Position& pos) final
+    {
+        record("push_property", pos);
+    }
+    void pop_property(const Source_Position& pos) final
+    {
+        record("pop_property", pos);
+    }
+    void push_object(const Source_Position& pos) final
+    {
+        record("push_object", pos);
+    }
+    void pop_object(const Source_Position& pos) final
+    {
+        record("pop_object", pos);
+    }
+    void push_array(const Source_Position& pos) final
+    {
+        record("push_array", pos);
+    }
+    void pop_array(const Source_Position& pos) final
+    {
+        record("pop_array", pos);
+    }
+    Error_Reaction error(const Source_Position& pos, JSON_Error e) final
+    {
+        record("error " + std::to_string(int(e)), pos);
+        return Error_Reaction::abort;
+    }
+};
+
+[[nodiscard]]
+bool push_parse(
+    JSON_Visitor& visitor,
+    std::u8string_view source,
+    JSON_Options options,
+    std::size_t chunk_size
+)
+{
+    JSON_Push_Parser parser { visitor, options };
+    for (std::size_t i = 0; i < source.length(); i += chunk_size) {
+        if (!parser.feed(source.substr(i, chunk_size))) {
+            return false;
+        }
+    }
+    return parser.finish();
+}
+
+TEST(JSON, push_parser_matches_parse_json)
+{
+    std::vector<std::u8string> sources {
+        u8"[1, -2.5e3, true, false, null, \"a\\nb\\u00e9c\\/\", {\"k\": [ ]}]",
+        u8"// comment\r\n{ /* block\n comment */ \"a\" : 1 } // trailing\u2028",
+        u8"{\"a\"/**/:/**/1, \"b\" // x\n : \"\\uD83D\"}\n\n",
+        u8"1 2\n[3]\n{\"a\": 4}\n\"five\"\n",
+        u8"[0.1, 123456789012345678901234567890, 1e400, 3.14159265358979323846]",
+        u8"{\"a\": 1,}",
+        u8"{\"a\": 1, 2}",
+        u8"{2}",
+        u8"[1,]",
+        u8"[1,",
+        u8"[1 2]",
+        u8"[,]",
+        u8"{\"a\" 1}",
+        u8"{\"a\":}",
+        u8"{\"a\":",
+        u8"{\"a\"",
+        u8"[",
+        u8"{",
+        u8"\"abc",
+        u8"\"a\\u12\"",
+        u8"\"a\\x\"",
+        u8"\"a\\",
+        u8"\"a\nb\"",
+        u8"nul",
+        u8"[tru]",
+        u8"[0123]",
+        u8"12-3",
+        u8"1.",
+        u8"",
+        u8"  \n ",
+        u8"{} x",
+        u8"/",
+        u8"[1 / 2]",
+        u8"{\"a\" / 2}",
+        u8"[/* unterminated",
+    };
+    for (const std::string_view file : { "test/json/nested.json", "test/json/values.json" }) {
+        std::vector<char8_t> source;
+        ASSERT_TRUE(load_utf8_file_or_error(source, file));
+        sources.emplace_back(source.begin(), source.end());
+    }
+
+    static constexpr JSON_Options options_list[] {
+        {},
+        { .allow_comments = true,
+          .parse_numbers = true,
+          .escapes = Escape_Parsing::parse_encode },
+        { .allow_comments = true,
+          .allow_multiple_values = true,
+          .escapes = Escape_Parsing::parse },
+    };
+
+    for (const std::u8string_view source : sources) {
+        for (const JSON_Options& options : options_list) {
+            Recording_Visitor expected;
+            const bool expected_result = parse_json(expected, source, options);
+
+            for (const std::size_t chunk_size : { 1uz, 2uz, 3uz, 5uz, 64uz, 1uz << 20 }) {
+                Recording_Visitor actual;
+                const bool actual_result = push_parse(actual, source, options, chunk_size);
+                EXPECT_EQ(actual_result, expected_result)
+                    << as_string_view(source) << " (chunk size " << chunk_size << ')';
+                EXPECT_EQ(actual.events, expected.events)
+                    << as_string_view(source) << " (chunk size " << chunk_size << ')';
+            }
+        }
+    }
+}
+
+TEST(JSON, push_parser_json_lines)
+{
+    struct Counting_Visitor final : JSON_Visitor {
+        std::size_t objects = 0;
+        double sum = 0;
+
+        void push_object(const Source_Position&) final
+        {
+            ++objects;
+        }
+        void number(const Source_Position&, std::u8string_view, double value) final
+        {
+            sum += value;
+        }
+    };
+
+    // Many lines, with numbers and strings split at every possible point over time.
+    std::u8string line = u8"{\"id\": 12345, \"name\": \"x\\ty\", \"ok\": true}\n";
+    Counting_Visitor visitor;
+    JSON_Push_Parser parser { visitor, { .parse_numbers = true, .allow_multiple_values = true } };
+    constexpr std::size_t line_count = 1000;
+    for (std::size_t i = 0; i < line_count; ++i) {
+        const std::size_t split = i % line.length();
+        ASSERT_TRUE(parser.feed(std::u8string_view { line }.substr(0, split)));
+        ASSERT_TRUE(parser.feed(std::u8string_view { line }.substr(split)));
+    }
+    EXPECT_TRUE(parser.finish());
+    EXPECT_EQ(visitor.objects, line_count);
+    EXPECT_EQ(visitor.sum, 12345.0 * line_count);
+    EXPECT_EQ(parser.position().line, line_count);
+}
+
+TEST(JSON, push_parser_rejects_input_after_error)
+{
+    Error_Visitor visitor;
+    JSON_Push_Parser parser { visitor };
+    EXPECT_TRUE(parser.feed(u8"[1, "));
+    EXPECT_FALSE(parser.feed(u8"}"));
+    EXPECT_EQ(visitor.error_code, JSON_Error::illegal_character);
+    EXPECT_EQ(visitor.error_position, 4);
+    EXPECT_FALSE(parser.feed(u8"2]"));
+    EXPECT_FALSE(parser.finish());
+}
+
 } // namespace
 } // namespace ulight::json
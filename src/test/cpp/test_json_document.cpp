@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <ranges>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ulight/json_document.hpp"
+
+#include "ulight/impl/io.hpp"
+
+namespace ulight::json {
+namespace {
+
+[[nodiscard]]
+bool points_into(std::u8string_view str, std::u8string_view source)
+{
+    return std::less_equal<> {}(source.data(), str.data())
+        && std::less_equal<> {}(str.data() + str.size(), source.data() + source.size());
+}
+
+TEST(JSON_Document, parse_values)
+{
+    std::vector<char8_t> source;
+    ASSERT_TRUE(load_utf8_file_or_error(source, "test/json/values.json"));
+    const std::u8string_view source_string { source.data(), source.size() };
+
+    Document document;
+    ASSERT_TRUE(document.parse(source_string));
+    const Node* const root = document.root();
+    ASSERT_NE(root, nullptr);
+    ASSERT_EQ(root->get_type(), Node_Type::object);
+    EXPECT_EQ(root->size(), 8);
+
+    const auto keys = root->members() | std::views::transform(&Member::key);
+    EXPECT_TRUE(std::ranges::is_sorted(keys));
+
+    ASSERT_NE(root->find(u8"string"), nullptr);
+    EXPECT_EQ(root->find(u8"string")->as_string(), u8"str\"ing");
+    EXPECT_EQ(root->find(u8"int")->as_number(), 123.0);
+    EXPECT_EQ(root->find(u8"float")->as_number(), 123.125);
+    EXPECT_TRUE(root->find(u8"null")->is_null());
+    EXPECT_EQ(root->find(u8"true")->get_type(), Node_Type::boolean);
+    EXPECT_TRUE(root->find(u8"true")->as_boolean());
+    EXPECT_FALSE(root->find(u8"false")->as_boolean());
+    EXPECT_EQ(root->find(u8"object")->get_type(), Node_Type::object);
+    EXPECT_EQ(root->find(u8"array")->get_type(), Node_Type::array);
+    EXPECT_EQ(root->find(u8"array")->size(), 0);
+    EXPECT_EQ(root->find(u8"missing"), nullptr);
+    EXPECT_EQ(root->find(u8"string")->find(u8"string"), nullptr);
+
+    for (const Member& member : root->members()) {
+        EXPECT_TRUE(points_into(member.key, source_string));
+    }
+}
+
+TEST(JSON_Document, parse_nested)
+{
+    static constexpr std::u8string_view source
+        = u8R"({ "b": [1, [2, 3], { "x": "y" }], "a": { "c": [] }, "b": null })";
+
+    Document document;
+    ASSERT_TRUE(document.parse(source));
+    const Node* const root = document.root();
+    ASSERT_NE(root, nullptr);
+    ASSERT_EQ(root->size(), 3);
+
+    // Duplicate keys are kept in their original order, and the first one is found.
+    EXPECT_EQ(root->members()[0].key, u8"a");
+    EXPECT_EQ(root->members()[1].key, u8"b");
+    EXPECT_EQ(root->members()[2].key, u8"b");
+    EXPECT_TRUE(root->members()[2].value.is_null());
+
+    const Node* const b = root->find(u8"b");
+    ASSERT_NE(b, nullptr);
+    ASSERT_EQ(b->get_type(), Node_Type::array);
+    ASSERT_EQ(b->size(), 3);
+    EXPECT_EQ(b->elements()[0].as_number(), 1.0);
+    ASSERT_EQ(b->elements()[1].size(), 2);
+    EXPECT_EQ(b->elements()[1].elements()[1].as_number(), 3.0);
+    ASSERT_NE(b->elements()[2].find(u8"x"), nullptr);
+    EXPECT_EQ(b->elements()[2].find(u8"x")->as_string(), u8"y");
+
+    const Node* const a = root->find(u8"a");
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(a->find(u8"c"), nullptr);
+    EXPECT_EQ(a->find(u8"c")->get_type(), Node_Type::array);
+}
+
+TEST(JSON_Document, parse_strings)
+{
+    static constexpr std::u8string_view source
+        = u8R"(["plain", "", "esc\naped", "ö", "\"", "tail\\"])";
+
+    Document document;
+    ASSERT_TRUE(document.parse(source));
+    const Node* const root = document.root();
+    ASSERT_NE(root, nullptr);
+    ASSERT_EQ(root->size(), 6);
+
+    const std::span<const Node> elements = root->elements();
+    EXPECT_EQ(elements[0].as_string(), u8"plain");
+    EXPECT_TRUE(points_into(elements[0].as_string(), source));
+    EXPECT_EQ(elements[1].as_string(), u8"");
+    EXPECT_EQ(elements[2].as_string(), u8"esc\naped");
+    EXPECT_FALSE(points_into(elements[2].as_string(), source));
+    EXPECT_EQ(elements[3].as_string(), u8"ö");
+    EXPECT_EQ(elements[4].as_string(), u8"\"");
+    EXPECT_EQ(elements[5].as_string(), u8"tail\\");
+}
+
+TEST(JSON_Document, parse_errors)
+{
+    Document document;
+    EXPECT_FALSE(document.parse(u8R"({ "a": [1, 2 })"));
+    EXPECT_EQ(document.root(), nullptr);
+
+    EXPECT_FALSE(document.parse("// comment\n{}"));
+    EXPECT_TRUE(document.parse("// comment\n{}", { .allow_comments = true }));
+    ASSERT_NE(document.root(), nullptr);
+    EXPECT_EQ(document.root()->get_type(), Node_Type::object);
+
+    EXPECT_TRUE(document.parse("123"));
+    ASSERT_NE(document.root(), nullptr);
+    EXPECT_EQ(document.root()->as_number(), 123.0);
+}
+
+} // namespace
+} // namespace ulight::json
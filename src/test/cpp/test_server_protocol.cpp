@@ -0,0 +1,73 @@
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include <gtest/gtest.h>
+
+#include "ulight/ulight.hpp"
+
+#include "ulight/impl/server_protocol.hpp"
+
+namespace ulight::server {
+namespace {
+
+TEST(Server_Protocol, request_round_trip)
+{
+    constexpr Request_Header header { .id = 0x12345678,
+                                      .lang = Lang::javascript,
+                                      .format = Output_Format::tokens,
+                                      .flags = Flag::coalesce | Flag::strict };
+    const Request_Prefix prefix = encode_request_prefix(header, 1000);
+
+    EXPECT_EQ(load_u32(prefix), request_header_size + 1000);
+    // Integers are little-endian regardless of the platform.
+    EXPECT_EQ(prefix[4], '\x78');
+    EXPECT_EQ(prefix[7], '\x12');
+
+    const std::optional<Request_Header> decoded
+        = decode_request_header(std::span { prefix }.subspan(frame_size_size));
+    ASSERT_TRUE(decoded);
+    EXPECT_EQ(decoded->id, header.id);
+    EXPECT_EQ(decoded->lang, header.lang);
+    EXPECT_EQ(decoded->format, header.format);
+    EXPECT_EQ(decoded->flags, header.flags);
+}
+
+TEST(Server_Protocol, response_round_trip)
+{
+    constexpr Response_Header header { .id = 7,
+                                       .status = Status::bad_lang,
+                                       .format = Output_Format::ansi };
+    const Response_Prefix prefix = encode_response_prefix(header, 0);
+
+    EXPECT_EQ(load_u32(prefix), response_header_size);
+    const std::optional<Response_Header> decoded
+        = decode_response_header(std::span { prefix }.subspan(frame_size_size));
+    ASSERT_TRUE(decoded);
+    EXPECT_EQ(decoded->id, header.id);
+    EXPECT_EQ(decoded->status, header.status);
+    EXPECT_EQ(decoded->format, header.format);
+}
+
+TEST(Server_Protocol, malformed_request_header)
+{
+    Request_Prefix prefix = encode_request_prefix(
+        { .id = 1, .lang = Lang::cpp, .format = Output_Format::html, .flags = Flag::no_flags }, 0
+    );
+    const std::span<const char> payload = std::span { prefix }.subspan(frame_size_size);
+
+    EXPECT_FALSE(decode_request_header(payload.first(request_header_size - 1)));
+
+    prefix[frame_size_size + 5] = char(Output_Format::tokens) + 1;
+    EXPECT_FALSE(decode_request_header(payload));
+    prefix[frame_size_size + 5] = char(Output_Format::html);
+
+    prefix[frame_size_size + 7] = 1;
+    EXPECT_FALSE(decode_request_header(payload));
+    prefix[frame_size_size + 7] = 0;
+
+    EXPECT_TRUE(decode_request_header(payload));
+}
+
+} // namespace
+} // namespace ulight::server
@@ -0,0 +1,81 @@
+#include <cstddef>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include <gtest/gtest.h>
+
+#include "ulight/impl/simd.hpp"
+#include "ulight/impl/unicode.hpp"
+
+namespace ulight::simd {
+namespace {
+
+TEST(SIMD, find_any)
+{
+    EXPECT_EQ(find_any<u8'<'>(u8""), std::u8string_view::npos);
+    EXPECT_EQ((find_any<u8'<', u8'&'>(u8"a < b")), 2);
+    EXPECT_EQ(
+        (find_any<u8'<', u8'&'>(u8"no special characters in here at all")),
+        std::u8string_view::npos
+    );
+
+    // Every position, both within and after the vectorized part,
+    // and with the match at every offset within a vector.
+    for (std::size_t length = 0; length <= 3 * vector_size; ++length) {
+        for (std::size_t pos = 0; pos < length; ++pos) {
+            std::u8string str(length, u8'x');
+            str[pos] = u8'&';
+            EXPECT_EQ((find_any<u8'<', u8'>', u8'&'>(str)), pos);
+            str[pos] = u8'>';
+            EXPECT_EQ((find_any<u8'<', u8'>', u8'&'>(str)), pos);
+        }
+    }
+}
+
+TEST(SIMD, find_any_random)
+{
+    std::default_random_engine rng { 12345 };
+    std::uniform_int_distribution<int> byte_distribution { 0, 255 };
+    std::uniform_int_distribution<std::size_t> length_distribution { 0, 100 };
+    for (int i = 0; i < 1000; ++i) {
+        std::u8string str(length_distribution(rng), u8'\0');
+        for (char8_t& c : str) {
+            // Mostly bytes that do not match, so that matches occur late.
+            c = char8_t(byte_distribution(rng) % 16 == 0 ? u8'{' : byte_distribution(rng) | 0x80);
+        }
+        EXPECT_EQ((find_any<u8'{', u8'}'>(str)), str.find_first_of(u8"{}"));
+    }
+}
+
+TEST(SIMD, ascii_prefix_length)
+{
+    EXPECT_EQ(ascii_prefix_length(u8""), 0);
+    EXPECT_EQ(ascii_prefix_length(u8"awoo"), 4);
+    EXPECT_EQ(ascii_prefix_length(u8"ä"), 0);
+
+    for (std::size_t length = 0; length <= 3 * vector_size; ++length) {
+        const std::u8string ascii(length, u8'\x7f');
+        EXPECT_EQ(ascii_prefix_length(ascii), length);
+        for (std::size_t pos = 0; pos < length; ++pos) {
+            std::u8string str = ascii;
+            str[pos] = u8'\x80';
+            EXPECT_EQ(ascii_prefix_length(str), pos);
+        }
+    }
+}
+
+TEST(SIMD, utf8_is_valid_after_ascii)
+{
+    // Validation skips over ASCII in bulk,
+    // so errors must still be found after long runs of it, and at the very end.
+    const std::u8string ascii(3 * vector_size + 1, u8'a');
+    EXPECT_TRUE(utf8::is_valid(ascii));
+    EXPECT_TRUE(utf8::is_valid(ascii + u8"ä" + ascii));
+    EXPECT_FALSE(utf8::is_valid(ascii + u8'\x80'));
+    EXPECT_FALSE(utf8::is_valid(ascii + u8'\xC3'));
+    EXPECT_FALSE(utf8::is_valid(ascii + u8"ä" + ascii + u8'\xFF' + ascii));
+}
+
+} // namespace
+} // namespace ulight::simd
@@ -0,0 +1,168 @@
+#include <cstddef>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ulight/impl/string_diff.hpp"
+
+namespace ulight {
+namespace {
+
+/// @brief Computes the length of the longest common subsequence with a full table,
+/// which the number of common elements in a shortest edit script must be equal to.
+[[nodiscard]]
+std::size_t brute_force_lcs(
+    std::span<const std::u8string_view> from,
+    std::span<const std::u8string_view> to
+)
+{
+    std::vector<std::vector<std::size_t>> table(
+        from.size() + 1, std::vector<std::size_t>(to.size() + 1)
+    );
+    for (std::size_t i = 1; i <= from.size(); ++i) {
+        for (std::size_t j = 1; j <= to.size(); ++j) {
+            table[i][j] = from[i - 1] == to[j - 1]
+                ? table[i - 1][j - 1] + 1
+                : std::max(table[i - 1][j], table[i][j - 1]);
+        }
+    }
+    return table[from.size()][to.size()];
+}
+
+/// @brief Checks that `edits` converts `from` into `to`,
+/// and that deletions precede insertions within every run of changes.
+/// @returns The number of common elements.
+[[nodiscard]]
+std::size_t verify_edit_script(
+    std::span<const Edit_Type> edits,
+    std::span<const std::u8string_view> from,
+    std::span<const std::u8string_view> to
+)
+{
+    std::size_t i = 0;
+    std::size_t j = 0;
+    std::size_t common = 0;
+    Edit_Type previous = Edit_Type::common;
+    for (const Edit_Type e : edits) {
+        switch (e) {
+        case Edit_Type::common: {
+            EXPECT_TRUE(i < from.size() && j < to.size() && from[i] == to[j]);
+            ++i;
+            ++j;
+            ++common;
+            break;
+        }
+        case Edit_Type::del: {
+            EXPECT_NE(previous, Edit_Type::ins);
+            ++i;
+            break;
+        }
+        case Edit_Type::ins: {
+            ++j;
+            break;
+        }
+        }
+        previous = e;
+    }
+    EXPECT_EQ(i, from.size());
+    EXPECT_EQ(j, to.size());
+    return common;
+}
+
+TEST(String_Diff, shortest_edit_script_simple)
+{
+    const std::u8string_view from[] { u8"a", u8"b", u8"c", u8"a", u8"b", u8"b", u8"a" };
+    const std::u8string_view to[] { u8"c", u8"b", u8"a", u8"b", u8"a", u8"c" };
+    const std::vector<Edit_Type> edits = shortest_edit_script(from, to);
+    // The example from Myers' paper, which has an edit distance of 5.
+    EXPECT_EQ(verify_edit_script(edits, from, to), 4);
+    EXPECT_EQ(edits.size(), 9);
+
+    EXPECT_TRUE(shortest_edit_script({}, {}).empty());
+    EXPECT_EQ(shortest_edit_script(from, {}), std::vector<Edit_Type>(7, Edit_Type::del));
+    EXPECT_EQ(shortest_edit_script({}, to), std::vector<Edit_Type>(6, Edit_Type::ins));
+}
+
+TEST(String_Diff, shortest_edit_script_random)
+{
+    // Small alphabets produce many equal elements and thus many alternative paths.
+    static constexpr std::u8string_view alphabet[] { u8"a", u8"b", u8"c", u8"d" };
+    std::default_random_engine rng { 12345 };
+    std::uniform_int_distribution<std::size_t> length_distribution { 0, 40 };
+
+    for (int iteration = 0; iteration < 2000; ++iteration) {
+        std::uniform_int_distribution<std::size_t> symbol_distribution {
+            0, std::size(alphabet) - 1 - std::size_t(iteration % 3)
+        };
+        std::vector<std::u8string_view> from(length_distribution(rng));
+        std::vector<std::u8string_view> to(length_distribution(rng));
+        for (auto& s : from) {
+            s = alphabet[symbol_distribution(rng)];
+        }
+        for (auto& s : to) {
+            s = alphabet[symbol_distribution(rng)];
+        }
+
+        const std::vector<Edit_Type> edits = shortest_edit_script(from, to);
+        EXPECT_EQ(verify_edit_script(edits, from, to), brute_force_lcs(from, to));
+    }
+}
+
+TEST(String_Diff, shortest_edit_script_large)
+{
+    // A golden file of 100k lines with a few changed lines would need a table of
+    // 10^10 entries with a quadratic algorithm, but is instant with Myers' algorithm.
+    std::vector<std::string> storage;
+    for (std::size_t i = 0; i < 100'000; ++i) {
+        storage.push_back("line " + std::to_string(i));
+    }
+    std::vector<std::u8string_view> from;
+    for (const std::string& line : storage) {
+        from.push_back({ reinterpret_cast<const char8_t*>(line.data()), line.size() });
+    }
+    std::vector<std::u8string_view> to = from;
+    to.erase(to.begin() + 100);
+    to.insert(to.begin() + 50'000, u8"inserted");
+    to[70'000] = u8"changed";
+
+    const std::vector<Edit_Type> edits = shortest_edit_script(from, to);
+    EXPECT_EQ(verify_edit_script(edits, from, to), from.size() - 2);
+    EXPECT_EQ(edits.size(), from.size() + 2);
+
+    // Instead of timing the search, check that it needs no more than the 4 edits
+    // (the erased line, the inserted line, and the deletion and insertion of the changed line).
+    // Myers' algorithm takes O((N + M) * D) time for D edits, so this bounds the work done.
+    std::vector<Edit_Type> bounded;
+    EXPECT_FALSE(shortest_edit_script<std::u8string_view>(bounded, from, to, 3));
+    EXPECT_TRUE(bounded.empty());
+    EXPECT_TRUE(shortest_edit_script<std::u8string_view>(bounded, from, to, 4));
+    EXPECT_EQ(bounded, edits);
+}
+
+TEST(String_Diff, shortest_edit_script_max_edits)
+{
+    const std::vector<std::u8string_view> from { u8"a", u8"b", u8"c", u8"d" };
+    const std::vector<std::u8string_view> to { u8"a", u8"x", u8"c", u8"y" };
+    const std::vector<Edit_Type> previous { Edit_Type::common };
+
+    std::vector<Edit_Type> edits = previous;
+    EXPECT_TRUE(shortest_edit_script<std::u8string_view>(edits, from, to, 4));
+    EXPECT_EQ(edits.size(), 7);
+    EXPECT_EQ(verify_edit_script(std::span(edits).subspan(1), from, to), 2);
+
+    // On failure, the output is left as it was.
+    edits = previous;
+    EXPECT_FALSE(shortest_edit_script<std::u8string_view>(edits, from, to, 3));
+    EXPECT_EQ(edits, previous);
+    EXPECT_FALSE(shortest_edit_script<std::u8string_view>(edits, from, to, 0));
+    EXPECT_EQ(edits, previous);
+    EXPECT_TRUE(shortest_edit_script<std::u8string_view>(edits, from, from, 0));
+    EXPECT_EQ(edits.size(), 5);
+}
+
+} // namespace
+} // namespace ulight
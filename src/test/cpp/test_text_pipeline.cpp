@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "ulight/text_pipeline.hpp"
+#include "ulight/ulight.hpp"
+
+namespace ulight {
+namespace {
+
+using namespace std::literals;
+
+TEST(Text_Pipeline, submit_preserves_order)
+{
+    std::string consumed;
+    const auto sink = [&](const char* text, std::size_t length) { consumed.append(text, length); };
+    {
+        Text_Pipeline pipeline { sink, 4, 2 };
+        pipeline.submit(std::span { "abc"sv });
+        pipeline.submit(std::span { "defghijkl"sv });
+        pipeline.submit(std::span { "m"sv });
+    }
+    ASSERT_EQ(consumed, "abcdefghijklm");
+}
+
+TEST(Text_Pipeline, slow_sink_applies_back_pressure)
+{
+    std::string consumed;
+    std::size_t calls = 0;
+    const auto sink = [&](const char* text, std::size_t length) {
+        std::this_thread::sleep_for(1ms);
+        consumed.append(text, length);
+        ++calls;
+    };
+    Text_Pipeline pipeline { sink, 1, 3 };
+    for (char c = 'a'; c <= 'z'; ++c) {
+        pipeline.submit({ &c, 1 });
+    }
+    pipeline.finish();
+    ASSERT_EQ(consumed, "abcdefghijklmnopqrstuvwxyz");
+    ASSERT_EQ(calls, 26);
+}
+
+TEST(Text_Pipeline, source_to_html_matches_synchronous_output)
+{
+    static constexpr std::u8string_view source = u8"int main() {\n"
+                                                 u8"    // comment with <angle> brackets\n"
+                                                 u8"    return 1 < 2 && 3 > 2;\n"
+                                                 u8"}\n";
+
+    Token token_buffer[8];
+
+    std::string expected;
+    {
+        char text_buffer[16];
+        const auto append = [&](char* text, std::size_t length) { expected.append(text, length); };
+
+        State state;
+        state.set_source(source);
+        state.set_lang(Lang::cpp);
+        state.set_token_buffer(token_buffer);
+        state.set_text_buffer(text_buffer);
+        state.on_flush_text(append);
+        ASSERT_EQ(state.source_to_html(), Status::ok);
+    }
+
+    for (const std::size_t buffer_count : { 1uz, 2uz, 4uz }) {
+        std::string actual;
+        const auto sink = [&](const char* text, std::size_t length) { actual.append(text, length); };
+
+        Text_Pipeline pipeline { sink, 16, buffer_count };
+        State state;
+        state.set_source(source);
+        state.set_lang(Lang::cpp);
+        state.set_token_buffer(token_buffer);
+        pipeline.attach(state);
+        ASSERT_EQ(state.source_to_html(), Status::ok);
+        pipeline.finish();
+
+        EXPECT_EQ(actual, expected);
+    }
+}
+
+} // namespace
+} // namespace ulight
@@ -0,0 +1,75 @@
+#include <cstddef>
+#include <cstdio>
+#include <string_view>
+
+#include <gtest/gtest.h>
+
+#include "ulight/impl/trace.hpp"
+#include "ulight/ulight.hpp"
+
+namespace ulight {
+namespace {
+
+struct Rule_Row {
+    unsigned long long attempts;
+    unsigned long long hits;
+};
+
+/// @brief Returns the row of `trace::dump_rules` for the rule whose name contains `name`
+/// and whose location contains `file`, or `{ 0, 0 }` if there is no such row.
+[[nodiscard]]
+Rule_Row find_rule(std::string_view name, std::string_view file)
+{
+    std::FILE* const out = std::tmpfile();
+    if (!out) {
+        ADD_FAILURE() << "Failed to create temporary file.";
+        return {};
+    }
+    trace::dump_rules(out);
+    std::rewind(out);
+
+    Rule_Row result {};
+    char line[1024];
+    while (std::fgets(line, sizeof(line), out)) {
+        const std::string_view row { line };
+        // The rule name occupies the first 40 columns, followed by a space.
+        if (row.size() <= 41 || row.substr(0, 40).find(name) == std::string_view::npos
+            || row.find(file) == std::string_view::npos) {
+            continue;
+        }
+        Rule_Row found {};
+        if (std::sscanf(line + 41, "%llu %llu", &found.attempts, &found.hits) == 2) {
+            result.attempts += found.attempts;
+            result.hits += found.hits;
+        }
+    }
+    std::fclose(out);
+    return result;
+}
+
+TEST(Trace, nested_language_rules_of_highlighter_base)
+{
+    static constexpr std::u8string_view source
+        = u8"<style>b { color: red; }</style>\n<script>let x = 1;</script>\n";
+
+    Token token_buffer[16];
+    State state;
+    state.set_source(source);
+    state.set_lang(Lang::html);
+    state.set_token_buffer(token_buffer);
+    state.on_flush_tokens([](Token*, std::size_t) { });
+
+    trace::reset_rules();
+    ASSERT_EQ(state.source_to_tokens(), Status::ok);
+
+    const Rule_Row nonempty = find_rule("consume_nested_language_nonempty", "highlighter.hpp");
+    EXPECT_EQ(nonempty.attempts, 2);
+    EXPECT_EQ(nonempty.hits, 2);
+
+    const Rule_Row nested = find_rule("highlight(nested_out", "highlighter.hpp");
+    EXPECT_EQ(nested.attempts, 2);
+    EXPECT_EQ(nested.hits, 2);
+}
+
+} // namespace
+} // namespace ulight
@@ -4,6 +4,7 @@
 #include <iterator>
 #include <memory_resource>
 #include <random>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -83,5 +84,47 @@ TEST(Unicode, encode_decode_reversible_fuzzing)
     }
 }
 
+TEST(Unicode, utf16_to_utf8)
+{
+    static constexpr std::u16string_view utf16 = u"a\u00e4\u20ac\U0001F600z";
+    static constexpr std::u8string_view utf8 = u8"a\u00e4\u20ac\U0001F600z";
+
+    char8_t buffer[utf16.length() * utf16::max_utf8_units_per_unit];
+    const std::expected<std::size_t, std::size_t> length = utf16::to_utf8(utf16, buffer);
+    ASSERT_TRUE(length);
+    EXPECT_EQ(std::u8string_view(buffer, *length), utf8);
+    EXPECT_EQ(utf16::transcoded_length(utf8), utf16.length());
+
+    // Unpaired surrogates are reported at their position.
+    static constexpr char16_t lone_leading[] { u'a', 0xd83d, u'b' };
+    EXPECT_EQ(utf16::to_utf8({ lone_leading, 3 }, buffer), std::unexpected(1uz));
+    static constexpr char16_t lone_trailing[] { u'a', u'b', 0xde00 };
+    EXPECT_EQ(utf16::to_utf8({ lone_trailing, 3 }, buffer), std::unexpected(2uz));
+    static constexpr char16_t truncated_pair[] { u'a', 0xd83d };
+    EXPECT_EQ(utf16::to_utf8({ truncated_pair, 2 }, buffer), std::unexpected(1uz));
+}
+
+TEST(Unicode, utf16_transcoded_length_fuzzing)
+{
+    constexpr int iterations = 10'000;
+
+    std::default_random_engine rng { 12345 };
+    std::uniform_int_distribution<std::uint32_t> distr { 0, code_point_max };
+
+    std::u8string utf8;
+    std::size_t expected_length = 0;
+    for (int i = 0; i < iterations; ++i) {
+        // Mostly ASCII, so that both the vectorized and the scalar paths are exercised.
+        const char32_t code_point = i % 8 == 0 ? distr(rng) : U'a' + char32_t(i % 26);
+        if (!is_scalar_value(code_point)) {
+            continue;
+        }
+        const Code_Units_And_Length encoded = encode8_unchecked(code_point);
+        utf8.append(encoded.begin(), encoded.end());
+        expected_length += code_point >= 0x10000 ? 2 : 1;
+    }
+    EXPECT_EQ(utf16::transcoded_length(utf8), expected_length);
+}
+
 } // namespace
 } // namespace ulight::utf8
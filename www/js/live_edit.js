@@ -15,7 +15,7 @@ import {
 } from "./live_edit_core.js";
 
 import {
-    loadWasm
+    UlightWorker
 } from "./ulight.js";
 
 const whileDraggingClass = 'while-dragging';
@@ -54,31 +54,42 @@ function setVisibleLineNumbers(e, n) {
     e.textContent = arr.join('\n');
 }
 
-function onCodeInput(persist) {
+/**
+ * Highlights the input in the worker, and displays the result.
+ * If more input arrives while the worker is busy, the result for this input is never displayed.
+ * @param {boolean} persist
+ */
+async function onCodeInput(persist) {
+    const source = codeInput.value;
     if (persist) {
-        localStorage.setItem(editorContentsItem, codeInput.value);
+        localStorage.setItem(editorContentsItem, source);
     }
 
+    let result;
     try {
         const languageId = Number(languageIdSelect.value);
-        const highlightedInput = wasm.toHtml(codeInput.value, languageId);
-        setVisibleLineNumbers(inputLineNumbers, highlightedInput.count('\n') + 1);
-        codeHighlight.innerHTML = highlightedInput;
-
-        const highlightedOutput = wasm.toHtml(highlightedInput, "html");
-        output.innerHTML = highlightedOutput;
-        setVisibleLineNumbers(outputLineNumbers, highlightedOutput.count('\n') + 1);
+        result = await highlighter.highlight(source, languageId, 0, true);
     } catch (e) {
-        setVisibleLineNumbers(inputLineNumbers, codeInput.value.count('\n') + 1);
-        codeHighlight.textContent = codeInput.value;
+        setVisibleLineNumbers(inputLineNumbers, source.count('\n') + 1);
+        codeHighlight.textContent = source;
         output.textContent = `Error: ${e.message}\n\n${e.stack}`;
         return;
     }
+    if (result === null) {
+        return;
+    }
+    setVisibleLineNumbers(inputLineNumbers, source.count('\n') + 1);
+    codeHighlight.innerHTML = result.html;
+
+    // The output is the HTML highlighted as HTML,
+    // which is built from the same tokens rather than by highlighting the HTML again.
+    output.innerHTML = result.htmlSource;
+    setVisibleLineNumbers(outputLineNumbers, result.html.count('\n') + 1);
 }
 
 function setLanguageOptions() {
     const map = new Map();
-    const langs = wasm.getLanguageList();
+    const langs = highlighter.languages;
     for (const { displayName, id } of langs) {
         map.set(id, displayName);
     }
@@ -251,7 +262,7 @@ splitHorizontalButton.addEventListener('click', (e) => {
 
 // =================================================================================================
 
-const wasm = await loadWasm();
+const highlighter = await UlightWorker.create({ split: true });
 
 codeInput.addEventListener('input', () => onCodeInput(true));
 languageIdSelect.addEventListener('change', () => onCodeInput(true));
@@ -259,5 +270,5 @@ languageIdSelect.addEventListener('input', () => setLanguageId(languageIdSelect.
 themePicker.addEventListener('input', () => setTheme(themePicker.value, true));
 
 setLanguageOptions();
-onCodeInput(false);
+await onCodeInput(false);
 
@@ -88,74 +88,261 @@ export class UlightWasm {
     }
 
     /**
-     * 
+     * Converts source code to HTML.
+     *
+     * All buffers are owned by a session (see `ulight_session_new`) which is kept alive
+     * between calls, so repeated calls (e.g. on every keystroke) do not allocate,
+     * and the output is decoded at once rather than in chunks.
      * @param {Uint8Array|string} source
      * The source code to HTML, either provided as a UTF-8-encoded `Uint8Array`,
-     * or as a `string` which is encoded on the fly.
-     * @param {number|string} id The language short name or numeric id. 
+     * or as a `string` which is encoded directly into WASM memory.
+     * @param {number|string} id The language short name or numeric id.
+     * If the module was loaded with `loadWasm({ split: true })`,
+     * the language has to be loaded with `ensureLanguage` first.
+     * @param {number} flags A combination of `ulight_flag` values.
      * @returns {string} The highlighted HTML.
      */
-    toHtml(source, id) {
-        const tokenSize = 12; // sizeof(ulight_token)
-        const tokenAlign = 4; // alignof(ulight_token)
-        const bufferByteSize = 64 * 1024;
-
+    toHtml(source, id, flags = 0) {
         const lang = typeof (id) === "string" ? this.getLanguageId(id) : id;
-        const sourceData = typeof (source) === "string" ? new TextEncoder().encode(source) : source;
+        const module = this._moduleOf(lang);
+        if (module !== this) {
+            return module.toHtml(source, lang, flags);
+        }
+        const session = this._getSession();
+
+        let sourceAddress;
+        let sourceLength;
+        if (typeof (source) === "string") {
+            // Every UTF-16 code unit takes at most three bytes in UTF-8.
+            const capacity = source.length * 3;
+            sourceAddress = this._reserveSource(session, capacity);
+            const view = new Uint8Array(this._memory.buffer, sourceAddress, capacity);
+            sourceLength = this._encoder.encodeInto(source, view).written;
+        } else {
+            sourceAddress = this._reserveSource(session, source.length);
+            new Uint8Array(this._memory.buffer).set(source, sourceAddress);
+            sourceLength = source.length;
+        }
 
-        this._bufferedText = "";
+        const result = this._exports.ulight_session_highlight(
+            session, sourceAddress, sourceLength, lang, flags);
+        if (result != 0) {
+            this._reportSessionError(session, "ulight_session_highlight", result);
+        }
 
-        let u8source = 0;
-        let tokenBuffer = 0;
-        let textBuffer = 0;
-        let state = 0;
-        try {
-            u8source = this._allocBytes(sourceData);
-            tokenBuffer = this._alloc(bufferByteSize, tokenAlign);
-            textBuffer = this._alloc(bufferByteSize, 1);
-            state = this._newState();
-
-            const heap32 = new Int32Array(this._memory.buffer);
-            heap32[state / 4 + 0] = u8source;
-            heap32[state / 4 + 1] = sourceData.length;
-            heap32[state / 4 + 2] = lang;
-            heap32[state / 4 + 3] = 0; // TODO: flags
-            heap32[state / 4 + 4] = tokenBuffer;
-            heap32[state / 4 + 5] = bufferByteSize / tokenSize;
-            // 6: flush_tokens_data is added automatically
-            // 7: flush_tokens is added automatically
-            // 8: html_tag_name stays defaulted
-            // 9: html_tag_name_length stays defaulted
-            // 10: html_attr_name stays defaulted
-            // 11: html_attr_name_length stays defaulted
-            heap32[state / 4 + 12] = textBuffer;
-            heap32[state / 4 + 13] = bufferByteSize;
-            // no flush_text_data necessary
-            heap32[state / 4 + 15] = this._flushTextIndex;
-
-            const result = this._exports.ulight_source_to_html(state);
-            if (result != 0) {
-                const errorAddress = heap32[state / 4 + 16];
-                const errorLength = heap32[state / 4 + 17];
-                const error = this._loadUtf8(errorAddress, errorLength);
-                console.error(`ulight_source_to_html failed with status ${result}:`, error);
-                throw result;
-            }
-            return this._bufferedText;
-        } finally {
-            if (state) {
-                this._deleteState(state);
-            }
-            if (textBuffer) {
-                this._free(textBuffer, bufferByteSize, 1);
-            }
-            if (tokenBuffer) {
-                this._free(tokenBuffer, bufferByteSize, tokenAlign);
+        const outputAddress = this._exports.ulight_session_output(session);
+        const outputLength = this._exports.ulight_session_output_length(session);
+        return this._loadUtf8(outputAddress, outputLength);
+    }
+
+    /**
+     * Converts source code to tokens, without producing any HTML.
+     *
+     * The tokens are returned as a view into WASM memory rather than a copy,
+     * where every token is a record of `tokenRecordSize` elements:
+     * `begin`, `length`, and `type` (see `ulight_session_token_records`).
+     * These can be used for building DOM ranges, CSS Custom Highlight API ranges,
+     * or drawing onto a canvas directly, where `getHighlightTypeName` provides the same names
+     * as the `data-h` attributes in HTML.
+     *
+     * The view remains valid until the next call to `toTokens` or `dispose`.
+     * It is also detached if WASM memory grows, such as during the next conversion,
+     * so tokens that need to be kept should be copied using `slice()`.
+     * @param {Uint8Array|string} source
+     * The source code, either provided as a UTF-8-encoded `Uint8Array`,
+     * where token positions are measured in bytes,
+     * or as a `string`, where token positions are measured in UTF-16 code units,
+     * i.e. they can be used as string indices directly.
+     * Strings containing unpaired surrogates are rejected (`ULIGHT_STATUS_BAD_TEXT`).
+     * @param {number|string} id The language short name or numeric id,
+     * which has to be loaded with `ensureLanguage` first, like for `toHtml`.
+     * @param {number} flags A combination of `ulight_flag` values.
+     * @returns {Uint32Array} The token records.
+     */
+    toTokens(source, id, flags = 0) {
+        const lang = typeof (id) === "string" ? this.getLanguageId(id) : id;
+        const module = this._moduleOf(lang);
+        if (module !== this) {
+            return module.toTokens(source, lang, flags);
+        }
+        const session = this._getSession();
+
+        let result;
+        if (typeof (source) === "string") {
+            // The code units of the string are copied as-is, without transcoding to UTF-8.
+            const sourceAddress = this._reserveSource(session, source.length * 2);
+            const view = new Uint16Array(this._memory.buffer, sourceAddress, source.length);
+            for (let i = 0; i < source.length; ++i) {
+                view[i] = source.charCodeAt(i);
             }
-            if (u8source) {
-                this._free(u8source, sourceData.length, 1);
+            result = this._exports.ulight_session_tokens_utf16(
+                session, sourceAddress, source.length, lang, flags);
+        } else {
+            const sourceAddress = this._reserveSource(session, source.length);
+            new Uint8Array(this._memory.buffer).set(source, sourceAddress);
+            result = this._exports.ulight_session_tokens(
+                session, sourceAddress, source.length, lang, flags);
+        }
+        if (result != 0) {
+            this._reportSessionError(session, "ulight_session_tokens", result);
+        }
+
+        const recordsAddress = this._exports.ulight_session_token_records(session);
+        const count = this._exports.ulight_session_token_count(session);
+        return new Uint32Array(this._memory.buffer, recordsAddress, count * tokenRecordSize);
+    }
+
+    /**
+     * Returns the short name of a highlight type, such as `"kw"` for keywords,
+     * which is also used for the `data-h` attribute in HTML.
+     * @param {number} type The numeric highlight type, e.g. taken from `toTokens`.
+     * @returns {string}
+     */
+    getHighlightTypeName(type) {
+        let name = this._typeNames.get(type);
+        if (name === undefined) {
+            // ulight_string_view is returned through a pointer to memory provided by the caller.
+            const resultAddress = this._alloc(8, 4);
+            try {
+                this._exports.ulight_highlight_type_short_string(resultAddress, type);
+                const heap32 = new Int32Array(this._memory.buffer);
+                name = this._loadUtf8(heap32[resultAddress / 4], heap32[resultAddress / 4 + 1]);
+            } finally {
+                this._free(resultAddress, 8, 4);
             }
+            this._typeNames.set(type, name);
+        }
+        return name;
+    }
+
+    /**
+     * Ensures that the given language can be highlighted.
+     *
+     * If the module was loaded with `loadWasm({ split: true })`,
+     * only JSON and plain text are built into it,
+     * and the module containing any other language is fetched and instantiated on first use,
+     * and cached afterwards.
+     * Otherwise, every language is available, and this function does nothing.
+     * @param {number|string} id The language short name or numeric id.
+     * @returns {Promise<void>}
+     */
+    async ensureLanguage(id) {
+        const lang = typeof (id) === "string" ? this.getLanguageId(id) : id;
+        const name = this._split?.moduleNames.get(lang);
+        if (name === undefined) {
+            return;
+        }
+        let module = this._split.modules.get(name);
+        if (module === undefined) {
+            module = this._split.fetchModule(name);
+            this._split.modules.set(name, module);
+        }
+        try {
+            const loaded = await module;
+            loaded.setCancellation(this._isCancelled);
+            this._split.loaded.set(name, loaded);
+        } catch (e) {
+            // Failed fetches are not cached, so that they can be retried.
+            this._split.modules.delete(name);
+            throw e;
+        }
+    }
+
+    /**
+     * Makes `toHtml` and `toTokens` stop early once `isCancelled` returns `true`,
+     * which is polled regularly during highlighting (see `ulight_state::is_cancelled`).
+     * A cancelled conversion throws `statusCancelled`.
+     *
+     * This is mostly useful when highlighting in a worker,
+     * where `isCancelled` can read a flag in a `SharedArrayBuffer`
+     * that is set by the main thread once the result is no longer needed.
+     * @param {(() => boolean)|null} isCancelled
+     * The function to poll, or `null` if highlighting should never be cancelled.
+     */
+    setCancellation(isCancelled) {
+        this._isCancelled = isCancelled;
+        if (isCancelled !== null && this._isCancelledIndex === 0) {
+            // JS functions cannot be put into the function table directly,
+            // only functions exported by other WASM modules (see src/main/wasm/README.md).
+            const module = new WebAssembly.Module(functionModuleI32ToI32);
+            const instance = new WebAssembly.Instance(module, {
+                m: { f: () => this._isCancelled?.() ? 1 : 0 }
+            });
+            this._isCancelledIndex = this._functionTable.grow(1);
+            this._functionTable.set(this._isCancelledIndex, instance.exports.f);
+        }
+        if (this._session) {
+            this._applyCancellation(this._session);
+        }
+        for (const module of this._split?.loaded.values() ?? []) {
+            module.setCancellation(isCancelled);
+        }
+    }
+
+    /**
+     * Frees the session used by `toHtml` and `toTokens`, if any,
+     * including those of modules loaded by `ensureLanguage`.
+     * The sessions are recreated on the next call to either of these.
+     */
+    dispose() {
+        if (this._session) {
+            this._exports.ulight_session_delete(this._session);
+            this._session = 0;
+        }
+        for (const module of this._split?.loaded.values() ?? []) {
+            module.dispose();
+        }
+    }
+
+    /**
+     * Switches this module to split mode, where it only highlights JSON and plain text itself,
+     * and where other languages are delegated to the modules loaded by `ensureLanguage`.
+     * @param {(name:string) => Promise<UlightWasm>} fetchModule
+     * Fetches and initializes `ulight-${name}.wasm`.
+     */
+    _enableSplit(fetchModule) {
+        const moduleNames = new Map();
+        for (const [lang, name] of Object.entries(splitModules)) {
+            moduleNames.set(this.getLanguageId(lang), name);
         }
+        this._split = { moduleNames, fetchModule, modules: new Map(), loaded: new Map() };
+    }
+
+    /**
+     * @param {number} lang The numeric language id.
+     * @returns {UlightWasm} The module which highlights `lang`, which is usually `this`.
+     * @throws If the module is split, and the language has not been loaded.
+     */
+    _moduleOf(lang) {
+        const name = this._split?.moduleNames.get(lang);
+        if (name === undefined) {
+            return this;
+        }
+        const module = this._split.loaded.get(name);
+        if (module === undefined) {
+            throw new Error(`Language ${lang} is not loaded yet; await ensureLanguage(${lang}).`);
+        }
+        return module;
+    }
+
+    /**
+     * Logs and throws the error of a failed session function.
+     * @param {number} session The address of the session.
+     * @param {string} functionName The name of the function that failed.
+     * @param {number} status The `ulight_status` returned by that function.
+     * @throws {number} Always throws `status`.
+     */
+    _reportSessionError(session, functionName, status) {
+        if (status === statusCancelled) {
+            throw status;
+        }
+        const heap32 = new Int32Array(this._memory.buffer);
+        const state = this._exports.ulight_session_state(session);
+        const errorAddress = heap32[state / 4 + 16];
+        const errorLength = heap32[state / 4 + 17];
+        const error = this._loadUtf8(errorAddress, errorLength);
+        console.error(`${functionName} failed with status ${status}:`, error);
+        throw status;
     }
 
     /**
@@ -165,10 +352,9 @@ export class UlightWasm {
      * @returns {string} The decoded string.
      */
     _loadUtf8(address, length) {
-        const wasmMemoryView = new Uint8Array(this._memory.buffer);
-        const utf8Bytes = wasmMemoryView.slice(address, address + length);
-        const decoder = new TextDecoder("utf-8", { fatal: true });
-        return decoder.decode(utf8Bytes);
+        // Decoding directly from a view into WASM memory avoids copying the bytes first.
+        const utf8Bytes = new Uint8Array(this._memory.buffer, address, length);
+        return this._decoder.decode(utf8Bytes);
     }
 
     /**
@@ -179,7 +365,7 @@ export class UlightWasm {
      * @see _freeUtf8
      */
     _allocUtf8(str) {
-        const data = new TextEncoder().encode(str);
+        const data = this._encoder.encode(str);
         const address = this._allocBytes(data);
         return { address, size: data.length };
     }
@@ -214,7 +400,7 @@ export class UlightWasm {
     _alloc(size, alignment) {
         const result = this._exports.ulight_alloc(size, alignment);
         if (result === 0) {
-            throw new Error(`Allocation failure in WASM with: bytes=${bytes}, align=${alignment}`);
+            throw new Error(`Allocation failure in WASM with: bytes=${size}, align=${alignment}`);
         }
         return result;
     }
@@ -248,13 +434,46 @@ export class UlightWasm {
     }
 
     /**
-     * @param {WebAssembly.ExportValue} flushText 
+     * @returns {number} The address of the session used by `toHtml` and `toTokens`,
+     * which is created on first use.
+     * @throws If allocation failed.
      */
-    _addCallbacks(flushText) {
-        const index = this._functionTable.length;
-        this._functionTable.grow(2);
-        this._functionTable.set(index, flushText);
-        this._flushTextIndex = index;
+    _getSession() {
+        if (!this._session) {
+            this._session = this._exports.ulight_session_new();
+            if (this._session === 0) {
+                throw new Error("Allocation failure in ulight_session_new.");
+            }
+            this._applyCancellation(this._session);
+        }
+        return this._session;
+    }
+
+    /**
+     * Sets the `is_cancelled` members of the state of `session`
+     * according to the most recent call to `setCancellation`.
+     * @param {number} session The address of the session.
+     */
+    _applyCancellation(session) {
+        const heap32 = new Int32Array(this._memory.buffer);
+        const state = this._exports.ulight_session_state(session);
+        // is_cancelled_data is unused because the callback is a closure.
+        heap32[state / 4 + 20] = 0;
+        heap32[state / 4 + 21] = this._isCancelled === null ? 0 : this._isCancelledIndex;
+    }
+
+    /**
+     * @param {number} session The address of the session.
+     * @param {number} length The number of bytes to reserve.
+     * @returns {number} The address of the source buffer within the session.
+     * @throws If allocation failed.
+     */
+    _reserveSource(session, length) {
+        const result = this._exports.ulight_session_reserve_source(session, length);
+        if (result === 0) {
+            throw new Error(`Allocation failure in ulight_session_reserve_source: bytes=${length}`);
+        }
+        return result;
     }
 
     async init() {
@@ -263,22 +482,13 @@ export class UlightWasm {
         } else {
             console.warn('module has no export _initialize');
         }
-
-        const flushTextFunction = (_, textAddress, textLength) => {
-            const str = this._loadUtf8(textAddress, textLength);
-            this._bufferedText += str;
-        };
-        const flushTextModule = await fetchBytes('f_i32_i32_i32_to_void.wasm')
-            .then(bytes => WebAssembly.compile(bytes));
-        const flushTextImports = { m: { f: flushTextFunction } };
-        const flushTextInstance = await WebAssembly.instantiate(flushTextModule, flushTextImports);
-
-        this._addCallbacks(flushTextInstance.exports.f);
-    }
-
-    /** @returns {WebAssembly.Table} */
-    get _functionTable() {
-        return this._exports.__indirect_function_table;
+        this._encoder = new TextEncoder();
+        this._decoder = new TextDecoder("utf-8", { fatal: true });
+        this._session = 0;
+        this._typeNames = new Map();
+        this._split = null;
+        this._isCancelled = null;
+        this._isCancelledIndex = 0;
     }
 
     /** @returns {WebAssembly.Memory} */
@@ -295,43 +505,345 @@ export class UlightWasm {
     get _exports() {
         return this.wasm.instance.exports;
     }
+
+    /** @returns {WebAssembly.Table} */
+    get _functionTable() {
+        return this._exports.__indirect_function_table;
+    }
 }
 
 /**
- * Loads the WebAssembly module.
- * @returns {Promise<UlightWasm>}
+ * A highlighter which runs ulight in a Web Worker (see `ulight_worker.js`),
+ * so that highlighting large documents does not block the main thread.
+ *
+ * At most one request is processed by the worker at a time.
+ * When a new request is made while the worker is busy,
+ * the request in progress is cancelled, and any request that is still waiting is dropped,
+ * so that e.g. an editor only ever waits for the result of the latest keystroke.
+ * In-progress requests can only be cancelled if `SharedArrayBuffer` is available,
+ * i.e. if the page is cross-origin isolated;
+ * otherwise, they run to completion, and only waiting requests are dropped.
  */
-export async function loadWasm() {
-    // The implementations of these functions we provide don't actually match the WASI
-    // requirements (https://wasix.org/docs/api-reference).
-    // This is actually okay because we don't expect these functions to ever be called;
-    // they are simply stuff that dead code elimination missed.
-    const importObject = {
-        env: {
-            emscripten_notify_memory_growth() { }
-        },
-        wasi_snapshot_preview1: {
-            clock_time_get() { },
-            proc_exit() { },
-            fd_close() { },
-            fd_write() { },
-            fd_seek() { },
-            fd_read() { },
-            environ_sizes_get() { },
-            environ_get() { }
-        }
-    };
-    const resultWasm = await WebAssembly.instantiateStreaming(fetch("ulight.wasm"), importObject);
-    const result = new UlightWasm(resultWasm);
+export class UlightWorker {
+    /**
+     * Starts the worker and waits until it has loaded ulight.
+     * @param {{split?:boolean}} options Passed on to `loadWasm` within the worker.
+     * @returns {Promise<UlightWorker>}
+     */
+    static async create({ split = true } = {}) {
+        const result = new UlightWorker();
+        const ready = new Promise((resolve, reject) => {
+            result._worker.onmessage = ({ data }) => {
+                if (data.type === "ready") {
+                    result.languages = data.languages;
+                    result._worker.onmessage = e => result._onMessage(e.data);
+                    resolve(result);
+                } else {
+                    reject(new Error(data.message));
+                }
+            };
+        });
+        result._worker.postMessage({ type: "init", cancelFlag: result._cancelFlag, split });
+        return ready;
+    }
+
+    constructor() {
+        const url = new URL("./ulight_worker.js", import.meta.url);
+        this._worker = new Worker(url, { type: "module" });
+        /** @type {Int32Array|null} */
+        this._cancelFlag = globalThis.crossOriginIsolated
+            ? new Int32Array(new SharedArrayBuffer(4))
+            : null;
+        this._nextId = 1;
+        this._active = null;
+        this._waiting = null;
+        /**
+         * The list of languages, like `UlightWasm.getLanguageList`.
+         * @type {{name:string;displayName:string;id:number;}[]}
+         */
+        this.languages = [];
+    }
+
+    /**
+     * Highlights `source` in the worker.
+     * @param {string} source The source code.
+     * @param {number} lang The numeric language id.
+     * @param {number} flags A combination of `ulight_flag` values.
+     * @param {boolean} withHtmlSource If `true`, the result also contains `htmlSource`,
+     * which is the HTML highlighted as HTML (see `tokensToHtml`).
+     * @returns {Promise<{html:string;htmlSource?:string}|null>}
+     * The result, or `null` if the request was superseded by a newer one.
+     * @throws {Error} If highlighting failed.
+     */
+    highlight(source, lang, flags = 0, withHtmlSource = false) {
+        this._waiting?.resolve(null);
+        const message = { type: "highlight", id: 0, source, lang, flags, withHtmlSource };
+        const result = new Promise((resolve, reject) => {
+            this._waiting = { message, resolve, reject };
+        });
+        if (this._active === null) {
+            this._sendWaiting();
+        } else if (this._cancelFlag !== null) {
+            Atomics.store(this._cancelFlag, 0, 1);
+        }
+        return result;
+    }
+
+    /** Terminates the worker. Requests that have not completed yet never complete. */
+    terminate() {
+        this._worker.terminate();
+    }
+
+    _sendWaiting() {
+        this._active = this._waiting;
+        this._waiting = null;
+        if (this._active === null) {
+            return;
+        }
+        // The worker is idle, so it cannot observe the flag being reset.
+        if (this._cancelFlag !== null) {
+            Atomics.store(this._cancelFlag, 0, 0);
+        }
+        this._active.message.id = this._nextId++;
+        this._worker.postMessage(this._active.message);
+    }
+
+    /**
+     * @param {{type:string;id:number;message?:string;html?:string;htmlSource?:string}} data
+     */
+    _onMessage(data) {
+        const active = this._active;
+        if (active === null || data.id !== active.message.id) {
+            return;
+        }
+        if (data.type === "error") {
+            active.reject(new Error(data.message));
+        } else if (data.type === "cancelled" || this._waiting !== null) {
+            active.resolve(null);
+        } else {
+            active.resolve({ html: data.html, htmlSource: data.htmlSource });
+        }
+        this._sendWaiting();
+    }
+}
+
+/**
+ * Builds HTML from the tokens that `UlightWasm.toTokens` returns for a `string` source,
+ * without highlighting the source again.
+ * The result is the same as that of `toHtml`,
+ * except that text outside of tokens is always HTML-escaped.
+ *
+ * If `asHtmlSource` is `true`, the result is instead the source code of that HTML,
+ * highlighted as HTML, i.e. the same as passing the former result to `toHtml(html, "html")`.
+ * This is much cheaper than actually highlighting the generated HTML,
+ * which is several times larger than the source.
+ * @param {string} source The source code that was passed to `toTokens`.
+ * @param {Uint32Array} tokens The token records.
+ * @param {(type:number) => string} getTypeName Returns the short name of a highlight type,
+ * such as `UlightWasm.getHighlightTypeName`.
+ * @param {boolean} asHtmlSource
+ * @returns {string}
+ */
+export function tokensToHtml(source, tokens, getTypeName, asHtmlSource = false) {
+    const escape = asHtmlSource ? escapeHtmlAsSource : escapeHtml;
+    const tags = asHtmlSource ? htmlSourceTags : htmlTags;
+    const tagsByType = new Map();
+    const parts = [];
+    let previousEnd = 0;
+    for (let i = 0; i < tokens.length; i += tokenRecordSize) {
+        const begin = tokens[i];
+        const end = begin + tokens[i + 1];
+        if (begin > previousEnd) {
+            parts.push(escape(source.substring(previousEnd, begin)));
+        }
+        const type = tokens[i + 2];
+        let typeTags = tagsByType.get(type);
+        if (typeTags === undefined) {
+            typeTags = tags(getTypeName(type));
+            tagsByType.set(type, typeTags);
+        }
+        const [open, close] = typeTags;
+        parts.push(open, escape(source.substring(begin, end)), close);
+        previousEnd = end;
+    }
+    if (previousEnd < source.length) {
+        parts.push(escape(source.substring(previousEnd)));
+    }
+    return parts.join("");
+}
+
+const htmlEntities = { "&": "&amp;", "<": "&lt;", ">": "&gt;" };
+
+/**
+ * @param {string} text
+ * @returns {string} `text`, HTML-escaped like `ulight_source_to_html` does.
+ */
+function escapeHtml(text) {
+    return text.replace(/[&<>]/g, c => htmlEntities[c]);
+}
+
+/**
+ * @param {string} text
+ * @returns {string} The result of `escapeHtml(text)`,
+ * HTML-escaped and highlighted as HTML, where every character reference is an escape.
+ */
+function escapeHtmlAsSource(text) {
+    return text.replace(/[&<>]/g, c => `<h- data-h=esc>${escapeHtml(htmlEntities[c])}</h->`);
+}
+
+/**
+ * @param {string} typeName The short name of a highlight type.
+ * @returns {[string, string]} The opening and closing tag of a token in HTML.
+ */
+function htmlTags(typeName) {
+    return [`<h- data-h=${typeName}>`, "</h->"];
+}
+
+/**
+ * @param {string} typeName The short name of a highlight type.
+ * @returns {[string, string]} The results of `htmlTags`, HTML-escaped and highlighted as HTML.
+ */
+function htmlSourceTags(typeName) {
+    const h = (type, text) => `<h- data-h=${type}>${text}</h->`;
+    const tagName = h("mk_tag", "h-");
+    const open = h("sym_punc", "&lt;") + tagName + " " + h("mk_attr", "data-h")
+        + h("sym_punc", "=") + h("str", typeName) + h("sym_punc", "&gt;");
+    const close = h("sym_punc", "&lt;/") + tagName + h("sym_punc", "&gt;");
+    return [open, close];
+}
+
+/**
+ * The number of `Uint32Array` elements per token returned by `UlightWasm.toTokens`,
+ * i.e. `ULIGHT_TOKEN_RECORD_SIZE`.
+ */
+export const tokenRecordSize = 3;
+
+/**
+ * The status thrown by `UlightWasm.toHtml` and `UlightWasm.toTokens` when they are cancelled,
+ * i.e. `ULIGHT_STATUS_CANCELLED`.
+ */
+export const statusCancelled = 8;
+
+/**
+ * The modules built with `-DULIGHT_WASM_SPLIT=ON` (see `CMakeLists.txt`),
+ * i.e. `ulight-${name}.wasm`, by the short names of the languages that need them.
+ * Any other language (JSON and plain text) is built into `ulight-core.wasm`.
+ */
+const splitModules = {
+    bash: "bash",
+    c: "cpp",
+    cowel: "cowel",
+    cpp: "cpp",
+    css: "css",
+    diff: "diff",
+    html: "html",
+    js: "js",
+    latex: "tex",
+    lua: "lua",
+    nasm: "nasm",
+    tex: "tex",
+    xml: "xml",
+};
+
+/**
+ * A minimal module which exports the function imported as `m.f`,
+ * taking and returning `i32` (see `src/main/wasm/f_i32_to_i32.wat`).
+ */
+const functionModuleI32ToI32 = new Uint8Array([
+    0, 97, 115, 109, 1, 0, 0, 0, 1, 6, 1, 96, 1, 127, 1, 127,
+    2, 7, 1, 1, 109, 1, 102, 0, 0, 7, 5, 1, 1, 102, 0, 0
+]);
+
+/**
+ * A minimal module containing a function which uses SIMD128 instructions
+ * (`i8x16.splat` and `i8x16.popcnt`).
+ * It only validates if the runtime supports SIMD128.
+ */
+const simdTestModule = new Uint8Array([
+    0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3,
+    2, 1, 0, 10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11
+]);
+
+/**
+ * @returns {boolean} `true` if the WebAssembly runtime supports SIMD128,
+ * and `ulight-simd.wasm` can be used.
+ */
+export function isSimdSupported() {
+    return WebAssembly.validate(simdTestModule);
+}
+
+// The implementations of these functions we provide don't actually match the WASI
+// requirements (https://wasix.org/docs/api-reference).
+// This is actually okay because we don't expect these functions to ever be called;
+// they are simply stuff that dead code elimination missed.
+export const wasmImportObject = {
+    env: {
+        emscripten_notify_memory_growth() { }
+    },
+    wasi_snapshot_preview1: {
+        clock_time_get() { },
+        proc_exit() { },
+        fd_close() { },
+        fd_write() { },
+        fd_seek() { },
+        fd_read() { },
+        environ_sizes_get() { },
+        environ_get() { }
+    }
+};
+
+/**
+ * @param {string|URL} url The URL of the `.wasm` file.
+ * @returns {Promise<UlightWasm>} The instantiated and initialized module.
+ */
+async function instantiateModule(url) {
+    const wasm = await WebAssembly.instantiateStreaming(fetch(url), wasmImportObject);
+    const result = new UlightWasm(wasm);
     await result.init();
     return result;
 }
 
 /**
- * @param {string} uri 
- * @returns {Promise<Uint8Array<ArrayBufferLike>>}
+ * Loads the WebAssembly module.
+ *
+ * If `split` is `true`, the small `ulight-core.wasm` is loaded,
+ * and the modules for individual languages are only fetched when `UlightWasm.ensureLanguage`
+ * is called, which needs to be awaited before highlighting.
+ * Since these modules are only built optionally (`-DULIGHT_WASM_SPLIT=ON`),
+ * the module that contains every language is loaded instead if the core cannot be fetched.
+ *
+ * Otherwise, if `simd` is `true` (the default) and the runtime supports SIMD128,
+ * `ulight-simd.wasm` is loaded.
+ * Since that module is only built optionally (`-DULIGHT_WASM_SIMD=ON`),
+ * `ulight.wasm` is loaded instead if it cannot be fetched, or if SIMD128 is unsupported.
+ *
+ * The `.wasm` files are fetched relative to `base`, which defaults to the URL of the document.
+ * Workers need to provide it because they resolve URLs relative to the worker script.
+ * @param {{simd?:boolean;split?:boolean;base?:string|URL}} options
+ * @returns {Promise<UlightWasm>}
  */
-async function fetchBytes(uri) {
-    const response = await fetch(uri);
-    return await response.bytes();
+export async function loadWasm({ simd = true, split = false, base = undefined } = {}) {
+    const url = name => base === undefined ? name : new URL(name, base);
+    if (split) {
+        const response = await fetch(url("ulight-core.wasm"));
+        if (response.ok) {
+            const core = new UlightWasm(
+                await WebAssembly.instantiateStreaming(response, wasmImportObject));
+            await core.init();
+            core._enableSplit(name => instantiateModule(url(`ulight-${name}.wasm`)));
+            return core;
+        }
+    }
+    let resultWasm = null;
+    if (simd && isSimdSupported()) {
+        const response = await fetch(url("ulight-simd.wasm"));
+        if (response.ok) {
+            resultWasm = await WebAssembly.instantiateStreaming(response, wasmImportObject);
+        }
+    }
+    resultWasm ??= await WebAssembly.instantiateStreaming(
+        fetch(url("ulight.wasm")), wasmImportObject);
+    const result = new UlightWasm(resultWasm);
+    await result.init();
+    return result;
 }
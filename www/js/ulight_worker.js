@@ -0,0 +1,63 @@
+// The Web Worker used by UlightWorker (see ulight.js), which highlights code off the main thread.
+//
+// Messages from the main thread:
+//     { type: "init", cancelFlag: Int32Array|null, split: boolean }
+//         Loads ulight, and responds with { type: "ready", languages } or { type: "error" }.
+//         If cancelFlag is not null, it is a view of a SharedArrayBuffer,
+//         and highlighting stops early once its first element is nonzero.
+//     { type: "highlight", id, source, lang, flags, withHtmlSource }
+//         Highlights source, and responds with { type: "result", id, html, htmlSource },
+//         { type: "cancelled", id }, or { type: "error", id, message }.
+//         Both html and htmlSource (if requested) are built from the same tokens
+//         (see tokensToHtml), so the source is only highlighted once.
+
+import { loadWasm, statusCancelled, tokensToHtml } from "./ulight.js";
+
+/** @type {Promise<import("./ulight.js").UlightWasm>} */
+let wasmPromise = null;
+
+/**
+ * @param {{cancelFlag:Int32Array|null;split:boolean}} message
+ */
+async function init({ cancelFlag, split }) {
+    // The .wasm files are next to index.html, not next to this script.
+    wasmPromise = loadWasm({ split, base: new URL("../", import.meta.url) });
+    const wasm = await wasmPromise;
+    if (cancelFlag !== null) {
+        wasm.setCancellation(() => Atomics.load(cancelFlag, 0) !== 0);
+    }
+    return { type: "ready", languages: wasm.getLanguageList() };
+}
+
+/**
+ * @param {{id:number;source:string;lang:number;flags:number;withHtmlSource:boolean}} message
+ */
+async function highlight({ id, source, lang, flags, withHtmlSource }) {
+    const wasm = await wasmPromise;
+    await wasm.ensureLanguage(lang);
+    try {
+        const tokens = wasm.toTokens(source, lang, flags);
+        const getTypeName = type => wasm.getHighlightTypeName(type);
+        // getHighlightTypeName may allocate and grow WASM memory, which detaches tokens.
+        const records = tokens.slice();
+        const html = tokensToHtml(source, records, getTypeName);
+        const htmlSource = withHtmlSource
+            ? tokensToHtml(source, records, getTypeName, true)
+            : undefined;
+        return { type: "result", id, html, htmlSource };
+    } catch (e) {
+        if (e === statusCancelled) {
+            return { type: "cancelled", id };
+        }
+        throw e;
+    }
+}
+
+onmessage = async ({ data }) => {
+    try {
+        postMessage(data.type === "init" ? await init(data) : await highlight(data));
+    } catch (e) {
+        const message = typeof e === "number" ? `Highlighting failed with status ${e}.` : e.message;
+        postMessage({ type: "error", id: data.id, message });
+    }
+};